@@ -0,0 +1,659 @@
+/*
+ * -----------------------------------------------------------------------------
+ *
+ * gtm_bench utility
+ *
+ *  Measures the throughput and latency of GTM requests, sent to the GTM
+ *  directly or through one or more GTM proxies.
+ *
+ * Command syntax:
+ *
+ * gtm_bench [ options ]
+ *
+ * Options are:
+ * -h host[,host...]	Hosts of the GTM or GTM proxies.  Default is localhost.
+ * -p port[,port...]	Ports of the GTM or GTM proxies.  Default is 6666.
+ * -c clients			Number of clients, each one runs in its own thread
+ *						with its own connection.  Default is 1.
+ * -n transactions		Number of times each client runs the script.
+ *						Default is 10000.
+ * -T seconds			Run the script for that long instead.
+ * -m script			Comma-separated requests each client sends in turn,
+ *						among begin, getgxid, snapshot, nextval and commit,
+ *						each one optionally followed by :count.
+ *						Default is begin,snapshot,commit.
+ * -r range				Number of values nextval reserves at once.
+ *						Default is 1.
+ * -S					Use the shared memory transport of GTM proxies
+ *						running on this host.
+ * --help				Prints the help message and exits with 0.
+ *
+ * Clients are spread evenly over the hosts and ports given, so that several
+ * GTM proxies can be loaded at once.  When all of them are done, gtm_bench
+ * prints the number of scripts run per second, and for each kind of request
+ * how many were sent per second and the percentiles of their latency.
+ *
+ * --------------------------------------------------------------------------
+ */
+
+
+#include "gtm/gtm_client.h"
+#include "gtm/libpq-fe.h"
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+/* Requests a script is made of */
+typedef enum
+{
+	BENCH_BEGIN,
+	BENCH_GETGXID,
+	BENCH_SNAPSHOT,
+	BENCH_NEXTVAL,
+	BENCH_COMMIT,
+	BENCH_NREQUESTS
+} benchreq_t;
+
+static const char *benchreq_names[BENCH_NREQUESTS] = {
+	"begin",
+	"getgxid",
+	"snapshot",
+	"nextval",
+	"commit"
+};
+
+#define MAX_SCRIPT_STEPS	64
+#define MAX_TARGETS			64
+
+typedef struct BenchStep
+{
+	benchreq_t	req;
+	int			count;
+} BenchStep;
+
+/*
+ * Latencies are counted in nanoseconds into log-linear buckets: values below
+ * HIST_SUB have a bucket each, larger ones have HIST_SUB buckets per power of
+ * two, which keeps the error of the percentiles under 3%.
+ */
+#define HIST_SUB_BITS	5
+#define HIST_SUB		(1 << HIST_SUB_BITS)
+#define HIST_BUCKETS	((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct BenchStats
+{
+	uint64		count;
+	uint64		total_ns;
+	uint64		max_ns;
+	uint64		hist[HIST_BUCKETS];
+} BenchStats;
+
+typedef struct BenchClient
+{
+	int			id;
+	pthread_t	thread;
+	char	   *host;
+	char	   *port;
+	char		node_name[64];
+	uint64		nscripts;
+	BenchStats	stats[BENCH_NREQUESTS];
+} BenchClient;
+
+static char *progname;
+
+static char *hosts[MAX_TARGETS];
+static char *ports[MAX_TARGETS];
+static int	nhosts;
+static int	nports;
+
+static int	nclients = 1;
+static int	ntransactions = 10000;
+static int	duration = 0;
+static int	range = 1;
+static bool	shared_memory = false;
+
+static BenchStep script[MAX_SCRIPT_STEPS];
+static int	nsteps;
+static bool	script_nextval = false;
+
+static GTM_SequenceKeyData seqkey;
+
+/* All clients start at once, when they are all connected */
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static int	nconnected = 0;
+static bool	started = false;
+static uint64 end_ns = 0;
+
+#define Free(x) do{if((x)) free((x)); x = NULL;} while(0)
+
+static void usage(void);
+static int split_list(char *list, char **items, const char *what);
+static void parse_script(char *spec);
+static GTM_Conn *bench_connect(char *host, char *port, char *node_name);
+static void *client_main(void *arg);
+static uint64 now_ns(void);
+static int hist_index(uint64 ns);
+static uint64 hist_value(int index);
+static uint64 hist_percentile(BenchStats *stats, double fraction);
+static void print_results(BenchClient *clients, double elapsed);
+
+int
+main(int ac, char *av[])
+{
+	int			opt;
+	char	   *host = NULL;
+	char	   *port = NULL;
+	char	   *spec = NULL;
+	BenchClient *clients;
+	GTM_Conn   *conn = NULL;
+	uint64		start_ns;
+	uint64		stop_ns;
+	int			ii;
+
+	progname = strdup(av[0]);
+
+	/* Print help if necessary */
+	if (ac > 1)
+	{
+		if (strcmp(av[1], "--help") == 0 || strcmp(av[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+	}
+
+	/* Scan options */
+	while ((opt = getopt(ac, av, "h:p:c:n:T:m:r:S")) != -1)
+	{
+		switch(opt)
+		{
+			case 'h':
+				Free(host);
+				host = strdup(optarg);
+				break;
+			case 'p':
+				Free(port);
+				port = strdup(optarg);
+				break;
+			case 'c':
+				nclients = atoi(optarg);
+				break;
+			case 'n':
+				ntransactions = atoi(optarg);
+				break;
+			case 'T':
+				duration = atoi(optarg);
+				break;
+			case 'm':
+				Free(spec);
+				spec = strdup(optarg);
+				break;
+			case 'r':
+				range = atoi(optarg);
+				break;
+			case 'S':
+				shared_memory = true;
+				break;
+			default:
+				fprintf(stderr, "%s: unknow option %c.\n", progname, opt);
+				exit(3);
+		}
+	}
+
+	if (nclients <= 0 || ntransactions <= 0 || duration < 0 || range <= 0)
+	{
+		fprintf(stderr, "%s: -c, -n, -T and -r must be positive.\n", progname);
+		exit(3);
+	}
+
+	nhosts = split_list(host ? host : "localhost", hosts, "hosts");
+	nports = split_list(port ? port : "6666", ports, "ports");
+	if (nhosts > 1 && nports > 1 && nhosts != nports)
+	{
+		fprintf(stderr, "%s: -h and -p must list as many values when both list several.\n",
+				progname);
+		exit(3);
+	}
+	parse_script(spec ? spec : "begin,snapshot,commit");
+
+	/* nextval needs a sequence, create it before the clients start */
+	if (script_nextval)
+	{
+		seqkey.gsk_key = "gtm_bench.public.nextval";
+		seqkey.gsk_keylen = strlen(seqkey.gsk_key) + 1;
+		seqkey.gsk_type = GTM_SEQ_FULL_NAME;
+
+		conn = bench_connect(hosts[0], ports[0], "gtm_bench");
+		/* The sequence may be left over by a run that did not finish */
+		open_sequence(conn, &seqkey, 1, 1, InvalidSequenceValue - 1, 1, true);
+	}
+
+	clients = (BenchClient *) calloc(nclients, sizeof (BenchClient));
+	if (clients == NULL)
+	{
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(2);
+	}
+
+	for (ii = 0; ii < nclients; ii++)
+	{
+		BenchClient *client = &clients[ii];
+		int			target = ii % Max(nhosts, nports);
+
+		client->id = ii;
+		client->host = hosts[nhosts > 1 ? target : 0];
+		client->port = ports[nports > 1 ? target : 0];
+		snprintf(client->node_name, sizeof (client->node_name),
+				 "gtm_bench_%d", ii);
+		if (pthread_create(&client->thread, NULL, client_main, client) != 0)
+		{
+			fprintf(stderr, "%s: could not create thread: %s\n", progname,
+					strerror(errno));
+			exit(2);
+		}
+	}
+
+	/* Wait for all the clients to be connected, then let them go */
+	pthread_mutex_lock(&start_lock);
+	while (nconnected < nclients)
+		pthread_cond_wait(&start_cond, &start_lock);
+	start_ns = now_ns();
+	if (duration > 0)
+		end_ns = start_ns + (uint64) duration * 1000000000;
+	started = true;
+	pthread_cond_broadcast(&start_cond);
+	pthread_mutex_unlock(&start_lock);
+
+	for (ii = 0; ii < nclients; ii++)
+		pthread_join(clients[ii].thread, NULL);
+	stop_ns = now_ns();
+
+	if (conn != NULL)
+	{
+		close_sequence(conn, &seqkey);
+		GTMPQfinish(conn);
+	}
+
+	print_results(clients, (stop_ns - start_ns) / 1e9);
+	exit(0);
+}
+
+/*
+ * Split a comma-separated list in place
+ */
+static int
+split_list(char *list, char **items, const char *what)
+{
+	char	   *item;
+	char	   *save;
+	int			nitems = 0;
+
+	list = strdup(list);
+	for (item = strtok_r(list, ",", &save); item != NULL;
+		 item = strtok_r(NULL, ",", &save))
+	{
+		if (nitems == MAX_TARGETS)
+		{
+			fprintf(stderr, "%s: too many %s, at most %d are supported.\n",
+					progname, what, MAX_TARGETS);
+			exit(3);
+		}
+		items[nitems++] = item;
+	}
+	if (nitems == 0)
+	{
+		fprintf(stderr, "%s: no %s given.\n", progname, what);
+		exit(3);
+	}
+	return nitems;
+}
+
+/*
+ * Parse the script given with -m.  Requests on a transaction must come
+ * between its begin and its commit, and the script must commit what it
+ * begins.
+ */
+static void
+parse_script(char *spec)
+{
+	char	   *item;
+	char	   *save;
+	bool		in_txn = false;
+
+	spec = strdup(spec);
+	for (item = strtok_r(spec, ",", &save); item != NULL;
+		 item = strtok_r(NULL, ",", &save))
+	{
+		char	   *colon = strchr(item, ':');
+		BenchStep  *step;
+		int			req;
+
+		if (nsteps == MAX_SCRIPT_STEPS)
+		{
+			fprintf(stderr, "%s: script too long, at most %d steps are supported.\n",
+					progname, MAX_SCRIPT_STEPS);
+			exit(3);
+		}
+		step = &script[nsteps++];
+
+		step->count = 1;
+		if (colon != NULL)
+		{
+			*colon = '\0';
+			step->count = atoi(colon + 1);
+			if (step->count <= 0)
+			{
+				fprintf(stderr, "%s: invalid count for %s in script.\n",
+						progname, item);
+				exit(3);
+			}
+		}
+
+		for (req = 0; req < BENCH_NREQUESTS; req++)
+		{
+			if (strcmp(item, benchreq_names[req]) == 0)
+				break;
+		}
+		if (req == BENCH_NREQUESTS)
+		{
+			fprintf(stderr, "%s: unknown request %s in script.\n", progname, item);
+			exit(3);
+		}
+		step->req = (benchreq_t) req;
+
+		switch (step->req)
+		{
+			case BENCH_BEGIN:
+				if (in_txn || step->count > 1)
+				{
+					fprintf(stderr, "%s: begin must follow a commit in script.\n",
+							progname);
+					exit(3);
+				}
+				in_txn = true;
+				break;
+			case BENCH_SNAPSHOT:
+				if (!in_txn)
+				{
+					fprintf(stderr, "%s: snapshot must follow a begin in script.\n",
+							progname);
+					exit(3);
+				}
+				break;
+			case BENCH_COMMIT:
+				if (!in_txn || step->count > 1)
+				{
+					fprintf(stderr, "%s: commit must follow a begin in script.\n",
+							progname);
+					exit(3);
+				}
+				in_txn = false;
+				break;
+			case BENCH_NEXTVAL:
+				script_nextval = true;
+				break;
+			default:
+				break;
+		}
+	}
+
+	if (nsteps == 0)
+	{
+		fprintf(stderr, "%s: empty script.\n", progname);
+		exit(3);
+	}
+	if (in_txn)
+	{
+		fprintf(stderr, "%s: script does not commit what it begins.\n", progname);
+		exit(3);
+	}
+}
+
+static GTM_Conn *
+bench_connect(char *host, char *port, char *node_name)
+{
+	char		connect_str[256];
+	GTM_Conn   *conn;
+
+	snprintf(connect_str, sizeof (connect_str),
+			 "host=%s port=%s node_name=%s remote_type=%d postmaster=0 connect_timeout=60 shared_memory=%d",
+			 host, port, node_name, GTM_NODE_COORDINATOR, shared_memory);
+	conn = PQconnectGTM(connect_str);
+	if (conn == NULL)
+	{
+		fprintf(stderr, "%s: could not connect to %s:%s\n", progname,
+				host, port);
+		exit(1);
+	}
+	if (GTMPQstatus(conn) != CONNECTION_OK)
+	{
+		fprintf(stderr, "%s: could not connect to %s:%s: %s", progname,
+				host, port, GTMPQerrorMessage(conn));
+		exit(1);
+	}
+	return conn;
+}
+
+/*
+ * Run the script until the clients have run it -n times, or for -T seconds
+ */
+static void *
+client_main(void *arg)
+{
+	BenchClient *client = (BenchClient *) arg;
+	GTM_Conn   *conn;
+	GlobalTransactionId gxid = InvalidGlobalTransactionId;
+	GTM_Sequence value;
+	GTM_Sequence rangemax;
+
+	conn = bench_connect(client->host, client->port, client->node_name);
+
+	pthread_mutex_lock(&start_lock);
+	nconnected++;
+	pthread_cond_broadcast(&start_cond);
+	while (!started)
+		pthread_cond_wait(&start_cond, &start_lock);
+	pthread_mutex_unlock(&start_lock);
+
+	for (;;)
+	{
+		int			step;
+
+		if (duration > 0 ? now_ns() >= end_ns :
+			client->nscripts >= ntransactions)
+			break;
+
+		for (step = 0; step < nsteps; step++)
+		{
+			benchreq_t	req = script[step].req;
+			BenchStats *stats = &client->stats[req];
+			int			ii;
+
+			for (ii = 0; ii < script[step].count; ii++)
+			{
+				uint64		start = now_ns();
+				uint64		elapsed;
+				bool		ok = false;
+
+				switch (req)
+				{
+					case BENCH_BEGIN:
+						gxid = begin_transaction(conn, GTM_ISOLATION_RC, NULL, NULL);
+						ok = GlobalTransactionIdIsValid(gxid);
+						break;
+					case BENCH_GETGXID:
+						ok = GlobalTransactionIdIsValid(get_next_gxid(conn));
+						break;
+					case BENCH_SNAPSHOT:
+						ok = (get_snapshot(conn, gxid, true) != NULL);
+						break;
+					case BENCH_NEXTVAL:
+						ok = (get_next(conn, &seqkey, client->node_name,
+									   client->id + 1, range,
+									   &value, &rangemax) == 0);
+						break;
+					case BENCH_COMMIT:
+						ok = (commit_transaction(conn, gxid, 0, NULL) == 0);
+						gxid = InvalidGlobalTransactionId;
+						break;
+					default:
+						break;
+				}
+				elapsed = now_ns() - start;
+
+				if (!ok)
+				{
+					fprintf(stderr, "%s: %s failed on %s:%s: %s\n", progname,
+							benchreq_names[req], client->host, client->port,
+							GTMPQerrorMessage(conn));
+					exit(1);
+				}
+
+				stats->count++;
+				stats->total_ns += elapsed;
+				if (elapsed > stats->max_ns)
+					stats->max_ns = elapsed;
+				stats->hist[hist_index(elapsed)]++;
+			}
+		}
+		client->nscripts++;
+	}
+
+	GTMPQfinish(conn);
+	return NULL;
+}
+
+static uint64
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+hist_index(uint64 ns)
+{
+	int			bit = HIST_SUB_BITS;
+
+	if (ns < HIST_SUB)
+		return (int) ns;
+	while ((ns >> (bit + 1)) != 0)
+		bit++;
+	return (bit - HIST_SUB_BITS + 1) * HIST_SUB +
+		(int) ((ns >> (bit - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/*
+ * Middle of the range of values counted in a bucket
+ */
+static uint64
+hist_value(int index)
+{
+	int			bit;
+	uint64		width;
+
+	if (index < HIST_SUB)
+		return index;
+	bit = index / HIST_SUB + HIST_SUB_BITS - 1;
+	width = (uint64) 1 << (bit - HIST_SUB_BITS);
+	return (uint64) (HIST_SUB + index % HIST_SUB) * width + width / 2;
+}
+
+static uint64
+hist_percentile(BenchStats *stats, double fraction)
+{
+	uint64		rank = (uint64) (stats->count * fraction);
+	uint64		seen = 0;
+	int			ii;
+
+	for (ii = 0; ii < HIST_BUCKETS; ii++)
+	{
+		seen += stats->hist[ii];
+		if (seen > rank)
+			return Min(hist_value(ii), stats->max_ns);
+	}
+	return stats->max_ns;
+}
+
+static void
+print_results(BenchClient *clients, double elapsed)
+{
+	BenchStats *total;
+	uint64		nscripts = 0;
+	int			req;
+	int			ii;
+	int			jj;
+
+	total = (BenchStats *) calloc(BENCH_NREQUESTS, sizeof (BenchStats));
+	if (total == NULL)
+	{
+		fprintf(stderr, "%s: out of memory\n", progname);
+		exit(2);
+	}
+
+	for (ii = 0; ii < nclients; ii++)
+	{
+		nscripts += clients[ii].nscripts;
+		for (req = 0; req < BENCH_NREQUESTS; req++)
+		{
+			BenchStats *stats = &clients[ii].stats[req];
+
+			total[req].count += stats->count;
+			total[req].total_ns += stats->total_ns;
+			total[req].max_ns = Max(total[req].max_ns, stats->max_ns);
+			for (jj = 0; jj < HIST_BUCKETS; jj++)
+				total[req].hist[jj] += stats->hist[jj];
+		}
+	}
+
+	printf("clients: %d, targets: %d, shared memory: %s\n", nclients,
+		   Max(nhosts, nports), shared_memory ? "on" : "off");
+	printf("scripts run: " UINT64_FORMAT " in %.3f s, %.0f scripts/s\n",
+		   nscripts, elapsed, nscripts / elapsed);
+	printf("\n%-10s %12s %10s %10s %10s %10s %10s %10s\n", "request", "count",
+		   "ops/s", "avg(us)", "p50(us)", "p99(us)", "p999(us)", "max(us)");
+	for (req = 0; req < BENCH_NREQUESTS; req++)
+	{
+		BenchStats *stats = &total[req];
+
+		if (stats->count == 0)
+			continue;
+		printf("%-10s %12" INT64_MODIFIER "u %10.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			   benchreq_names[req], stats->count, stats->count / elapsed,
+			   stats->total_ns / 1000.0 / stats->count,
+			   hist_percentile(stats, 0.50) / 1000.0,
+			   hist_percentile(stats, 0.99) / 1000.0,
+			   hist_percentile(stats, 0.999) / 1000.0,
+			   stats->max_ns / 1000.0);
+	}
+	free(total);
+}
+
+/*
+ * Show help information
+ */
+static void
+usage(void)
+{
+	printf("gtm_bench -h host[,host...] -p port[,port...] [ options ]\n\n");
+	printf("Options are:\n");
+	printf("    -h host[,host...]   Hosts of the GTM or GTM proxies. Default is localhost.\n");
+	printf("    -p port[,port...]   Ports of the GTM or GTM proxies. Default is 6666.\n");
+	printf("                        Clients are spread evenly over them.\n");
+	printf("    -c clients          Number of clients. Default is 1.\n");
+	printf("    -n transactions     Number of times each client runs the script.\n");
+	printf("                        Default is 10000.\n");
+	printf("    -T seconds          Run the script for that long instead.\n");
+	printf("    -m script           Comma-separated requests each client sends in turn,\n");
+	printf("                        among begin, getgxid, snapshot, nextval and commit,\n");
+	printf("                        each one optionally followed by :count.\n");
+	printf("                        Default is begin,snapshot,commit.\n");
+	printf("    -r range            Number of values nextval reserves at once. Default is 1.\n");
+	printf("    -S                  Use the shared memory transport of local GTM proxies.\n");
+	printf("    --help              Prints the help message and exits with 0.\n");
+}
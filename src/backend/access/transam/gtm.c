@@ -15,7 +15,11 @@
 #include "gtm/libpq-fe.h"
 #include "gtm/gtm_client.h"
 #include "access/gtm.h"
+#include "access/htup_details.h"
 #include "access/transam.h"
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "utils/builtins.h"
 #include "utils/elog.h"
 #include "miscadmin.h"
 #include "pgxc/pgxc.h"
@@ -34,6 +38,7 @@
 /* Configuration variables */
 char *GtmHost = "localhost";
 int GtmPort = 6666;
+bool GtmSharedMemory = false;
 static int GtmConnectTimeout = 60;
 bool IsXidFromGTM = false;
 bool gtm_backup_barrier = false;
@@ -91,8 +96,9 @@ InitGTM(void)
 	else
 	{
 		/* Use 60s as connection timeout */
-		sprintf(conn_str, "host=%s port=%d node_name=%s connect_timeout=%d",
-				GtmHost, GtmPort, PGXCNodeName, GtmConnectTimeout);
+		sprintf(conn_str, "host=%s port=%d node_name=%s connect_timeout=%d shared_memory=%d",
+				GtmHost, GtmPort, PGXCNodeName, GtmConnectTimeout,
+				GtmSharedMemory ? 1 : 0);
 
 		/* Log activity of GTM connections */
 		if (IsAutoVacuumWorkerProcess())
@@ -711,3 +717,105 @@ ReportGlobalXmin(GlobalTransactionId gxid, GlobalTransactionId *global_xmin,
 	else
 		return 0;
 }
+
+/*
+ * Fetch the latency histograms of GTM.  The entries are malloc'd.
+ */
+int
+GetStatsGTM(GTM_StatEntry **entries)
+{
+	CheckConnection();
+	if (!conn)
+		return -1;
+
+	return get_gtm_stats(conn, entries);
+}
+
+/*
+ * pgxc_gtm_stats
+ *		Latency histograms of GTM, in microseconds
+ */
+Datum
+pgxc_gtm_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	GTM_StatEntry *entries;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc	tupdesc;
+		GTM_StatEntry *result;
+		int			count;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(8, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "kind",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "name",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "count",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "avg_us",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "p50_us",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "p99_us",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "p999_us",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 8, "max_us",
+						   INT8OID, -1, 0);
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+		count = GetStatsGTM(&result);
+		if (count < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("could not get statistics from GTM")));
+
+		/* Keep a copy in the function context, the result is malloc'd */
+		entries = (GTM_StatEntry *) palloc(sizeof (GTM_StatEntry) * count);
+		memcpy(entries, result, sizeof (GTM_StatEntry) * count);
+		free(result);
+
+		funcctx->user_fctx = entries;
+		funcctx->max_calls = count;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	entries = (GTM_StatEntry *) funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		GTM_StatEntry *entry = &entries[funcctx->call_cntr];
+		GTM_StatHist *hist = &entry->se_hist;
+		Datum		values[8];
+		bool		nulls[8];
+		HeapTuple	tuple;
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = CStringGetTextDatum(GTM_StatKindName(entry->se_kind));
+		values[1] = CStringGetTextDatum(entry->se_name);
+		values[2] = Int64GetDatum((int64) hist->sh_count);
+		if (hist->sh_count > 0)
+			values[3] = Float8GetDatum((double) hist->sh_total_us /
+									   hist->sh_count);
+		else
+			nulls[3] = true;
+		values[4] = Int64GetDatum((int64) GTM_StatHistPercentile(hist, 0.5));
+		values[5] = Int64GetDatum((int64) GTM_StatHistPercentile(hist, 0.99));
+		values[6] = Int64GetDatum((int64) GTM_StatHistPercentile(hist, 0.999));
+		values[7] = Int64GetDatum((int64) hist->sh_max_us);
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
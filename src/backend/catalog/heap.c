@@ -58,6 +58,7 @@
 #include "commands/typecmds.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "optimizer/var.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_collate.h"
@@ -75,6 +76,7 @@
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/tqual.h"
+#include "utils/typcache.h"
 
 #ifdef PGXC
 #include "catalog/pgxc_class.h"
@@ -997,9 +999,14 @@ AddRelationDistribution(Oid relid,
 	int hashalgorithm 	= 0;
 	int hashbuckets 	= 0;
 	AttrNumber attnum 	= 0;
+	List   *attnums		= NIL;
 	ObjectAddress myself, referenced;
 	int	numnodes;
 	Oid	*nodeoids;
+	int16  *keyattnums;
+	int		numkeyattnums = 0;
+	ArrayType *values = NULL;
+	ListCell *lc;
 
 	/* Obtain details of distribution information */
 	GetRelationDistributionItems(relid,
@@ -1008,14 +1015,28 @@ AddRelationDistribution(Oid relid,
 								 &locatortype,
 								 &hashalgorithm,
 								 &hashbuckets,
-								 &attnum);
+								 &attnum,
+								 &attnums);
 
-	/* Obtain details of nodes and classify them */
-	nodeoids = GetRelationDistributionNodes(subcluster, &numnodes);
+	/*
+	 * Obtain details of nodes and classify them.  The nodes of a RANGE or
+	 * LIST distribution are the ones given with their values.
+	 */
+	if (IsLocatorBoundDistributed(locatortype))
+		values = GetRelationDistributionValues(distributeby, subcluster,
+											   descriptor, attnum,
+											   &nodeoids, &numnodes);
+	else
+		nodeoids = GetRelationDistributionNodes(subcluster, &numnodes);
+
+	keyattnums = (int16 *) palloc((list_length(attnums) + 1) * sizeof(int16));
+	foreach(lc, attnums)
+		keyattnums[numkeyattnums++] = (int16) lfirst_int(lc);
 
 	/* Now OK to insert data in catalog */
 	PgxcClassCreate(relid, locatortype, attnum, hashalgorithm,
-					hashbuckets, numnodes, nodeoids);
+					hashbuckets, numnodes, nodeoids,
+					numkeyattnums, keyattnums, values);
 
 	/* Make dependency entries */
 	myself.classId = PgxcClassRelationId;
@@ -1034,6 +1055,9 @@ AddRelationDistribution(Oid relid,
  * Obtain distribution type and related items based on deparsed information
  * of clause DISTRIBUTE BY.
  * Depending on the column types given a fallback to a safe distribution can be done.
+ * attnum is set to the first distribution column and attnums to the list of
+ * all of them, which has more than one member if the table is distributed
+ * by a hash of several columns.
  */
 void
 GetRelationDistributionItems(Oid relid,
@@ -1042,12 +1066,14 @@ GetRelationDistributionItems(Oid relid,
 							 char *locatortype,
 							 int *hashalgorithm,
 							 int *hashbuckets,
-							 AttrNumber *attnum)
+							 AttrNumber *attnum,
+							 List **attnums)
 {
 	int local_hashalgorithm = 0;
 	int local_hashbuckets = 0;
 	char local_locatortype = '\0';
 	AttrNumber local_attnum = 0;
+	List *local_attnums = NIL;
 
 	if (!distributeby)
 	{
@@ -1068,6 +1094,7 @@ GetRelationDistributionItems(Oid relid,
 			{
 				/* distribute on this column */
 				local_attnum = i + 1;
+				local_attnums = list_make1_int(local_attnum);
 				break;
 			}
 		}
@@ -1084,8 +1111,54 @@ GetRelationDistributionItems(Oid relid,
 		switch (distributeby->disttype)
 		{
 			case DISTTYPE_HASH:
+			{
+				List	   *colnames = distributeby->colnames;
+				ListCell   *lc;
+
+				if (colnames == NIL)
+					colnames = list_make1(makeString(distributeby->colname));
+
+				/*
+				 * Validate user-specified hash columns.
+				 * System columns cannot be used.
+				 */
+				foreach(lc, colnames)
+				{
+					char	   *colname = strVal(lfirst(lc));
+					AttrNumber	keyattnum = get_attnum(relid, colname);
+
+					if (keyattnum <= 0 && keyattnum >= -(int) lengthof(SysAtt))
+					{
+						ereport(ERROR,
+							(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+							 errmsg("Invalid distribution column specified")));
+					}
+
+					if (!IsTypeHashDistributable(descriptor->attrs[keyattnum - 1]->atttypid))
+					{
+						ereport(ERROR,
+							(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+							 errmsg("Column %s is not a hash distributable data type",
+								colname)));
+					}
+
+					if (list_member_int(local_attnums, keyattnum))
+					{
+						ereport(ERROR,
+							(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+							 errmsg("Column %s appears twice in distribution key",
+								colname)));
+					}
+					local_attnums = lappend_int(local_attnums, keyattnum);
+				}
+				local_attnum = linitial_int(local_attnums);
+				local_locatortype = LOCATOR_TYPE_HASH;
+				break;
+			}
+
+			case DISTTYPE_MODULO:
 				/*
-				 * Validate user-specified hash column.
+				 * Validate user specified modulo column.
 				 * System columns cannot be used.
 				 */
 				local_attnum = get_attnum(relid, distributeby->colname);
@@ -1096,20 +1169,22 @@ GetRelationDistributionItems(Oid relid,
 						 errmsg("Invalid distribution column specified")));
 				}
 
-				if (!IsTypeHashDistributable(descriptor->attrs[local_attnum - 1]->atttypid))
+				if (!IsTypeModuloDistributable(descriptor->attrs[local_attnum - 1]->atttypid))
 				{
 					ereport(ERROR,
 						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-						 errmsg("Column %s is not a hash distributable data type",
+						 errmsg("Column %s is not modulo distributable data type",
 							distributeby->colname)));
 				}
-				local_locatortype = LOCATOR_TYPE_HASH;
+				local_attnums = list_make1_int(local_attnum);
+				local_locatortype = LOCATOR_TYPE_MODULO;
 				break;
 
-			case DISTTYPE_MODULO:
+			case DISTTYPE_RANGE:
+			case DISTTYPE_LIST:
 				/*
-				 * Validate user specified modulo column.
-				 * System columns cannot be used.
+				 * Validate user specified range or list column, its values
+				 * are compared with the bounds or values of the nodes.
 				 */
 				local_attnum = get_attnum(relid, distributeby->colname);
 				if (local_attnum <= 0 && local_attnum >= -(int) lengthof(SysAtt))
@@ -1119,14 +1194,16 @@ GetRelationDistributionItems(Oid relid,
 						 errmsg("Invalid distribution column specified")));
 				}
 
-				if (!IsTypeModuloDistributable(descriptor->attrs[local_attnum - 1]->atttypid))
+				if (!IsTypeBoundDistributable(descriptor->attrs[local_attnum - 1]->atttypid))
 				{
 					ereport(ERROR,
 						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-						 errmsg("Column %s is not modulo distributable data type",
+						 errmsg("Column %s is not a range or list distributable data type",
 							distributeby->colname)));
 				}
-				local_locatortype = LOCATOR_TYPE_MODULO;
+				local_attnums = list_make1_int(local_attnum);
+				local_locatortype = distributeby->disttype == DISTTYPE_RANGE ?
+					LOCATOR_TYPE_RANGE : LOCATOR_TYPE_LIST;
 				break;
 
 			case DISTTYPE_REPLICATION:
@@ -1154,6 +1231,8 @@ GetRelationDistributionItems(Oid relid,
 	/* Save results */
 	if (attnum)
 		*attnum = local_attnum;
+	if (attnums)
+		*attnums = local_attnums;
 	if (hashalgorithm)
 		*hashalgorithm = local_hashalgorithm;
 	if (hashbuckets)
@@ -1298,6 +1377,247 @@ GetRelationDistributionNodes(PGXCSubCluster *subcluster, int *numnodes)
 	return SortRelationDistributionNodes(nodes, *numnodes);
 }
 
+/*
+ * Transform a value given in the VALUES of a RANGE or LIST distribution into
+ * a Const of the type of the distribution column.
+ */
+static Const *
+transformDistributionValue(ParseState *pstate, Node *value,
+						   Form_pg_attribute attr)
+{
+	Node	   *expr;
+
+	expr = transformExpr(pstate, value, EXPR_KIND_OTHER);
+	expr = coerce_to_target_type(pstate, expr, exprType(expr),
+								 attr->atttypid, attr->atttypmod,
+								 COERCION_ASSIGNMENT,
+								 COERCE_IMPLICIT_CAST,
+								 -1);
+	if (expr == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("distribution value is not of the type %s of column \"%s\"",
+						format_type_be(attr->atttypid),
+						NameStr(attr->attname)),
+				 parser_errposition(pstate, exprLocation(value))));
+	assign_expr_collations(pstate, expr);
+	expr = eval_const_expressions(NULL, expr);
+	if (!IsA(expr, Const))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("distribution values must be constants"),
+				 parser_errposition(pstate, exprLocation(value))));
+
+	return (Const *) expr;
+}
+
+/* Comparison of the values of a RANGE or LIST distribution */
+typedef struct DistributionValueCmp
+{
+	FmgrInfo   *cmpfunc;
+	Oid			collation;
+} DistributionValueCmp;
+
+static int
+cmp_distribution_values(const void *p1, const void *p2, void *arg)
+{
+	DistributionValueCmp *cmp = (DistributionValueCmp *) arg;
+
+	return DatumGetInt32(FunctionCall2Coll(cmp->cmpfunc, cmp->collation,
+										   *(Datum *) p1, *(Datum *) p2));
+}
+
+/*
+ * GetRelationDistributionValues
+ * Transform the VALUES of a RANGE or LIST distribution of column attnum into
+ * the text array stored in pgxc_class.  Its elements are aligned with the
+ * sorted array of the nodes of the table, returned in nodeoids: the text of
+ * the lower bound of the range of the node, NULL for the lowest range, or
+ * the text of the array of the values of the node.  If a subcluster is given
+ * too, it has to name the same nodes.
+ */
+ArrayType *
+GetRelationDistributionValues(DistributeBy *distributeby,
+							  PGXCSubCluster *subcluster,
+							  TupleDesc descriptor,
+							  AttrNumber attnum,
+							  Oid **nodeoids,
+							  int *numnodes)
+{
+	Form_pg_attribute attr = descriptor->attrs[attnum - 1];
+	bool		isrange = (distributeby->disttype == DISTTYPE_RANGE);
+	ParseState *pstate;
+	TypeCacheEntry *typentry;
+	DistributionValueCmp cmp;
+	Oid			typoutput;
+	bool		typisvarlena;
+	int16		typlen;
+	bool		typbyval;
+	char		typalign;
+	List	   *nodenames = NIL;
+	Datum	   *elems;
+	bool	   *elemnulls;
+	Datum	   *allvalues;
+	int			numvalues = 0;
+	int			numnulls = 0;
+	int			numlowest = 0;
+	int			i;
+	ListCell   *lc;
+	int			dims[1];
+	int			lbs[1];
+
+	foreach(lc, distributeby->values)
+		nodenames = lappend(nodenames,
+							makeString(((DefElem *) lfirst(lc))->defname));
+	*nodeoids = BuildRelationDistributionNodes(nodenames, numnodes);
+	if (*numnodes != list_length(nodenames))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("a Datanode can only be given once in VALUES")));
+	*nodeoids = SortRelationDistributionNodes(*nodeoids, *numnodes);
+
+	if (subcluster)
+	{
+		Oid		   *suboids;
+		int			numsub;
+
+		suboids = GetRelationDistributionNodes(subcluster, &numsub);
+		if (numsub != *numnodes ||
+			memcmp(suboids, *nodeoids, numsub * sizeof(Oid)) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+					 errmsg("the nodes of the table must be the nodes given in VALUES")));
+		pfree(suboids);
+	}
+
+	typentry = lookup_type_cache(getBaseType(attr->atttypid),
+								 TYPECACHE_CMP_PROC_FINFO);
+	cmp.cmpfunc = &typentry->cmp_proc_finfo;
+	cmp.collation = attr->attcollation;
+	getTypeOutputInfo(attr->atttypid, &typoutput, &typisvarlena);
+	get_typlenbyvalalign(attr->atttypid, &typlen, &typbyval, &typalign);
+
+	pstate = make_parsestate(NULL);
+	elems = (Datum *) palloc0(*numnodes * sizeof(Datum));
+	elemnulls = (bool *) palloc0(*numnodes * sizeof(bool));
+	allvalues = NULL;
+
+	foreach(lc, distributeby->values)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+		Oid			nodeoid = get_pgxc_nodeoid(def->defname);
+
+		/* Find the position of the node in the sorted array */
+		for (i = 0; i < *numnodes; i++)
+			if ((*nodeoids)[i] == nodeoid)
+				break;
+		Assert(i < *numnodes);
+
+		if (isrange)
+		{
+			Const	   *bound;
+
+			if (def->arg == NULL)
+			{
+				elemnulls[i] = true;
+				numlowest++;
+				continue;
+			}
+			if (IsA(def->arg, List))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("Datanode %s of a RANGE distribution takes FROM a lower bound",
+								def->defname)));
+			bound = transformDistributionValue(pstate, def->arg, attr);
+			if (bound->constisnull)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+						 errmsg("the lower bound of a range cannot be NULL")));
+			elems[i] = CStringGetTextDatum(OidOutputFunctionCall(typoutput,
+														bound->constvalue));
+			allvalues = allvalues ?
+				repalloc(allvalues, (numvalues + 1) * sizeof(Datum)) :
+				palloc(sizeof(Datum));
+			allvalues[numvalues++] = bound->constvalue;
+		}
+		else
+		{
+			List	   *exprs = (List *) def->arg;
+			int			nitems = list_length(exprs);
+			Datum	   *items;
+			bool	   *itemnulls;
+			ListCell   *lc2;
+			int			j = 0;
+
+			if (def->arg == NULL || !IsA(def->arg, List))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("Datanode %s of a LIST distribution takes IN a list of values",
+								def->defname)));
+
+			items = (Datum *) palloc(nitems * sizeof(Datum));
+			itemnulls = (bool *) palloc(nitems * sizeof(bool));
+			allvalues = allvalues ?
+				repalloc(allvalues, (numvalues + nitems) * sizeof(Datum)) :
+				palloc(nitems * sizeof(Datum));
+			foreach(lc2, exprs)
+			{
+				Const	   *value = transformDistributionValue(pstate,
+															   lfirst(lc2),
+															   attr);
+
+				items[j] = value->constvalue;
+				itemnulls[j] = value->constisnull;
+				if (value->constisnull)
+					numnulls++;
+				else
+					allvalues[numvalues++] = value->constvalue;
+				j++;
+			}
+			dims[0] = nitems;
+			lbs[0] = 1;
+			elems[i] = DirectFunctionCall1(array_out,
+						PointerGetDatum(construct_md_array(items, itemnulls,
+														   1, dims, lbs,
+														   getBaseType(attr->atttypid),
+														   typlen, typbyval,
+														   typalign)));
+			elems[i] = CStringGetTextDatum(DatumGetCString(elems[i]));
+		}
+	}
+
+	if (isrange && numlowest != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("exactly one Datanode of a RANGE distribution must be given without FROM"),
+				 errhint("It stores the values below the lowest bound.")));
+	if (numnulls > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("NULL can only be listed once in VALUES")));
+
+	/* A value can only be stored on one node */
+	if (numvalues > 1)
+	{
+		qsort_arg(allvalues, numvalues, sizeof(Datum),
+				  cmp_distribution_values, &cmp);
+		for (i = 1; i < numvalues; i++)
+			if (cmp_distribution_values(&allvalues[i - 1], &allvalues[i],
+										&cmp) == 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+						 errmsg("value %s is given twice in VALUES",
+								OidOutputFunctionCall(typoutput,
+													  allvalues[i]))));
+	}
+	free_parsestate(pstate);
+
+	dims[0] = *numnodes;
+	lbs[0] = 1;
+	return construct_md_array(elems, elemnulls, 1, dims, lbs,
+							  TEXTOID, -1, false, 'i');
+}
+
 /*
  * SortRelationDistributionNodes
  * Sort elements in a node array.
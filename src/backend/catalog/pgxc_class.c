@@ -19,6 +19,7 @@
 #include "catalog/pg_type.h"
 #include "catalog/pgxc_class.h"
 #include "utils/builtins.h"
+#include "utils/inval.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
 #include "pgxc/locator.h"
@@ -35,7 +36,10 @@ PgxcClassCreate(Oid pcrelid,
 				int pchashalgorithm,
 				int pchashbuckets,
 				int numnodes,
-				Oid *nodes)
+				Oid *nodes,
+				int numattnums,
+				int16 *attnums,
+				ArrayType *pcvalues)
 {
 	Relation	pgxcclassrel;
 	HeapTuple	htup;
@@ -43,9 +47,12 @@ PgxcClassCreate(Oid pcrelid,
 	Datum		values[Natts_pgxc_class];
 	int		i;
 	oidvector	*nodes_array;
+	int2vector	*attnums_array;
 
 	/* Build array of Oids to be inserted */
 	nodes_array = buildoidvector(nodes, numnodes);
+	/* Build array of distribution columns */
+	attnums_array = buildint2vector(attnums, numattnums);
 
 	/* Iterate through attributes initializing nulls and values */
 	for (i = 0; i < Natts_pgxc_class; i++)
@@ -64,7 +71,7 @@ PgxcClassCreate(Oid pcrelid,
 	values[Anum_pgxc_class_pcrelid - 1]   = ObjectIdGetDatum(pcrelid);
 	values[Anum_pgxc_class_pclocatortype - 1] = CharGetDatum(pclocatortype);
 
-	if (pclocatortype == LOCATOR_TYPE_HASH || pclocatortype == LOCATOR_TYPE_MODULO)
+	if (IsLocatorDistributedByValue(pclocatortype))
 	{
 		values[Anum_pgxc_class_pcattnum - 1] = UInt16GetDatum(pcattnum);
 		values[Anum_pgxc_class_pchashalgorithm - 1] = UInt16GetDatum(pchashalgorithm);
@@ -74,6 +81,21 @@ PgxcClassCreate(Oid pcrelid,
 	/* Node information */
 	values[Anum_pgxc_class_nodes - 1] = PointerGetDatum(nodes_array);
 
+	/* Distribution columns */
+	values[Anum_pgxc_class_pcattnums - 1] = PointerGetDatum(attnums_array);
+
+	/* Bounds or values of the nodes of a RANGE or LIST distribution */
+	if (pcvalues)
+		values[Anum_pgxc_class_pcvalues - 1] = PointerGetDatum(pcvalues);
+	else
+		nulls[Anum_pgxc_class_pcvalues - 1] = true;
+
+	/* No statistics until the table is analyzed */
+	nulls[Anum_pgxc_class_pcnodetuples - 1] = true;
+	nulls[Anum_pgxc_class_pchotvalues - 1] = true;
+	nulls[Anum_pgxc_class_pchotfreqs - 1] = true;
+	nulls[Anum_pgxc_class_pchotnodes - 1] = true;
+
 	/* Open the relation for insertion */
 	pgxcclassrel = heap_open(PgxcClassRelationId, RowExclusiveLock);
 
@@ -99,11 +121,15 @@ PgxcClassAlter(Oid pcrelid,
 			   int pchashbuckets,
 			   int numnodes,
 			   Oid *nodes,
+			   int numattnums,
+			   int16 *attnums,
+			   ArrayType *pcvalues,
 			   PgxcClassAlterType type)
 {
 	Relation	rel;
 	HeapTuple	oldtup, newtup;
 	oidvector  *nodes_array;
+	int2vector *attnums_array;
 	Datum		new_record[Natts_pgxc_class];
 	bool		new_record_nulls[Natts_pgxc_class];
 	bool		new_record_repl[Natts_pgxc_class];
@@ -119,6 +145,8 @@ PgxcClassAlter(Oid pcrelid,
 
 	/* Build array of Oids to be inserted */
 	nodes_array = buildoidvector(nodes, numnodes);
+	/* Build array of distribution columns */
+	attnums_array = buildint2vector(attnums, numattnums);
 
 	/* Initialize fields */
 	MemSet(new_record, 0, sizeof(new_record));
@@ -133,6 +161,8 @@ PgxcClassAlter(Oid pcrelid,
 			new_record_repl[Anum_pgxc_class_pcattnum - 1] = true;
 			new_record_repl[Anum_pgxc_class_pchashalgorithm - 1] = true;
 			new_record_repl[Anum_pgxc_class_pchashbuckets - 1] = true;
+			new_record_repl[Anum_pgxc_class_pcattnums - 1] = true;
+			new_record_repl[Anum_pgxc_class_pcvalues - 1] = true;
 			break;
 		case PGXC_CLASS_ALTER_NODES:
 			new_record_repl[Anum_pgxc_class_nodes - 1] = true;
@@ -145,6 +175,8 @@ PgxcClassAlter(Oid pcrelid,
 			new_record_repl[Anum_pgxc_class_pchashalgorithm - 1] = true;
 			new_record_repl[Anum_pgxc_class_pchashbuckets - 1] = true;
 			new_record_repl[Anum_pgxc_class_nodes - 1] = true;
+			new_record_repl[Anum_pgxc_class_pcattnums - 1] = true;
+			new_record_repl[Anum_pgxc_class_pcvalues - 1] = true;
 	}
 
 	/* Set up new fields */
@@ -172,6 +204,32 @@ PgxcClassAlter(Oid pcrelid,
 	if (new_record_repl[Anum_pgxc_class_nodes - 1])
 		new_record[Anum_pgxc_class_nodes - 1] = PointerGetDatum(nodes_array);
 
+	/* Attribute numbers of distribution columns */
+	if (new_record_repl[Anum_pgxc_class_pcattnums - 1])
+		new_record[Anum_pgxc_class_pcattnums - 1] = PointerGetDatum(attnums_array);
+
+	/* Bounds or values of the nodes of a RANGE or LIST distribution */
+	if (new_record_repl[Anum_pgxc_class_pcvalues - 1])
+	{
+		if (pcvalues)
+			new_record[Anum_pgxc_class_pcvalues - 1] = PointerGetDatum(pcvalues);
+		else
+			new_record_nulls[Anum_pgxc_class_pcvalues - 1] = true;
+	}
+
+	/*
+	 * Statistics are collected per node and per distribution key value, they
+	 * are obsolete once either changes.  Let the next ANALYZE rebuild them.
+	 */
+	new_record_repl[Anum_pgxc_class_pcnodetuples - 1] = true;
+	new_record_nulls[Anum_pgxc_class_pcnodetuples - 1] = true;
+	new_record_repl[Anum_pgxc_class_pchotvalues - 1] = true;
+	new_record_nulls[Anum_pgxc_class_pchotvalues - 1] = true;
+	new_record_repl[Anum_pgxc_class_pchotfreqs - 1] = true;
+	new_record_nulls[Anum_pgxc_class_pchotfreqs - 1] = true;
+	new_record_repl[Anum_pgxc_class_pchotnodes - 1] = true;
+	new_record_nulls[Anum_pgxc_class_pchotnodes - 1] = true;
+
 	/* Update relation */
 	newtup = heap_modify_tuple(oldtup, RelationGetDescr(rel),
 							   new_record,
@@ -182,6 +240,96 @@ PgxcClassAlter(Oid pcrelid,
 	heap_close(rel, RowExclusiveLock);
 }
 
+/*
+ * PgxcClassUpdateStats
+ *		Store the statistics of the distribution of a table collected by
+ *		ANALYZE: the rows of each of its nodes, aligned with nodeoids, and
+ *		its most common distribution key values with the fraction of all the
+ *		rows they have and the index of their node in nodeoids.  Pass
+ *		numnodes or numhot 0 to clear them.
+ */
+void
+PgxcClassUpdateStats(Oid pcrelid,
+					 int numnodes,
+					 float4 *nodetuples,
+					 int numhot,
+					 Datum *hotvalues,
+					 float4 *hotfreqs,
+					 int16 *hotnodes)
+{
+	Relation	rel;
+	HeapTuple	oldtup, newtup;
+	Datum		new_record[Natts_pgxc_class];
+	bool		new_record_nulls[Natts_pgxc_class];
+	bool		new_record_repl[Natts_pgxc_class];
+	Datum	   *datums;
+	int			i;
+
+	Assert(OidIsValid(pcrelid));
+
+	rel = heap_open(PgxcClassRelationId, RowExclusiveLock);
+	oldtup = SearchSysCacheCopy1(PGXCCLASSRELID,
+								 ObjectIdGetDatum(pcrelid));
+
+	if (!HeapTupleIsValid(oldtup)) /* should not happen */
+		elog(ERROR, "cache lookup failed for pgxc_class %u", pcrelid);
+
+	MemSet(new_record, 0, sizeof(new_record));
+	MemSet(new_record_nulls, true, sizeof(new_record_nulls));
+	MemSet(new_record_repl, false, sizeof(new_record_repl));
+
+	new_record_repl[Anum_pgxc_class_pcnodetuples - 1] = true;
+	new_record_repl[Anum_pgxc_class_pchotvalues - 1] = true;
+	new_record_repl[Anum_pgxc_class_pchotfreqs - 1] = true;
+	new_record_repl[Anum_pgxc_class_pchotnodes - 1] = true;
+
+	if (numnodes > 0)
+	{
+		datums = (Datum *) palloc(numnodes * sizeof(Datum));
+		for (i = 0; i < numnodes; i++)
+			datums[i] = Float4GetDatum(nodetuples[i]);
+		new_record[Anum_pgxc_class_pcnodetuples - 1] = PointerGetDatum(
+				construct_array(datums, numnodes, FLOAT4OID, sizeof(float4),
+								FLOAT4PASSBYVAL, 'i'));
+		new_record_nulls[Anum_pgxc_class_pcnodetuples - 1] = false;
+		pfree(datums);
+	}
+
+	if (numhot > 0)
+	{
+		new_record[Anum_pgxc_class_pchotvalues - 1] = PointerGetDatum(
+				construct_array(hotvalues, numhot, TEXTOID, -1, false, 'i'));
+		new_record_nulls[Anum_pgxc_class_pchotvalues - 1] = false;
+
+		datums = (Datum *) palloc(numhot * sizeof(Datum));
+		for (i = 0; i < numhot; i++)
+			datums[i] = Float4GetDatum(hotfreqs[i]);
+		new_record[Anum_pgxc_class_pchotfreqs - 1] = PointerGetDatum(
+				construct_array(datums, numhot, FLOAT4OID, sizeof(float4),
+								FLOAT4PASSBYVAL, 'i'));
+		new_record_nulls[Anum_pgxc_class_pchotfreqs - 1] = false;
+
+		for (i = 0; i < numhot; i++)
+			datums[i] = Int16GetDatum(hotnodes[i]);
+		new_record[Anum_pgxc_class_pchotnodes - 1] = PointerGetDatum(
+				construct_array(datums, numhot, INT2OID, sizeof(int16), true,
+								's'));
+		new_record_nulls[Anum_pgxc_class_pchotnodes - 1] = false;
+		pfree(datums);
+	}
+
+	newtup = heap_modify_tuple(oldtup, RelationGetDescr(rel),
+							   new_record,
+							   new_record_nulls, new_record_repl);
+	simple_heap_update(rel, &oldtup->t_self, newtup);
+	CatalogUpdateIndexes(rel, newtup);
+
+	heap_close(rel, RowExclusiveLock);
+
+	/* The planner reads the hottest key from the relation cache */
+	CacheInvalidateRelcacheByRelid(pcrelid);
+}
+
 /*
  * RemovePGXCClass():
  *		Remove extended PGXC information
@@ -215,6 +215,43 @@ CREATE VIEW pg_stats AS
 
 REVOKE ALL on pg_statistic FROM public;
 
+CREATE VIEW pgxc_stat_distribution AS
+    SELECT
+        c.oid AS relid,
+        n.nspname AS schemaname,
+        c.relname AS relname,
+        x.node_name AS nodename,
+        p.pcnodetuples[k + 1] AS n_tup,
+        p.pcnodetuples[k + 1] /
+            nullif((SELECT sum(v) FROM unnest(p.pcnodetuples) AS v), 0)
+            AS tup_frac,
+        ARRAY(SELECT p.pchotvalues[h]
+              FROM generate_subscripts(p.pchotvalues, 1) AS h
+              WHERE p.pchotnodes[h] = k ORDER BY h) AS most_common_vals,
+        ARRAY(SELECT p.pchotfreqs[h]
+              FROM generate_subscripts(p.pchotfreqs, 1) AS h
+              WHERE p.pchotnodes[h] = k ORDER BY h) AS most_common_freqs
+    FROM pgxc_class p JOIN pg_class c ON (c.oid = p.pcrelid)
+         LEFT JOIN pg_namespace n ON (n.oid = c.relnamespace)
+         CROSS JOIN generate_series(0, array_upper(p.pcnodetuples, 1) - 1) AS k
+         JOIN pgxc_node x ON (x.oid = p.nodeoids[k])
+    WHERE has_table_privilege(c.oid, 'select');
+
+CREATE VIEW pgxc_stat_rebalance AS
+    SELECT
+            S.pid,
+            S.datid,
+            D.datname,
+            S.relid,
+            S.tables_total,
+            S.tables_done,
+            S.buckets_total,
+            S.buckets_moved,
+            S.rows_moved,
+            S.start_time
+    FROM pgxc_stat_get_rebalance() AS S
+         LEFT JOIN pg_database D ON (S.datid = D.oid);
+
 CREATE VIEW pg_locks AS
     SELECT * FROM pg_lock_status() AS L;
 
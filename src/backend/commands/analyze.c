@@ -63,10 +63,13 @@
 
 #ifdef XCP
 #include "catalog/pg_operator.h"
+#include "catalog/pgxc_class.h"
 #include "nodes/makefuncs.h"
 #include "pgxc/execRemote.h"
+#include "pgxc/locator.h"
 #include "pgxc/pgxc.h"
 #include "pgxc/planner.h"
+#include "utils/builtins.h"
 #include "utils/snapmgr.h"
 #endif
 
@@ -111,8 +114,17 @@ static Datum std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
 static Datum ind_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
 
 #ifdef XCP
+/*
+ * At most this many of the most common distribution key values of a table
+ * are kept in pgxc_class, the ones having at least this fraction of its rows
+ */
+#define DISTRIBUTION_HOT_KEYS		10
+#define DISTRIBUTION_HOT_KEY_FRAC	0.01
+
 static void analyze_rel_coordinator(Relation onerel, bool inh, int attr_cnt,
 						VacAttrStats **vacattrstats);
+static void analyze_distribution_coordinator(Relation onerel, char *nspname,
+						char *relname);
 #endif
 
 /*
@@ -3147,5 +3159,212 @@ analyze_rel_coordinator(Relation onerel, bool inh, int attr_cnt,
 		}
 	}
 	update_attstats(RelationGetRelid(onerel), inh, attr_cnt, vacattrstats);
+
+	/*
+	 * Each copy of a replicated table has all the rows, and the statistics
+	 * of the children are not those of the distribution of the table.
+	 */
+	if (!inh && !IsRelationReplicated(RelationGetLocInfo(onerel)))
+		analyze_distribution_coordinator(onerel, nspname, relname);
+}
+
+/*
+ * A distribution key value of a table, with the rows having it
+ */
+typedef struct HotKeyItem
+{
+	Datum		value;			/* text */
+	float4		rows;
+	int16		node;			/* index in nodeoids */
+} HotKeyItem;
+
+static int
+compare_hot_keys(const void *a, const void *b)
+{
+	float4		ra = ((const HotKeyItem *) a)->rows;
+	float4		rb = ((const HotKeyItem *) b)->rows;
+
+	return (ra < rb) ? 1 : (ra > rb) ? -1 : 0;
+}
+
+/*
+ * Collect the rows of each node of the table and its most common
+ * distribution key values, and store them in pgxc_class.
+ *
+ * Every row having a given distribution key value is on the same node, so
+ * the most common values of the key on a node are the most common values on
+ * the cluster, once their frequencies are weighted by the rows of the node.
+ * Keys of several columns have no statistics of their own, only the rows of
+ * the nodes are collected for them.
+ */
+static void
+analyze_distribution_coordinator(Relation onerel, char *nspname,
+								 char *relname)
+{
+	RelationLocInfo *locinfo = RelationGetLocInfo(onerel);
+	char	   *attname = NULL;
+	StringInfoData query;
+	EState	   *estate;
+	MemoryContext oldcontext;
+	RemoteQuery *step;
+	RemoteQueryState *node;
+	TupleTableSlot *result;
+	Oid		   *nodeoids;
+	int			numnodes;
+	float4	   *nodetuples;
+	float4		totaltuples = 0;
+	HotKeyItem *items = NULL;
+	int			nitems = 0;
+	Datum	   *hotvalues;
+	float4	   *hotfreqs;
+	int16	   *hotnodes;
+	int			numhot = 0;
+	int			i;
+
+	numnodes = get_pgxc_classnodes(RelationGetRelid(onerel), &nodeoids);
+	nodetuples = (float4 *) palloc0(numnodes * sizeof(float4));
+
+	if (IsRelationDistributedByValue(locinfo) &&
+			list_length(locinfo->partAttrNums) == 1)
+		attname = locinfo->partAttrName;
+
+	initStringInfo(&query);
+	appendStringInfoString(&query, "SELECT pgxc_node_str(), "
+								   "c.reltuples, "
+								   "s.most_common_vals::text::text[], "
+								   "s.most_common_freqs "
+								   "FROM pg_class c JOIN pg_namespace n "
+								   "ON c.relnamespace = n.oid "
+								   "LEFT JOIN pg_stats s "
+								   "ON s.schemaname = n.nspname "
+								   "AND s.tablename = c.relname "
+								   "AND NOT s.inherited ");
+	if (attname)
+		appendStringInfo(&query, "AND s.attname = %s ",
+						 quote_literal_cstr(attname));
+	else
+		appendStringInfoString(&query, "AND false ");
+	appendStringInfo(&query, "WHERE n.nspname = %s "
+							 "AND c.relname = %s",
+					 quote_literal_cstr(nspname), quote_literal_cstr(relname));
+
+	/* Build up RemoteQuery */
+	step = makeNode(RemoteQuery);
+	step->combine_type = COMBINE_TYPE_NONE;
+	step->exec_nodes = NULL;
+	step->sql_statement = query.data;
+	step->force_autocommit = true;
+	step->exec_type = EXEC_ON_DATANODES;
+
+	/* Add targetlist entries, of the types of the columns of the query */
+	step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+										 make_relation_tle(RelationRelationId,
+														   "pg_class",
+														   "relname"));
+	step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+										 make_relation_tle(RelationRelationId,
+														   "pg_class",
+														   "reltuples"));
+	step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+										 makeTargetEntry((Expr *) makeVar(1, 3,
+																		  TEXTARRAYOID,
+																		  -1,
+																		  InvalidOid,
+																		  0),
+														 3, NULL, false));
+	step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+										 make_relation_tle(StatisticRelationId,
+														   "pg_statistic",
+														   "stanumbers1"));
+
+	/* Execute query on the data nodes */
+	estate = CreateExecutorState();
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	/* See analyze_rel_coordinator */
+	PushActiveSnapshot(GetTransactionSnapshot());
+	estate->es_snapshot = GetActiveSnapshot();
+
+	node = ExecInitRemoteQuery(step, estate, 0);
+	MemoryContextSwitchTo(oldcontext);
+
+	result = ExecRemoteQuery(node);
+	PopActiveSnapshot();
+	while (result != NULL && !TupIsNull(result))
+	{
+		Datum		value;
+		bool		isnull;
+		Oid			nodeoid;
+		int16		nodeidx;
+		float4		reltuples;
+		Datum	   *values;
+		bool	   *nulls;
+		int			nvalues;
+		ArrayType  *freqs;
+		float4	   *numbers;
+
+		value = slot_getattr(result, 1, &isnull); /* node name */
+		nodeoid = get_pgxc_nodeoid(NameStr(*DatumGetName(value)));
+		for (nodeidx = 0; nodeidx < numnodes; nodeidx++)
+			if (nodeoids[nodeidx] == nodeoid)
+				break;
+		value = slot_getattr(result, 2, &isnull); /* reltuples */
+		if (nodeidx >= numnodes || isnull)
+			goto next;
+		reltuples = Max(DatumGetFloat4(value), 0);
+		nodetuples[nodeidx] = reltuples;
+		totaltuples += reltuples;
+
+		value = slot_getattr(result, 3, &isnull); /* most_common_vals */
+		if (isnull)
+			goto next;
+		deconstruct_array(DatumGetArrayTypeP(value), TEXTOID, -1, false, 'i',
+						  &values, &nulls, &nvalues);
+		value = slot_getattr(result, 4, &isnull); /* most_common_freqs */
+		if (isnull)
+			goto next;
+		freqs = DatumGetArrayTypeP(value);
+		if (ARR_NDIM(freqs) != 1 || ARR_HASNULL(freqs) ||
+				ARR_ELEMTYPE(freqs) != FLOAT4OID ||
+				ARR_DIMS(freqs)[0] != nvalues)
+			elog(ERROR, "most_common_freqs does not match most_common_vals");
+		numbers = (float4 *) ARR_DATA_PTR(freqs);
+
+		items = items ?
+			repalloc(items, (nitems + nvalues) * sizeof(HotKeyItem)) :
+			palloc(nvalues * sizeof(HotKeyItem));
+		for (i = 0; i < nvalues; i++)
+		{
+			if (nulls[i])
+				continue;
+			items[nitems].value = datumCopy(values[i], false, -1);
+			items[nitems].rows = numbers[i] * reltuples;
+			items[nitems++].node = nodeidx;
+		}
+
+next:
+		/* fetch next */
+		result = ExecRemoteQuery(node);
+	}
+	ExecEndRemoteQuery(node);
+
+	/* Keep the values having enough of all the rows, most common first */
+	if (nitems > 1)
+		qsort(items, nitems, sizeof(HotKeyItem), compare_hot_keys);
+	hotvalues = (Datum *) palloc(DISTRIBUTION_HOT_KEYS * sizeof(Datum));
+	hotfreqs = (float4 *) palloc(DISTRIBUTION_HOT_KEYS * sizeof(float4));
+	hotnodes = (int16 *) palloc(DISTRIBUTION_HOT_KEYS * sizeof(int16));
+	for (i = 0; i < nitems && numhot < DISTRIBUTION_HOT_KEYS; i++)
+	{
+		if (items[i].rows < totaltuples * DISTRIBUTION_HOT_KEY_FRAC)
+			break;
+		hotvalues[numhot] = items[i].value;
+		hotfreqs[numhot] = items[i].rows / totaltuples;
+		hotnodes[numhot++] = items[i].node;
+	}
+
+	PgxcClassUpdateStats(RelationGetRelid(onerel), numnodes, nodetuples,
+						 numhot, hotvalues, hotfreqs, hotnodes);
 }
 #endif
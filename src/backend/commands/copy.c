@@ -67,6 +67,7 @@
 #include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/portal.h"
@@ -242,6 +243,26 @@ typedef struct
 	uint64		processed;		/* # of tuples processed */
 } DR_copy;
 
+#ifdef PGXC
+/*
+ * Rows buffered by the Coordinator during COPY FROM, so that the Datanodes
+ * of a batch of rows are found at once when each row goes to a single one.
+ */
+#define MAX_REMOTE_BUFFERED_ROWS 64
+
+typedef struct RemoteCopyBatch
+{
+	int			count;			/* # of rows buffered */
+	int			firstLineNo;	/* line number of the first row buffered */
+	StringInfoData data;		/* data of the rows, one after the other */
+	int			ends[MAX_REMOTE_BUFFERED_ROWS];	/* end of each row in data */
+	Datum		values[MAX_REMOTE_BUFFERED_ROWS];	/* distribution values */
+	bool		nulls[MAX_REMOTE_BUFFERED_ROWS];
+	int			nodes[MAX_REMOTE_BUFFERED_ROWS];	/* node of each row */
+	MemoryContext context;		/* holds the values, reset once sent */
+} RemoteCopyBatch;
+#endif
+
 
 /*
  * These macros centralize code used to process line_buf and raw_buf buffers.
@@ -332,6 +353,10 @@ static void CopyFromInsertBatch(CopyState cstate, EState *estate,
 					BulkInsertState bistate,
 					int nBufferedTuples, HeapTuple *bufferedTuples,
 					int firstBufferedLineNo);
+#ifdef PGXC
+static void CopyFromRemoteBatch(CopyState cstate, RemoteCopyBatch *batch,
+					Locator *locator);
+#endif
 static bool CopyReadLine(CopyState cstate);
 static bool CopyReadLineText(CopyState cstate);
 static int	CopyReadAttributesText(CopyState cstate);
@@ -988,7 +1013,6 @@ DoCopy(const CopyStmt *stmt, const char *queryString, uint64 *processed)
 	 * The user might have set the GUC value himself. Honor that if so
 	 */
 
-#define MAX_CACHEVAL	1024
 	if (rel && getOwnedSequences(RelationGetRelid(rel)) != NIL &&
 				SequenceRangeVal == DEFAULT_CACHEVAL)
 		SequenceRangeVal = MAX_CACHEVAL;
@@ -2356,6 +2380,9 @@ CopyFrom(CopyState cstate)
 	HeapTuple  *bufferedTuples = NULL;	/* initialize to silence warning */
 	Size		bufferedTuplesSize = 0;
 	int			firstBufferedLineNo = 0;
+#ifdef PGXC
+	RemoteCopyBatch *remoteBatch = NULL;
+#endif
 
 	Assert(cstate->rel);
 
@@ -2521,6 +2548,21 @@ CopyFrom(CopyState cstate)
 	bistate = GetBulkInsertState();
 	econtext = GetPerTupleExprContext(estate);
 
+#ifdef PGXC
+	if (IS_PGXC_COORDINATOR && cstate->remoteCopyState->rel_loc &&
+		isLocatorSingleNode(cstate->remoteCopyState->locator))
+	{
+		remoteBatch = (RemoteCopyBatch *) palloc(sizeof(RemoteCopyBatch));
+		remoteBatch->count = 0;
+		initStringInfo(&remoteBatch->data);
+		remoteBatch->context = AllocSetContextCreate(CurrentMemoryContext,
+													 "COPY FROM batch",
+													 ALLOCSET_DEFAULT_MINSIZE,
+													 ALLOCSET_DEFAULT_INITSIZE,
+													 ALLOCSET_DEFAULT_MAXSIZE);
+	}
+#endif
+
 	/* Set up callback to identify error line number */
 	errcallback.callback = CopyFromErrorCallback;
 	errcallback.arg = (void *) cstate;
@@ -2564,12 +2606,40 @@ CopyFrom(CopyState cstate)
 			AttrNumber			dist_col = rcstate->rel_loc->partAttrNum;
 
 			if (AttributeNumberIsValid(dist_col))
+				value = GetRelationDistribKeyValue(rcstate->rel_loc, tupDesc,
+												   values, nulls, &isnull);
+
+			if (remoteBatch)
 			{
-				value = values[dist_col-1];
-				isnull = nulls[dist_col-1];
-			}
+				int			n = remoteBatch->count++;
+
+				if (n == 0)
+					remoteBatch->firstLineNo = cstate->cur_lineno;
+				appendBinaryStringInfo(&remoteBatch->data,
+									   cstate->line_buf.data,
+									   cstate->line_buf.len);
+				remoteBatch->ends[n] = remoteBatch->data.len;
+				remoteBatch->nulls[n] = isnull;
+				remoteBatch->values[n] = value;
+				/*
+				 * The value has to survive the per-tuple context.  The int4
+				 * key of several columns is passed by value.
+				 */
+				if (!isnull &&
+					!IsRelationMultiColumnDistributed(rcstate->rel_loc))
+				{
+					Form_pg_attribute attr = tupDesc->attrs[dist_col - 1];
 
-			if (DataNodeCopyIn(cstate->line_buf.data,
+					MemoryContextSwitchTo(remoteBatch->context);
+					remoteBatch->values[n] = datumCopy(value, attr->attbyval,
+													   attr->attlen);
+					MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+				}
+				if (remoteBatch->count == MAX_REMOTE_BUFFERED_ROWS)
+					CopyFromRemoteBatch(cstate, remoteBatch,
+										rcstate->locator);
+			}
+			else if (DataNodeCopyIn(cstate->line_buf.data,
 							   cstate->line_buf.len,
 							   GET_NODES(rcstate->locator, value, isnull, NULL),
 					   (PGXCNodeHandle**) getLocatorResults(rcstate->locator)))
@@ -2683,6 +2753,19 @@ CopyFrom(CopyState cstate)
 							nBufferedTuples, bufferedTuples,
 							firstBufferedLineNo);
 
+#ifdef PGXC
+	/* Send the rows still buffered */
+	if (remoteBatch)
+	{
+		if (remoteBatch->count > 0)
+			CopyFromRemoteBatch(cstate, remoteBatch,
+								cstate->remoteCopyState->locator);
+		pfree(remoteBatch->data.data);
+		MemoryContextDelete(remoteBatch->context);
+		pfree(remoteBatch);
+	}
+#endif
+
 #ifdef XCP
 	/*
 	 * Now if line buffer contains some data that is an EOF marker. We should
@@ -2741,6 +2824,49 @@ CopyFrom(CopyState cstate)
 	return processed;
 }
 
+#ifdef PGXC
+/*
+ * A subroutine of CopyFrom, to send the rows buffered by the Coordinator to
+ * their Datanode.
+ */
+static void
+CopyFromRemoteBatch(CopyState cstate, RemoteCopyBatch *batch, Locator *locator)
+{
+	PGXCNodeHandle **connections = (PGXCNodeHandle **) getLocatorNodeMap(locator);
+	int			start = 0;
+	int			i;
+	int			save_cur_lineno;
+
+	/*
+	 * Print error context information correctly, if one of the operations
+	 * below fail: the rows are located from the first line of the batch.
+	 */
+	cstate->line_buf_valid = false;
+	save_cur_lineno = cstate->cur_lineno;
+	cstate->cur_lineno = batch->firstLineNo;
+
+	GET_NODES_BATCH(locator, batch->values, batch->nulls, batch->count,
+					batch->nodes);
+	for (i = 0; i < batch->count; i++)
+	{
+		cstate->cur_lineno = batch->firstLineNo + i;
+		if (DataNodeCopyIn(batch->data.data + start, batch->ends[i] - start,
+						   1, &connections[batch->nodes[i]]))
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_EXCEPTION),
+					 errmsg("Copy failed on a data node")));
+		start = batch->ends[i];
+	}
+
+	/* reset cur_lineno to where we were */
+	cstate->cur_lineno = save_cur_lineno;
+
+	batch->count = 0;
+	resetStringInfo(&batch->data);
+	MemoryContextReset(batch->context);
+}
+#endif
+
 /*
  * A subroutine of CopyFrom, to write the current batch of buffered heap
  * tuples to the heap. Also updates indexes and runs AFTER ROW INSERT
@@ -547,21 +547,36 @@ DefineIndex(Oid relationId,
 		ListCell *elem;
 		bool isSafe = false;
 
-		foreach(elem, stmt->indexParams)
+		if (rel->rd_locator_info &&
+				IsRelationMultiColumnDistributed(rel->rd_locator_info))
 		{
-			IndexElem  *key = (IndexElem *) lfirst(elem);
-
-			if (rel->rd_locator_info == NULL)
+			List *indexcolnames = NIL;
+
+			foreach(elem, stmt->indexParams)
+				indexcolnames = lappend(indexcolnames,
+										((IndexElem *) lfirst(elem))->name);
+			isSafe = CheckLocalIndexColumns(
+					GetRelationDistribColumns(rel->rd_locator_info),
+					indexcolnames);
+		}
+		else
+		{
+			foreach(elem, stmt->indexParams)
 			{
-				isSafe = true;
-				break;
-			}
+				IndexElem  *key = (IndexElem *) lfirst(elem);
 
-			if (CheckLocalIndexColumn(rel->rd_locator_info->locatorType, 
-				rel->rd_locator_info->partAttrName, key->name))
-			{
-				isSafe = true;
-				break;
+				if (rel->rd_locator_info == NULL)
+				{
+					isSafe = true;
+					break;
+				}
+
+				if (CheckLocalIndexColumn(rel->rd_locator_info->locatorType, 
+					rel->rd_locator_info->partAttrName, key->name))
+				{
+					isSafe = true;
+					break;
+				}
 			}
 		}
 		if (!isSafe)
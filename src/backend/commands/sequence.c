@@ -73,6 +73,15 @@
 #ifdef XCP
 
 int			SequenceRangeVal = 1;
+
+/*
+ * When sequence_range is set, ranges of sequence values asked from GTM are
+ * sized to last about SEQ_RANGE_TARGET_MS at the rate the session consumed
+ * the previous one.  A session that did not ask for values for
+ * SEQ_RANGE_RESET_MS goes back to one value at a time.
+ */
+#define SEQ_RANGE_TARGET_MS		1000
+#define SEQ_RANGE_RESET_MS		5000
 #endif
 
 typedef struct sequence_magic
@@ -150,6 +159,9 @@ static void init_params(List *options, bool isInit,
 #endif
 static void do_setval(Oid relid, int64 next, bool iscalled);
 static void process_owned_by(Relation seqrel, List *owned_by);
+#ifdef XCP
+static int64 adapt_sequence_range(SeqTable elm);
+#endif
 
 
 /*
@@ -758,65 +770,22 @@ nextval_internal(Oid relid)
 		 * Above, we still use the page as a locking mechanism to handle
 		 * concurrency
 		 *
-		 * If the user has set a CACHE parameter, we use that. Else we pass in
-		 * the SequenceRangeVal value
+		 * If the user has set a CACHE parameter, we use that. Else, if
+		 * sequence_range is set, the range adapts to the rate the session
+		 * consumes values.  The catalog does not tell an explicit CACHE 1
+		 * from the default, so both ask GTM for one value at a time unless
+		 * sequence_range is set.
 		 */
-		if (range == DEFAULT_CACHEVAL && SequenceRangeVal > range)
-		{
-			TimestampTz curtime = GetCurrentTimestamp();
-
-			if (!TimestampDifferenceExceeds(elm->last_call_time,
-													curtime, 1000))
-			{
-				/*
-				 * The previous GetNextValGTM call was made just a while back.
-				 * Request double the range of what was requested in the
-				 * earlier call. Honor the SequenceRangeVal boundary
-				 * value to limit very large range requests!
-				 */
-				elm->range_multiplier *= 2;
-				if (elm->range_multiplier < SequenceRangeVal)
-					range = elm->range_multiplier;
-				else
-					elm->range_multiplier = range = SequenceRangeVal;
-
-				elog(DEBUG1, "increase sequence range %ld", range);
-			}
-			else if (TimestampDifferenceExceeds(elm->last_call_time,
-												curtime, 5000))
-			{
-				/* The previous GetNextValGTM call was pretty old */
-				range = elm->range_multiplier = DEFAULT_CACHEVAL;
-				elog(DEBUG1, "reset sequence range %ld", range);
-			}
-			else if (TimestampDifferenceExceeds(elm->last_call_time,
-												curtime, 3000))
-			{
-				/*
-				 * The previous GetNextValGTM call was made quite some time
-				 * ago. Try to reduce the range request to reduce the gap
-				 */
-				if (elm->range_multiplier != DEFAULT_CACHEVAL)
-				{
-					range = elm->range_multiplier =
-								rint(elm->range_multiplier/2);
-					elog(DEBUG1, "decrease sequence range %ld", range);
-				}
-			}
-			else
-			{
-				/*
-				 * Current range_multiplier alllows to cache sequence values
-				 * for 1-3 seconds of work. Keep that rate.
-				 */
-				range = elm->range_multiplier;
-			}
-			elm->last_call_time = curtime;
-		}
+		if (range == DEFAULT_CACHEVAL &&
+			SequenceRangeVal > DEFAULT_CACHEVAL)
+			range = adapt_sequence_range(elm);
 
 		result = (int64) GetNextValGTM(seqname, range, &rangemax);
 		pfree(seqname);
 
+		/* GTM grants less near the end of the sequence */
+		elm->range_multiplier = (rangemax - result) / seq->increment_by + 1;
+
 		/* Update the on-disk data */
 		seq->last_value = result; /* last fetched number */
 		seq->is_called = true;
@@ -1050,6 +1019,50 @@ nextval_internal(Oid relid)
 	return result;
 }
 
+#ifdef XCP
+/*
+ * Choose how many values to ask from GTM for a sequence without CACHE,
+ * when sequence_range is set.
+ *
+ * The session consumed the previous range since the previous call, which
+ * gives its rate.  The new range covers about SEQ_RANGE_TARGET_MS at that
+ * rate, at most doubles from one call to the next and is capped by
+ * sequence_range.  Values of the range the session does not consume are
+ * lost, so the cap and the target bound the gap a session can leave.
+ */
+static int64
+adapt_sequence_range(SeqTable elm)
+{
+	TimestampTz curtime = GetCurrentTimestamp();
+	long		secs;
+	int			usecs;
+	int64		elapsed;
+	int64		range;
+	double		rate;
+
+	TimestampDifference(elm->last_call_time, curtime, &secs, &usecs);
+	elapsed = (int64) secs * 1000 + usecs / 1000;
+	elm->last_call_time = curtime;
+
+	if (elapsed >= SEQ_RANGE_RESET_MS)
+		return DEFAULT_CACHEVAL;
+
+	/* Values consumed per second */
+	rate = (double) elm->range_multiplier * 1000.0 / Max(elapsed, 1);
+
+	range = (int64) Min(rate * SEQ_RANGE_TARGET_MS / 1000.0,
+						(double) elm->range_multiplier * 2);
+	range = Max(range, DEFAULT_CACHEVAL);
+	range = Min(range, SequenceRangeVal);
+
+	if (range != elm->range_multiplier)
+		elog(DEBUG1, "sequence range " INT64_FORMAT " -> " INT64_FORMAT,
+			 elm->range_multiplier, range);
+
+	return range;
+}
+#endif
+
 Datum
 currval_oid(PG_FUNCTION_ARGS)
 {
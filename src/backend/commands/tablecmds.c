@@ -11326,6 +11326,13 @@ AtExecDistributeBy(Relation rel, DistributeBy *options)
 	char locatortype;
 	int hashalgorithm, hashbuckets;
 	AttrNumber attnum;
+	List *attnums;
+	int16 *keyattnums;
+	int numkeyattnums = 0;
+	ListCell *lc;
+	ArrayType *values = NULL;
+	Oid *nodeoids = NULL;
+	int numnodes = 0;
 
 	/* Nothing to do on Datanodes */
 	if (IS_PGXC_DATANODE || options == NULL)
@@ -11340,7 +11347,22 @@ AtExecDistributeBy(Relation rel, DistributeBy *options)
 								 &locatortype,
 								 &hashalgorithm,
 								 &hashbuckets,
-								 &attnum);
+								 &attnum,
+								 &attnums);
+
+	keyattnums = (int16 *) palloc((list_length(attnums) + 1) * sizeof(int16));
+	foreach(lc, attnums)
+		keyattnums[numkeyattnums++] = (int16) lfirst_int(lc);
+
+	/*
+	 * The nodes of a table distributed by range or list are the ones given
+	 * their values, BuildRedistribCommands checked they are the ones of any
+	 * sub-cluster defined at the same time.
+	 */
+	if (IsLocatorBoundDistributed(locatortype))
+		values = GetRelationDistributionValues(options, NULL,
+											   RelationGetDescr(rel), attnum,
+											   &nodeoids, &numnodes);
 
 	/*
 	 * It is not checked if the distribution type list is the same as the old one,
@@ -11353,8 +11375,12 @@ AtExecDistributeBy(Relation rel, DistributeBy *options)
 				   (int) attnum,
 				   hashalgorithm,
 				   hashbuckets,
-				   0,
-				   NULL,
+				   numnodes,
+				   nodeoids,
+				   numkeyattnums,
+				   keyattnums,
+				   values,
+				   values ? PGXC_CLASS_ALTER_ALL :
 				   PGXC_CLASS_ALTER_DISTRIBUTION);
 
 	/* Make the additional catalog changes visible */
@@ -11391,6 +11417,9 @@ AtExecSubCluster(Relation rel, PGXCSubCluster *options)
 				   0,
 				   numnodes,
 				   nodeoids,
+				   0,
+				   NULL,
+				   NULL,
 				   PGXC_CLASS_ALTER_NODES);
 
 	/* Make the additional catalog changes visible */
@@ -11437,6 +11466,9 @@ AtExecAddNode(Relation rel, List *options)
 				   0,
 				   old_num,
 				   old_oids,
+				   0,
+				   NULL,
+				   NULL,
 				   PGXC_CLASS_ALTER_NODES);
 
 	/* Make the additional catalog changes visible */
@@ -11480,6 +11512,9 @@ AtExecDeleteNode(Relation rel, List *options)
 				   0,
 				   old_num,
 				   old_oids,
+				   0,
+				   NULL,
+				   NULL,
 				   PGXC_CLASS_ALTER_NODES);
 
 	/* Make the additional catalog changes visible */
@@ -11529,6 +11564,10 @@ BuildRedistribCommands(Oid relid, List *subCmds)
 	Oid		   *new_oid_array;	/* Modified list of Oids */
 	int			new_num, i;	/* Modified number of Oids */
 	ListCell   *item;
+	DistributeBy *distributeby = NULL;	/* Last new distribution */
+	PGXCSubCluster *subcluster = NULL;	/* Last new sub-cluster */
+	bool		changesNodes = false;	/* Nodes are added or deleted */
+	ArrayType  *values = NULL;
 #ifdef XCP
 	char		node_type = PGXC_NODE_DATANODE;
 #endif
@@ -11556,21 +11595,29 @@ BuildRedistribCommands(Oid relid, List *subCmds)
 		switch (cmd->subtype)
 		{
 			case AT_DistributeBy:
-				/*
-				 * Get necessary distribution information and update to new
-				 * distribution type.
-				 */
-				GetRelationDistributionItems(redistribState->relid,
-											 (DistributeBy *) cmd->def,
-											 RelationGetDescr(rel),
-											 &(newLocInfo->locatorType),
-											 NULL,
-											 NULL,
-											 (AttrNumber *)&(newLocInfo->partAttrNum));
+				{
+					AttrNumber attnum;
+
+					/*
+					 * Get necessary distribution information and update to new
+					 * distribution type.
+					 */
+					GetRelationDistributionItems(redistribState->relid,
+												 (DistributeBy *) cmd->def,
+												 RelationGetDescr(rel),
+												 &(newLocInfo->locatorType),
+												 NULL,
+												 NULL,
+												 &attnum,
+												 &(newLocInfo->partAttrNums));
+					newLocInfo->partAttrNum = attnum;
+					distributeby = (DistributeBy *) cmd->def;
+				}
 				break;
 			case AT_SubCluster:
 				/* Update new list of nodes */
 				new_oid_array = GetRelationDistributionNodes((PGXCSubCluster *) cmd->def, &new_num);
+				subcluster = (PGXCSubCluster *) cmd->def;
 				break;
 			case AT_AddNodeList:
 				{
@@ -11579,6 +11626,7 @@ BuildRedistribCommands(Oid relid, List *subCmds)
 					add_oids = BuildRelationDistributionNodes((List *) cmd->def, &add_num);
 					/* Add elements to array */
 					new_oid_array = add_node_list(new_oid_array, new_num, add_oids, add_num, &new_num);
+					changesNodes = true;
 				}
 				break;
 			case AT_DeleteNodeList:
@@ -11588,6 +11636,7 @@ BuildRedistribCommands(Oid relid, List *subCmds)
 					del_oids = BuildRelationDistributionNodes((List *) cmd->def, &del_num);
 					/* Delete elements from array */
 					new_oid_array = delete_node_list(new_oid_array, new_num, del_oids, del_num, &new_num);
+					changesNodes = true;
 				}
 				break;
 			default:
@@ -11595,11 +11644,38 @@ BuildRedistribCommands(Oid relid, List *subCmds)
 		}
 	}
 
+	/*
+	 * Each node of a table distributed by range or list stores the rows of
+	 * the values given for it, nodes can only change with these values.
+	 */
+	if (IsRelationBoundDistributed(newLocInfo))
+	{
+		if (distributeby == NULL || changesNodes)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("nodes of a table distributed by range or list can only be changed by DISTRIBUTE BY with VALUES")));
+		pfree(new_oid_array);
+		values = GetRelationDistributionValues(distributeby, subcluster,
+											   RelationGetDescr(rel),
+											   newLocInfo->partAttrNum,
+											   &new_oid_array, &new_num);
+	}
+
 	/* Build relation node list for new locator info */
 	for (i = 0; i < new_num; i++)
 		newLocInfo->nodeList = lappend_int(newLocInfo->nodeList,
 										   PGXCNodeGetNodeId(new_oid_array[i],
 															 &node_type));
+	if (values)
+	{
+		if (newLocInfo->bounds)
+			pfree(newLocInfo->bounds);
+		if (newLocInfo->boundNodes)
+			pfree(newLocInfo->boundNodes);
+		BuildRelationLocBounds(newLocInfo, RelationGetDescr(rel),
+							   PointerGetDatum(values), false);
+	}
+
 	/* Build the command tree for table redistribution */
 	PGXCRedistribCreateCommandList(redistribState, newLocInfo);
 
@@ -3155,6 +3155,8 @@ _copyDistributeBy(const DistributeBy *from)
 
 	COPY_SCALAR_FIELD(disttype);
 	COPY_STRING_FIELD(colname);
+	COPY_NODE_FIELD(colnames);
+	COPY_NODE_FIELD(values);
 
 	return newnode;
 }
@@ -4409,6 +4411,18 @@ _copyPauseClusterStmt(const PauseClusterStmt *from)
 	return newnode;
 }
 
+static RebalanceStmt *
+_copyRebalanceStmt(const RebalanceStmt *from)
+{
+	RebalanceStmt *newnode = makeNode(RebalanceStmt);
+
+	COPY_NODE_FIELD(source);
+	COPY_NODE_FIELD(target);
+	COPY_NODE_FIELD(options);
+
+	return newnode;
+}
+
 /* ****************************************************************
  *					nodemgr.h copy functions
  * ****************************************************************
@@ -5145,6 +5159,9 @@ copyObject(const void *from)
 		case T_PauseClusterStmt:
 			retval = _copyPauseClusterStmt(from);
 			break;
+		case T_RebalanceStmt:
+			retval = _copyRebalanceStmt(from);
+			break;
 		case T_AlterNodeStmt:
 			retval = _copyAlterNodeStmt(from);
 			break;
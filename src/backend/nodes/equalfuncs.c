@@ -2716,6 +2716,15 @@ _equalPauseClusterStmt(const PauseClusterStmt *a, const PauseClusterStmt *b)
 	COMPARE_SCALAR_FIELD(pause);
 	return true;
 }
+
+static bool
+_equalRebalanceStmt(const RebalanceStmt *a, const RebalanceStmt *b)
+{
+	COMPARE_NODE_FIELD(source);
+	COMPARE_NODE_FIELD(target);
+	COMPARE_NODE_FIELD(options);
+	return true;
+}
 #endif
 /*
  * stuff from nodemgr.h
@@ -3278,6 +3287,9 @@ equal(const void *a, const void *b)
 		case T_PauseClusterStmt:
 			retval = _equalPauseClusterStmt(a, b);
 			break;
+		case T_RebalanceStmt:
+			retval = _equalRebalanceStmt(a, b);
+			break;
 		case T_AlterNodeStmt:
 			retval = _equalAlterNodeStmt(a, b);
 			break;
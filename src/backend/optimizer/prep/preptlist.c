@@ -101,7 +101,7 @@ preprocess_targetlist(PlannerInfo *root, List *tlist)
 			Distribution *distribution = makeNode(Distribution);
 			ListCell *lc;
 
-			distribution->distributionType = rel_loc_info->locatorType;
+			distribution->distributionType = PlannerLocatorType(rel_loc_info);
 			foreach(lc, rel_loc_info->nodeList)
 				distribution->nodes = bms_add_member(distribution->nodes,
 													 lfirst_int(lc));
@@ -115,10 +115,36 @@ preprocess_targetlist(PlannerInfo *root, List *tlist)
 				if (command_type == CMD_INSERT || command_type == CMD_UPDATE)
 				{
 					TargetEntry *keyTle;
-					keyTle = (TargetEntry *) list_nth(tlist,
-											  rel_loc_info->partAttrNum - 1);
 
-					distribution->distributionExpr = (Node *) keyTle->expr;
+					if (IsRelationMultiColumnDistributed(rel_loc_info))
+					{
+						List	   *args = NIL;
+
+						foreach(lc, rel_loc_info->partAttrNums)
+						{
+							keyTle = (TargetEntry *) list_nth(tlist,
+													  lfirst_int(lc) - 1);
+							args = lappend(args, copyObject(keyTle->expr));
+						}
+						distribution->distributionExpr = (Node *)
+							makeDistribKeyExpr(args);
+					}
+					else if (IsRelationBoundDistributed(rel_loc_info))
+					{
+						keyTle = (TargetEntry *) list_nth(tlist,
+												  rel_loc_info->partAttrNum - 1);
+
+						distribution->distributionExpr = (Node *)
+							makeBoundKeyExpr(rel_loc_info,
+											 copyObject(keyTle->expr));
+					}
+					else
+					{
+						keyTle = (TargetEntry *) list_nth(tlist,
+												  rel_loc_info->partAttrNum - 1);
+
+						distribution->distributionExpr = (Node *) keyTle->expr;
+					}
 
 					/*
 					 * We can restrict the distribution if the expression
@@ -173,21 +199,35 @@ preprocess_targetlist(PlannerInfo *root, List *tlist)
 				 */
 				if (command_type == CMD_DELETE)
 				{
-					Form_pg_attribute att_tup;
-					TargetEntry *tle;
-					Var		   *var;
-
-					att_tup = rel->rd_att->attrs[rel_loc_info->partAttrNum - 1];
-					var = makeVar(result_relation, rel_loc_info->partAttrNum,
-								  att_tup->atttypid, att_tup->atttypmod,
-								  att_tup->attcollation, 0);
-
-					tle = makeTargetEntry((Expr *) var,
-										  list_length(tlist) + 1,
-										  pstrdup(NameStr(att_tup->attname)),
-										  true);
-					tlist = lappend(tlist, tle);
-					distribution->distributionExpr = (Node *) var;
+					List	   *args = NIL;
+
+					foreach(lc, rel_loc_info->partAttrNums)
+					{
+						Form_pg_attribute att_tup;
+						TargetEntry *tle;
+						Var		   *var;
+
+						att_tup = rel->rd_att->attrs[lfirst_int(lc) - 1];
+						var = makeVar(result_relation, lfirst_int(lc),
+									  att_tup->atttypid, att_tup->atttypmod,
+									  att_tup->attcollation, 0);
+
+						tle = makeTargetEntry((Expr *) var,
+											  list_length(tlist) + 1,
+											  pstrdup(NameStr(att_tup->attname)),
+											  true);
+						tlist = lappend(tlist, tle);
+						args = lappend(args, var);
+					}
+					if (list_length(args) > 1)
+						distribution->distributionExpr = (Node *)
+							makeDistribKeyExpr(args);
+					else if (IsRelationBoundDistributed(rel_loc_info))
+						distribution->distributionExpr = (Node *)
+							makeBoundKeyExpr(rel_loc_info,
+											 (Expr *) linitial(args));
+					else
+						distribution->distributionExpr = (Node *) linitial(args);
 				}
 			}
 			else
@@ -30,15 +30,19 @@
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
 #include "optimizer/var.h"
+#include "parser/parse_coerce.h"
 #include "parser/parsetree.h"
 #include "utils/lsyscache.h"
 #include "utils/selfuncs.h"
 #ifdef XCP
 #include "access/heapam.h"
+#include "access/htup_details.h"
+#include "catalog/pg_statistic.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "pgxc/locator.h"
 #include "pgxc/nodemgr.h"
+#include "pgxc/redistrib.h"
 #include "utils/rel.h"
 #endif
 
@@ -60,7 +64,7 @@ typedef enum
 
 static List *translate_sub_tlist(List *tlist, int relid);
 #ifdef XCP
-static void restrict_distribution(PlannerInfo *root, RestrictInfo *ri,
+static void restrict_distribution(PlannerInfo *root, List *restrictinfo,
 								  Path *pathnode);
 static Path *redistribute_path(Path *subpath, char distributionType,
 				  Bitmapset *nodes, Bitmapset *restrictNodes,
@@ -712,31 +716,21 @@ add_path_precheck(RelOptInfo *parent_rel,
  *****************************************************************************/
 #ifdef XCP
 /*
- * restrict_distribution
- *    Analyze the RestrictInfo and decide if it is possible to restrict
- *    distribution nodes
+ * distribution_key_const
+ *    Analyze the RestrictInfo and return the constant it equates keyExpr
+ *    with, if any
  */
-static void
-restrict_distribution(PlannerInfo *root, RestrictInfo *ri,
-								  Path *pathnode)
+static Const *
+distribution_key_const(PlannerInfo *root, RestrictInfo *ri, Node *keyExpr)
 {
-	Distribution   *distribution = pathnode->distribution;
-	Oid				keytype;
 	Const		   *constExpr = NULL;
 	bool			found_key = false;
 
-	/*
-	 * Can not restrict - not distributed or key is not defined
-	 */
-	if (distribution == NULL ||
-			distribution->distributionExpr == NULL)
-		return;
-
 	/*
 	 * We do not support OR'ed conditions yet
 	 */
 	if (ri->orclause)
-		return;
+		return NULL;
 
 	/*
 	 * Check if the operator is hash joinable. Currently we only support hash
@@ -753,22 +747,20 @@ restrict_distribution(PlannerInfo *root, RestrictInfo *ri,
 		Node	   *leftarg;
 
 		if (ri->pseudoconstant)
-			return;
+			return NULL;
 		if (!is_opclause(clause))
-			return;
+			return NULL;
 		if (list_length(((OpExpr *) clause)->args) != 2)
-			return;
+			return NULL;
 
 		opno = ((OpExpr *) clause)->opno;
 		leftarg = linitial(((OpExpr *) clause)->args);
 
 		if (!op_hashjoinable(opno, exprType(leftarg)) ||
 				contain_volatile_functions((Node *) clause))
-			return;
+			return NULL;
 	}
 
-
-	keytype = exprType(distribution->distributionExpr);
 	if (ri->left_ec)
 	{
 		EquivalenceClass *ec = ri->left_ec;
@@ -776,7 +768,7 @@ restrict_distribution(PlannerInfo *root, RestrictInfo *ri,
 		foreach(lc, ec->ec_members)
 		{
 			EquivalenceMember *em = (EquivalenceMember *) lfirst(lc);
-			if (equal(em->em_expr, distribution->distributionExpr))
+			if (equal(em->em_expr, keyExpr))
 				found_key = true;
 			else if (bms_is_empty(em->em_relids))
 			{
@@ -794,7 +786,7 @@ restrict_distribution(PlannerInfo *root, RestrictInfo *ri,
 		foreach(lc, ec->ec_members)
 		{
 			EquivalenceMember *em = (EquivalenceMember *) lfirst(lc);
-			if (equal(em->em_expr, distribution->distributionExpr))
+			if (equal(em->em_expr, keyExpr))
 				found_key = true;
 			else if (bms_is_empty(em->em_relids))
 			{
@@ -814,9 +806,9 @@ restrict_distribution(PlannerInfo *root, RestrictInfo *ri,
 			Expr *arg1 = (Expr *) linitial(opexpr->args);
 			Expr *arg2 = (Expr *) lsecond(opexpr->args);
 			Expr *other = NULL;
-			if (equal(arg1, distribution->distributionExpr))
+			if (equal(arg1, keyExpr))
 				other = arg2;
-			else if (equal(arg2, distribution->distributionExpr))
+			else if (equal(arg2, keyExpr))
 				other = arg1;
 			if (other)
 			{
@@ -827,42 +819,194 @@ restrict_distribution(PlannerInfo *root, RestrictInfo *ri,
 			}
 		}
 	}
-	if (found_key && constExpr)
+	return found_key ? constExpr : NULL;
+}
+
+/*
+ * restrict_distribution_nodes
+ *    Restrict distribution nodes to the ones storing the key value
+ */
+static void
+restrict_distribution_nodes(Distribution *distribution, Oid keytype,
+							Const *constExpr)
+{
+	List 	   *nodeList = NIL;
+	Bitmapset  *tmpset = bms_copy(distribution->nodes);
+	Bitmapset  *restrictinfo = NULL;
+	Locator    *locator;
+	int		   *nodenums;
+	int 		i, count;
+
+	while((i = bms_first_member(tmpset)) >= 0)
+		nodeList = lappend_int(nodeList, i);
+	bms_free(tmpset);
+
+	locator = createLocator(distribution->distributionType,
+							RELATION_ACCESS_READ,
+							keytype,
+							LOCATOR_LIST_LIST,
+							0,
+							(void *) nodeList,
+							(void **) &nodenums,
+							false);
+	count = GET_NODES(locator, constExpr->constvalue,
+					  constExpr->constisnull, NULL);
+
+	for (i = 0; i < count; i++)
+		restrictinfo = bms_add_member(restrictinfo, nodenums[i]);
+	if (distribution->restrictNodes)
+		distribution->restrictNodes = bms_intersect(distribution->restrictNodes,
+													restrictinfo);
+	else
+		distribution->restrictNodes = restrictinfo;
+	list_free(nodeList);
+	freeLocator(locator);
+}
+
+/*
+ * restrict_distribution
+ *    Analyze the RestrictInfos and decide if it is possible to restrict
+ *    distribution nodes
+ */
+static void
+restrict_distribution(PlannerInfo *root, List *restrictinfo,
+								  Path *pathnode)
+{
+	Distribution   *distribution = pathnode->distribution;
+	Node		   *keyExpr;
+	ListCell	   *lc;
+
+	/*
+	 * Can not restrict - not distributed or key is not defined
+	 */
+	if (distribution == NULL ||
+			distribution->distributionExpr == NULL)
+		return;
+
+	keyExpr = distribution->distributionExpr;
+
+	/*
+	 * Rows of a relation distributed by range or list of values are on the
+	 * nodes of the ranges or values satisfying the quals, the key being the
+	 * rank of their node among the nodes of the distribution.
+	 */
+	if (IsBoundKeyExpr(keyExpr))
 	{
-		List 	   *nodeList = NIL;
-		Bitmapset  *tmpset = bms_copy(distribution->nodes);
-		Bitmapset  *restrictinfo = NULL;
-		Locator    *locator;
-		int		   *nodenums;
-		int 		i, count;
-
-		while((i = bms_first_member(tmpset)) >= 0)
-			nodeList = lappend_int(nodeList, i);
+		Bitmapset  *ranks;
+		Bitmapset  *nodes = NULL;
+		Bitmapset  *tmpset;
+		int			rank = 0;
+		int			node;
+
+		ranks = GetBoundKeyRanks(keyExpr,
+								 extract_actual_clauses(restrictinfo, false));
+		if (ranks == NULL)
+			return;
+
+		tmpset = bms_copy(distribution->nodes);
+		while ((node = bms_first_member(tmpset)) >= 0)
+			if (bms_is_member(rank++, ranks))
+				nodes = bms_add_member(nodes, node);
 		bms_free(tmpset);
 
-		locator = createLocator(distribution->distributionType,
-								RELATION_ACCESS_READ,
-								keytype,
-								LOCATOR_LIST_LIST,
-								0,
-								(void *) nodeList,
-								(void **) &nodenums,
-								false);
-		count = GET_NODES(locator, constExpr->constvalue,
-						  constExpr->constisnull, NULL);
-
-		for (i = 0; i < count; i++)
-			restrictinfo = bms_add_member(restrictinfo, nodenums[i]);
 		if (distribution->restrictNodes)
-			distribution->restrictNodes = bms_intersect(distribution->restrictNodes,
-														restrictinfo);
+			distribution->restrictNodes =
+				bms_int_members(distribution->restrictNodes, nodes);
 		else
-			distribution->restrictNodes = restrictinfo;
-		list_free(nodeList);
-		freeLocator(locator);
+			distribution->restrictNodes = nodes;
+		return;
+	}
+
+	/*
+	 * The key of a relation distributed by several columns is known if every
+	 * column is equal to a constant, maybe in different RestrictInfos.
+	 */
+	if (IsDistribKeyExpr(keyExpr))
+	{
+		List	   *args = NIL;
+		ListCell   *argc;
+		Node	   *keyConst;
+
+		foreach(argc, ((FuncExpr *) keyExpr)->args)
+		{
+			Node	   *arg = (Node *) lfirst(argc);
+			Const	   *constExpr = NULL;
+
+			foreach(lc, restrictinfo)
+			{
+				constExpr = distribution_key_const(root,
+												   (RestrictInfo *) lfirst(lc),
+												   arg);
+				if (constExpr)
+					break;
+			}
+			if (constExpr == NULL)
+				return;
+			/* The column value has to be hashed as the column type */
+			args = lappend(args, coerce_to_target_type(NULL,
+													   (Node *) constExpr,
+													   constExpr->consttype,
+													   exprType(arg),
+													   exprTypmod(arg),
+													   COERCION_ASSIGNMENT,
+													   COERCE_IMPLICIT_CAST,
+													   -1));
+		}
+		keyConst = eval_const_expressions(root,
+										  (Node *) makeDistribKeyExpr(args));
+		if (keyConst && IsA(keyConst, Const))
+			restrict_distribution_nodes(distribution, exprType(keyExpr),
+										(Const *) keyConst);
+		return;
+	}
+
+	foreach(lc, restrictinfo)
+	{
+		Const	   *constExpr;
+
+		constExpr = distribution_key_const(root, (RestrictInfo *) lfirst(lc),
+										   keyExpr);
+		if (constExpr)
+			restrict_distribution_nodes(distribution, exprType(keyExpr),
+										constExpr);
 	}
 }
 
+/*
+ * scanpath_key_var
+ *	  Return the Var representing the given attribute of a base relation.
+ */
+static Var *
+scanpath_key_var(RelOptInfo *rel, Oid relid, AttrNumber attnum)
+{
+	Var 	   *var = NULL;
+	ListCell   *lc;
+
+	/* Look if the Var is already in the target list */
+	foreach (lc, rel->reltargetlist)
+	{
+		var = (Var *) lfirst(lc);
+		if (IsA(var, Var) && var->varno == rel->relid &&
+				var->varattno == attnum)
+			return var;
+	}
+
+	/* If not found we should look up the attribute and make the Var */
+	{
+		Relation 	relation = heap_open(relid, NoLock);
+		TupleDesc	tdesc = RelationGetDescr(relation);
+		Form_pg_attribute att_tup;
+
+		att_tup = tdesc->attrs[attnum - 1];
+		var = makeVar(rel->relid, attnum,
+					  att_tup->atttypid, att_tup->atttypmod,
+					  att_tup->attcollation, 0);
+
+		heap_close(relation, NoLock);
+	}
+	return var;
+}
+
 /*
  * set_scanpath_distribution
  *	  Assign distribution to the path which is a base relation scan.
@@ -874,52 +1018,43 @@ set_scanpath_distribution(PlannerInfo *root, RelOptInfo *rel, Path *pathnode)
 	RelationLocInfo *rel_loc_info;
 
 	rte = planner_rt_fetch(rel->relid, root);
-	rel_loc_info = GetRelationLocInfo(rte->relid);
+	/* Rows of a relation being redistributed may not be where catalog says */
+	rel_loc_info = GetRedistribSourceLocInfo(rte->relid);
+	if (rel_loc_info == NULL)
+		rel_loc_info = GetRelationLocInfo(rte->relid);
 	if (rel_loc_info)
 	{
 		ListCell *lc;
 		Distribution *distribution = makeNode(Distribution);
-		distribution->distributionType = rel_loc_info->locatorType;
+		distribution->distributionType = PlannerLocatorType(rel_loc_info);
 		foreach(lc, rel_loc_info->nodeList)
 			distribution->nodes = bms_add_member(distribution->nodes,
 												 lfirst_int(lc));
 		distribution->restrictNodes = NULL;
 		/*
 		 * Distribution expression of the base relation is Var representing
-		 * respective attribute.
+		 * respective attribute, or the key expression of the Vars of
+		 * respective attributes if the relation is distributed by several,
+		 * or by range or list of values.
 		 */
 		distribution->distributionExpr = NULL;
-		if (rel_loc_info->partAttrNum)
+		if (IsRelationMultiColumnDistributed(rel_loc_info))
 		{
-			Var 	   *var = NULL;
-			ListCell   *lc;
+			List	   *args = NIL;
 
-			/* Look if the Var is already in the target list */
-			foreach (lc, rel->reltargetlist)
-			{
-				var = (Var *) lfirst(lc);
-				if (IsA(var, Var) && var->varno == rel->relid &&
-						var->varattno == rel_loc_info->partAttrNum)
-					break;
-			}
-			/* If not found we should look up the attribute and make the Var */
-			if (!lc)
-			{
-				Relation 	relation = heap_open(rte->relid, NoLock);
-				TupleDesc	tdesc = RelationGetDescr(relation);
-				Form_pg_attribute att_tup;
-
-				att_tup = tdesc->attrs[rel_loc_info->partAttrNum - 1];
-				var = makeVar(rel->relid, rel_loc_info->partAttrNum,
-							  att_tup->atttypid, att_tup->atttypmod,
-							  att_tup->attcollation, 0);
-
-
-				heap_close(relation, NoLock);
-			}
-
-			distribution->distributionExpr = (Node *) var;
+			foreach(lc, rel_loc_info->partAttrNums)
+				args = lappend(args, scanpath_key_var(rel, rte->relid,
+													  lfirst_int(lc)));
+			distribution->distributionExpr = (Node *) makeDistribKeyExpr(args);
 		}
+		else if (IsRelationBoundDistributed(rel_loc_info))
+			distribution->distributionExpr = (Node *)
+				makeBoundKeyExpr(rel_loc_info, (Expr *)
+								 scanpath_key_var(rel, rte->relid,
+												  rel_loc_info->partAttrNum));
+		else if (rel_loc_info->partAttrNum)
+			distribution->distributionExpr = (Node *)
+				scanpath_key_var(rel, rte->relid, rel_loc_info->partAttrNum);
 		pathnode->distribution = distribution;
 	}
 }
@@ -1029,6 +1164,162 @@ flatCopyJoinPath(JoinPath *pathnode)
 }
 
 
+/*
+ * Check if one of the join restrictions is an equality of the outer and
+ * inner expressions.
+ */
+static bool
+join_equates_exprs(List *restrictClauses, Node *outerExpr, Node *innerExpr)
+{
+	ListCell   *lc;
+
+	foreach(lc, restrictClauses)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+		bool		found_outer = false;
+		bool		found_inner = false;
+
+		/* Same restrictions as for a join on a single distribution column */
+		if (ri->left_ec == NULL || ri->right_ec == NULL ||
+				ri->orclause || !OidIsValid(ri->hashjoinoperator))
+			continue;
+
+		if (ri->left_ec == ri->right_ec)
+		{
+			ListCell   *emc;
+
+			foreach(emc, ri->left_ec->ec_members)
+			{
+				EquivalenceMember *em = (EquivalenceMember *) lfirst(emc);
+				Expr	   *var = (Expr *) em->em_expr;
+
+				if (IsA(var, RelabelType))
+					var = ((RelabelType *) var)->arg;
+				if (!found_outer)
+					found_outer = equal(var, outerExpr);
+				if (!found_inner)
+					found_inner = equal(var, innerExpr);
+			}
+		}
+		else
+		{
+			OpExpr	   *op_exp = (OpExpr *) ri->clause;
+			Expr	   *arg1,
+					   *arg2;
+
+			if (!IsA(op_exp, OpExpr) || list_length(op_exp->args) != 2)
+				continue;
+
+			arg1 = (Expr *) linitial(op_exp->args);
+			arg2 = (Expr *) lsecond(op_exp->args);
+			found_outer = equal(arg1, outerExpr) || equal(arg2, outerExpr);
+			found_inner = equal(arg1, innerExpr) || equal(arg2, innerExpr);
+		}
+
+		if (found_outer && found_inner)
+			return true;
+	}
+	return false;
+}
+
+
+/*
+ * A key is skewed if its most common value has at least this many times the
+ * rows each node would get if the rows were spread evenly.
+ */
+#define SKEWED_KEY_FACTOR	2.0
+
+/*
+ * Estimate the fraction of the rows having the most common value of the
+ * key, NULL included, or 0 if unknown.  The most common values of the
+ * distribution column of a table are collected by ANALYZE over all its nodes,
+ * the statistics of the column have those of one node only.
+ */
+static double
+hot_key_fraction(PlannerInfo *root, Expr *key)
+{
+	VariableStatData vardata;
+	Expr	   *expr = key;
+	bool		distribcol = false;
+	double		hotfrac = 0;
+
+	while (IsA(expr, RelabelType))
+		expr = ((RelabelType *) expr)->arg;
+
+	if (IsA(expr, Var) && ((Var *) expr)->varlevelsup == 0)
+	{
+		Var		   *var = (Var *) expr;
+		RangeTblEntry *rte = planner_rt_fetch(var->varno, root);
+
+		if (rte->rtekind == RTE_RELATION)
+		{
+			RelationLocInfo *rel_loc_info = GetRelationLocInfo(rte->relid);
+
+			if (rel_loc_info &&
+					IsRelationDistributedByValue(rel_loc_info) &&
+					list_length(rel_loc_info->partAttrNums) == 1 &&
+					rel_loc_info->partAttrNum == var->varattno)
+			{
+				distribcol = true;
+				hotfrac = rel_loc_info->hotKeyFrac;
+			}
+		}
+	}
+
+	examine_variable(root, (Node *) key, 0, &vardata);
+	if (HeapTupleIsValid(vardata.statsTuple))
+	{
+		Form_pg_statistic stats;
+		float4	   *numbers;
+		int			nnumbers;
+
+		stats = (Form_pg_statistic) GETSTRUCT(vardata.statsTuple);
+		hotfrac = Max(hotfrac, stats->stanullfrac);
+		if (!distribcol &&
+				get_attstatsslot(vardata.statsTuple,
+								 vardata.atttype, vardata.atttypmod,
+								 STATISTIC_KIND_MCV, InvalidOid,
+								 NULL,
+								 NULL, NULL,
+								 &numbers, &nnumbers))
+		{
+			/* Most common values are sorted by decreasing frequency */
+			if (nnumbers > 0)
+				hotfrac = Max(hotfrac, numbers[0]);
+			free_attstatsslot(vardata.atttype, NULL, 0, numbers, nnumbers);
+		}
+	}
+	ReleaseVariableStats(vardata);
+
+	return hotfrac;
+}
+
+
+/*
+ * Check if redistributing the path by the key onto numnodes nodes would
+ * leave the node of its most common value with more rows to join than
+ * leaving the path where it is and broadcasting the other part of the join
+ * to its nodes.
+ */
+static bool
+redistribution_is_skewed(PlannerInfo *root, Path *path, Expr *key,
+						 Path *other, int numnodes)
+{
+	double		hotfrac = hot_key_fraction(root, key);
+	int			pathnodes = bms_num_members(path->distribution->nodes);
+	double		hot_rows;
+	double		broadcast_rows;
+
+	if (numnodes < 2 || pathnodes < 1 ||
+			hotfrac * numnodes < SKEWED_KEY_FACTOR)
+		return false;
+
+	hot_rows = hotfrac * path->rows + other->rows / numnodes;
+	broadcast_rows = path->rows / pathnodes + other->rows;
+	return broadcast_rows < hot_rows;
+}
+
+
 /*
  * Analyze join parameters and set distribution of the join node.
  * If there are possible alternate distributions the respective pathes are
@@ -1146,6 +1437,52 @@ set_joinpath_distribution(PlannerInfo *root, JoinPath *pathnode)
 	{
 		ListCell   *lc;
 
+		/*
+		 * Relations distributed by several columns are joined along their
+		 * keys if every pair of key columns at the same position is joined.
+		 * The columns have to be of the same type to be hashed the same way.
+		 */
+		if (IsDistribKeyExpr(innerd->distributionExpr) &&
+				IsDistribKeyExpr(outerd->distributionExpr))
+		{
+			List	   *innerArgs = ((FuncExpr *) innerd->distributionExpr)->args;
+			List	   *outerArgs = ((FuncExpr *) outerd->distributionExpr)->args;
+			ListCell   *ilc,
+					   *olc;
+
+			if (list_length(innerArgs) != list_length(outerArgs))
+				goto not_allowed_join;
+
+			forboth(ilc, innerArgs, olc, outerArgs)
+			{
+				Node	   *innerArg = (Node *) lfirst(ilc);
+				Node	   *outerArg = (Node *) lfirst(olc);
+
+				if (exprType(innerArg) != exprType(outerArg) ||
+						!join_equates_exprs(restrictClauses, outerArg, innerArg))
+					goto not_allowed_join;
+			}
+
+			targetd = makeNode(Distribution);
+			targetd->distributionType = innerd->distributionType;
+			targetd->nodes = bms_copy(innerd->nodes);
+			targetd->restrictNodes = bms_copy(innerd->restrictNodes);
+			pathnode->path.distribution = targetd;
+
+			/*
+			 * In case of outer join distribution key should not refer
+			 * distribution key of nullable part.
+			 */
+			if (pathnode->jointype == JOIN_FULL)
+				targetd->distributionExpr = NULL;
+			else if (pathnode->jointype == JOIN_RIGHT)
+				targetd->distributionExpr = innerd->distributionExpr;
+			else
+				targetd->distributionExpr = outerd->distributionExpr;
+
+			return alternate;
+		}
+
 		/*
 		 * Make sure distribution functions are the same, for now they depend
 		 * on data type
@@ -1585,6 +1922,62 @@ not_allowed_join:
 				restrictNodes = bms_copy(innerd->restrictNodes);
 			}
 
+			/*
+			 * If most rows of a part share the same key value, redistributing
+			 * it sends them all to the same node, which then does most of the
+			 * join.  If the join type allows, leave that part where it is and
+			 * broadcast the other part to its nodes when the other part is
+			 * small enough for that to be faster.
+			 */
+			if (new_outer_key &&
+					!IsLocatorReplicated(outerd->distributionType) &&
+					(pathnode->jointype == JOIN_INNER ||
+					 pathnode->jointype == JOIN_LEFT ||
+					 pathnode->jointype == JOIN_SEMI ||
+					 pathnode->jointype == JOIN_ANTI) &&
+					redistribution_is_skewed(root, pathnode->outerjoinpath,
+											 new_outer_key,
+											 pathnode->innerjoinpath,
+											 bms_num_members(nodes)))
+			{
+				pathnode->innerjoinpath = redistribute_path(
+						pathnode->innerjoinpath,
+						LOCATOR_TYPE_REPLICATED,
+						bms_copy(outerd->nodes),
+						bms_copy(outerd->restrictNodes),
+						NULL);
+				targetd = makeNode(Distribution);
+				targetd->distributionType = outerd->distributionType;
+				targetd->nodes = bms_copy(outerd->nodes);
+				targetd->restrictNodes = bms_copy(outerd->restrictNodes);
+				targetd->distributionExpr = outerd->distributionExpr;
+				pathnode->path.distribution = targetd;
+				return alternate;
+			}
+			if (new_inner_key &&
+					!IsLocatorReplicated(innerd->distributionType) &&
+					(pathnode->jointype == JOIN_INNER ||
+					 pathnode->jointype == JOIN_RIGHT) &&
+					redistribution_is_skewed(root, pathnode->innerjoinpath,
+											 new_inner_key,
+											 pathnode->outerjoinpath,
+											 bms_num_members(nodes)))
+			{
+				pathnode->outerjoinpath = redistribute_path(
+						pathnode->outerjoinpath,
+						LOCATOR_TYPE_REPLICATED,
+						bms_copy(innerd->nodes),
+						bms_copy(innerd->restrictNodes),
+						NULL);
+				targetd = makeNode(Distribution);
+				targetd->distributionType = innerd->distributionType;
+				targetd->nodes = bms_copy(innerd->nodes);
+				targetd->restrictNodes = bms_copy(innerd->restrictNodes);
+				targetd->distributionExpr = innerd->distributionExpr;
+				pathnode->path.distribution = targetd;
+				return alternate;
+			}
+
 			/*
 			 * Redistribute join by hash, and, if jointype allows, create
 			 * alternate path where inner subplan is distributed by replication
@@ -1683,15 +2076,7 @@ create_seqscan_path(PlannerInfo *root, RelOptInfo *rel, Relids required_outer)
 
 #ifdef XCP
 	set_scanpath_distribution(root, rel, pathnode);
-	if (rel->baserestrictinfo)
-	{
-		ListCell *lc;
-		foreach (lc, rel->baserestrictinfo)
-		{
-			RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
-			restrict_distribution(root, ri, pathnode);
-		}
-	}
+	restrict_distribution(root, rel->baserestrictinfo, pathnode);
 #endif
 
 	cost_seqscan(pathnode, root, rel, pathnode->param_info);
@@ -1716,15 +2101,7 @@ create_samplescan_path(PlannerInfo *root, RelOptInfo *rel, Relids required_outer
 
 #ifdef XCP
 	set_scanpath_distribution(root, rel, pathnode);
-	if (rel->baserestrictinfo)
-	{
-		ListCell *lc;
-		foreach (lc, rel->baserestrictinfo)
-		{
-			RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
-			restrict_distribution(root, ri, pathnode);
-		}
-	}
+	restrict_distribution(root, rel->baserestrictinfo, pathnode);
 #endif
 
 	cost_samplescan(pathnode, root, rel);
@@ -1795,15 +2172,7 @@ create_index_path(PlannerInfo *root,
 
 #ifdef XCP
 	set_scanpath_distribution(root, rel, (Path *) pathnode);
-	if (indexclauses)
-	{
-		ListCell *lc;
-		foreach (lc, indexclauses)
-		{
-			RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
-			restrict_distribution(root, ri, (Path *) pathnode);
-		}
-	}
+	restrict_distribution(root, indexclauses, (Path *) pathnode);
 #endif
 	cost_index(pathnode, root, loop_count);
 
@@ -1841,15 +2210,7 @@ create_bitmap_heap_path(PlannerInfo *root,
 
 #ifdef XCP
 	set_scanpath_distribution(root, rel, (Path *) pathnode);
-	if (rel->baserestrictinfo)
-	{
-		ListCell *lc;
-		foreach (lc, rel->baserestrictinfo)
-		{
-			RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
-			restrict_distribution(root, ri, (Path *) pathnode);
-		}
-	}
+	restrict_distribution(root, rel->baserestrictinfo, (Path *) pathnode);
 #endif
 
 	cost_bitmap_heap_scan(&pathnode->path, root, rel,
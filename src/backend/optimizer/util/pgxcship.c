@@ -120,6 +120,12 @@ static ExecNodes *pgxc_FQS_find_datanodes(Query *query);
 static bool pgxc_query_needs_coord(Query *query);
 static bool pgxc_query_contains_only_pg_catalog(List *rtable);
 static bool pgxc_is_var_distrib_column(Var *var, List *rtable);
+static bool pgxc_is_var_bound_distributed(Var *var, List *rtable);
+static int pgxc_var_distkey_position(Var *var, List *rtable, int *nkeys);
+static bool pgxc_exprs_cover_distkey(List *exprs, List *rtable);
+static Expr *pgxc_find_distkey_equijoin_quals(Relids varnos_1,
+								 Relids varnos_2, List *lquals, List *rtable);
+static bool pgxc_is_distkey_equality(Expr *qual_expr, Var **lvar, Var **rvar);
 static bool pgxc_distinct_has_distcol(Query *query);
 static bool pgxc_targetlist_has_distcol(Query *query);
 static ExecNodes *pgxc_FQS_find_datanodes_recurse(Node *node, Query *query,
@@ -491,34 +497,49 @@ pgxc_FQS_get_relation_nodes(RangeTblEntry *rte, Index varno, Query *query)
 	{
 		ListCell *lc;
 		TargetEntry *tle;
+		ListCell *klc;
+		List	 *keyexprs = NIL;
 		/*
 		 * If the INSERT is happening on a table distributed by value of a
 		 * column, find out the
 		 * expression for distribution column in the targetlist, and stick in
 		 * in ExecNodes, and clear the nodelist. Execution will find
 		 * out where to insert the row.
+		 * If the table is distributed by several columns, the expression
+		 * is the key expression of the ones of all its columns.
 		 */
 		/* It is a partitioned table, get value by looking in targetList */
-		foreach(lc, query->targetList)
+		foreach(klc, rel_loc_info->partAttrNums)
 		{
-			tle = (TargetEntry *) lfirst(lc);
+			char   *keycolname = get_attname(rel_loc_info->relid,
+											 lfirst_int(klc));
 
-			if (tle->resjunk)
-				continue;
-			if (strcmp(tle->resname, GetRelationDistribColumn(rel_loc_info)) == 0)
-				break;
+			foreach(lc, query->targetList)
+			{
+				tle = (TargetEntry *) lfirst(lc);
+
+				if (tle->resjunk)
+					continue;
+				if (strcmp(tle->resname, keycolname) == 0)
+					break;
+			}
+			/* Not found, bail out */
+			if (!lc)
+				return NULL;
+
+			Assert(tle);
+			keyexprs = lappend(keyexprs, tle->expr);
 		}
-		/* Not found, bail out */
-		if (!lc)
-			return NULL;
 
-		Assert(tle);
-		/* We found the TargetEntry for the partition column */
+		/* We found the TargetEntry for the partition columns */
 		list_free(rel_exec_nodes->primarynodelist);
 		rel_exec_nodes->primarynodelist = NULL;
 		list_free(rel_exec_nodes->nodeList);
 		rel_exec_nodes->nodeList = NULL;
-		rel_exec_nodes->en_expr = tle->expr;
+		if (list_length(keyexprs) > 1)
+			rel_exec_nodes->en_expr = makeDistribKeyExpr(keyexprs);
+		else
+			rel_exec_nodes->en_expr = (Expr *) linitial(keyexprs);
 		rel_exec_nodes->en_relid = rel_loc_info->relid;
 	}
 	return rel_exec_nodes;
@@ -528,6 +549,7 @@ bool
 pgxc_query_has_distcolgrouping(Query *query)
 {
 	ListCell	*lcell;
+	List		*sgc_exprs = NIL;
 	foreach (lcell, query->groupClause)
 	{
 		SortGroupClause 	*sgc = lfirst(lcell);
@@ -538,14 +560,16 @@ pgxc_query_has_distcolgrouping(Query *query)
 		if (IsA(sgc_expr, Var) &&
 			pgxc_is_var_distrib_column((Var *)sgc_expr, query->rtable))
 			return true;
+		sgc_exprs = lappend(sgc_exprs, sgc_expr);
 	}
-	return false;
+	return pgxc_exprs_cover_distkey(sgc_exprs, query->rtable);
 }
 
 static bool
 pgxc_distinct_has_distcol(Query *query)
 {
 	ListCell	*lcell;
+	List		*sgc_exprs = NIL;
 	foreach (lcell, query->distinctClause)
 	{
 		SortGroupClause 	*sgc = lfirst(lcell);
@@ -556,8 +580,9 @@ pgxc_distinct_has_distcol(Query *query)
 		if (IsA(sgc_expr, Var) &&
 			pgxc_is_var_distrib_column((Var *)sgc_expr, query->rtable))
 			return true;
+		sgc_exprs = lappend(sgc_exprs, sgc_expr);
 	}
-	return false;
+	return pgxc_exprs_cover_distkey(sgc_exprs, query->rtable);
 }
 
 /*
@@ -1156,7 +1181,8 @@ pgxc_query_needs_coord(Query *query)
 
 /*
  * pgxc_is_var_distrib_column
- * Check if given var is a distribution key.
+ * Check if given var is a distribution key.  A column of a key made of
+ * several columns is not the distribution key by itself.
  */
 static
 bool pgxc_is_var_distrib_column(Var *var, List *rtable)
@@ -1171,12 +1197,111 @@ bool pgxc_is_var_distrib_column(Var *var, List *rtable)
 	rel_loc_info = GetRelationLocInfo(rte->relid);
 	if (!rel_loc_info)
 		return false;
+	if (IsRelationMultiColumnDistributed(rel_loc_info))
+		return false;
 	if (var->varattno == rel_loc_info->partAttrNum)
 		return true;
 	return false;
 }
 
 
+/*
+ * pgxc_is_var_bound_distributed
+ * Is the given var a column of a relation distributed by range or list?
+ */
+static bool
+pgxc_is_var_bound_distributed(Var *var, List *rtable)
+{
+	RangeTblEntry   *rte = rt_fetch(var->varno, rtable);
+	RelationLocInfo	*rel_loc_info;
+
+	if (rte->rtekind != RTE_RELATION ||
+		rte->relkind != RELKIND_RELATION)
+		return false;
+	rel_loc_info = GetRelationLocInfo(rte->relid);
+	return rel_loc_info && IsRelationBoundDistributed(rel_loc_info);
+}
+
+
+/*
+ * pgxc_var_distkey_position
+ * If given var is a column of a distribution key made of several columns,
+ * return its position in the key and set nkeys to the number of columns of
+ * the key.  Otherwise return -1.
+ */
+static int
+pgxc_var_distkey_position(Var *var, List *rtable, int *nkeys)
+{
+	RangeTblEntry   *rte;
+	RelationLocInfo	*rel_loc_info;
+	ListCell		*lc;
+	int				position = 0;
+
+	if (var->varlevelsup != 0)
+		return -1;
+	rte = rt_fetch(var->varno, rtable);
+	/* distribution column only applies to the relations */
+	if (rte->rtekind != RTE_RELATION ||
+		rte->relkind != RELKIND_RELATION)
+		return -1;
+	rel_loc_info = GetRelationLocInfo(rte->relid);
+	if (!rel_loc_info || !IsRelationMultiColumnDistributed(rel_loc_info))
+		return -1;
+
+	*nkeys = list_length(rel_loc_info->partAttrNums);
+	foreach(lc, rel_loc_info->partAttrNums)
+	{
+		if (var->varattno == lfirst_int(lc))
+			return position;
+		position++;
+	}
+	return -1;
+}
+
+
+/*
+ * pgxc_exprs_cover_distkey
+ * Check if the given expressions include all the columns of the distribution
+ * key made of several columns of one of the relations.
+ */
+static bool
+pgxc_exprs_cover_distkey(List *exprs, List *rtable)
+{
+	ListCell	*lc;
+
+	foreach(lc, exprs)
+	{
+		Var			*var = (Var *) lfirst(lc);
+		Bitmapset	*positions = NULL;
+		ListCell	*lc2;
+		int			nkeys = 0;
+
+		if (!IsA(var, Var) ||
+			pgxc_var_distkey_position(var, rtable, &nkeys) < 0)
+			continue;
+
+		/* Collect the key columns of the relation of this one */
+		foreach(lc2, exprs)
+		{
+			Var		*other = (Var *) lfirst(lc2);
+			int		position;
+			int		other_nkeys;
+
+			if (!IsA(other, Var) || other->varno != var->varno ||
+				other->varlevelsup != var->varlevelsup)
+				continue;
+			position = pgxc_var_distkey_position(other, rtable, &other_nkeys);
+			if (position >= 0)
+				positions = bms_add_member(positions, position);
+		}
+		if (bms_num_members(positions) == nkeys)
+			return true;
+		bms_free(positions);
+	}
+	return false;
+}
+
+
 /*
  * Returns whether or not the rtable (and its subqueries)
  * only contain pg_catalog entries.
@@ -1408,6 +1533,14 @@ pgxc_find_dist_equijoin_qual(Relids varnos_1,
 	else
 		lquals = (List *)quals;
 
+	/* Relations distributed by several columns are joined on all of them */
+	{
+		Expr *distkey_quals = pgxc_find_distkey_equijoin_quals(varnos_1,
+												varnos_2, lquals, rtable);
+		if (distkey_quals)
+			return distkey_quals;
+	}
+
 	foreach(qcell, lquals)
 	{
 		Expr *qual_expr = (Expr *)lfirst(qcell);
@@ -1448,6 +1581,14 @@ pgxc_find_dist_equijoin_qual(Relids varnos_1,
 			if (!pgxc_is_var_distrib_column(lvar, rtable) ||
 				!pgxc_is_var_distrib_column(rvar, rtable))
 				continue;
+			/*
+			 * Equal keys of relations distributed by range or list are on
+			 * the same node only if the relations have the same bounds,
+			 * which is not checked by the callers.
+			 */
+			if (pgxc_is_var_bound_distributed(lvar, rtable) ||
+				pgxc_is_var_bound_distributed(rvar, rtable))
+				continue;
 		}
 		else
 			continue;
@@ -1469,6 +1610,112 @@ pgxc_find_dist_equijoin_qual(Relids varnos_1,
 }
 
 
+/*
+ * pgxc_find_distkey_equijoin_quals
+ * Find equijoin conditions between every pair of columns at the same
+ * position of the distribution keys of two relations distributed by several
+ * columns, one among varnos_1 and the other among varnos_2.  The result is
+ * the AND of these conditions, or NULL if there are none.
+ */
+static Expr *
+pgxc_find_distkey_equijoin_quals(Relids varnos_1, Relids varnos_2,
+								 List *lquals, List *rtable)
+{
+	ListCell	*qcell;
+
+	foreach(qcell, lquals)
+	{
+		Expr		*qual_expr = (Expr *) lfirst(qcell);
+		Var			*lvar;
+		Var			*rvar;
+		int			nkeys;
+		int			other_nkeys;
+		Bitmapset	*positions = NULL;
+		List		*found_quals = NIL;
+		ListCell	*qcell2;
+
+		/*
+		 * Take each equality of key columns as the first one of a join of two
+		 * relations on their keys, and look for the other ones.
+		 */
+		if (!pgxc_is_distkey_equality(qual_expr, &lvar, &rvar))
+			continue;
+		if (!(bms_is_member(lvar->varno, varnos_1) &&
+			  bms_is_member(rvar->varno, varnos_2)) &&
+			!(bms_is_member(lvar->varno, varnos_2) &&
+			  bms_is_member(rvar->varno, varnos_1)))
+			continue;
+		if (pgxc_var_distkey_position(lvar, rtable, &nkeys) < 0 ||
+			pgxc_var_distkey_position(rvar, rtable, &other_nkeys) < 0 ||
+			nkeys != other_nkeys)
+			continue;
+
+		foreach(qcell2, lquals)
+		{
+			Expr	*qual_expr2 = (Expr *) lfirst(qcell2);
+			Var		*lvar2;
+			Var		*rvar2;
+			Var		*tmp;
+			int		lposition;
+			int		rposition;
+
+			if (!pgxc_is_distkey_equality(qual_expr2, &lvar2, &rvar2))
+				continue;
+			/* Both sides have to be the same relations as the first one */
+			if (lvar2->varno != lvar->varno)
+			{
+				tmp = lvar2;
+				lvar2 = rvar2;
+				rvar2 = tmp;
+			}
+			if (lvar2->varno != lvar->varno || rvar2->varno != rvar->varno)
+				continue;
+			lposition = pgxc_var_distkey_position(lvar2, rtable, &other_nkeys);
+			rposition = pgxc_var_distkey_position(rvar2, rtable, &other_nkeys);
+			if (lposition < 0 || lposition != rposition)
+				continue;
+			positions = bms_add_member(positions, lposition);
+			found_quals = lappend(found_quals, qual_expr2);
+		}
+
+		if (bms_num_members(positions) == nkeys)
+			return make_andclause(found_quals);
+		bms_free(positions);
+		list_free(found_quals);
+	}
+	return NULL;
+}
+
+
+/*
+ * pgxc_is_distkey_equality
+ * Check if the qual is an equality of two Vars of the same type, that could
+ * be columns of distribution keys, and return them.
+ */
+static bool
+pgxc_is_distkey_equality(Expr *qual_expr, Var **lvar, Var **rvar)
+{
+	OpExpr	*op;
+
+	if (!IsA(qual_expr, OpExpr))
+		return false;
+	op = (OpExpr *) qual_expr;
+	if (list_length(op->args) != 2)
+		return false;
+	if (!IsA(linitial(op->args), Var) || !IsA(lsecond(op->args), Var))
+		return false;
+	*lvar = (Var *) linitial(op->args);
+	*rvar = (Var *) lsecond(op->args);
+	/* Only columns of the same type are sure to hash the same way */
+	if (exprType((Node *) *lvar) != exprType((Node *) *rvar))
+		return false;
+	if (!op_mergejoinable(op->opno, exprType((Node *) *lvar)) &&
+		!op_hashjoinable(op->opno, exprType((Node *) *lvar)))
+		return false;
+	return true;
+}
+
+
 /*
  * pgxc_merge_exec_nodes
  * The routine combines the two exec_nodes passed such that the resultant
@@ -1697,10 +1944,12 @@ pgxc_check_index_shippability(RelationLocInfo *relLocInfo,
 
 			case LOCATOR_TYPE_HASH:
 			case LOCATOR_TYPE_MODULO:
+			case LOCATOR_TYPE_RANGE:
+			case LOCATOR_TYPE_LIST:
 				/*
-				 * Unique indexes on Hash and Modulo tables are shippable if the
-				 * index expression contains all the distribution expressions of
-				 * its parent relation.
+				 * Unique indexes on Hash, Modulo, Range and List tables are
+				 * shippable if the index expression contains all the
+				 * distribution expressions of its parent relation.
 				 *
 				 * Here is a short example with concatenate that cannot be
 				 * shipped:
@@ -1722,10 +1971,8 @@ pgxc_check_index_shippability(RelationLocInfo *relLocInfo,
 				 * INSERT INTO aa (2); -- to Datanode 1
 				 * INSERT INTO aa (-2); -- to Datanode 2, breaks uniqueness
 				 *
-				 * PGXCTODO: for the time being distribution key can only be
-				 * defined on a single column, so this will need to be changed
-				 * onde a relation distribution will be able to be defined based
-				 * on an expression of multiple columns.
+				 * A relation distributed by several columns needs all of
+				 * them in the index.
 				 */
 
 				/* Index contains expressions, it cannot be shipped safely */
@@ -1740,10 +1987,10 @@ pgxc_check_index_shippability(RelationLocInfo *relLocInfo,
 					break;
 
 				/*
-				 * Check that distribution column is included in the list of
+				 * Check that distribution columns are included in the list of
 				 * index columns.
 				 */
-				if (!list_member_int(indexAttrs, relLocInfo->partAttrNum))
+				if (list_difference_int(relLocInfo->partAttrNums, indexAttrs) != NIL)
 				{
 					/*
 					 * Distribution column is not in index column list
@@ -1760,7 +2007,6 @@ pgxc_check_index_shippability(RelationLocInfo *relLocInfo,
 				break;
 
 			/* Those types are not supported yet */
-			case LOCATOR_TYPE_RANGE:
 			case LOCATOR_TYPE_NONE:
 			case LOCATOR_TYPE_DISTRIBUTED:
 			case LOCATOR_TYPE_CUSTOM:
@@ -1875,10 +2121,58 @@ pgxc_check_fk_shippability(RelationLocInfo *parentLocInfo,
 				break;
 			}
 
+			/*
+			 * With keys of several columns, each child key column has to
+			 * reference the parent key column at the same position.
+			 */
+			if (IsRelationMultiColumnDistributed(parentLocInfo) ||
+				IsRelationMultiColumnDistributed(childLocInfo))
+			{
+				ListCell   *clc,
+						   *plc;
+
+				if (list_length(parentLocInfo->partAttrNums) !=
+						list_length(childLocInfo->partAttrNums))
+				{
+					result = false;
+					break;
+				}
+				forboth(clc, childLocInfo->partAttrNums,
+						plc, parentLocInfo->partAttrNums)
+				{
+					ListCell   *crlc,
+							   *prlc;
+					bool		found = false;
+
+					forboth(crlc, childRefs, prlc, parentRefs)
+					{
+						if (lfirst_int(crlc) == lfirst_int(clc) &&
+							lfirst_int(prlc) == lfirst_int(plc))
+						{
+							found = true;
+							break;
+						}
+					}
+					if (!found)
+					{
+						result = false;
+						break;
+					}
+				}
+			}
+
 			/* By being here, parent-child constraint can be shipped correctly */
 			break;
 
 		case LOCATOR_TYPE_RANGE:
+		case LOCATOR_TYPE_LIST:
+			/*
+			 * The parent row of a child row may be on any node unless both
+			 * relations have the same bounds, they are not compared yet.
+			 */
+			result = false;
+			break;
+
 		case LOCATOR_TYPE_NONE:
 		case LOCATOR_TYPE_DISTRIBUTED:
 		case LOCATOR_TYPE_CUSTOM:
@@ -1996,7 +2290,6 @@ bool pgxc_targetlist_has_distcol(Query *query)
 	RangeTblEntry   *rte = rt_fetch(query->resultRelation, query->rtable);
 	RelationLocInfo	*rel_loc_info;
 	ListCell   *lc;
-	const char *distcol;
 
 	/* distribution column only applies to the relations */
 	if (rte->rtekind != RTE_RELATION ||
@@ -2006,17 +2299,18 @@ bool pgxc_targetlist_has_distcol(Query *query)
 	if (!rel_loc_info)
 		return false;
 
-	distcol = GetRelationDistribColumn(rel_loc_info);
-	if (!distcol)
+	if (!IsRelationDistributedByValue(rel_loc_info))
 		return false;
 
+	/* Any of the columns of the key changes the key */
 	foreach(lc, query->targetList)
 	{
 		TargetEntry *tle = (TargetEntry *) lfirst(lc);
 
 		if (tle->resjunk)
 			continue;
-		if (strcmp(tle->resname, distcol) == 0)
+		if (list_member_int(rel_loc_info->partAttrNums,
+							get_attnum(rel_loc_info->relid, tle->resname)))
 			return true;
 	}
 	return false;
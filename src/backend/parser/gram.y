@@ -271,7 +271,7 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 		DeallocateStmt PrepareStmt ExecuteStmt
 		DropOwnedStmt ReassignOwnedStmt
 		AlterTSConfigurationStmt AlterTSDictionaryStmt
-		BarrierStmt PauseStmt AlterNodeStmt CreateNodeStmt DropNodeStmt
+		BarrierStmt PauseStmt RebalanceStmt AlterNodeStmt CreateNodeStmt DropNodeStmt
 		CreateNodeGroupStmt DropNodeGroupStmt
 		CreateMatViewStmt RefreshMatViewStmt
 
@@ -554,6 +554,8 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 /* PGXC_BEGIN */
 %type <str>		opt_barrier_id OptDistributeType
 %type <distby>	OptDistributeBy OptDistributeByInternal
+%type <list>	OptDistributeValues distribute_value_list
+%type <defelt>	distribute_value
 %type <subclus> OptSubCluster OptSubClusterInternal
 /* PGXC_END */
 %type <boolean> opt_if_not_exists
@@ -645,7 +647,7 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 
 	QUOTE
 
-	RANGE READ REAL REASSIGN RECHECK RECURSIVE REF REFERENCES REFRESH REINDEX
+	RANGE READ REAL REASSIGN REBALANCE RECHECK RECURSIVE REF REFERENCES REFRESH REINDEX
 	RELATIVE_P RELEASE RENAME REPEATABLE REPLACE REPLICA
 	RESET RESTART RESTRICT RETURNING RETURNS REVOKE RIGHT ROLE ROLLBACK ROLLUP
 	ROW ROWS RULE
@@ -892,6 +894,7 @@ stmt :
 			| PauseStmt
 			| PrepareStmt
 			| ReassignOwnedStmt
+			| RebalanceStmt
 			| ReindexStmt
 			| RemoveAggrStmt
 			| RemoveFuncStmt
@@ -3554,20 +3557,51 @@ OptDistributeBy: OptDistributeByInternal			{ $$ = $1; }
  * new distributions.
  */
 OptDistributeType: IDENT							{ $$ = $1; }
+			| RANGE									{ $$ = "range"; }
 		;
 
-OptDistributeByInternal:  DISTRIBUTE BY OptDistributeType '(' name ')'
+OptDistributeByInternal:  DISTRIBUTE BY OptDistributeType '(' name_list ')' OptDistributeValues
 				{
 					DistributeBy *n = makeNode(DistributeBy);
 					if (strcmp($3, "modulo") == 0)
 						n->disttype = DISTTYPE_MODULO;
 					else if (strcmp($3, "hash") == 0)
 						n->disttype = DISTTYPE_HASH;
+					else if (strcmp($3, "range") == 0)
+						n->disttype = DISTTYPE_RANGE;
+					else if (strcmp($3, "list") == 0)
+						n->disttype = DISTTYPE_LIST;
 					else
                         ereport(ERROR,
                                 (errcode(ERRCODE_SYNTAX_ERROR),
                                  errmsg("unrecognized distribution option \"%s\"", $3)));
-					n->colname = $5;
+					/* Only a hash can be computed of several columns */
+					if (list_length($5) > 1 && n->disttype != DISTTYPE_HASH)
+						ereport(ERROR,
+								(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+								 errmsg("%s distribution takes a single column",
+										$3),
+								 parser_errposition(@5)));
+					/* Ranges and lists give the node of each value */
+					if (n->disttype == DISTTYPE_RANGE ||
+						n->disttype == DISTTYPE_LIST)
+					{
+						if ($7 == NIL)
+							ereport(ERROR,
+									(errcode(ERRCODE_SYNTAX_ERROR),
+									 errmsg("%s distribution requires VALUES",
+											$3),
+									 parser_errposition(@3)));
+					}
+					else if ($7 != NIL)
+						ereport(ERROR,
+								(errcode(ERRCODE_SYNTAX_ERROR),
+								 errmsg("%s distribution does not take VALUES",
+										$3),
+								 parser_errposition(@7)));
+					n->colname = strVal(linitial($5));
+					n->colnames = list_length($5) > 1 ? $5 : NIL;
+					n->values = $7;
 					$$ = n;
 				}
 			| DISTRIBUTE BY OptDistributeType
@@ -3586,6 +3620,29 @@ OptDistributeByInternal:  DISTRIBUTE BY OptDistributeType '(' name ')'
 				}
 		;
 
+/*
+ * Nodes of a RANGE or LIST distribution, each given as a DefElem whose arg
+ * is NULL for the node of the lowest range, the lower bound of the range of
+ * the node, or the list of the values of the node.
+ */
+OptDistributeValues: VALUES '(' distribute_value_list ')'	{ $$ = $3; }
+			| /* EMPTY */							{ $$ = NIL; }
+		;
+
+distribute_value_list:
+			distribute_value_list ',' distribute_value	{ $$ = lappend($1, $3); }
+			| distribute_value						{ $$ = list_make1($1); }
+		;
+
+distribute_value:
+			pgxcnode_name
+				{ $$ = makeDefElem($1, NULL); }
+			| pgxcnode_name FROM a_expr
+				{ $$ = makeDefElem($1, $3); }
+			| pgxcnode_name IN_P '(' expr_list ')'
+				{ $$ = makeDefElem($1, (Node *) $4); }
+		;
+
 OptSubCluster: OptSubClusterInternal				{ $$ = $1; }
 			| /* EMPTY */							{ $$ = NULL; }
 		;
@@ -9528,6 +9585,37 @@ PauseStmt: PAUSE CLUSTER
 				}
 			;
 
+/*****************************************************************************
+ *
+ *		QUERY:
+ *		REBALANCE FROM { NODE (nodename, ...) | GROUP groupname }
+ *				[ TO { NODE (nodename, ...) | GROUP groupname } ]
+ *				[ WITH ( option [, ...] ) ]
+ *
+ *****************************************************************************/
+
+RebalanceStmt: REBALANCE FROM NODE pgxcnodes OptSubCluster opt_definition
+				{
+					RebalanceStmt *n = makeNode(RebalanceStmt);
+					n->source = makeNode(PGXCSubCluster);
+					n->source->clustertype = SUBCLUSTER_NODE;
+					n->source->members = $4;
+					n->target = $5;
+					n->options = $6;
+					$$ = (Node *)n;
+				}
+			| REBALANCE FROM GROUP_P pgxcgroup_name OptSubCluster opt_definition
+				{
+					RebalanceStmt *n = makeNode(RebalanceStmt);
+					n->source = makeNode(PGXCSubCluster);
+					n->source->clustertype = SUBCLUSTER_GROUP;
+					n->source->members = list_make1(makeString($4));
+					n->target = $5;
+					n->options = $6;
+					$$ = (Node *)n;
+				}
+			;
+
 BarrierStmt: CREATE BARRIER opt_barrier_id
 				{
 					BarrierStmt *n = makeNode(BarrierStmt);
@@ -14239,6 +14327,7 @@ unreserved_keyword:
 			| RANGE
 			| READ
 			| REASSIGN
+			| REBALANCE
 			| RECHECK
 			| RECURSIVE
 			| REF
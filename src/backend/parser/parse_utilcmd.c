@@ -165,6 +165,7 @@ static void checkLocalFKConstraints(CreateStmtContext *cxt);
 #endif
 #ifdef XCP
 static List *transformSubclusterNodes(PGXCSubCluster *subcluster);
+static List *distribution_key_colnames(CreateStmtContext *cxt);
 static PGXCSubCluster *makeSubCluster(List *nodelist);
 #endif
 
@@ -400,12 +401,34 @@ transformCreateStmt(CreateStmt *stmt, const char *queryString)
 						stmt->distributeby->disttype = DISTTYPE_HASH;
 						stmt->distributeby->colname =
 								pstrdup(rel->rd_locator_info->partAttrName);
+						if (IsRelationMultiColumnDistributed(rel->rd_locator_info))
+						{
+							List	   *colnames;
+							ListCell   *lc;
+
+							colnames = GetRelationDistribColumns(rel->rd_locator_info);
+							foreach(lc, colnames)
+								stmt->distributeby->colnames =
+										lappend(stmt->distributeby->colnames,
+												makeString((char *) lfirst(lc)));
+						}
 						break;
 					case LOCATOR_TYPE_MODULO:
 						stmt->distributeby->disttype = DISTTYPE_MODULO;
 						stmt->distributeby->colname =
 								pstrdup(rel->rd_locator_info->partAttrName);
 						break;
+					case LOCATOR_TYPE_RANGE:
+					case LOCATOR_TYPE_LIST:
+						stmt->distributeby->disttype =
+								rel->rd_locator_info->locatorType == LOCATOR_TYPE_RANGE ?
+								DISTTYPE_RANGE : DISTTYPE_LIST;
+						stmt->distributeby->colname =
+								pstrdup(rel->rd_locator_info->partAttrName);
+						/* Values of the child go to the nodes of the parent */
+						stmt->distributeby->values =
+								GetRelationDistribValues(rel->rd_locator_info);
+						break;
 					case LOCATOR_TYPE_REPLICATED:
 						stmt->distributeby->disttype = DISTTYPE_REPLICATION;
 						break;
@@ -2084,9 +2107,10 @@ transformIndexConstraint(Constraint *constraint, CreateStmtContext *cxt)
 				ListCell *lc;
 				/*
 				 * If distribution is defined check current column against
-				 * the distribution.
+				 * the distribution.  A distribution key of several columns
+				 * is checked once all the index columns are known.
 				 */
-				if (cxt->distributeby)
+				if (cxt->distributeby && cxt->distributeby->colnames == NIL)
 					isLocalSafe = CheckLocalIndexColumn (
 							ConvertToLocatorType(cxt->distributeby->disttype),
 							cxt->distributeby->colname, key);
@@ -2094,7 +2118,9 @@ transformIndexConstraint(Constraint *constraint, CreateStmtContext *cxt)
 				 * Similar, if altering existing table check against target
 				 * table distribution
 				 */
-				if (cxt->isalter)
+				if (cxt->isalter &&
+						!(cxt->rel->rd_locator_info &&
+						  IsRelationMultiColumnDistributed(cxt->rel->rd_locator_info)))
 					isLocalSafe = cxt->rel->rd_locator_info == NULL ||
 							CheckLocalIndexColumn (
 									cxt->rel->rd_locator_info->locatorType,
@@ -2131,6 +2157,20 @@ transformIndexConstraint(Constraint *constraint, CreateStmtContext *cxt)
 		index->indexParams = lappend(index->indexParams, iparam);
 	}
 #ifdef PGXC
+	if (IS_PGXC_COORDINATOR && !isLocalSafe)
+	{
+		List	   *keycolnames = distribution_key_colnames(cxt);
+
+		if (keycolnames)
+		{
+			List	   *indexcolnames = NIL;
+
+			foreach(lc, index->indexParams)
+				indexcolnames = lappend(indexcolnames,
+										((IndexElem *) lfirst(lc))->name);
+			isLocalSafe = CheckLocalIndexColumns(keycolnames, indexcolnames);
+		}
+	}
 	if (IS_PGXC_COORDINATOR && !isLocalSafe)
 	{
 		if (cxt->distributeby || cxt->isalter)
@@ -3237,6 +3277,64 @@ setSchemaName(char *context_schema, char **stmt_schema_name)
 }
 
 #ifdef PGXC
+/*
+ * distribution_key_colnames
+ *
+ * Return the names of the columns of the distribution key of the table being
+ * created or altered if it is made of several columns, NIL otherwise.
+ */
+static List *
+distribution_key_colnames(CreateStmtContext *cxt)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	if (cxt->distributeby)
+	{
+		foreach(lc, cxt->distributeby->colnames)
+			result = lappend(result, strVal(lfirst(lc)));
+	}
+	else if (cxt->isalter && cxt->rel->rd_locator_info &&
+			 IsRelationMultiColumnDistributed(cxt->rel->rd_locator_info))
+		result = GetRelationDistribColumns(cxt->rel->rd_locator_info);
+
+	return result;
+}
+
+/*
+ * CheckLocalIndexColumns
+ *
+ * Checks whether or not an index on indexcolnames can be safely enforced
+ * locally on a table distributed by several columns, partcolnames: they all
+ * have to be in the index.
+ */
+bool
+CheckLocalIndexColumns(List *partcolnames, List *indexcolnames)
+{
+	ListCell   *lc;
+
+	foreach(lc, partcolnames)
+	{
+		char	   *partcolname = (char *) lfirst(lc);
+		ListCell   *lc2;
+		bool		found = false;
+
+		foreach(lc2, indexcolnames)
+		{
+			char	   *indexcolname = (char *) lfirst(lc2);
+
+			if (indexcolname && strcmp(partcolname, indexcolname) == 0)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+	return true;
+}
+
 /*
  * CheckLocalIndexColumn
  *
@@ -3252,7 +3350,8 @@ CheckLocalIndexColumn (char loctype, char *partcolname, char *indexcolname)
 			ereport(ERROR,
 					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
 					errmsg("Cannot locally enforce a unique index on round robin distributed table.")));
-	else if (loctype == LOCATOR_TYPE_HASH || loctype == LOCATOR_TYPE_MODULO)
+	else if (loctype == LOCATOR_TYPE_HASH || loctype == LOCATOR_TYPE_MODULO ||
+			 IsLocatorBoundDistributed(loctype))
 	{
 		if (partcolname && indexcolname && strcmp(partcolname, indexcolname) == 0)
 			return true;
@@ -3440,6 +3539,12 @@ checkLocalFKConstraints(CreateStmtContext *cxt)
 					(errcode(ERRCODE_SYNTAX_ERROR),
 					 errmsg("Cannot reference a round robin table in a foreign key constraint")));
 		}
+		else if (IsLocatorBoundDistributed(rel_loc_info->locatorType))
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("Cannot reference a range or list distributed table in a foreign key constraint")));
+		}
 		else if (IsLocatorDistributedByValue(rel_loc_info->locatorType))
 		{
 			ListCell   *fklc;
@@ -3449,6 +3554,16 @@ checkLocalFKConstraints(CreateStmtContext *cxt)
 			bool		found = false;
 			List 	   *common;
 
+			/*
+			 * Foreign keys are only checked against a distribution key of a
+			 * single column.
+			 */
+			if (IsRelationMultiColumnDistributed(rel_loc_info) ||
+					distribution_key_colnames(cxt) != NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("Cannot enforce a foreign key constraint on a table distributed by several columns")));
+
 			/*
 			 * First check nodes, they must be the same as in
 			 * the referenced relation
@@ -56,13 +56,8 @@ RemoteCopy_GetRelationLoc(RemoteCopyData *state,
 	if (state->rel_loc &&
 			AttributeNumberIsValid(state->rel_loc->partAttrNum))
 	{
-		TupleDesc tdesc;
-		Form_pg_attribute pattr;
-		/* determine distribution column data type */
-		tdesc = RelationGetDescr(rel);
-
-		pattr = tdesc->attrs[state->rel_loc->partAttrNum - 1];
-		state->dist_type = pattr->atttypid;
+		/* determine distribution key data type */
+		state->dist_type = GetRelationDistribKeyType(state->rel_loc);
 	}
 	else
 		state->dist_type = InvalidOid;
@@ -92,6 +87,10 @@ RemoteCopy_BuildStatement(RemoteCopyData *state,
 	initStringInfo(&state->query_buf);
 	appendStringInfoString(&state->query_buf, "COPY ");
 
+	/* Rows to copy out are restricted through a query */
+	if (!state->is_from && options->rco_where)
+		appendStringInfoString(&state->query_buf, "(SELECT * FROM ");
+
 	/*
 	 * The table name should be qualified, unless the table is a temporary table
 	 */
@@ -104,6 +103,12 @@ RemoteCopy_BuildStatement(RemoteCopyData *state,
 								get_namespace_name(RelationGetNamespace(rel)),
 								RelationGetRelationName(rel)));
 
+	if (!state->is_from && options->rco_where)
+	{
+		Assert(attnamelist == NIL);
+		appendStringInfo(&state->query_buf, " WHERE %s)", options->rco_where);
+	}
+
 	if (attnamelist)
 	{
 		ListCell *cell;
@@ -246,6 +251,7 @@ makeRemoteCopyOptions(void)
 	res->rco_escape = NULL;
 	res->rco_force_quote = NIL;
 	res->rco_force_notnull = NIL;
+	res->rco_where = NULL;
 	return res;
 }
 
@@ -274,6 +280,8 @@ FreeRemoteCopyOptions(RemoteCopyOptions *options)
 		list_free(options->rco_force_quote);
 	if (options->rco_force_notnull)
 		list_free(options->rco_force_notnull);
+	if (options->rco_where)
+		pfree(options->rco_where);
 
 	/* Then finish the work */
 	pfree(options);
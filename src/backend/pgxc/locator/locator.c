@@ -28,20 +28,26 @@
 
 #include "postgres.h"
 #include "access/skey.h"
+#include "access/nbtree.h"
+#include "access/htup_details.h"
 #include "access/gtm.h"
 #include "access/relscan.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_type.h"
+#include "nodes/makefuncs.h"
 #include "nodes/pg_list.h"
 #include "nodes/nodeFuncs.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/catcache.h"
+#include "utils/datum.h"
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/relcache.h"
 #include "utils/tqual.h"
 #include "utils/syscache.h"
+#include "utils/typcache.h"
 #include "nodes/nodes.h"
 #include "optimizer/clauses.h"
 #include "parser/parse_coerce.h"
@@ -56,11 +62,25 @@
 #include "access/hash.h"
 #ifdef XCP
 #include "utils/date.h"
+#include "utils/uuid.h"
 #include "utils/memutils.h"
 
 /*
  * Locator details are private
  */
+/*
+ * Hash functions a HASH locator computes inline rather than through fmgr,
+ * they have to return the same values as the functions of hash_func_ptr.
+ */
+typedef enum LocatorHashKind
+{
+	LOCATOR_HASH_FMGR,			/* call hashfunc */
+	LOCATOR_HASH_INT4,			/* hashint4 */
+	LOCATOR_HASH_INT8,			/* hashint8 */
+	LOCATOR_HASH_TEXT,			/* hashtext */
+	LOCATOR_HASH_UUID			/* uuid_hash */
+} LocatorHashKind;
+
 struct _Locator
 {
 	/*
@@ -77,7 +97,21 @@ struct _Locator
 	/* XXX: move them into union ? */
 	int			roundRobinNode; /* for LOCATOR_TYPE_RROBIN */
 	LocatorHashFunc	hashfunc; /* for LOCATOR_TYPE_HASH */
+	LocatorHashKind	hashkind; /* for LOCATOR_TYPE_HASH */
+	int16	   *bucketMap; /* node index of each bucket, for LOCATOR_TYPE_HASH */
 	int 		valuelen; /* 1, 2 or 4 for LOCATOR_TYPE_MODULO */
+	/*
+	 * For LOCATOR_TYPE_RANGE and LOCATOR_TYPE_LIST, the bounds of the
+	 * relation as in RelationLocInfo, boundIndexes and nullIndex giving
+	 * positions in the node map rather than node indexes.
+	 */
+	bool		rangeBounds;	/* LOCATOR_TYPE_RANGE rather than LIST */
+	int			nbounds;
+	Datum	   *bounds;
+	int		   *boundIndexes;
+	int			nullIndex;
+	FmgrInfo	cmpfunc;
+	Oid			collation;
 
 	int			nodeCount; /* How many nodes are in the map */
 	void	   *nodeMap; /* map index to node reference according to listType */
@@ -92,6 +126,8 @@ Oid		preferred_data_node[MAX_PREFERRED_NODES];
 #ifdef XCP
 static int modulo_value_len(Oid dataType);
 static LocatorHashFunc hash_func_ptr(Oid dataType);
+static LocatorHashKind hash_kind(Oid dataType);
+static const int16 *bucket_map_lookup(Oid *nodeOids, int nodeCount);
 static int locate_static(Locator *self, Datum value, bool isnull,
 			  bool *hasprimary);
 static int locate_roundrobin(Locator *self, Datum value, bool isnull,
@@ -100,13 +136,28 @@ static int locate_hash_insert(Locator *self, Datum value, bool isnull,
 			  bool *hasprimary);
 static int locate_hash_select(Locator *self, Datum value, bool isnull,
 			  bool *hasprimary);
+static void locate_hash_batch(Locator *self, Datum *values, bool *nulls,
+			  int count, int *indexes);
 static int locate_modulo_insert(Locator *self, Datum value, bool isnull,
 			  bool *hasprimary);
 static int locate_modulo_select(Locator *self, Datum value, bool isnull,
 			  bool *hasprimary);
+static int locate_bound_insert(Locator *self, Datum value, bool isnull,
+			  bool *hasprimary);
+static int locate_bound_select(Locator *self, Datum value, bool isnull,
+			  bool *hasprimary);
+static int bound_search(char locatorType, Datum value, Datum *bounds,
+			 int nbounds, FmgrInfo *cmpfunc, Oid collation);
+static Oid *locator_node_oids(Locator *locator, void *nodeMap, List *nodeIds);
+static int node_rank(List *nodeList, int node);
 static Expr * pgxc_find_distcol_expr(Index varno,
 					   AttrNumber attrNum,
 					   Node *quals);
+static Expr *pgxc_find_distcol_value(Oid reloid, Index varno,
+						AttrNumber attrNum, Node *quals);
+static ExecNodes *locate_relation_nodes(RelationLocInfo *rel_loc_info,
+					  Locator *locator, Datum valueForDistCol,
+					  bool isValueNull, RelationAccessType accessType);
 #endif
 
 static const unsigned int xc_mod_m[] =
@@ -172,89 +223,131 @@ static const unsigned int xc_mod_r[][6] =
   {0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff}
 };
 
+/*
+ * Scores of Datanodes this close to the lowest one are considered equal
+ */
+#define LOAD_TIE_FACTOR		1.25
+
+/*
+ * Pick the least loaded of the given Datanodes, as seen from the node
+ * handles of all the sessions of this Coordinator.  The score of a node is
+ * the time a new request would take if it waited for the ones the node has
+ * not answered yet: the requests in flight plus one, times the moving average
+ * of its response time.  Nodes without any answered request yet get the best
+ * response time.  Among the nodes whose score is close to the lowest a
+ * preferred node is picked, otherwise one of them at random, so that the
+ * reads spread over nodes equally loaded.
+ *
+ * This is called when planning: all the consumers of a replicated result have
+ * to agree on its producer, see ExecInitRemoteSubplan.  A cached plan keeps
+ * the node chosen for it.
+ */
+static int
+least_loaded_node(int *members, int nmembers)
+{
+	double		scores[nmembers];
+	bool		preferred[nmembers];
+	uint32		min_latency = 0;
+	double		min_score = 0;
+	int			candidates[nmembers];
+	int			ncandidates = 0;
+	bool		has_preferred = false;
+	int			i, j;
+
+	if (nmembers == 1)
+		return members[0];
+
+	for (i = 0; i < nmembers; i++)
+	{
+		NodeLoad   *load = PGXCNodeGetLoad(members[i]);
+		uint32		latency;
+
+		scores[i] = load ? pg_atomic_read_u32(&load->latency) : 0;
+		latency = (uint32) scores[i];
+		if (latency > 0 && (min_latency == 0 || latency < min_latency))
+			min_latency = latency;
+	}
+
+	for (i = 0; i < nmembers; i++)
+	{
+		NodeLoad   *load = PGXCNodeGetLoad(members[i]);
+		int32		inflight;
+
+		/* Counts may go below zero for a while if the node was redefined */
+		inflight = load ? (int32) pg_atomic_read_u32(&load->inflight) : 0;
+		if (scores[i] == 0)
+			scores[i] = Max(min_latency, 1);
+		scores[i] *= Max(inflight, 0) + 1;
+		if (i == 0 || scores[i] < min_score)
+			min_score = scores[i];
+
+		preferred[i] = false;
+		for (j = 0; j < num_preferred_data_nodes; j++)
+		{
+			char		ntype = PGXC_NODE_DATANODE;
+
+			if (PGXCNodeGetNodeId(preferred_data_node[j], &ntype) == members[i])
+				preferred[i] = true;
+		}
+	}
+
+	for (i = 0; i < nmembers; i++)
+	{
+		if (scores[i] > min_score * LOAD_TIE_FACTOR)
+			continue;
+		if (preferred[i] && !has_preferred)
+		{
+			/* Forget the candidates that are not preferred */
+			has_preferred = true;
+			ncandidates = 0;
+		}
+		if (preferred[i] || !has_preferred)
+			candidates[ncandidates++] = members[i];
+	}
+
+	return candidates[((unsigned int) random()) % ncandidates];
+}
+
 /*
  * GetPreferredReplicationNode
- * Pick any Datanode from given list, however fetch a preferred node first.
+ * Pick the least loaded Datanode from given list, preferring a preferred
+ * node if it is not more loaded than the others.
  */
 List *
 GetPreferredReplicationNode(List *relNodes)
 {
-	ListCell	*item;
-	int			nodeid = -1;
+	ListCell   *item;
+	int			nmembers = 0;
+	int			members[list_length(relNodes) > 0 ? list_length(relNodes) : 1];
 
 	if (list_length(relNodes) <= 0)
 		elog(ERROR, "a list of nodes should have at least one node");
 
 	foreach(item, relNodes)
-	{
-		int cnt_nodes;
-		char nodetype = PGXC_NODE_DATANODE;
-		for (cnt_nodes = 0;
-				cnt_nodes < num_preferred_data_nodes && nodeid < 0;
-				cnt_nodes++)
-		{
-			if (PGXCNodeGetNodeId(preferred_data_node[cnt_nodes],
-								  &nodetype) == lfirst_int(item))
-				nodeid = lfirst_int(item);
-		}
-		if (nodeid >= 0)
-			break;
-	}
-	if (nodeid < 0)
-		return list_make1_int(linitial_int(relNodes));
+		members[nmembers++] = lfirst_int(item);
 
-	return list_make1_int(nodeid);
+	return list_make1_int(least_loaded_node(members, nmembers));
 }
 
 /*
  * GetAnyDataNode
- * Pick any data node from given set, but try a preferred node
+ * Pick the least loaded data node from given set, preferring a preferred
+ * node if it is not more loaded than the others.
  */
 int
 GetAnyDataNode(Bitmapset *nodes)
 {
-	Bitmapset  *preferred = NULL;
-	int			i, nodeid;
+	Bitmapset  *members_set = bms_copy(nodes);
+	int			nodeid;
 	int			nmembers = 0;
 	int			members[NumDataNodes];
 
-	for (i = 0; i < num_preferred_data_nodes; i++)
-	{
-		char ntype = PGXC_NODE_DATANODE;
-		nodeid = PGXCNodeGetNodeId(preferred_data_node[i], &ntype);
-
-		/* OK, found one */
-		if (bms_is_member(nodeid, nodes))
-			preferred = bms_add_member(preferred, nodeid);
-	}
-
-	/*
-	 * If no preferred data nodes or they are not in the desired set, pick up
-	 * from the original set.
-	 */
-	if (bms_is_empty(preferred))
-		preferred = bms_copy(nodes);
-
-	/*
-	 * Load balance.
-	 * We can not get item from the set, convert it to array
-	 */
-	while ((nodeid = bms_first_member(preferred)) >= 0)
+	/* We can not get item from the set, convert it to array */
+	while ((nodeid = bms_first_member(members_set)) >= 0)
 		members[nmembers++] = nodeid;
-	bms_free(preferred);
-
-	/* If there is a single member nothing to balance */
-	if (nmembers == 1)
-		return members[0];
+	bms_free(members_set);
 
-	/*
-	 * In general, the set may contain any number of nodes, and if we save
-	 * previous returned index for load balancing the distribution won't be
-	 * flat, because small set will probably reset saved value, and lower
-	 * indexes will be picked up more often.
-	 * So we just get a random value from 0..nmembers-1.
-	 */
-	return members[((unsigned int) random()) % nmembers];
+	return least_loaded_node(members, nmembers);
 }
 
 /*
@@ -377,6 +470,10 @@ IsHashColumn(RelationLocInfo *rel_loc_info, char *part_col_name)
 		ret_value = false;
 	else if (rel_loc_info->locatorType != LOCATOR_TYPE_HASH)
 		ret_value = false;
+	else if (IsRelationMultiColumnDistributed(rel_loc_info))
+		ret_value = list_member_int(rel_loc_info->partAttrNums,
+									get_attnum(rel_loc_info->relid,
+											   part_col_name));
 	else
 		ret_value = !strcmp(part_col_name, rel_loc_info->partAttrName);
 
@@ -558,7 +655,8 @@ IsLocatorInfoEqual(RelationLocInfo *rel_loc_info1, RelationLocInfo *rel_loc_info
 		return false;
 
 	/* Same attribute number? */
-	if (rel_loc_info1->partAttrNum != rel_loc_info2->partAttrNum)
+	if (rel_loc_info1->partAttrNum != rel_loc_info2->partAttrNum ||
+		!equal(rel_loc_info1->partAttrNums, rel_loc_info2->partAttrNums))
 		return false;
 
 	/* Same node list? */
@@ -566,10 +664,54 @@ IsLocatorInfoEqual(RelationLocInfo *rel_loc_info1, RelationLocInfo *rel_loc_info
 		list_difference_int(nodeList2, nodeList1) != NIL)
 		return false;
 
+	/* Same bounds or values, on the same nodes? */
+	if (IsRelationBoundDistributed(rel_loc_info1))
+	{
+		int			nslots = rel_loc_info1->nbounds;
+		int16		typlen;
+		bool		typbyval;
+		int			i;
+
+		if (rel_loc_info1->nbounds != rel_loc_info2->nbounds ||
+			rel_loc_info1->nullNode != rel_loc_info2->nullNode ||
+			rel_loc_info1->boundType != rel_loc_info2->boundType ||
+			rel_loc_info1->boundCollation != rel_loc_info2->boundCollation)
+			return false;
+
+		if (rel_loc_info1->locatorType == LOCATOR_TYPE_RANGE)
+			nslots++;
+		if (memcmp(rel_loc_info1->boundNodes, rel_loc_info2->boundNodes,
+				   nslots * sizeof(int)) != 0)
+			return false;
+
+		get_typlenbyval(rel_loc_info1->boundType, &typlen, &typbyval);
+		for (i = 0; i < rel_loc_info1->nbounds; i++)
+			if (!datumIsEqual(rel_loc_info1->bounds[i],
+							  rel_loc_info2->bounds[i], typbyval, typlen))
+				return false;
+	}
+
 	/* Everything is equal */
 	return true;
 }
 
+/*
+ * IsLocatorInfoIdentical
+ * Check if locators built from given locator information locate rows the
+ * same way: unlike IsLocatorInfoEqual, the nodes have to be in the same
+ * order, as a MODULO locator depends on their positions.
+ */
+bool
+IsLocatorInfoIdentical(RelationLocInfo *rel_loc_info1,
+					   RelationLocInfo *rel_loc_info2)
+{
+	if (rel_loc_info1 == rel_loc_info2)
+		return true;
+
+	return equal(rel_loc_info1->nodeList, rel_loc_info2->nodeList) &&
+		IsLocatorInfoEqual(rel_loc_info1, rel_loc_info2);
+}
+
 /*
  * ConvertToLocatorType
  *		get locator distribution type
@@ -594,6 +736,12 @@ ConvertToLocatorType(int disttype)
 		case DISTTYPE_MODULO:
 			loctype = LOCATOR_TYPE_MODULO;
 			break;
+		case DISTTYPE_RANGE:
+			loctype = LOCATOR_TYPE_RANGE;
+			break;
+		case DISTTYPE_LIST:
+			loctype = LOCATOR_TYPE_LIST;
+			break;
 		default:
 			ereport(ERROR,
 					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
@@ -680,6 +828,8 @@ RelationBuildLocator(Relation rel)
 	RelationLocInfo	*relationLocInfo;
 	int		j;
 	Form_pgxc_class	pgxc_class;
+	Datum		attnumsDatum;
+	bool		attnumsNull;
 
 	ScanKeyInit(&skey,
 				Anum_pgxc_class_pcrelid,
@@ -714,6 +864,21 @@ RelationBuildLocator(Relation rel)
 
 	relationLocInfo->partAttrName = get_attname(relationLocInfo->relid, pgxc_class->pcattnum);
 
+	/* Columns of the distribution key, variable length so not in the struct */
+	relationLocInfo->partAttrNums = NIL;
+	attnumsDatum = heap_getattr(htup, Anum_pgxc_class_pcattnums,
+								RelationGetDescr(pcrel), &attnumsNull);
+	if (!attnumsNull)
+	{
+		int2vector *attnums = (int2vector *) DatumGetPointer(attnumsDatum);
+
+		for (j = 0; j < attnums->dim1; j++)
+			relationLocInfo->partAttrNums =
+				lappend_int(relationLocInfo->partAttrNums, attnums->values[j]);
+	}
+	if (relationLocInfo->partAttrNums == NIL && pgxc_class->pcattnum != 0)
+		relationLocInfo->partAttrNums = list_make1_int(pgxc_class->pcattnum);
+
 	relationLocInfo->nodeList = NIL;
 
 	for (j = 0; j < pgxc_class->nodeoids.dim1; j++)
@@ -744,10 +909,196 @@ RelationBuildLocator(Relation rel)
 			relationLocInfo->roundRobinNode = relationLocInfo->roundRobinNode->next;
 	}
 
+	MemoryContextSwitchTo(oldContext);
+
+	relationLocInfo->nbounds = 0;
+	relationLocInfo->bounds = NULL;
+	relationLocInfo->boundNodes = NULL;
+	relationLocInfo->nullNode = -1;
+	relationLocInfo->boundType = InvalidOid;
+	relationLocInfo->boundCollation = InvalidOid;
+	if (IsRelationBoundDistributed(relationLocInfo))
+	{
+		Datum		valuesDatum;
+		bool		valuesNull;
+
+		valuesDatum = heap_getattr(htup, Anum_pgxc_class_pcvalues,
+								   RelationGetDescr(pcrel), &valuesNull);
+		BuildRelationLocBounds(relationLocInfo, RelationGetDescr(rel),
+							   valuesDatum, valuesNull);
+	}
+
+	/* Hot keys are stored most common first */
+	relationLocInfo->hotKeyFrac = 0;
+	if (IsRelationDistributedByValue(relationLocInfo))
+	{
+		Datum		freqsDatum;
+		bool		freqsNull;
+
+		freqsDatum = heap_getattr(htup, Anum_pgxc_class_pchotfreqs,
+								  RelationGetDescr(pcrel), &freqsNull);
+		if (!freqsNull)
+		{
+			ArrayType  *freqs = DatumGetArrayTypeP(freqsDatum);
+
+			if (ARR_NDIM(freqs) == 1 && ARR_DIMS(freqs)[0] > 0 &&
+					!ARR_HASNULL(freqs) && ARR_ELEMTYPE(freqs) == FLOAT4OID)
+				relationLocInfo->hotKeyFrac = ((float4 *) ARR_DATA_PTR(freqs))[0];
+		}
+	}
+
 	systable_endscan(pcscan);
 	heap_close(pcrel, AccessShareLock);
+}
 
-	MemoryContextSwitchTo(oldContext);
+
+/*
+ * A bound or a value of a RANGE or LIST distribution, with its node
+ */
+typedef struct BoundItem
+{
+	Datum		value;
+	int			node;
+} BoundItem;
+
+typedef struct BoundSortContext
+{
+	FmgrInfo   *cmpfunc;
+	Oid			collation;
+} BoundSortContext;
+
+static int
+cmp_bound_items(const void *a, const void *b, void *arg)
+{
+	BoundSortContext *cxt = (BoundSortContext *) arg;
+
+	return DatumGetInt32(FunctionCall2Coll(cxt->cmpfunc, cxt->collation,
+										   ((const BoundItem *) a)->value,
+										   ((const BoundItem *) b)->value));
+}
+
+/*
+ * BuildRelationLocBounds
+ * Build the bound map of a RANGE or LIST distributed relation from
+ * pgxc_class.pcvalues, whose elements are aligned with the nodes of the
+ * relation.  The map is allocated in CacheMemoryContext.
+ */
+void
+BuildRelationLocBounds(RelationLocInfo *locInfo, TupleDesc tupdesc,
+					   Datum pcvalues, bool isnull)
+{
+	Form_pg_attribute attr = tupdesc->attrs[locInfo->partAttrNum - 1];
+	Oid			keytype = getBaseType(attr->atttypid);
+	int			nnodes = list_length(locInfo->nodeList);
+	int			nslots;
+	Datum	   *texts = NULL;
+	bool	   *textnulls = NULL;
+	int			ntexts = 0;
+	BoundItem  *items = NULL;
+	int			nitems = 0;
+	int			lowest;
+	Oid			typinput;
+	Oid			typioparam;
+	int16		typlen;
+	bool		typbyval;
+	char		typalign;
+	BoundSortContext cxt;
+	int			i;
+
+	locInfo->boundType = keytype;
+	locInfo->boundCollation = attr->attcollation;
+	locInfo->nullNode = -1;
+	getTypeInputInfo(keytype, &typinput, &typioparam);
+	get_typlenbyvalalign(keytype, &typlen, &typbyval, &typalign);
+
+	if (!isnull)
+		deconstruct_array(DatumGetArrayTypeP(pcvalues), TEXTOID, -1, false,
+						  'i', &texts, &textnulls, &ntexts);
+
+	/* The lowest range goes to the first node, unless specified otherwise */
+	lowest = linitial_int(locInfo->nodeList);
+	for (i = 0; i < ntexts && i < nnodes; i++)
+	{
+		int			node = list_nth_int(locInfo->nodeList, i);
+		char	   *str;
+
+		if (textnulls[i])
+		{
+			lowest = node;
+			continue;
+		}
+		str = TextDatumGetCString(texts[i]);
+		if (locInfo->locatorType == LOCATOR_TYPE_RANGE)
+		{
+			items = items ?
+				repalloc(items, (nitems + 1) * sizeof(BoundItem)) :
+				palloc(sizeof(BoundItem));
+			items[nitems].value = OidInputFunctionCall(typinput, str,
+													   typioparam,
+													   attr->atttypmod);
+			items[nitems++].node = node;
+		}
+		else
+		{
+			Datum		array;
+			Datum	   *values;
+			bool	   *nulls;
+			int			nvalues;
+			int			j;
+
+			array = OidInputFunctionCall(F_ARRAY_IN, str, keytype,
+										 attr->atttypmod);
+			deconstruct_array(DatumGetArrayTypeP(array), keytype, typlen,
+							  typbyval, typalign, &values, &nulls, &nvalues);
+			items = items ?
+				repalloc(items, (nitems + nvalues) * sizeof(BoundItem)) :
+				palloc(nvalues * sizeof(BoundItem));
+			for (j = 0; j < nvalues; j++)
+			{
+				if (nulls[j])
+				{
+					locInfo->nullNode = node;
+					continue;
+				}
+				items[nitems].value = values[j];
+				items[nitems++].node = node;
+			}
+		}
+		pfree(str);
+	}
+
+	cxt.cmpfunc = &lookup_type_cache(keytype,
+									 TYPECACHE_CMP_PROC_FINFO)->cmp_proc_finfo;
+	cxt.collation = locInfo->boundCollation;
+	if (nitems > 1)
+		qsort_arg(items, nitems, sizeof(BoundItem), cmp_bound_items, &cxt);
+
+	nslots = locInfo->locatorType == LOCATOR_TYPE_RANGE ? nitems + 1 : nitems;
+	locInfo->nbounds = nitems;
+	locInfo->bounds = (Datum *) MemoryContextAlloc(CacheMemoryContext,
+										(nitems + 1) * sizeof(Datum));
+	locInfo->boundNodes = (int *) MemoryContextAlloc(CacheMemoryContext,
+										(nslots + 1) * sizeof(int));
+	for (i = 0; i < nitems; i++)
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(CacheMemoryContext);
+
+		locInfo->bounds[i] = datumCopy(items[i].value, typbyval, typlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	if (locInfo->locatorType == LOCATOR_TYPE_RANGE)
+	{
+		/* NULL keys go with the lowest range */
+		locInfo->boundNodes[0] = lowest;
+		for (i = 0; i < nitems; i++)
+			locInfo->boundNodes[i + 1] = items[i].node;
+		locInfo->nullNode = lowest;
+	}
+	else
+	{
+		for (i = 0; i < nitems; i++)
+			locInfo->boundNodes[i] = items[i].node;
+	}
 }
 
 /*
@@ -801,11 +1152,37 @@ CopyRelationLocInfo(RelationLocInfo * src_info)
 	dest_info->partAttrNum = src_info->partAttrNum;
 	if (src_info->partAttrName)
 		dest_info->partAttrName = pstrdup(src_info->partAttrName);
+	dest_info->partAttrNums = list_copy(src_info->partAttrNums);
 
 	if (src_info->nodeList)
 		dest_info->nodeList = list_copy(src_info->nodeList);
 	/* Note, for round robin, we use the relcache entry */
 
+	dest_info->nullNode = src_info->nullNode;
+	dest_info->boundType = src_info->boundType;
+	dest_info->boundCollation = src_info->boundCollation;
+	dest_info->hotKeyFrac = src_info->hotKeyFrac;
+	if (src_info->boundNodes)
+	{
+		int			nslots = src_info->nbounds;
+		int16		typlen;
+		bool		typbyval;
+		int			i;
+
+		if (src_info->locatorType == LOCATOR_TYPE_RANGE)
+			nslots++;
+		get_typlenbyval(src_info->boundType, &typlen, &typbyval);
+		dest_info->nbounds = src_info->nbounds;
+		dest_info->bounds = (Datum *) palloc((src_info->nbounds + 1) *
+											 sizeof(Datum));
+		for (i = 0; i < src_info->nbounds; i++)
+			dest_info->bounds[i] = datumCopy(src_info->bounds[i], typbyval,
+											 typlen);
+		dest_info->boundNodes = (int *) palloc((nslots + 1) * sizeof(int));
+		memcpy(dest_info->boundNodes, src_info->boundNodes,
+			   nslots * sizeof(int));
+	}
+
 	return dest_info;
 }
 
@@ -820,6 +1197,17 @@ FreeRelationLocInfo(RelationLocInfo *relationLocInfo)
 	{
 		if (relationLocInfo->partAttrName)
 			pfree(relationLocInfo->partAttrName);
+		list_free(relationLocInfo->partAttrNums);
+		if (relationLocInfo->boundNodes)
+		{
+			int			i;
+
+			if (!get_typbyval(relationLocInfo->boundType))
+				for (i = 0; i < relationLocInfo->nbounds; i++)
+					pfree(DatumGetPointer(relationLocInfo->bounds[i]));
+			pfree(relationLocInfo->bounds);
+			pfree(relationLocInfo->boundNodes);
+		}
 		pfree(relationLocInfo);
 	}
 }
@@ -920,103 +1308,540 @@ hash_func_ptr(Oid dataType)
 }
 
 
-Locator *
-createLocator(char locatorType, RelationAccessType accessType,
-			  Oid dataType, LocatorListType listType, int nodeCount,
-			  void *nodeList, void **result, bool primary)
+static LocatorHashKind
+hash_kind(Oid dataType)
 {
-	Locator    *locator;
-	ListCell   *lc;
-	void 	   *nodeMap = NULL;
-	int 		i;
+	switch (dataType)
+	{
+		case INT8OID:
+		case CASHOID:
+			return LOCATOR_HASH_INT8;
+		case INT4OID:
+		case ABSTIMEOID:
+		case RELTIMEOID:
+		case DATEOID:
+			return LOCATOR_HASH_INT4;
+		case VARCHAROID:
+		case TEXTOID:
+			return LOCATOR_HASH_TEXT;
+		case UUIDOID:
+			return LOCATOR_HASH_UUID;
+		default:
+			return LOCATOR_HASH_FMGR;
+	}
+}
 
-	locator = (Locator *) palloc(sizeof(Locator));
-	locator->dataType = dataType;
-	locator->listType = listType;
-	locator->nodeCount = nodeCount;
-	/* Create node map */
-	switch (listType)
+
+/*
+ * Hash a value the way hashfunc does.  When kind is a constant the compiler
+ * reduces this to the code of that kind, see locate_hash_batch.
+ */
+static inline uint32
+locator_hash(LocatorHashKind kind, LocatorHashFunc hashfunc, Datum value)
+{
+	switch (kind)
 	{
-		case LOCATOR_LIST_NONE:
-			/* No map, return indexes */
-			break;
-		case LOCATOR_LIST_INT:
-			/* Copy integer array */
-			nodeMap = palloc(nodeCount * sizeof(int));
-			memcpy(nodeMap, nodeList, nodeCount * sizeof(int));
-			break;
-		case LOCATOR_LIST_OID:
-			/* Copy array of Oids */
-			nodeMap = palloc(nodeCount * sizeof(Oid));
-			memcpy(nodeMap, nodeList, nodeCount * sizeof(Oid));
-			break;
-		case LOCATOR_LIST_POINTER:
-			/* Copy array of Oids */
-			nodeMap = palloc(nodeCount * sizeof(void *));
-			memcpy(nodeMap, nodeList, nodeCount * sizeof(void *));
-			break;
-		case LOCATOR_LIST_LIST:
-			/* Create map from list */
-		{
-			List *l = (List *) nodeList;
-			locator->nodeCount = list_length(l);
-			if (IsA(l, IntList))
-			{
-				int *intptr;
-				nodeMap = palloc(locator->nodeCount * sizeof(int));
-				intptr = (int *) nodeMap;
-				foreach(lc, l)
-					*intptr++ = lfirst_int(lc);
-				locator->listType = LOCATOR_LIST_INT;
-			}
-			else if (IsA(l, OidList))
-			{
-				Oid *oidptr;
-				nodeMap = palloc(locator->nodeCount * sizeof(Oid));
-				oidptr = (Oid *) nodeMap;
-				foreach(lc, l)
-					*oidptr++ = lfirst_oid(lc);
-				locator->listType = LOCATOR_LIST_OID;
-			}
-			else if (IsA(l, List))
+		case LOCATOR_HASH_INT4:
+			return DatumGetUInt32(hash_uint32((uint32) DatumGetInt32(value)));
+		case LOCATOR_HASH_INT8:
 			{
-				void **voidptr;
-				nodeMap = palloc(locator->nodeCount * sizeof(void *));
-				voidptr = (void **) nodeMap;
-				foreach(lc, l)
-					*voidptr++ = lfirst(lc);
-				locator->listType = LOCATOR_LIST_POINTER;
+				int64		val = DatumGetInt64(value);
+				uint32		lohalf = (uint32) val;
+				uint32		hihalf = (uint32) (val >> 32);
+
+				lohalf ^= (val >= 0) ? hihalf : ~hihalf;
+				return DatumGetUInt32(hash_uint32(lohalf));
 			}
-			else
+		case LOCATOR_HASH_TEXT:
 			{
-				/* can not get here */
-				Assert(false);
+				struct varlena *key = PG_DETOAST_DATUM_PACKED(value);
+				uint32		result;
+
+				result = DatumGetUInt32(hash_any((unsigned char *) VARDATA_ANY(key),
+												 VARSIZE_ANY_EXHDR(key)));
+				/* Avoid leaking memory for toasted inputs */
+				if ((Pointer) key != DatumGetPointer(value))
+					pfree(key);
+				return result;
 			}
-			break;
-		}
+		case LOCATOR_HASH_UUID:
+			return DatumGetUInt32(hash_any((unsigned char *) DatumGetPointer(value),
+										   UUID_LEN));
+		case LOCATOR_HASH_FMGR:
+		default:
+			return (uint32) DatumGetInt32(DirectFunctionCall1(hashfunc, value));
 	}
-	/*
-	 * Determine locatefunc, allocate results, set up parameters
-	 * specific to locator type
-	 */
-	switch (locatorType)
+}
+
+
+/*
+ * compute_distkey_hash
+ * Combine the hashes of the columns of a multi-column distribution key into
+ * the key value.  A NULL column contributes 0, so the value is never NULL.
+ */
+int32
+compute_distkey_hash(int nkeys, Oid *types, Datum *values, bool *nulls)
+{
+	uint32		result = 0;
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
 	{
-		case LOCATOR_TYPE_REPLICATED:
-			if (accessType == RELATION_ACCESS_INSERT ||
-					accessType == RELATION_ACCESS_UPDATE)
-			{
-				locator->locatefunc = locate_static;
-				if (nodeMap == NULL)
-				{
-					/* no map, prepare array with indexes */
-					int *intptr;
-					nodeMap = palloc(locator->nodeCount * sizeof(int));
-					intptr = (int *) nodeMap;
-					for (i = 0; i < locator->nodeCount; i++)
-						*intptr++ = i;
-				}
-				locator->nodeMap = nodeMap;
-				locator->results = nodeMap;
+		uint32		h = 0;
+
+		if (!nulls[i])
+			h = locator_hash(hash_kind(types[i]), hash_func_ptr(types[i]),
+							 values[i]);
+		result = (result << 5) - result + h;
+	}
+	return (int32) result;
+}
+
+
+/*
+ * pgxc_distkey_hash
+ * SQL callable compute_distkey_hash, taking the values of the key columns in
+ * key order.
+ */
+Datum
+pgxc_distkey_hash(PG_FUNCTION_ARGS)
+{
+	int			nkeys = PG_NARGS();
+	Oid		   *types;
+	Datum	   *values;
+	bool	   *nulls;
+	int32		result;
+	int			i;
+
+	if (get_fn_expr_variadic(fcinfo->flinfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("pgxc_distkey_hash does not accept a VARIADIC array")));
+
+	types = (Oid *) palloc(nkeys * sizeof(Oid));
+	values = (Datum *) palloc(nkeys * sizeof(Datum));
+	nulls = (bool *) palloc(nkeys * sizeof(bool));
+	for (i = 0; i < nkeys; i++)
+	{
+		types[i] = get_fn_expr_argtype(fcinfo->flinfo, i);
+		if (!IsTypeHashDistributable(types[i]))
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("type %s is not a hash distributable data type",
+							format_type_be(types[i]))));
+		values[i] = PG_GETARG_DATUM(i);
+		nulls[i] = PG_ARGISNULL(i);
+	}
+
+	result = compute_distkey_hash(nkeys, types, values, nulls);
+
+	pfree(types);
+	pfree(values);
+	pfree(nulls);
+
+	PG_RETURN_INT32(result);
+}
+
+
+/*
+ * Hash bucket maps
+ *
+ * Values of hash distributed tables are hashed into HASH_SIZE buckets, and
+ * each bucket is stored on one node.  A bucket goes to the node for which
+ * a hash of the bucket number and of the node name is the highest, so the
+ * map depends only on the set of nodes: tables distributed on the same nodes
+ * are co-located, and when a node is added or removed only the buckets this
+ * node gains or loses change of node, about 1/N of the data.
+ *
+ * Maps are cached by backend, as building one takes HASH_SIZE hashes per
+ * node.
+ */
+typedef struct BucketMapEntry
+{
+	int			nodeCount;
+	Oid		   *nodeOids;			/* node at each index of the map */
+	int16		map[HASH_SIZE];		/* node index of each bucket */
+} BucketMapEntry;
+
+#define BUCKET_MAP_CACHE_SIZE 16
+
+static BucketMapEntry *bucketMapCache[BUCKET_MAP_CACHE_SIZE];
+static int	bucketMapCacheNext = 0;
+
+/*
+ * Return the bucket map of the given nodes, building it if not cached yet.
+ * The result is only valid until the next call.
+ */
+static const int16 *
+bucket_map_lookup(Oid *nodeOids, int nodeCount)
+{
+	BucketMapEntry *entry;
+	uint32	   *nodeKeys;
+	int			bucket;
+	int			i;
+
+	for (i = 0; i < BUCKET_MAP_CACHE_SIZE; i++)
+	{
+		entry = bucketMapCache[i];
+		if (entry && entry->nodeCount == nodeCount &&
+			memcmp(entry->nodeOids, nodeOids, nodeCount * sizeof(Oid)) == 0)
+			return entry->map;
+	}
+
+	/* Identify each node by the hash of its name, which is cluster-wide */
+	nodeKeys = (uint32 *) palloc(nodeCount * sizeof(uint32));
+	for (i = 0; i < nodeCount; i++)
+	{
+		char	   *nodename = get_pgxc_nodename(nodeOids[i]);
+
+		nodeKeys[i] = DatumGetUInt32(hash_any((unsigned char *) nodename,
+											  strlen(nodename)));
+		pfree(nodename);
+	}
+
+	entry = (BucketMapEntry *) MemoryContextAlloc(TopMemoryContext,
+												  sizeof(BucketMapEntry));
+	entry->nodeCount = nodeCount;
+	entry->nodeOids = (Oid *) MemoryContextAlloc(TopMemoryContext,
+												 nodeCount * sizeof(Oid));
+	memcpy(entry->nodeOids, nodeOids, nodeCount * sizeof(Oid));
+
+	for (bucket = 0; bucket < HASH_SIZE; bucket++)
+	{
+		uint32		bucketKey = DatumGetUInt32(hash_uint32((uint32) bucket));
+		uint32		best = 0;
+		int			bestIndex = 0;
+
+		for (i = 0; i < nodeCount; i++)
+		{
+			uint32		weight;
+
+			weight = DatumGetUInt32(hash_uint32(bucketKey ^ nodeKeys[i]));
+			/* Break ties on the node so that the order of nodes does not matter */
+			if (i == 0 || weight > best ||
+				(weight == best && nodeKeys[i] < nodeKeys[bestIndex]))
+			{
+				best = weight;
+				bestIndex = i;
+			}
+		}
+		entry->map[bucket] = (int16) bestIndex;
+	}
+	pfree(nodeKeys);
+
+	/* Replace the oldest entry of the cache */
+	if (bucketMapCache[bucketMapCacheNext])
+	{
+		pfree(bucketMapCache[bucketMapCacheNext]->nodeOids);
+		pfree(bucketMapCache[bucketMapCacheNext]);
+	}
+	bucketMapCache[bucketMapCacheNext] = entry;
+	bucketMapCacheNext = (bucketMapCacheNext + 1) % BUCKET_MAP_CACHE_SIZE;
+
+	return entry->map;
+}
+
+
+/*
+ * GetHashBucketMap
+ * Return a palloc'd array giving for each hash bucket the position in
+ * nodeList, a list of Datanode indexes, of the node storing it.
+ */
+int16 *
+GetHashBucketMap(List *nodeList)
+{
+	int			nodeCount = list_length(nodeList);
+	Oid		   *nodeOids;
+	int16	   *result;
+	ListCell   *lc;
+	int			i = 0;
+
+	Assert(nodeCount > 0);
+
+	nodeOids = (Oid *) palloc(nodeCount * sizeof(Oid));
+	foreach(lc, nodeList)
+		nodeOids[i++] = PGXCNodeGetNodeOid(lfirst_int(lc), PGXC_NODE_DATANODE);
+
+	result = (int16 *) palloc(HASH_SIZE * sizeof(int16));
+	memcpy(result, bucket_map_lookup(nodeOids, nodeCount),
+		   HASH_SIZE * sizeof(int16));
+	pfree(nodeOids);
+
+	return result;
+}
+
+
+/*
+ * Oids of the nodes of the node map of a locator.  Unless given separately
+ * as a list of Datanode indexes, the nodes are determined from the node map:
+ * integers are indexes of Datanodes, and pointers are Datanode connection
+ * handles.
+ */
+static Oid *
+locator_node_oids(Locator *locator, void *nodeMap, List *nodeIds)
+{
+	Oid		   *nodeOids;
+	int			i;
+
+	Assert(nodeIds == NIL || list_length(nodeIds) == locator->nodeCount);
+
+	nodeOids = (Oid *) palloc(locator->nodeCount * sizeof(Oid));
+	for (i = 0; i < locator->nodeCount; i++)
+	{
+		if (nodeIds != NIL)
+			nodeOids[i] = PGXCNodeGetNodeOid(list_nth_int(nodeIds, i),
+											 PGXC_NODE_DATANODE);
+		else if (locator->listType == LOCATOR_LIST_INT)
+			nodeOids[i] = PGXCNodeGetNodeOid(((int *) nodeMap)[i],
+											 PGXC_NODE_DATANODE);
+		else if (locator->listType == LOCATOR_LIST_OID)
+			nodeOids[i] = ((Oid *) nodeMap)[i];
+		else if (locator->listType == LOCATOR_LIST_POINTER)
+			nodeOids[i] = ((PGXCNodeHandle **) nodeMap)[i]->nodeoid;
+		else
+			nodeOids[i] = PGXCNodeGetNodeOid(i, PGXC_NODE_DATANODE);
+	}
+	return nodeOids;
+}
+
+
+/*
+ * Position in the node map of nodeOids of the given Datanode index
+ */
+static int
+locator_node_position(Oid *nodeOids, int nodeCount, int node)
+{
+	Oid			nodeOid = PGXCNodeGetNodeOid(node, PGXC_NODE_DATANODE);
+	int			i;
+
+	for (i = 0; i < nodeCount; i++)
+		if (nodeOids[i] == nodeOid)
+			return i;
+	elog(ERROR, "node %s of the distribution is not in the locator node map",
+		 get_pgxc_nodename(nodeOid));
+	return -1;					/* keep compiler quiet */
+}
+
+
+/*
+ * createRelationLocator
+ * Create a locator for the rows of a relation, as createLocator would for
+ * its locator type and distribution key type.  nodeList has to hold all the
+ * nodes of a RANGE or LIST distributed relation, whose bounds are copied
+ * into the locator.
+ */
+Locator *
+createRelationLocator(RelationLocInfo *locInfo, RelationAccessType accessType,
+					  LocatorListType listType, int nodeCount, void *nodeList,
+					  void **result, bool primary)
+{
+	Locator    *locator;
+	Oid			keytype = InvalidOid;
+	Oid		   *nodeOids;
+	int16		typlen;
+	bool		typbyval;
+	int			nslots;
+	int			i;
+
+	if (IsRelationDistributedByValue(locInfo))
+		keytype = GetRelationDistribKeyType(locInfo);
+
+	locator = createLocator(locInfo->locatorType, accessType, keytype,
+							listType, nodeCount, nodeList, result, primary);
+	if (!IsRelationBoundDistributed(locInfo))
+		return locator;
+
+	nslots = locInfo->nbounds;
+	if (locInfo->locatorType == LOCATOR_TYPE_RANGE)
+		nslots++;
+
+	get_typlenbyval(locInfo->boundType, &typlen, &typbyval);
+	locator->rangeBounds = (locInfo->locatorType == LOCATOR_TYPE_RANGE);
+	locator->nbounds = locInfo->nbounds;
+	locator->bounds = (Datum *) palloc((locInfo->nbounds + 1) * sizeof(Datum));
+	for (i = 0; i < locInfo->nbounds; i++)
+		locator->bounds[i] = datumCopy(locInfo->bounds[i], typbyval, typlen);
+
+	nodeOids = locator_node_oids(locator, locator->nodeMap, NIL);
+	locator->boundIndexes = (int *) palloc((nslots + 1) * sizeof(int));
+	for (i = 0; i < nslots; i++)
+		locator->boundIndexes[i] = locator_node_position(nodeOids,
+														 locator->nodeCount,
+														 locInfo->boundNodes[i]);
+	if (locInfo->nullNode >= 0)
+		locator->nullIndex = locator_node_position(nodeOids,
+												   locator->nodeCount,
+												   locInfo->nullNode);
+	pfree(nodeOids);
+
+	fmgr_info_copy(&locator->cmpfunc,
+				   &lookup_type_cache(locInfo->boundType,
+									  TYPECACHE_CMP_PROC_FINFO)->cmp_proc_finfo,
+				   CurrentMemoryContext);
+	locator->collation = locInfo->boundCollation;
+
+	return locator;
+}
+
+
+/*
+ * RelationGetLocator
+ * Return the locator of the rows of a relation for given access type, as
+ * GetRelationNodes would create it, or NULL if it would change while locating
+ * rows, as round robin locators do.  It is built when first needed and kept
+ * with the relcache entry, which frees it when invalidated, so the caller
+ * must keep the relation open while using it and must not free it.  Nothing
+ * is allocated while locating rows with it; its results array is overwritten
+ * by each call.
+ */
+Locator *
+RelationGetLocator(Relation rel, RelationAccessType accessType)
+{
+	RelationLocInfo *locInfo = RelationGetLocInfo(rel);
+	MemoryContext oldcontext;
+
+	if (locInfo == NULL)
+		return NULL;
+
+	/* Locators using locate_roundrobin move on to the next node */
+	if ((locInfo->locatorType == LOCATOR_TYPE_REPLICATED &&
+		 accessType != RELATION_ACCESS_INSERT &&
+		 accessType != RELATION_ACCESS_UPDATE) ||
+		(locInfo->locatorType == LOCATOR_TYPE_RROBIN &&
+		 accessType == RELATION_ACCESS_INSERT))
+		return NULL;
+
+	if (rel->rd_locators[accessType])
+		return rel->rd_locators[accessType];
+
+	if (rel->rd_locatorcxt == NULL)
+		rel->rd_locatorcxt = AllocSetContextCreate(CacheMemoryContext,
+												   RelationGetRelationName(rel),
+												   ALLOCSET_SMALL_MINSIZE,
+												   ALLOCSET_SMALL_INITSIZE,
+												   ALLOCSET_SMALL_MAXSIZE);
+	oldcontext = MemoryContextSwitchTo(rel->rd_locatorcxt);
+	rel->rd_locators[accessType] =
+		createRelationLocator(locInfo, accessType, LOCATOR_LIST_LIST, 0,
+							  (void *) locInfo->nodeList, NULL, false);
+	MemoryContextSwitchTo(oldcontext);
+
+	return rel->rd_locators[accessType];
+}
+
+
+Locator *
+createLocator(char locatorType, RelationAccessType accessType,
+			  Oid dataType, LocatorListType listType, int nodeCount,
+			  void *nodeList, void **result, bool primary)
+{
+	return createLocatorExtended(locatorType, accessType, dataType, listType,
+								 nodeCount, nodeList, NIL, result, primary);
+}
+
+
+Locator *
+createLocatorExtended(char locatorType, RelationAccessType accessType,
+			  Oid dataType, LocatorListType listType, int nodeCount,
+			  void *nodeList, List *nodeIds, void **result, bool primary)
+{
+	Locator    *locator;
+	ListCell   *lc;
+	void 	   *nodeMap = NULL;
+	int 		i;
+
+	locator = (Locator *) palloc(sizeof(Locator));
+	locator->dataType = dataType;
+	locator->listType = listType;
+	locator->nodeCount = nodeCount;
+	locator->bucketMap = NULL;
+	locator->nbounds = 0;
+	locator->bounds = NULL;
+	locator->boundIndexes = NULL;
+	locator->nullIndex = -1;
+	/* Create node map */
+	switch (listType)
+	{
+		case LOCATOR_LIST_NONE:
+			/* No map, return indexes */
+			break;
+		case LOCATOR_LIST_INT:
+			/* Copy integer array */
+			nodeMap = palloc(nodeCount * sizeof(int));
+			memcpy(nodeMap, nodeList, nodeCount * sizeof(int));
+			break;
+		case LOCATOR_LIST_OID:
+			/* Copy array of Oids */
+			nodeMap = palloc(nodeCount * sizeof(Oid));
+			memcpy(nodeMap, nodeList, nodeCount * sizeof(Oid));
+			break;
+		case LOCATOR_LIST_POINTER:
+			/* Copy array of Oids */
+			nodeMap = palloc(nodeCount * sizeof(void *));
+			memcpy(nodeMap, nodeList, nodeCount * sizeof(void *));
+			break;
+		case LOCATOR_LIST_LIST:
+			/* Create map from list */
+		{
+			List *l = (List *) nodeList;
+			locator->nodeCount = list_length(l);
+			if (IsA(l, IntList))
+			{
+				int *intptr;
+				nodeMap = palloc(locator->nodeCount * sizeof(int));
+				intptr = (int *) nodeMap;
+				foreach(lc, l)
+					*intptr++ = lfirst_int(lc);
+				locator->listType = LOCATOR_LIST_INT;
+			}
+			else if (IsA(l, OidList))
+			{
+				Oid *oidptr;
+				nodeMap = palloc(locator->nodeCount * sizeof(Oid));
+				oidptr = (Oid *) nodeMap;
+				foreach(lc, l)
+					*oidptr++ = lfirst_oid(lc);
+				locator->listType = LOCATOR_LIST_OID;
+			}
+			else if (IsA(l, List))
+			{
+				void **voidptr;
+				nodeMap = palloc(locator->nodeCount * sizeof(void *));
+				voidptr = (void **) nodeMap;
+				foreach(lc, l)
+					*voidptr++ = lfirst(lc);
+				locator->listType = LOCATOR_LIST_POINTER;
+			}
+			else
+			{
+				/* can not get here */
+				Assert(false);
+			}
+			break;
+		}
+	}
+	/*
+	 * Determine locatefunc, allocate results, set up parameters
+	 * specific to locator type
+	 */
+	switch (locatorType)
+	{
+		case LOCATOR_TYPE_REPLICATED:
+			if (accessType == RELATION_ACCESS_INSERT ||
+					accessType == RELATION_ACCESS_UPDATE)
+			{
+				locator->locatefunc = locate_static;
+				if (nodeMap == NULL)
+				{
+					/* no map, prepare array with indexes */
+					int *intptr;
+					nodeMap = palloc(locator->nodeCount * sizeof(int));
+					intptr = (int *) nodeMap;
+					for (i = 0; i < locator->nodeCount; i++)
+						*intptr++ = i;
+				}
+				locator->nodeMap = nodeMap;
+				locator->results = nodeMap;
 			}
 			else
 			{
@@ -1132,6 +1957,20 @@ createLocator(char locatorType, RelationAccessType accessType,
 			if (locator->hashfunc == NULL)
 				ereport(ERROR, (errmsg("Error: unsupported data type for HASH locator: %d\n",
 								   dataType)));
+			locator->hashkind = hash_kind(dataType);
+
+			/* Get the bucket map of the nodes */
+			if (locator->nodeCount > 0)
+			{
+				Oid		   *nodeOids;
+
+				nodeOids = locator_node_oids(locator, nodeMap, nodeIds);
+				locator->bucketMap = (int16 *) palloc(HASH_SIZE * sizeof(int16));
+				memcpy(locator->bucketMap,
+					   bucket_map_lookup(nodeOids, locator->nodeCount),
+					   HASH_SIZE * sizeof(int16));
+				pfree(nodeOids);
+			}
 			break;
 		case LOCATOR_TYPE_MODULO:
 			if (accessType == RELATION_ACCESS_INSERT)
@@ -1184,43 +2023,98 @@ createLocator(char locatorType, RelationAccessType accessType,
 				ereport(ERROR, (errmsg("Error: unsupported data type for MODULO locator: %d\n",
 								   dataType)));
 			break;
-		default:
-			ereport(ERROR, (errmsg("Error: no such supported locator type: %c\n",
-								   locatorType)));
-	}
-
-	if (result)
-		*result = locator->results;
-
-	return locator;
-}
-
-
-void
-freeLocator(Locator *locator)
-{
-	pfree(locator->nodeMap);
-	/*
-	 * locator->nodeMap and locator->results may point to the same memory,
-	 * do not free it twice
-	 */
-	if (locator->results != locator->nodeMap)
-		pfree(locator->results);
-	pfree(locator);
-}
-
-
-/*
- * Each time return the same predefined results
- */
-static int
-locate_static(Locator *self, Datum value, bool isnull,
-			  bool *hasprimary)
-{
-	/* TODO */
-	if (hasprimary)
-		*hasprimary = false;
-	return self->nodeCount;
+		case LOCATOR_TYPE_RANGE:
+		case LOCATOR_TYPE_LIST:
+			/* The bounds are set up by createRelationLocator */
+			if (accessType == RELATION_ACCESS_INSERT)
+			{
+				locator->locatefunc = locate_bound_insert;
+				locator->nodeMap = nodeMap;
+				switch (locator->listType)
+				{
+					case LOCATOR_LIST_NONE:
+					case LOCATOR_LIST_INT:
+						locator->results = palloc(sizeof(int));
+						break;
+					case LOCATOR_LIST_OID:
+						locator->results = palloc(sizeof(Oid));
+						break;
+					case LOCATOR_LIST_POINTER:
+						locator->results = palloc(sizeof(void *));
+						break;
+					case LOCATOR_LIST_LIST:
+						/* Should never happen */
+						Assert(false);
+						break;
+				}
+			}
+			else
+			{
+				locator->locatefunc = locate_bound_select;
+				locator->nodeMap = nodeMap;
+				switch (locator->listType)
+				{
+					case LOCATOR_LIST_NONE:
+					case LOCATOR_LIST_INT:
+						locator->results = palloc(locator->nodeCount * sizeof(int));
+						break;
+					case LOCATOR_LIST_OID:
+						locator->results = palloc(locator->nodeCount * sizeof(Oid));
+						break;
+					case LOCATOR_LIST_POINTER:
+						locator->results = palloc(locator->nodeCount * sizeof(void *));
+						break;
+					case LOCATOR_LIST_LIST:
+						/* Should never happen */
+						Assert(false);
+						break;
+				}
+			}
+			break;
+		default:
+			ereport(ERROR, (errmsg("Error: no such supported locator type: %c\n",
+								   locatorType)));
+	}
+
+	if (result)
+		*result = locator->results;
+
+	return locator;
+}
+
+
+void
+freeLocator(Locator *locator)
+{
+	pfree(locator->nodeMap);
+	/*
+	 * locator->nodeMap and locator->results may point to the same memory,
+	 * do not free it twice
+	 */
+	if (locator->results != locator->nodeMap)
+		pfree(locator->results);
+	if (locator->bucketMap)
+		pfree(locator->bucketMap);
+	if (locator->boundIndexes)
+	{
+		pfree(locator->bounds);
+		pfree(locator->boundIndexes);
+	}
+	pfree(locator);
+}
+
+
+/*
+ * Each time return the same predefined results
+ */
+static int
+locate_static(Locator *self, Datum value, bool isnull,
+			  bool *hasprimary)
+{
+	/* TODO */
+	if (hasprimary)
+		*hasprimary = false;
+	return self->nodeCount;
 }
 
 
@@ -1263,7 +2157,44 @@ locate_roundrobin(Locator *self, Datum value, bool isnull,
 
 
 /*
- * Calculate hash from supplied value and use modulo by nodeCount as an index
+ * Node indexes of a batch of values for locate_hash_insert.  The loop is
+ * written for each kind of hash, so that the hash is computed inline.
+ */
+#define LOCATE_HASH_BATCH(kind) \
+	for (i = 0; i < count; i++) \
+		indexes[i] = nulls[i] ? self->bucketMap[0] : \
+			self->bucketMap[locator_hash(kind, self->hashfunc, values[i]) & HASH_MASK]
+
+static void
+locate_hash_batch(Locator *self, Datum *values, bool *nulls, int count,
+				  int *indexes)
+{
+	int			i;
+
+	switch (self->hashkind)
+	{
+		case LOCATOR_HASH_INT4:
+			LOCATE_HASH_BATCH(LOCATOR_HASH_INT4);
+			break;
+		case LOCATOR_HASH_INT8:
+			LOCATE_HASH_BATCH(LOCATOR_HASH_INT8);
+			break;
+		case LOCATOR_HASH_TEXT:
+			LOCATE_HASH_BATCH(LOCATOR_HASH_TEXT);
+			break;
+		case LOCATOR_HASH_UUID:
+			LOCATE_HASH_BATCH(LOCATOR_HASH_UUID);
+			break;
+		case LOCATOR_HASH_FMGR:
+			LOCATE_HASH_BATCH(LOCATOR_HASH_FMGR);
+			break;
+	}
+}
+
+
+/*
+ * Calculate hash from supplied value and use the node of its bucket as an
+ * index. NULL values are in bucket 0.
  */
 static int
 locate_hash_insert(Locator *self, Datum value, bool isnull,
@@ -1273,14 +2204,14 @@ locate_hash_insert(Locator *self, Datum value, bool isnull,
 	if (hasprimary)
 		*hasprimary = false;
 	if (isnull)
-		index = 0;
+		index = self->bucketMap[0];
 	else
 	{
 		unsigned int hash32;
 
-		hash32 = (unsigned int) DatumGetInt32(DirectFunctionCall1(self->hashfunc, value));
+		hash32 = locator_hash(self->hashkind, self->hashfunc, value);
 
-		index = compute_modulo(hash32, self->nodeCount);
+		index = self->bucketMap[hash32 & HASH_MASK];
 	}
 	switch (self->listType)
 	{
@@ -1306,8 +2237,8 @@ locate_hash_insert(Locator *self, Datum value, bool isnull,
 
 
 /*
- * Calculate hash from supplied value and use modulo by nodeCount as an index
- * if value is NULL assume no hint and return all the nodes.
+ * Calculate hash from supplied value and use the node of its bucket as an
+ * index if value is NULL assume no hint and return all the nodes.
  */
 static int
 locate_hash_select(Locator *self, Datum value, bool isnull,
@@ -1348,9 +2279,9 @@ locate_hash_select(Locator *self, Datum value, bool isnull,
 		unsigned int hash32;
 		int 		 index;
 
-		hash32 = (unsigned int) DatumGetInt32(DirectFunctionCall1(self->hashfunc, value));
+		hash32 = locator_hash(self->hashkind, self->hashfunc, value);
 
-		index = compute_modulo(hash32, self->nodeCount);
+		index = self->bucketMap[hash32 & HASH_MASK];
 		switch (self->listType)
 		{
 			case LOCATOR_LIST_NONE:
@@ -1375,6 +2306,22 @@ locate_hash_select(Locator *self, Datum value, bool isnull,
 }
 
 
+/*
+ * Value of a MODULO distributed column the modulo is computed from
+ */
+static inline unsigned int
+modulo_value(Locator *self, Datum value)
+{
+	if (self->valuelen == 4)
+		return (unsigned int) (GET_4_BYTES(value));
+	else if (self->valuelen == 2)
+		return (unsigned int) (GET_2_BYTES(value));
+	else if (self->valuelen == 1)
+		return (unsigned int) (GET_1_BYTE(value));
+	return 0;
+}
+
+
 /*
  * Use modulo of supplied value by nodeCount as an index
  */
@@ -1391,14 +2338,7 @@ locate_modulo_insert(Locator *self, Datum value, bool isnull,
 	{
 		unsigned int mod32;
 
-		if (self->valuelen == 4)
-			mod32 = (unsigned int) (GET_4_BYTES(value));
-		else if (self->valuelen == 2)
-			mod32 = (unsigned int) (GET_2_BYTES(value));
-		else if (self->valuelen == 1)
-			mod32 = (unsigned int) (GET_1_BYTE(value));
-		else
-			mod32 = 0;
+		mod32 = modulo_value(self, value);
 
 		index = compute_modulo(mod32, self->nodeCount);
 	}
@@ -1468,14 +2408,7 @@ locate_modulo_select(Locator *self, Datum value, bool isnull,
 		unsigned int mod32;
 		int 		 index;
 
-		if (self->valuelen == 4)
-			mod32 = (unsigned int) (GET_4_BYTES(value));
-		else if (self->valuelen == 2)
-			mod32 = (unsigned int) (GET_2_BYTES(value));
-		else if (self->valuelen == 1)
-			mod32 = (unsigned int) (GET_1_BYTE(value));
-		else
-			mod32 = 0;
+		mod32 = modulo_value(self, value);
 
 		index = compute_modulo(mod32, self->nodeCount);
 
@@ -1503,6 +2436,185 @@ locate_modulo_select(Locator *self, Datum value, bool isnull,
 }
 
 
+/*
+ * Search a sorted array of bounds.  For a RANGE return the number of bounds
+ * lower than or equal to value, which is the number of the range of value,
+ * for a LIST return the position of the value equal to value, or -1.
+ */
+static int
+bound_search(char locatorType, Datum value, Datum *bounds, int nbounds,
+			 FmgrInfo *cmpfunc, Oid collation)
+{
+	int			low = 0;
+	int			high = nbounds;
+
+	/* Find the first bound greater than value */
+	while (low < high)
+	{
+		int			mid = (low + high) / 2;
+		int32		cmp;
+
+		cmp = DatumGetInt32(FunctionCall2Coll(cmpfunc, collation,
+											  bounds[mid], value));
+		if (cmp <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (locatorType == LOCATOR_TYPE_RANGE)
+		return low;
+	if (low > 0 &&
+		DatumGetInt32(FunctionCall2Coll(cmpfunc, collation,
+										bounds[low - 1], value)) == 0)
+		return low - 1;
+	return -1;
+}
+
+
+/*
+ * Position in the node map of the node storing value, erroring out if a
+ * LIST has no node for it
+ */
+static int
+bound_index(Locator *self, Datum value, bool isnull)
+{
+	int			slot;
+
+	if (isnull)
+	{
+		if (self->nullIndex < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_CHECK_VIOLATION),
+					 errmsg("no Datanode is listed for NULL distribution key values")));
+		return self->nullIndex;
+	}
+
+	slot = bound_search(self->rangeBounds ? LOCATOR_TYPE_RANGE :
+						LOCATOR_TYPE_LIST,
+						value, self->bounds, self->nbounds,
+						&self->cmpfunc, self->collation);
+	if (slot < 0)
+	{
+		Oid			typoutput;
+		bool		typisvarlena;
+
+		getTypeOutputInfo(self->dataType, &typoutput, &typisvarlena);
+		ereport(ERROR,
+				(errcode(ERRCODE_CHECK_VIOLATION),
+				 errmsg("no Datanode is listed for distribution key value %s",
+						OidOutputFunctionCall(typoutput, value))));
+	}
+	return self->boundIndexes[slot];
+}
+
+
+/*
+ * Store the value in the node of its range or of its list, NULL values in
+ * the node of the lowest range or in the node listing NULL.
+ */
+static int
+locate_bound_insert(Locator *self, Datum value, bool isnull,
+					bool *hasprimary)
+{
+	int			index = bound_index(self, value, isnull);
+
+	if (hasprimary)
+		*hasprimary = false;
+	switch (self->listType)
+	{
+		case LOCATOR_LIST_NONE:
+			((int *) self->results)[0] = index;
+			break;
+		case LOCATOR_LIST_INT:
+			((int *) self->results)[0] = ((int *) self->nodeMap)[index];
+			break;
+		case LOCATOR_LIST_OID:
+			((Oid *) self->results)[0] = ((Oid *) self->nodeMap)[index];
+			break;
+		case LOCATOR_LIST_POINTER:
+			((void **) self->results)[0] = ((void **) self->nodeMap)[index];
+			break;
+		case LOCATOR_LIST_LIST:
+			/* Should never happen */
+			Assert(false);
+			break;
+	}
+	return 1;
+}
+
+
+/*
+ * Return the node of the range or of the list of value.  If value is NULL
+ * assume no hint and return all the nodes, as for a value no list holds.
+ */
+static int
+locate_bound_select(Locator *self, Datum value, bool isnull,
+					bool *hasprimary)
+{
+	int			slot = -1;
+	int			index;
+
+	if (hasprimary)
+		*hasprimary = false;
+	if (!isnull)
+		slot = bound_search(self->rangeBounds ? LOCATOR_TYPE_RANGE :
+							LOCATOR_TYPE_LIST,
+							value, self->bounds, self->nbounds,
+							&self->cmpfunc, self->collation);
+	if (slot < 0)
+	{
+		int i;
+		switch (self->listType)
+		{
+			case LOCATOR_LIST_NONE:
+				for (i = 0; i < self->nodeCount; i++)
+					((int *) self->results)[i] = i;
+				break;
+			case LOCATOR_LIST_INT:
+				memcpy(self->results, self->nodeMap,
+					   self->nodeCount * sizeof(int));
+				break;
+			case LOCATOR_LIST_OID:
+				memcpy(self->results, self->nodeMap,
+					   self->nodeCount * sizeof(Oid));
+				break;
+			case LOCATOR_LIST_POINTER:
+				memcpy(self->results, self->nodeMap,
+					   self->nodeCount * sizeof(void *));
+				break;
+			case LOCATOR_LIST_LIST:
+				/* Should never happen */
+				Assert(false);
+				break;
+		}
+		return self->nodeCount;
+	}
+
+	index = self->boundIndexes[slot];
+	switch (self->listType)
+	{
+		case LOCATOR_LIST_NONE:
+			((int *) self->results)[0] = index;
+			break;
+		case LOCATOR_LIST_INT:
+			((int *) self->results)[0] = ((int *) self->nodeMap)[index];
+			break;
+		case LOCATOR_LIST_OID:
+			((Oid *) self->results)[0] = ((Oid *) self->nodeMap)[index];
+			break;
+		case LOCATOR_LIST_POINTER:
+			((void **) self->results)[0] = ((void **) self->nodeMap)[index];
+			break;
+		case LOCATOR_LIST_LIST:
+			/* Should never happen */
+			Assert(false);
+			break;
+	}
+	return 1;
+}
+
+
 int
 GET_NODES(Locator *self, Datum value, bool isnull, bool *hasprimary)
 {
@@ -1510,6 +2622,55 @@ GET_NODES(Locator *self, Datum value, bool isnull, bool *hasprimary)
 }
 
 
+/*
+ * Determine the nodes of count values at once, saving a call per value.  Only
+ * locators storing each value on a single node can do it, see
+ * isLocatorSingleNode.  indexes[i] is set to the position in the node map of
+ * the node of values[i].
+ */
+void
+GET_NODES_BATCH(Locator *self, Datum *values, bool *nulls, int count,
+				int *indexes)
+{
+	int			i;
+
+	if (self->locatefunc == locate_hash_insert)
+		locate_hash_batch(self, values, nulls, count, indexes);
+	else if (self->locatefunc == locate_modulo_insert)
+	{
+		for (i = 0; i < count; i++)
+			indexes[i] = nulls[i] ? 0 :
+				compute_modulo(modulo_value(self, values[i]), self->nodeCount);
+	}
+	else if (self->locatefunc == locate_bound_insert)
+	{
+		for (i = 0; i < count; i++)
+			indexes[i] = bound_index(self, values[i], nulls[i]);
+	}
+	else if (self->locatefunc == locate_roundrobin)
+	{
+		for (i = 0; i < count; i++)
+		{
+			if (++self->roundRobinNode >= self->nodeCount)
+				self->roundRobinNode = 0;
+			indexes[i] = self->roundRobinNode;
+		}
+	}
+	else
+		elog(ERROR, "locator does not support batches of values");
+}
+
+
+bool
+isLocatorSingleNode(Locator *self)
+{
+	return self->locatefunc == locate_hash_insert ||
+		self->locatefunc == locate_modulo_insert ||
+		self->locatefunc == locate_bound_insert ||
+		self->locatefunc == locate_roundrobin;
+}
+
+
 void *
 getLocatorResults(Locator *self)
 {
@@ -1555,44 +2716,74 @@ GetRelationNodes(RelationLocInfo *rel_loc_info, Datum valueForDistCol,
 				RelationAccessType accessType)
 {
 	ExecNodes	*exec_nodes;
-	int			*nodenums;
-	int			i, count;
 	Locator		*locator;
-	Oid typeOfValueForDistCol = InvalidOid;
 
 	if (rel_loc_info == NULL)
 		return NULL;
 
+	locator = createRelationLocator(rel_loc_info,
+									accessType,
+									LOCATOR_LIST_LIST,
+									0,
+									(void *)rel_loc_info->nodeList,
+									NULL,
+									false);
+	exec_nodes = locate_relation_nodes(rel_loc_info, locator,
+									   valueForDistCol, isValueNull,
+									   accessType);
+	freeLocator(locator);
+	return exec_nodes;
+}
 
-	if (IsLocatorDistributedByValue(rel_loc_info->locatorType))
-	{
-		/* A sufficient lock level needs to be taken at a higher level */
-		Relation rel = relation_open(rel_loc_info->relid, NoLock);
-		TupleDesc	tupDesc = RelationGetDescr(rel);
-		Form_pg_attribute *attr = tupDesc->attrs;
-		/* Get the hash type of relation */
-		typeOfValueForDistCol = attr[rel_loc_info->partAttrNum - 1]->atttypid;
-		relation_close(rel, NoLock);
-	}
+/*
+ * GetRelationNodesForRelation
+ * Same as GetRelationNodes for an open relation, using the locator cached in
+ * its relcache entry rather than building one for each call.
+ */
+ExecNodes *
+GetRelationNodesForRelation(Relation rel, Datum valueForDistCol,
+							bool isValueNull,
+							RelationAccessType accessType)
+{
+	RelationLocInfo *rel_loc_info = RelationGetLocInfo(rel);
+	Locator		*locator;
+
+	if (rel_loc_info == NULL)
+		return NULL;
+
+	/* Locators moving on to the next node at each call are not cached */
+	locator = RelationGetLocator(rel, accessType);
+	if (locator == NULL)
+		return GetRelationNodes(rel_loc_info, valueForDistCol, isValueNull,
+								accessType);
+
+	return locate_relation_nodes(rel_loc_info, locator, valueForDistCol,
+								 isValueNull, accessType);
+}
+
+/*
+ * locate_relation_nodes
+ * Build the ExecNodes of the nodes locator gives for a value of the
+ * distribution column.
+ */
+static ExecNodes *
+locate_relation_nodes(RelationLocInfo *rel_loc_info, Locator *locator,
+					  Datum valueForDistCol, bool isValueNull,
+					  RelationAccessType accessType)
+{
+	ExecNodes	*exec_nodes;
+	int			*nodenums = (int *) getLocatorResults(locator);
+	int			i, count;
 
 	exec_nodes = makeNode(ExecNodes);
 	exec_nodes->baselocatortype = rel_loc_info->locatorType;
 	exec_nodes->accesstype = accessType;
 
-	locator = createLocator(rel_loc_info->locatorType,
-							accessType,
-							typeOfValueForDistCol,
-							LOCATOR_LIST_LIST,
-							0,
-							(void *)rel_loc_info->nodeList,
-							(void **)&nodenums,
-							false);
 	count = GET_NODES(locator, valueForDistCol, isValueNull, NULL);
 
 	for (i = 0; i < count; i++)
 		exec_nodes->nodeList = lappend_int(exec_nodes->nodeList, nodenums[i]);
 
-	freeLocator(locator);
 	return exec_nodes;
 }
 
@@ -1607,6 +2798,7 @@ GetRelationNodesByQuals(Oid reloid, Index varno, Node *quals,
 						RelationAccessType relaccess)
 {
 	RelationLocInfo *rel_loc_info = GetRelationLocInfo(reloid);
+	Relation		rel;
 	Expr			*distcol_expr = NULL;
 	ExecNodes		*exec_nodes;
 	Datum			distcol_value;
@@ -1618,36 +2810,64 @@ GetRelationNodesByQuals(Oid reloid, Index varno, Node *quals,
 	 * If the table distributed by value, check if we can reduce the Datanodes
 	 * by looking at the qualifiers for this relation
 	 */
-	if (IsRelationDistributedByValue(rel_loc_info))
+	if (IsRelationBoundDistributed(rel_loc_info))
 	{
-		Oid		disttype = get_atttype(reloid, rel_loc_info->partAttrNum);
-		int32	disttypmod = get_atttypmod(reloid, rel_loc_info->partAttrNum);
-		distcol_expr = pgxc_find_distcol_expr(varno, rel_loc_info->partAttrNum,
-													quals);
+		Var		   *var;
+		Bitmapset  *ranks;
+		ListCell   *lc;
+
 		/*
-		 * If the type of expression used to find the Datanode, is not same as
-		 * the distribution column type, try casting it. This is same as what
-		 * will happen in case of inserting that type of expression value as the
-		 * distribution column value.
+		 * Ranges or lists of a table are not only selected by an equality,
+		 * look for the nodes of the ones satisfying the quals.
 		 */
-		if (distcol_expr)
+		var = makeVar(varno, rel_loc_info->partAttrNum,
+					  get_atttype(reloid, rel_loc_info->partAttrNum),
+					  get_atttypmod(reloid, rel_loc_info->partAttrNum),
+					  rel_loc_info->boundCollation, 0);
+		if (quals && !IsA(quals, List))
+			quals = (Node *) make_ands_implicit((Expr *) quals);
+		ranks = GetBoundKeyRanks((Node *) makeBoundKeyExpr(rel_loc_info,
+														   (Expr *) var),
+								 (List *) quals);
+
+		exec_nodes = GetRelationNodes(rel_loc_info, (Datum) 0, true,
+									  relaccess);
+		if (ranks == NULL || relaccess == RELATION_ACCESS_INSERT)
+			return exec_nodes;
+
+		list_free(exec_nodes->nodeList);
+		exec_nodes->nodeList = NIL;
+		foreach(lc, rel_loc_info->nodeList)
 		{
-			distcol_expr = (Expr *)coerce_to_target_type(NULL,
-													(Node *)distcol_expr,
-													exprType((Node *)distcol_expr),
-													disttype, disttypmod,
-													COERCION_ASSIGNMENT,
-													COERCE_IMPLICIT_CAST, -1);
-			/*
-			 * PGXC_FQS_TODO: We should set the bound parameters here, but we don't have
-			 * PlannerInfo struct and we don't handle them right now.
-			 * Even if constant expression mutator changes the expression, it will
-			 * only simplify it, keeping the semantics same
-			 */
-			distcol_expr = (Expr *)eval_const_expressions(NULL,
-															(Node *)distcol_expr);
+			if (bms_is_member(node_rank(rel_loc_info->nodeList,
+										lfirst_int(lc)), ranks))
+				exec_nodes->nodeList = lappend_int(exec_nodes->nodeList,
+												   lfirst_int(lc));
 		}
+		return exec_nodes;
 	}
+	else if (IsRelationMultiColumnDistributed(rel_loc_info))
+	{
+		List	   *args = NIL;
+		ListCell   *lc;
+
+		/* The key value is known if the value of every key column is */
+		foreach(lc, rel_loc_info->partAttrNums)
+		{
+			Expr   *arg = pgxc_find_distcol_value(reloid, varno,
+												  lfirst_int(lc), quals);
+			if (!arg)
+				break;
+			args = lappend(args, arg);
+		}
+		if (!lc)
+			distcol_expr = (Expr *) eval_const_expressions(NULL,
+											(Node *) makeDistribKeyExpr(args));
+	}
+	else if (IsRelationDistributedByValue(rel_loc_info))
+		distcol_expr = pgxc_find_distcol_value(reloid, varno,
+											   rel_loc_info->partAttrNum,
+											   quals);
 
 	if (distcol_expr && IsA(distcol_expr, Const))
 	{
@@ -1661,12 +2881,742 @@ GetRelationNodesByQuals(Oid reloid, Index varno, Node *quals,
 		distcol_isnull = true;
 	}
 
-	exec_nodes = GetRelationNodes(rel_loc_info, distcol_value,
-												distcol_isnull,
-												relaccess);
+	/* The planner holds a lock on the relation already */
+	rel = relation_open(reloid, AccessShareLock);
+	exec_nodes = GetRelationNodesForRelation(rel, distcol_value,
+											 distcol_isnull, relaccess);
+	relation_close(rel, AccessShareLock);
 	return exec_nodes;
 }
 
+/*
+ * pgxc_find_distcol_value
+ * Find in quals an expression giving the value of column attrNum of the
+ * relation as varno, see pgxc_find_distcol_expr, and cast it to the type of
+ * the column.  Returns NULL if there is none.
+ */
+static Expr *
+pgxc_find_distcol_value(Oid reloid, Index varno, AttrNumber attrNum,
+						Node *quals)
+{
+	Oid		disttype = get_atttype(reloid, attrNum);
+	int32	disttypmod = get_atttypmod(reloid, attrNum);
+	Expr   *distcol_expr;
+
+	distcol_expr = pgxc_find_distcol_expr(varno, attrNum, quals);
+	/*
+	 * If the type of expression used to find the Datanode, is not same as
+	 * the distribution column type, try casting it. This is same as what
+	 * will happen in case of inserting that type of expression value as the
+	 * distribution column value.
+	 */
+	if (distcol_expr)
+	{
+		distcol_expr = (Expr *)coerce_to_target_type(NULL,
+												(Node *)distcol_expr,
+												exprType((Node *)distcol_expr),
+												disttype, disttypmod,
+												COERCION_ASSIGNMENT,
+												COERCE_IMPLICIT_CAST, -1);
+		/*
+		 * PGXC_FQS_TODO: We should set the bound parameters here, but we don't have
+		 * PlannerInfo struct and we don't handle them right now.
+		 * Even if constant expression mutator changes the expression, it will
+		 * only simplify it, keeping the semantics same
+		 */
+		distcol_expr = (Expr *)eval_const_expressions(NULL,
+														(Node *)distcol_expr);
+	}
+	return distcol_expr;
+}
+
+/*
+ * GetRelationDistribKeyType
+ * Return the type of the distribution key values of a relation distributed
+ * by value, int4 if the key is made of several columns.
+ */
+Oid
+GetRelationDistribKeyType(RelationLocInfo *locInfo)
+{
+	Relation	rel;
+	Oid			keytype;
+
+	if (IsRelationMultiColumnDistributed(locInfo))
+		return INT4OID;
+
+	/* A sufficient lock level needs to be taken at a higher level */
+	rel = relation_open(locInfo->relid, NoLock);
+	keytype = RelationGetDescr(rel)->attrs[locInfo->partAttrNum - 1]->atttypid;
+	relation_close(rel, NoLock);
+
+	return keytype;
+}
+
+/*
+ * GetRelationDistribKeyValue
+ * Return the distribution key value of a row of the relation described by
+ * tupdesc, given as values and nulls arrays.
+ */
+Datum
+GetRelationDistribKeyValue(RelationLocInfo *locInfo, TupleDesc tupdesc,
+						   Datum *values, bool *nulls, bool *isnull)
+{
+	if (IsRelationMultiColumnDistributed(locInfo))
+	{
+		int			nkeys = list_length(locInfo->partAttrNums);
+		Oid			types[nkeys];
+		Datum		keyvalues[nkeys];
+		bool		keynulls[nkeys];
+		ListCell   *lc;
+		int			i = 0;
+
+		foreach(lc, locInfo->partAttrNums)
+		{
+			int		attidx = lfirst_int(lc) - 1;
+
+			types[i] = tupdesc->attrs[attidx]->atttypid;
+			keyvalues[i] = values[attidx];
+			keynulls[i] = nulls[attidx];
+			i++;
+		}
+		*isnull = false;
+		return Int32GetDatum(compute_distkey_hash(nkeys, types, keyvalues,
+												  keynulls));
+	}
+
+	*isnull = nulls[locInfo->partAttrNum - 1];
+	return values[locInfo->partAttrNum - 1];
+}
+
+/*
+ * makeDistribKeyExpr
+ * Make the expression computing the distribution key value of a table
+ * distributed by several columns, args giving the values of the columns.
+ */
+Expr *
+makeDistribKeyExpr(List *args)
+{
+	return (Expr *) makeFuncExpr(F_PGXC_DISTKEY_HASH, INT4OID, args,
+								 InvalidOid, InvalidOid,
+								 COERCE_EXPLICIT_CALL);
+}
+
+/*
+ * IsDistribKeyExpr
+ * Is the node an expression made by makeDistribKeyExpr?
+ */
+bool
+IsDistribKeyExpr(Node *node)
+{
+	return node && IsA(node, FuncExpr) &&
+		((FuncExpr *) node)->funcid == F_PGXC_DISTKEY_HASH;
+}
+
+/*
+ * IsTypeBoundDistributable
+ * Can a column of that type be distributed by RANGE or LIST?  Its values
+ * have to be ordered by a btree operator class, and an array of its bounds
+ * has to be built by makeBoundKeyExpr.
+ */
+bool
+IsTypeBoundDistributable(Oid col_type)
+{
+	Oid			basetype = getBaseType(col_type);
+
+	return OidIsValid(get_array_type(basetype)) &&
+		OidIsValid(lookup_type_cache(basetype, TYPECACHE_CMP_PROC)->cmp_proc);
+}
+
+/*
+ * Rank of a Datanode index among the node indexes of nodeList in ascending
+ * order, which is its position in the nodes of a planner Distribution.
+ */
+static int
+node_rank(List *nodeList, int node)
+{
+	ListCell   *lc;
+	int			rank = 0;
+
+	foreach(lc, nodeList)
+		if (lfirst_int(lc) < node)
+			rank++;
+	return rank;
+}
+
+/*
+ * makeBoundKeyExpr
+ * Make the distribution key expression of a RANGE or LIST distributed
+ * relation, key giving the value of its distribution column.  The expression
+ * is pgxc_distkey_node() of the key, returning the rank of the node of the
+ * key among the nodes of the relation, and carries the bounds of the
+ * relation, so that it can be evaluated where pgxc_class is not available.
+ */
+Expr *
+makeBoundKeyExpr(RelationLocInfo *locInfo, Expr *key)
+{
+	int			nslots = locInfo->nbounds;
+	Datum	   *ranks;
+	ArrayType  *bounds;
+	int16		typlen;
+	bool		typbyval;
+	char		typalign;
+	List	   *args;
+	int			i;
+
+	Assert(IsRelationBoundDistributed(locInfo));
+
+	if (locInfo->locatorType == LOCATOR_TYPE_RANGE)
+		nslots++;
+
+	/* Keys of a domain are compared as values of its base type */
+	if (exprType((Node *) key) != locInfo->boundType)
+		key = (Expr *) makeRelabelType(key, locInfo->boundType, -1,
+									   locInfo->boundCollation,
+									   COERCE_IMPLICIT_CAST);
+
+	get_typlenbyvalalign(locInfo->boundType, &typlen, &typbyval, &typalign);
+	if (locInfo->nbounds > 0)
+		bounds = construct_array(locInfo->bounds, locInfo->nbounds,
+								 locInfo->boundType, typlen, typbyval,
+								 typalign);
+	else
+		bounds = construct_empty_array(locInfo->boundType);
+
+	/* Rank of the node of each slot, and last of the node of NULL keys */
+	ranks = (Datum *) palloc((nslots + 1) * sizeof(Datum));
+	for (i = 0; i < nslots; i++)
+		ranks[i] = Int32GetDatum(node_rank(locInfo->nodeList,
+										   locInfo->boundNodes[i]));
+	ranks[nslots] = Int32GetDatum(locInfo->nullNode < 0 ? -1 :
+								  node_rank(locInfo->nodeList,
+											locInfo->nullNode));
+
+	args = list_make4(makeConst(CHAROID, -1, InvalidOid, 1,
+								CharGetDatum(locInfo->locatorType),
+								false, true),
+					  key,
+					  makeConst(get_array_type(locInfo->boundType), -1,
+								InvalidOid, -1, PointerGetDatum(bounds),
+								false, false),
+					  makeConst(INT4ARRAYOID, -1, InvalidOid, -1,
+								PointerGetDatum(construct_array(ranks,
+																nslots + 1,
+																INT4OID, 4,
+																true, 'i')),
+								false, false));
+
+	return (Expr *) makeFuncExpr(F_PGXC_DISTKEY_NODE, INT4OID, args,
+								 InvalidOid, locInfo->boundCollation,
+								 COERCE_EXPLICIT_CALL);
+}
+
+/*
+ * IsBoundKeyExpr
+ * Is the node an expression made by makeBoundKeyExpr?
+ */
+bool
+IsBoundKeyExpr(Node *node)
+{
+	return node && IsA(node, FuncExpr) &&
+		((FuncExpr *) node)->funcid == F_PGXC_DISTKEY_NODE;
+}
+
+/*
+ * Bound map of a pgxc_distkey_node() call, cached in fn_extra
+ */
+typedef struct BoundKeyCache
+{
+	ArrayType  *boundsArray;	/* copies of the arrays it was built from */
+	ArrayType  *ranksArray;
+	char		locatorType;
+	int			nbounds;
+	Datum	   *bounds;
+	int		   *ranks;			/* rank of each slot, then of NULL keys */
+	FmgrInfo	cmpfunc;
+} BoundKeyCache;
+
+static bool
+same_array(ArrayType *a, ArrayType *b)
+{
+	return VARSIZE(a) == VARSIZE(b) && memcmp(a, b, VARSIZE(a)) == 0;
+}
+
+/*
+ * pgxc_distkey_node
+ * Rank of the node storing key among the nodes of a RANGE or LIST
+ * distributed relation, see makeBoundKeyExpr.  Arguments are the locator
+ * type, the key, the sorted bounds or values, and the ranks of the node of
+ * each range or value followed by the rank of the node of NULL keys.
+ */
+Datum
+pgxc_distkey_node(PG_FUNCTION_ARGS)
+{
+	BoundKeyCache *cache = (BoundKeyCache *) fcinfo->flinfo->fn_extra;
+	ArrayType  *boundsArray;
+	ArrayType  *ranksArray;
+	char		locatorType;
+	int			nslots;
+	int			slot;
+	int			rank;
+
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(2) || PG_ARGISNULL(3))
+		PG_RETURN_NULL();
+
+	locatorType = PG_GETARG_CHAR(0);
+	boundsArray = PG_GETARG_ARRAYTYPE_P(2);
+	ranksArray = PG_GETARG_ARRAYTYPE_P(3);
+	if (!IsLocatorBoundDistributed(locatorType))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("pgxc_distkey_node takes a RANGE or LIST locator type")));
+
+	if (cache == NULL || cache->locatorType != locatorType ||
+		!same_array(cache->boundsArray, boundsArray) ||
+		!same_array(cache->ranksArray, ranksArray))
+	{
+		MemoryContext oldcontext;
+		Oid			elemtype = ARR_ELEMTYPE(boundsArray);
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		Datum	   *ranks;
+		int			nranks;
+		TypeCacheEntry *typentry;
+		int			i;
+
+		typentry = lookup_type_cache(elemtype, TYPECACHE_CMP_PROC_FINFO);
+		if (!OidIsValid(typentry->cmp_proc))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify a comparison function for type %s",
+							format_type_be(elemtype))));
+
+		oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+		if (cache)
+		{
+			pfree(cache->boundsArray);
+			pfree(cache->ranksArray);
+			pfree(cache->ranks);
+		}
+		else
+			cache = (BoundKeyCache *) palloc(sizeof(BoundKeyCache));
+		cache->boundsArray = (ArrayType *) palloc(VARSIZE(boundsArray));
+		memcpy(cache->boundsArray, boundsArray, VARSIZE(boundsArray));
+		cache->ranksArray = (ArrayType *) palloc(VARSIZE(ranksArray));
+		memcpy(cache->ranksArray, ranksArray, VARSIZE(ranksArray));
+		cache->locatorType = locatorType;
+
+		/* Bounds point into the copy of their array */
+		get_typlenbyvalalign(elemtype, &typlen, &typbyval, &typalign);
+		deconstruct_array(cache->boundsArray, elemtype, typlen, typbyval,
+						  typalign, &cache->bounds, NULL, &cache->nbounds);
+		deconstruct_array(cache->ranksArray, INT4OID, 4, true, 'i',
+						  &ranks, NULL, &nranks);
+		nslots = cache->nbounds + (locatorType == LOCATOR_TYPE_RANGE ? 1 : 0);
+		if (nranks != nslots + 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("pgxc_distkey_node takes a rank for each range or value and for NULL")));
+		cache->ranks = (int *) palloc(nranks * sizeof(int));
+		for (i = 0; i < nranks; i++)
+			cache->ranks[i] = DatumGetInt32(ranks[i]);
+		fmgr_info_cxt(typentry->cmp_proc, &cache->cmpfunc,
+					  fcinfo->flinfo->fn_mcxt);
+		MemoryContextSwitchTo(oldcontext);
+		fcinfo->flinfo->fn_extra = cache;
+	}
+
+	nslots = cache->nbounds + (locatorType == LOCATOR_TYPE_RANGE ? 1 : 0);
+	if (PG_ARGISNULL(1))
+		slot = nslots;
+	else
+		slot = bound_search(locatorType, PG_GETARG_DATUM(1), cache->bounds,
+							cache->nbounds, &cache->cmpfunc,
+							PG_GET_COLLATION());
+	rank = slot < 0 ? -1 : cache->ranks[slot];
+	if (rank < 0)
+	{
+		if (PG_ARGISNULL(1))
+			ereport(ERROR,
+					(errcode(ERRCODE_CHECK_VIOLATION),
+					 errmsg("no Datanode is listed for NULL distribution key values")));
+		else
+		{
+			Oid			typoutput;
+			bool		typisvarlena;
+
+			getTypeOutputInfo(ARR_ELEMTYPE(boundsArray), &typoutput,
+							  &typisvarlena);
+			ereport(ERROR,
+					(errcode(ERRCODE_CHECK_VIOLATION),
+					 errmsg("no Datanode is listed for distribution key value %s",
+							OidOutputFunctionCall(typoutput,
+												  PG_GETARG_DATUM(1)))));
+		}
+	}
+
+	PG_RETURN_INT32(rank);
+}
+
+/*
+ * Slots of a bound map some values satisfying qual may fall into, the slot
+ * nslots standing for NULL keys.  Returns false if the qual does not
+ * restrict the key with a constant.  Bounds are compared with constants
+ * through the operator family of the btree operator class of their type,
+ * the lower bound of a range is taken as included when it is the constant.
+ */
+static bool
+bound_qual_slots(char locatorType, Datum *bounds, int nbounds, Oid boundType,
+				 Oid collation, Node *key, Node *qual, Bitmapset **slots)
+{
+	int			nslots = nbounds + (locatorType == LOCATOR_TYPE_RANGE ? 1 : 0);
+	Oid			opfamily;
+	Oid			opno;
+	Node	   *leftop;
+	Node	   *rightop;
+	Node	   *other;
+	bool		keyleft;
+	bool		isarray = false;
+	int			strategy;
+	Oid			lefttype;
+	Oid			righttype;
+	FmgrInfo	cmpfunc;
+	Datum	   *values;
+	bool	   *valuenulls;
+	int			nvalues;
+	int			i, j;
+
+	*slots = NULL;
+
+	if (IsA(qual, NullTest))
+	{
+		NullTest   *nt = (NullTest *) qual;
+		Node	   *arg = (Node *) nt->arg;
+
+		if (IsA(arg, RelabelType))
+			arg = (Node *) ((RelabelType *) arg)->arg;
+		if (nt->argisrow || !equal(arg, key))
+			return false;
+		if (nt->nulltesttype == IS_NULL)
+			*slots = bms_make_singleton(nslots);
+		else
+			for (i = 0; i < nslots; i++)
+				*slots = bms_add_member(*slots, i);
+		return true;
+	}
+
+	if (IsA(qual, OpExpr) && list_length(((OpExpr *) qual)->args) == 2)
+	{
+		OpExpr	   *op = (OpExpr *) qual;
+
+		if (OidIsValid(collation) && op->inputcollid != collation)
+			return false;
+		opno = op->opno;
+		leftop = (Node *) linitial(op->args);
+		rightop = (Node *) lsecond(op->args);
+	}
+	else if (IsA(qual, ScalarArrayOpExpr) &&
+			 ((ScalarArrayOpExpr *) qual)->useOr)
+	{
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) qual;
+
+		if (OidIsValid(collation) && saop->inputcollid != collation)
+			return false;
+		opno = saop->opno;
+		leftop = (Node *) linitial(saop->args);
+		rightop = (Node *) lsecond(saop->args);
+		isarray = true;
+	}
+	else
+		return false;
+
+	if (IsA(leftop, RelabelType))
+		leftop = (Node *) ((RelabelType *) leftop)->arg;
+	if (IsA(rightop, RelabelType))
+		rightop = (Node *) ((RelabelType *) rightop)->arg;
+	if (equal(leftop, key))
+	{
+		keyleft = true;
+		other = rightop;
+	}
+	else if (equal(rightop, key) && !isarray)
+	{
+		keyleft = false;
+		other = leftop;
+	}
+	else
+		return false;
+
+	other = eval_const_expressions(NULL, other);
+	if (!IsA(other, Const))
+		return false;
+
+	opfamily = lookup_type_cache(boundType, TYPECACHE_BTREE_OPFAMILY)->btree_opf;
+	if (!OidIsValid(opfamily) || !op_in_opfamily(opno, opfamily))
+		return false;
+	get_op_opfamily_properties(opno, opfamily, false, &strategy,
+							   &lefttype, &righttype);
+	if (isarray && strategy != BTEqualStrategyNumber)
+		return false;
+	fmgr_info(get_opfamily_proc(opfamily, lefttype, righttype, BTORDER_PROC),
+			  &cmpfunc);
+
+	/* Strict operators are never satisfied by NULL keys or constants */
+	if (((Const *) other)->constisnull)
+		return true;
+	if (isarray)
+	{
+		ArrayType  *array = DatumGetArrayTypeP(((Const *) other)->constvalue);
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+
+		get_typlenbyvalalign(ARR_ELEMTYPE(array), &typlen, &typbyval,
+							 &typalign);
+		deconstruct_array(array, ARR_ELEMTYPE(array), typlen, typbyval,
+						  typalign, &values, &valuenulls, &nvalues);
+	}
+	else
+	{
+		values = &((Const *) other)->constvalue;
+		valuenulls = NULL;
+		nvalues = 1;
+	}
+
+	for (j = 0; j < nvalues; j++)
+	{
+		int			nlower = 0;		/* bounds lower than value */
+		int			nequal = 0;		/* bounds equal to value */
+
+		if (valuenulls && valuenulls[j])
+			continue;
+
+		for (i = 0; i < nbounds; i++)
+		{
+			int32		cmp;
+
+			if (keyleft)
+				cmp = DatumGetInt32(FunctionCall2Coll(&cmpfunc, collation,
+													  bounds[i], values[j]));
+			else
+				cmp = -DatumGetInt32(FunctionCall2Coll(&cmpfunc, collation,
+													   values[j], bounds[i]));
+			if (cmp < 0)
+				nlower++;
+			else if (cmp == 0)
+				nequal++;
+		}
+
+		/* Make the strategy the one of key op value */
+		if (!keyleft)
+		{
+			if (strategy == BTLessStrategyNumber)
+				strategy = BTGreaterStrategyNumber;
+			else if (strategy == BTLessEqualStrategyNumber)
+				strategy = BTGreaterEqualStrategyNumber;
+			else if (strategy == BTGreaterStrategyNumber)
+				strategy = BTLessStrategyNumber;
+			else if (strategy == BTGreaterEqualStrategyNumber)
+				strategy = BTLessEqualStrategyNumber;
+			keyleft = true;
+		}
+
+		if (locatorType == LOCATOR_TYPE_RANGE)
+		{
+			/* Range of value, bounds being sorted */
+			int			slot = nlower + nequal;
+			int			low = 0;
+			int			high = nbounds;
+
+			switch (strategy)
+			{
+				case BTLessStrategyNumber:
+				case BTLessEqualStrategyNumber:
+					high = slot;
+					break;
+				case BTEqualStrategyNumber:
+					low = high = slot;
+					break;
+				default:
+					low = slot;
+					break;
+			}
+			for (i = low; i <= high; i++)
+				*slots = bms_add_member(*slots, i);
+		}
+		else
+		{
+			/* Values satisfying the qual, values being sorted */
+			int			low = 0;
+			int			high = nbounds;
+
+			switch (strategy)
+			{
+				case BTLessStrategyNumber:
+					high = nlower;
+					break;
+				case BTLessEqualStrategyNumber:
+					high = nlower + nequal;
+					break;
+				case BTEqualStrategyNumber:
+					low = nlower;
+					high = nlower + nequal;
+					break;
+				case BTGreaterEqualStrategyNumber:
+					low = nlower;
+					break;
+				default:
+					low = nlower + nequal;
+					break;
+			}
+			for (i = low; i < high; i++)
+				*slots = bms_add_member(*slots, i);
+		}
+	}
+	return true;
+}
+
+/*
+ * GetBoundKeyRanks
+ * Return the ranks of the nodes some rows satisfying the implicitly ANDed
+ * quals may be stored on, keyExpr being made by makeBoundKeyExpr.  Returns
+ * NULL if the quals do not restrict them.
+ */
+Bitmapset *
+GetBoundKeyRanks(Node *keyExpr, List *quals)
+{
+	FuncExpr   *fexpr = (FuncExpr *) keyExpr;
+	char		locatorType;
+	Node	   *key;
+	ArrayType  *boundsArray;
+	Datum	   *bounds;
+	int			nbounds;
+	Datum	   *ranks;
+	int			nranks;
+	int16		typlen;
+	bool		typbyval;
+	char		typalign;
+	Bitmapset  *slots = NULL;
+	Bitmapset  *result = NULL;
+	bool		restricted = false;
+	ListCell   *lc;
+	int			i;
+
+	Assert(IsBoundKeyExpr(keyExpr));
+
+	locatorType = DatumGetChar(((Const *) linitial(fexpr->args))->constvalue);
+	key = (Node *) lsecond(fexpr->args);
+	if (IsA(key, RelabelType))
+		key = (Node *) ((RelabelType *) key)->arg;
+	boundsArray = DatumGetArrayTypeP(((Const *) lthird(fexpr->args))->constvalue);
+	get_typlenbyvalalign(ARR_ELEMTYPE(boundsArray), &typlen, &typbyval,
+						 &typalign);
+	deconstruct_array(boundsArray, ARR_ELEMTYPE(boundsArray), typlen,
+					  typbyval, typalign, &bounds, NULL, &nbounds);
+	deconstruct_array(DatumGetArrayTypeP(((Const *) lfourth(fexpr->args))->constvalue),
+					  INT4OID, 4, true, 'i', &ranks, NULL, &nranks);
+
+	/* Start with all the slots, NULL keys included */
+	for (i = 0; i < nranks; i++)
+		slots = bms_add_member(slots, i);
+
+	foreach(lc, quals)
+	{
+		Node	   *qual = (Node *) lfirst(lc);
+		Bitmapset  *qualslots;
+
+		if (IsA(qual, RestrictInfo))
+			qual = (Node *) ((RestrictInfo *) qual)->clause;
+		if (bound_qual_slots(locatorType, bounds, nbounds,
+							 ARR_ELEMTYPE(boundsArray), fexpr->inputcollid,
+							 key, qual, &qualslots))
+		{
+			slots = bms_int_members(slots, qualslots);
+			restricted = true;
+		}
+	}
+
+	/* An empty set of rows is not worth the trouble, keep all nodes */
+	if (!restricted || bms_is_empty(slots))
+		return NULL;
+
+	while ((i = bms_first_member(slots)) >= 0)
+		if (DatumGetInt32(ranks[i]) >= 0)
+			result = bms_add_member(result, DatumGetInt32(ranks[i]));
+	return result;
+}
+
+/*
+ * Constant of the text of a value as the grammar gives it, NULL if str is
+ */
+static Node *
+make_value_const(char *str)
+{
+	A_Const    *n = makeNode(A_Const);
+
+	if (str)
+	{
+		n->val.type = T_String;
+		n->val.val.str = str;
+	}
+	else
+		n->val.type = T_Null;
+	n->location = -1;
+	return (Node *) n;
+}
+
+/*
+ * GetRelationDistribValues
+ * Return the VALUES of a RANGE or LIST distributed relation, as the grammar
+ * gives them: a DefElem naming each node, with the text of its lower bound
+ * or the list of the texts of its values.
+ */
+List *
+GetRelationDistribValues(RelationLocInfo *locInfo)
+{
+	List	   *result = NIL;
+	Oid			typoutput;
+	bool		typisvarlena;
+	ListCell   *lc;
+	int			i;
+
+	if (!locInfo || !IsRelationBoundDistributed(locInfo))
+		return NIL;
+
+	getTypeOutputInfo(locInfo->boundType, &typoutput, &typisvarlena);
+	foreach(lc, locInfo->nodeList)
+	{
+		int			node = lfirst_int(lc);
+		char	   *nodename;
+		Node	   *arg = NULL;
+
+		nodename = get_pgxc_nodename(PGXCNodeGetNodeOid(node,
+														PGXC_NODE_DATANODE));
+		if (locInfo->locatorType == LOCATOR_TYPE_RANGE)
+		{
+			for (i = 0; i < locInfo->nbounds; i++)
+				if (locInfo->boundNodes[i + 1] == node)
+					arg = make_value_const(OidOutputFunctionCall(typoutput,
+														 locInfo->bounds[i]));
+		}
+		else
+		{
+			List	   *values = NIL;
+
+			for (i = 0; i < locInfo->nbounds; i++)
+				if (locInfo->boundNodes[i] == node)
+					values = lappend(values,
+							make_value_const(OidOutputFunctionCall(typoutput,
+														 locInfo->bounds[i])));
+			if (locInfo->nullNode == node)
+				values = lappend(values, make_value_const(NULL));
+			arg = (Node *) values;
+		}
+		result = lappend(result, makeDefElem(nodename, arg));
+	}
+	return result;
+}
+
 /*
  * GetRelationDistribColumn
  * Return hash column name for relation or NULL if relation is not distributed.
@@ -1686,6 +3636,26 @@ GetRelationDistribColumn(RelationLocInfo *locInfo)
 	return get_attname(locInfo->relid, locInfo->partAttrNum);
 }
 
+/*
+ * GetRelationDistribColumns
+ * Return the list of the names of the distribution columns of relation, in
+ * key order, or NIL if relation is not distributed.
+ */
+List *
+GetRelationDistribColumns(RelationLocInfo *locInfo)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	if (!locInfo || !IsRelationDistributedByValue(locInfo))
+		return NIL;
+
+	foreach(lc, locInfo->partAttrNums)
+		result = lappend(result, get_attname(locInfo->relid, lfirst_int(lc)));
+
+	return result;
+}
+
 /*
  * pgxc_find_distcol_expr
  * Search through the quals provided and find out an expression which will give
@@ -15,26 +15,90 @@
 #include "postgres.h"
 #include "miscadmin.h"
 
+#include "access/genam.h"
 #include "access/hash.h"
+#include "access/heapam.h"
 #include "access/htup.h"
+#include "access/htup_details.h"
 #include "access/xact.h"
+#include "catalog/heap.h"
+#include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
+#include "catalog/pgxc_class.h"
 #include "catalog/pgxc_node.h"
+#include "commands/defrem.h"
 #include "commands/tablecmds.h"
+#include "executor/spi.h"
+#include "funcapi.h"
+#include "optimizer/cost.h"
+#include "parser/parser.h"
 #include "pgxc/copyops.h"
 #include "pgxc/execRemote.h"
 #include "pgxc/pgxc.h"
+#include "pgxc/pgxcnode.h"
 #include "pgxc/redistrib.h"
 #include "pgxc/remotecopy.h"
+#include "storage/backendid.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/utility.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
 
 #define IsCommandTypePreUpdate(x) (x == CATALOG_UPDATE_BEFORE || \
 								   x == CATALOG_UPDATE_BOTH)
 #define IsCommandTypePostUpdate(x) (x == CATALOG_UPDATE_AFTER || \
 									x == CATALOG_UPDATE_BOTH)
 
+/* Number of hash buckets whose rows are moved by each statement */
+#define REDISTRIB_MOVE_BUCKETS	256
+
+/*
+ * While rows are moved, scans of the relation redistributed see it on the
+ * nodes the rows are moved from rather than on the nodes of its catalog
+ * entry, see GetRedistribSourceLocInfo.
+ */
+static Oid redistribSourceRelid = InvalidOid;
+static RelationLocInfo *redistribSourceLocInfo = NULL;
+
+/*
+ * Progress of a REBALANCE, one slot per backend in the shared memory of
+ * Coordinators. A slot is only written by its backend.
+ */
+typedef struct RebalanceProgress
+{
+	slock_t		mutex;			/* protects the fields below */
+	int			pid;			/* backend running REBALANCE, 0 if none */
+	Oid			datid;			/* database of the tables moved */
+	Oid			relid;			/* table being moved */
+	int			tablesTotal;	/* tables to move */
+	int			tablesDone;		/* tables moved, by this session or another */
+	int64		bucketsTotal;	/* hash buckets to move */
+	int64		bucketsMoved;	/* hash buckets moved */
+	int64		rowsMoved;		/* rows of the hash buckets moved */
+	TimestampTz	startTime;
+} RebalanceProgress;
+
+static RebalanceProgress *rebalanceProgress = NULL;
+static RebalanceProgress *myRebalanceProgress = NULL;
+
+/* Milliseconds REBALANCE sleeps after each batch of rows moved */
+static int	rebalanceDelay = 0;
+
+/* A table planned to be moved by REBALANCE */
+typedef struct RebalanceTable
+{
+	Oid			relid;
+	int64		buckets;		/* hash buckets changing of node */
+} RebalanceTable;
+
 /* Functions used for the execution of redistribution commands */
 static void distrib_execute_query(char *sql, bool is_temp, ExecNodes *exec_nodes);
 static void distrib_execute_command(RedistribState *distribState, RedistribCommand *command);
@@ -43,6 +107,13 @@ static void distrib_copy_from(RedistribState *distribState, ExecNodes *exec_node
 static void distrib_truncate(RedistribState *distribState, ExecNodes *exec_nodes);
 static void distrib_reindex(RedistribState *distribState, ExecNodes *exec_nodes);
 static void distrib_delete_hash(RedistribState *distribState, ExecNodes *exec_nodes);
+static void distrib_move(RedistribState *distribState, ExecNodes *exec_nodes);
+static char *distrib_disable_triggers(RedistribState *distribState);
+static void distrib_set_replication_role(RedistribState *distribState,
+										 const char *role);
+static uint64 distrib_move_batch(char *relname, Relation rel, Bitmapset *buckets);
+static void distrib_append_bucket_cond(StringInfo buf, Relation rel, Bitmapset *buckets);
+static char *distrib_key_expr(Relation rel, Oid *keytype);
 
 /* Functions used to build the command list */
 static void pgxc_redist_build_entry(RedistribState *distribState,
@@ -54,10 +125,28 @@ static void pgxc_redist_build_replicate(RedistribState *distribState,
 static void pgxc_redist_build_replicate_to_distrib(RedistribState *distribState,
 								RelationLocInfo *oldLocInfo,
 								RelationLocInfo *newLocInfo);
+static void pgxc_redist_build_hash_nodes(RedistribState *distribState,
+								RelationLocInfo *oldLocInfo,
+								RelationLocInfo *newLocInfo);
+
+static Bitmapset *distrib_moved_buckets(List *oldNodes, List *newNodes,
+								List **sourceNodes);
 
 static void pgxc_redist_build_default(RedistribState *distribState);
 static void pgxc_redist_add_reindex(RedistribState *distribState);
 
+/* Functions used by REBALANCE */
+static List *rebalance_nodes(PGXCSubCluster *subcluster, char **alterClause);
+static bool rebalance_same_nodes(List *nodes1, List *nodes2);
+static List *rebalance_plan(List *sourceNodes, List *targetNodes,
+							int64 *buckets);
+static bool rebalance_table(RebalanceTable *table, List *sourceNodes,
+							const char *alterClause, bool wait);
+static void rebalance_progress_start(int tables, int64 buckets);
+static void rebalance_progress_end(int code, Datum arg);
+static void rebalance_progress_table(Oid relid, int64 buckets);
+static void rebalance_progress_batch(int buckets, uint64 rows);
+
 
 /*
  * PGXCRedistribTable
@@ -67,6 +156,7 @@ void
 PGXCRedistribTable(RedistribState *distribState, RedistribCatalog type)
 {
 	ListCell *item;
+	char	   *saved_role = NULL;
 
 	/* Nothing to do if no redistribution operation */
 	if (!distribState)
@@ -76,6 +166,10 @@ PGXCRedistribTable(RedistribState *distribState, RedistribCatalog type)
 	if (IS_PGXC_DATANODE || IsConnFromCoord())
 		return;
 
+	/* Rows moved by DML must not fire the triggers of the relation */
+	if (IsCommandTypePostUpdate(type))
+		saved_role = distrib_disable_triggers(distribState);
+
 	/* Execute each command if necessary */
 	foreach(item, distribState->commands)
 	{
@@ -92,6 +186,13 @@ PGXCRedistribTable(RedistribState *distribState, RedistribCatalog type)
 		/* Now enter in execution list */
 		distrib_execute_command(distribState, command);
 	}
+
+	/* Triggers fire again for the rest of the transaction */
+	if (saved_role)
+	{
+		distrib_set_replication_role(distribState, saved_role);
+		pfree(saved_role);
+	}
 }
 
 
@@ -134,6 +235,9 @@ pgxc_redist_build_entry(RedistribState *distribState,
 	/* Evaluate cases for replicated to distributed tables */
 	pgxc_redist_build_replicate_to_distrib(distribState, oldLocInfo, newLocInfo);
 
+	/* Evaluate cases for hash distributed tables whose nodes change */
+	pgxc_redist_build_hash_nodes(distribState, oldLocInfo, newLocInfo);
+
 	/* PGXCTODO: perform more complex builds of command list */
 
 	/* Fallback to default */
@@ -158,9 +262,13 @@ pgxc_redist_build_replicate_to_distrib(RedistribState *distribState,
 	if (list_length(distribState->commands) != 0)
 		return;
 
-	/* Redistribution is done from replication to distributed (with value) */
+	/*
+	 * Redistribution is done from replication to distributed by hash or
+	 * modulo, a Datanode can not tell which rows of a range or list to keep.
+	 */
 	if (!IsLocatorReplicated(oldLocInfo->locatorType) ||
-		!IsLocatorDistributedByValue(newLocInfo->locatorType))
+		(newLocInfo->locatorType != LOCATOR_TYPE_HASH &&
+		 newLocInfo->locatorType != LOCATOR_TYPE_MODULO))
 		return;
 
 	/* Get the list of nodes that are added to the relation */
@@ -226,6 +334,94 @@ pgxc_redist_build_replicate_to_distrib(RedistribState *distribState,
 }
 
 
+/*
+ * pgxc_redist_build_hash_nodes
+ * Build redistribution command list for a hash distributed table whose set
+ * of nodes is changed. Only the rows of the hash buckets that change of node
+ * are moved, straight from the Datanodes losing them to the ones gaining
+ * them, and then deleted where they were. As nothing is truncated, sessions
+ * reading the table with the old distribution are not blocked.
+ */
+static void
+pgxc_redist_build_hash_nodes(RedistribState *distribState,
+							 RelationLocInfo *oldLocInfo,
+							 RelationLocInfo *newLocInfo)
+{
+	List	   *sourceNodes = NIL;
+	ExecNodes  *execNodes;
+
+	/* If a command list has already been built, nothing to do */
+	if (list_length(distribState->commands) != 0)
+		return;
+
+	/* Distribution has to stay the same, only nodes change */
+	if (oldLocInfo->locatorType != LOCATOR_TYPE_HASH ||
+		newLocInfo->locatorType != LOCATOR_TYPE_HASH ||
+		oldLocInfo->partAttrNum != newLocInfo->partAttrNum ||
+		!equal(oldLocInfo->partAttrNums, newLocInfo->partAttrNums))
+		return;
+
+	/* Find the buckets changing of node, and the nodes they leave */
+	distribState->buckets = distrib_moved_buckets(oldLocInfo->nodeList,
+												  newLocInfo->nodeList,
+												  &sourceNodes);
+
+	/* Nodes removed lose all their buckets, even if they had none */
+	sourceNodes = list_concat_unique_int(sourceNodes,
+				 list_difference_int(oldLocInfo->nodeList, newLocInfo->nodeList));
+
+	/* Nothing moves, which is unlikely enough to use the default build */
+	if (sourceNodes == NIL)
+		return;
+
+	/* Copy the rows of the buckets changing of node to their new node */
+	execNodes = makeNode(ExecNodes);
+	execNodes->nodeList = sourceNodes;
+	distribState->commands = lappend(distribState->commands,
+				 makeRedistribCommand(DISTRIB_MOVE, CATALOG_UPDATE_AFTER, execNodes));
+
+	/* Then delete them on the nodes they left */
+	execNodes = makeNode(ExecNodes);
+	execNodes->nodeList = list_copy(sourceNodes);
+	distribState->commands = lappend(distribState->commands,
+				 makeRedistribCommand(DISTRIB_DELETE_HASH, CATALOG_UPDATE_AFTER, execNodes));
+}
+
+
+/*
+ * distrib_moved_buckets
+ * Return the hash buckets whose node is not the same with the Datanodes of
+ * newNodes as with the ones of oldNodes. If sourceNodes is not NULL, the
+ * Datanodes the buckets leave are appended to it.
+ */
+static Bitmapset *
+distrib_moved_buckets(List *oldNodes, List *newNodes, List **sourceNodes)
+{
+	Bitmapset  *result = NULL;
+	int16	   *oldMap;
+	int16	   *newMap;
+	int			bucket;
+
+	oldMap = GetHashBucketMap(oldNodes);
+	newMap = GetHashBucketMap(newNodes);
+	for (bucket = 0; bucket < HASH_SIZE; bucket++)
+	{
+		int			oldNode = list_nth_int(oldNodes, oldMap[bucket]);
+
+		if (oldNode != list_nth_int(newNodes, newMap[bucket]))
+		{
+			result = bms_add_member(result, bucket);
+			if (sourceNodes)
+				*sourceNodes = list_append_unique_int(*sourceNodes, oldNode);
+		}
+	}
+	pfree(oldMap);
+	pfree(newMap);
+
+	return result;
+}
+
+
 /*
  * pgxc_redist_build_replicate
  * Build redistribution command list for replicated tables
@@ -364,6 +560,9 @@ distrib_execute_command(RedistribState *distribState, RedistribCommand *command)
 		case DISTRIB_DELETE_MODULO:
 			distrib_delete_hash(distribState, command->execNodes);
 			break;
+		case DISTRIB_MOVE:
+			distrib_move(distribState, command->execNodes);
+			break;
 		case DISTRIB_NONE:
 		default:
 			Assert(0); /* Should not happen */
@@ -373,7 +572,8 @@ distrib_execute_command(RedistribState *distribState, RedistribCommand *command)
 
 /*
  * distrib_copy_to
- * Copy all the data of table to be distributed.
+ * Copy all the data of table to be distributed, or only the data of the hash
+ * buckets changing of node if those are set in distribution state.
  * This data is saved in a tuplestore saved in distribution state.
  * a COPY FROM operation is always done on nodes determined by the locator data
  * in catalogs, explaining why this cannot be done on a subset of nodes. It also
@@ -401,6 +601,17 @@ distrib_copy_to(RedistribState *distribState)
 
 	/* A sufficient lock level needs to be taken at a higher level */
 	rel = relation_open(relOid, NoLock);
+
+	/* Only fetch the rows that move if this is known */
+	if (distribState->buckets)
+	{
+		StringInfoData where;
+
+		initStringInfo(&where);
+		distrib_append_bucket_cond(&where, rel, distribState->buckets);
+		options->rco_where = where.data;
+	}
+
 	RemoteCopy_GetRelationLoc(copyState, rel, NIL);
 	RemoteCopy_BuildStatement(copyState, rel, options, NIL, NIL);
 
@@ -446,11 +657,15 @@ distrib_copy_from(RedistribState *distribState, ExecNodes *exec_nodes)
 	RemoteCopyOptions *options;
 	RemoteCopyData *copyState;
 	TupleDesc tupdesc;
-	/* May be needed to decode partitioning value */
-	int 		partIdx = -1;
-	FmgrInfo 	in_function;
-	Oid 		typioparam;
-	int 		typmod = 0;
+	/* May be needed to decode partitioning values */
+	int			nkeys = 0;
+	int		   *partIdx = NULL;
+	FmgrInfo   *in_functions = NULL;
+	Oid		   *typioparams = NULL;
+	int		   *typmods = NULL;
+	Oid		   *keytypes = NULL;
+	Datum	   *keyvalues = NULL;
+	bool	   *keynulls = NULL;
 
 	/* Nothing to do if on remote node */
 	if (IS_PGXC_DATANODE || IsConnFromCoord())
@@ -481,29 +696,43 @@ distrib_copy_from(RedistribState *distribState, ExecNodes *exec_nodes)
 	tupdesc = RelationGetDescr(rel);
 	if (AttributeNumberIsValid(copyState->rel_loc->partAttrNum))
 	{
-		Oid in_func_oid;
-		int dropped = 0;
-		int i;
-
-		partIdx = copyState->rel_loc->partAttrNum - 1;
+		ListCell   *lc;
+		int			k = 0;
+
+		nkeys = list_length(copyState->rel_loc->partAttrNums);
+		partIdx = (int *) palloc(nkeys * sizeof(int));
+		in_functions = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+		typioparams = (Oid *) palloc(nkeys * sizeof(Oid));
+		typmods = (int *) palloc(nkeys * sizeof(int));
+		keytypes = (Oid *) palloc(nkeys * sizeof(Oid));
+		keyvalues = (Datum *) palloc(nkeys * sizeof(Datum));
+		keynulls = (bool *) palloc(nkeys * sizeof(bool));
+
+		foreach(lc, copyState->rel_loc->partAttrNums)
+		{
+			Oid			in_func_oid;
+			int			attidx = lfirst_int(lc) - 1;
+			int			dropped = 0;
+			int			i;
 
-		/* prepare function to decode partitioning value */
-		getTypeInputInfo(copyState->dist_type,
-						 &in_func_oid, &typioparam);
-		fmgr_info(in_func_oid, &in_function);
-		typmod = tupdesc->attrs[partIdx]->atttypmod;
+			/* prepare function to decode partitioning value */
+			keytypes[k] = tupdesc->attrs[attidx]->atttypid;
+			getTypeInputInfo(keytypes[k], &in_func_oid, &typioparams[k]);
+			fmgr_info(in_func_oid, &in_functions[k]);
+			typmods[k] = tupdesc->attrs[attidx]->atttypmod;
 
-		/*
-		 * Make partIdx pointing to correct field of the datarow.
-		 * The data row does not contain data of dropped attributes, we should
-		 * decrement partIdx appropriately
-		 */
-		for (i = 0; i < partIdx; i++)
-		{
-			if (tupdesc->attrs[i]->attisdropped)
-				dropped++;
+			/*
+			 * Make partIdx pointing to correct field of the datarow.
+			 * The data row does not contain data of dropped attributes, we
+			 * should decrement partIdx appropriately
+			 */
+			for (i = 0; i < attidx; i++)
+			{
+				if (tupdesc->attrs[i]->attisdropped)
+					dropped++;
+			}
+			partIdx[k++] = attidx - dropped;
 		}
-		partIdx -= dropped;
 	}
 
 	/* Inform client of operation being done */
@@ -531,22 +760,39 @@ distrib_copy_from(RedistribState *distribState, ExecNodes *exec_nodes)
 		if (!data)
 			break;
 
-		/* Find value of distribution column if necessary */
-		if (AttributeNumberIsValid(copyState->rel_loc->partAttrNum))
+		/* Find value of distribution key if necessary */
+		if (nkeys > 0)
 		{
 			char 	  **fields;
+			int			k;
 
 			/*
 			 * Split message on an array of fields.
 			 */
 			fields = CopyOps_RawDataToArrayField(tupdesc, data, len);
 
-			Assert(partIdx >= 0);
-			/* Determine partitioning value */
-			if (fields[partIdx])
+			/* Determine partitioning values */
+			for (k = 0; k < nkeys; k++)
+			{
+				Assert(partIdx[k] >= 0);
+				keynulls[k] = (fields[partIdx[k]] == NULL);
+				if (!keynulls[k])
+					keyvalues[k] = InputFunctionCall(&in_functions[k],
+													 fields[partIdx[k]],
+													 typioparams[k],
+													 typmods[k]);
+			}
+
+			if (nkeys > 1)
+			{
+				value = Int32GetDatum(compute_distkey_hash(nkeys, keytypes,
+														   keyvalues,
+														   keynulls));
+				is_null = false;
+			}
+			else if (!keynulls[0])
 			{
-				value = InputFunctionCall(&in_function, fields[partIdx],
-										  typioparam, typmod);
+				value = keyvalues[0];
 				is_null = false;
 			}
 		}
@@ -674,6 +920,7 @@ distrib_delete_hash(RedistribState *distribState, ExecNodes *exec_nodes)
 	StringInfo	buf;
 	Oid			relOid = distribState->relid;
 	ListCell   *item;
+	int16	   *bucketMap = NULL;
 
 	/* Nothing to do if on remote node */
 	if (IS_PGXC_DATANODE || IsConnFromCoord())
@@ -682,6 +929,10 @@ distrib_delete_hash(RedistribState *distribState, ExecNodes *exec_nodes)
 	/* A sufficient lock level needs to be taken at a higher level */
 	rel = relation_open(relOid, NoLock);
 
+	/* Get the node of each hash bucket */
+	if (RelationGetLocInfo(rel)->locatorType == LOCATOR_TYPE_HASH)
+		bucketMap = GetHashBucketMap(RelationGetLocInfo(rel)->nodeList);
+
 	/* Inform client of operation being done */
 	ereport(DEBUG1,
 			(errmsg("Deleting necessary tuples \"%s.%s\"",
@@ -709,29 +960,22 @@ distrib_delete_hash(RedistribState *distribState, ExecNodes *exec_nodes)
 		int			nodenum = lfirst_int(item);
 		int			nodepos = 0;
 		ExecNodes  *local_exec_nodes = makeNode(ExecNodes);
-		TupleDesc	tupDesc = RelationGetDescr(rel);
-		Form_pg_attribute *attr = tupDesc->attrs;
 		ListCell   *item2;
 
 		/* Here the query is launched to a unique node */
 		local_exec_nodes->nodeList = lappend_int(NIL, nodenum);
 
-		/* Get the hash type of relation */
-		hashtype = attr[locinfo->partAttrNum - 1]->atttypid;
-
-		/* Get function hash name */
-		hashfuncname = get_compute_hash_function(hashtype, locinfo->locatorType);
-
-		/* Get distribution column name */
-		if (locinfo->locatorType == LOCATOR_TYPE_HASH)
-			colname = GetRelationHashColumn(locinfo);
-		else if (locinfo->locatorType == LOCATOR_TYPE_MODULO)
-			colname = GetRelationModuloColumn(locinfo);
+		/* Get distribution key and its hash type */
+		if (IsRelationDistributedByValue(locinfo))
+			colname = distrib_key_expr(rel, &hashtype);
 		else
 			ereport(ERROR,
 					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 					 errmsg("Incorrect redistribution operation")));
 
+		/* Get function hash name */
+		hashfuncname = get_compute_hash_function(hashtype, locinfo->locatorType);
+
 		/*
 		 * Find the correct node position in node list of locator information.
 		 * So scan the node list and fetch the position of node.
@@ -746,17 +990,33 @@ distrib_delete_hash(RedistribState *distribState, ExecNodes *exec_nodes)
 
 		/*
 		 * Then build the WHERE clause for deletion.
-		 * The condition that allows to keep the tuples on remote nodes
-		 * is of the type "RemoteNodeNumber != abs(hash_func(dis_col)) % NumDatanodes".
-		 * the remote Datanode has no knowledge of its position in cluster so this
-		 * number needs to be compiled locally on Coordinator.
-		 * Taking the absolute value is necessary as hash may return a negative value.
-		 * For hash distributions a condition with correct hash function is used.
-		 * For modulo distribution, well we might need a hash function call but not
-		 * all the time, this is determined implicitely by get_compute_hash_function.
+		 * For hash distributions, the tuples kept on remote nodes are the ones
+		 * whose hash bucket is stored on this node. The remote Datanode has no
+		 * knowledge of the buckets it stores so they are listed by Coordinator.
+		 * For modulo distributions, the condition that allows to keep the
+		 * tuples on remote nodes is of the type
+		 * "RemoteNodeNumber != abs(dis_col) % NumDatanodes".
+		 * Taking the absolute value is necessary as value may be negative.
+		 * We might need a hash function call but not all the time, this is
+		 * determined implicitely by get_compute_hash_function.
 		 */
 		buf2 = makeStringInfo();
-		if (hashfuncname)
+		if (bucketMap)
+		{
+			Bitmapset  *buckets = NULL;
+			int			bucket;
+
+			for (bucket = 0; bucket < HASH_SIZE; bucket++)
+			{
+				if (bucketMap[bucket] == nodepos)
+					buckets = bms_add_member(buckets, bucket);
+			}
+			appendStringInfo(buf2, "%s WHERE NOT (", buf->data);
+			distrib_append_bucket_cond(buf2, rel, buckets);
+			appendStringInfoChar(buf2, ')');
+			bms_free(buckets);
+		}
+		else if (hashfuncname)
 			appendStringInfo(buf2, "%s WHERE abs(%s(%s)) %% %d != %d",
 							 buf->data, hashfuncname, colname,
 							 list_length(locinfo->nodeList), nodepos);
@@ -775,11 +1035,302 @@ distrib_delete_hash(RedistribState *distribState, ExecNodes *exec_nodes)
 	relation_close(rel, NoLock);
 
 	/* Clean buffers */
+	if (bucketMap)
+		pfree(bucketMap);
 	pfree(buf->data);
 	pfree(buf);
 }
 
 
+/*
+ * distrib_move
+ * Move the rows of the hash buckets changing of node from the Datanodes in
+ * exec_nodes, where they still are, to the Datanodes the catalog now sets
+ * for them. This is done by an INSERT SELECT of the relation into itself for
+ * each batch of buckets. Those are planned with the relation scanned on the
+ * source nodes only, as round robin distributed, so that the planner sends
+ * the rows read to their new node with a RemoteSubplan: rows go from one
+ * Datanode to another and never through the Coordinator. Triggers do not fire,
+ * see distrib_disable_triggers, and relations with rules are refused.
+ */
+static void
+distrib_move(RedistribState *distribState, ExecNodes *exec_nodes)
+{
+	Relation	rel;
+	char	   *relname;
+	RelationLocInfo *source;
+	Bitmapset  *batch = NULL;
+	int			bucket = -1;
+	uint64		moved = 0;
+	uint64		rows;
+	bool		save_fqs = enable_fast_query_shipping;
+
+	/* Nothing to do if on remote node */
+	if (IS_PGXC_DATANODE || IsConnFromCoord())
+		return;
+
+	/* A sufficient lock level needs to be taken at a higher level */
+	rel = relation_open(distribState->relid, NoLock);
+
+	/* The INSERT SELECT would be rewritten by the rules of the relation */
+	if (rel->rd_rules != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot redistribute table \"%s\" with rules",
+						RelationGetRelationName(rel)),
+				 errhint("Drop the rules of the table and create them again after.")));
+
+	relname = quote_qualified_identifier(
+					get_namespace_name(RelationGetNamespace(rel)),
+					RelationGetRelationName(rel));
+
+	/* Rows are read where they are, not where the catalog sets them */
+	source = CopyRelationLocInfo(RelationGetLocInfo(rel));
+	source->locatorType = LOCATOR_TYPE_RROBIN;
+	source->partAttrNum = 0;
+	list_free(source->partAttrNums);
+	source->partAttrNums = NIL;
+	list_free(source->nodeList);
+	source->nodeList = list_copy(exec_nodes->nodeList);
+	source->roundRobinNode = NULL;
+
+	/* Inform client of operation being done */
+	ereport(DEBUG1,
+			(errmsg("Moving data for relation \"%s.%s\"",
+					get_namespace_name(RelationGetNamespace(rel)),
+					RelationGetRelationName(rel))));
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	/*
+	 * Fast query shipping would run the INSERT SELECT on each Datanode, as the
+	 * relation is distributed the same way on both sides.
+	 */
+	enable_fast_query_shipping = false;
+	redistribSourceRelid = distribState->relid;
+	redistribSourceLocInfo = source;
+	PG_TRY();
+	{
+		while ((bucket = bms_next_member(distribState->buckets, bucket)) >= 0)
+		{
+			batch = bms_add_member(batch, bucket);
+			if (bms_num_members(batch) < REDISTRIB_MOVE_BUCKETS)
+				continue;
+
+			rows = distrib_move_batch(relname, rel, batch);
+			rebalance_progress_batch(bms_num_members(batch), rows);
+			moved += rows;
+			bms_free(batch);
+			batch = NULL;
+
+			CHECK_FOR_INTERRUPTS();
+		}
+		if (batch)
+		{
+			rows = distrib_move_batch(relname, rel, batch);
+			rebalance_progress_batch(bms_num_members(batch), rows);
+			moved += rows;
+		}
+	}
+	PG_CATCH();
+	{
+		enable_fast_query_shipping = save_fqs;
+		redistribSourceRelid = InvalidOid;
+		redistribSourceLocInfo = NULL;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	enable_fast_query_shipping = save_fqs;
+	redistribSourceRelid = InvalidOid;
+	redistribSourceLocInfo = NULL;
+
+	SPI_finish();
+
+	ereport(DEBUG1,
+			(errmsg("Moved " UINT64_FORMAT " rows of relation \"%s.%s\"",
+					moved, get_namespace_name(RelationGetNamespace(rel)),
+					RelationGetRelationName(rel))));
+
+	bms_free(batch);
+	FreeRelationLocInfo(source);
+	pfree(relname);
+
+	/* Lock is maintained until transaction commits */
+	relation_close(rel, NoLock);
+}
+
+
+/*
+ * distrib_disable_triggers
+ * Rows of hash buckets changing of node are moved with an INSERT SELECT and
+ * a DELETE, which would fire the triggers of the relation, including the
+ * internal ones of foreign keys, as if the rows were new or gone. Set
+ * session_replication_role to replica on the Datanodes for the time of the
+ * move, as logical replication does, so that they do not. Return the value
+ * to restore once done, or NULL if nothing was changed.
+ */
+static char *
+distrib_disable_triggers(RedistribState *distribState)
+{
+	Relation	rel;
+	bool		hastriggers;
+	const char *role;
+	ListCell   *item;
+	bool		moves = false;
+
+	foreach(item, distribState->commands)
+	{
+		RedistribCommand *command = (RedistribCommand *) lfirst(item);
+
+		if (command->type == DISTRIB_MOVE)
+			moves = true;
+	}
+	if (!moves)
+		return NULL;
+
+	rel = relation_open(distribState->relid, NoLock);
+	hastriggers = (rel->trigdesc != NULL);
+
+	if (hastriggers && !superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to redistribute table \"%s\" with triggers",
+						RelationGetRelationName(rel)),
+				 errdetail("Rows are moved with session_replication_role set to replica.")));
+	relation_close(rel, NoLock);
+
+	role = GetConfigOption("session_replication_role", false, false);
+	if (!hastriggers || strcmp(role, "replica") == 0)
+		return NULL;
+
+	distrib_set_replication_role(distribState, "replica");
+	return pstrdup(role);
+}
+
+
+/*
+ * distrib_set_replication_role
+ * Set session_replication_role on all the Datanodes until the end of the
+ * transaction.
+ */
+static void
+distrib_set_replication_role(RedistribState *distribState, const char *role)
+{
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf, "SET LOCAL session_replication_role = %s", role);
+	distrib_execute_query(buf.data, IsTempTable(distribState->relid), NULL);
+	pfree(buf.data);
+}
+
+
+/*
+ * distrib_move_batch
+ * Move the rows of given hash buckets, and return how many were moved
+ */
+static uint64
+distrib_move_batch(char *relname, Relation rel, Bitmapset *buckets)
+{
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf, "INSERT INTO %s SELECT * FROM %s WHERE ",
+					 relname, relname);
+	distrib_append_bucket_cond(&buf, rel, buckets);
+
+	if (SPI_execute(buf.data, false, 0) != SPI_OK_INSERT)
+		elog(ERROR, "failed to move rows of relation \"%s\"",
+			 RelationGetRelationName(rel));
+	pfree(buf.data);
+
+	return (uint64) SPI_processed;
+}
+
+
+/*
+ * GetRedistribSourceLocInfo
+ * Return the locator information scans of given relation have to use while
+ * its rows are moved by a redistribution, or NULL to use the one of the
+ * catalog.
+ */
+RelationLocInfo *
+GetRedistribSourceLocInfo(Oid relid)
+{
+	if (OidIsValid(redistribSourceRelid) && redistribSourceRelid == relid)
+		return CopyRelationLocInfo(redistribSourceLocInfo);
+	return NULL;
+}
+
+
+/*
+ * distrib_append_bucket_cond
+ * Append to buf a condition checking that the hash bucket of the distribution
+ * column of given relation is one of given buckets. Like for the locator, NULL
+ * values are in bucket 0.
+ */
+static void
+distrib_append_bucket_cond(StringInfo buf, Relation rel, Bitmapset *buckets)
+{
+	Oid			keytype;
+	char	   *colname = distrib_key_expr(rel, &keytype);
+	char	   *hashfuncname;
+	int			bucket = -1;
+	bool		first = true;
+
+	hashfuncname = get_compute_hash_function(keytype, LOCATOR_TYPE_HASH);
+
+	appendStringInfo(buf, "CASE WHEN %s IS NULL THEN %s ELSE (%s(%s) & %d) = ANY ('{",
+					 colname, bms_is_member(0, buckets) ? "true" : "false",
+					 hashfuncname, colname, HASH_MASK);
+	while ((bucket = bms_next_member(buckets, bucket)) >= 0)
+	{
+		appendStringInfo(buf, first ? "%d" : ",%d", bucket);
+		first = false;
+	}
+	appendStringInfoString(buf, "}'::int4[]) END");
+}
+
+
+/*
+ * distrib_key_expr
+ * Return the SQL expression of the distribution key of given relation, and
+ * set keytype to its type. A key of several columns is the int4 computed by
+ * pgxc_distkey_hash.
+ */
+static char *
+distrib_key_expr(Relation rel, Oid *keytype)
+{
+	RelationLocInfo *locinfo = RelationGetLocInfo(rel);
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	StringInfoData buf;
+	ListCell   *lc;
+
+	if (!IsRelationMultiColumnDistributed(locinfo))
+	{
+		Form_pg_attribute attr = tupdesc->attrs[locinfo->partAttrNum - 1];
+
+		*keytype = attr->atttypid;
+		return pstrdup(quote_identifier(NameStr(attr->attname)));
+	}
+
+	initStringInfo(&buf);
+	appendStringInfoString(&buf, "pg_catalog.pgxc_distkey_hash(");
+	foreach(lc, locinfo->partAttrNums)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[lfirst_int(lc) - 1];
+
+		if (lc != list_head(locinfo->partAttrNums))
+			appendStringInfoString(&buf, ", ");
+		appendStringInfoString(&buf, quote_identifier(NameStr(attr->attname)));
+	}
+	appendStringInfoChar(&buf, ')');
+	*keytype = INT4OID;
+	return buf.data;
+}
+
+
 /*
  * makeRedistribState
  * Build a distribution state operator
@@ -791,6 +1342,7 @@ makeRedistribState(Oid relOid)
 	res->relid = relOid;
 	res->commands = NIL;
 	res->store = NULL;
+	res->buckets = NULL;
 	return res;
 }
 
@@ -814,6 +1366,7 @@ FreeRedistribState(RedistribState *state)
 		list_free(state->commands);
 	if (state->store)
 		tuplestore_clear(state->store);
+	bms_free(state->buckets);
 }
 
 /*
@@ -870,3 +1423,548 @@ distrib_execute_query(char *sql, bool is_temp, ExecNodes *exec_nodes)
 	/* Be sure to advance the command counter after the last command */
 	CommandCounterIncrement();
 }
+
+
+/*
+ * PGXCRebalance
+ * Move the tables distributed on the nodes of the source of the statement to
+ * the nodes of its target, all the Datanodes by default.
+ *
+ * Each table is moved in its own transaction by an ALTER TABLE ... TO NODE,
+ * which is sent to the other nodes like any other, so that a table is only
+ * locked while its own rows move. Hash distributed tables only move the rows
+ * of the buckets changing of node, see pgxc_redist_build_hash_nodes.
+ *
+ * Several sessions of the same Coordinator may run the same REBALANCE to move
+ * tables concurrently: a session skips the tables another one is moving and
+ * comes back to them at the end, when they are normally moved already.
+ */
+void
+PGXCRebalance(RebalanceStmt *stmt, bool isTopLevel)
+{
+	MemoryContext rebalanceContext;
+	MemoryContext oldcontext;
+	List	   *sourceNodes;
+	List	   *targetNodes;
+	char	   *alterClause;
+	List	   *tables;
+	List	   *deferred = NIL;
+	ListCell   *lc;
+	int64		buckets;
+	int			delay = 0;
+
+	if (!IS_PGXC_COORDINATOR || IsConnFromCoord())
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("REBALANCE can only be run on a Coordinator")));
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to run REBALANCE")));
+
+	/* Tables are moved in their own transactions */
+	PreventTransactionChain(isTopLevel, "REBALANCE");
+
+	foreach(lc, stmt->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "delay") == 0)
+		{
+			delay = defGetInt32(def);
+			if (delay < 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("REBALANCE delay must not be negative")));
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("unrecognized REBALANCE option \"%s\"",
+							def->defname)));
+	}
+
+	/*
+	 * What has to be kept across the transactions is allocated in a child of
+	 * PortalContext, which goes away on error.
+	 */
+	rebalanceContext = AllocSetContextCreate(PortalContext,
+											 "Rebalance",
+											 ALLOCSET_DEFAULT_MINSIZE,
+											 ALLOCSET_DEFAULT_INITSIZE,
+											 ALLOCSET_DEFAULT_MAXSIZE);
+	oldcontext = MemoryContextSwitchTo(rebalanceContext);
+	sourceNodes = rebalance_nodes(stmt->source, NULL);
+	targetNodes = rebalance_nodes(stmt->target, &alterClause);
+	tables = rebalance_plan(sourceNodes, targetNodes, &buckets);
+	MemoryContextSwitchTo(oldcontext);
+
+	if (tables == NIL)
+	{
+		ereport(NOTICE,
+				(errmsg("no table to rebalance")));
+		MemoryContextDelete(rebalanceContext);
+		return;
+	}
+
+	ereport(DEBUG1,
+			(errmsg("Rebalancing %d tables, " INT64_FORMAT " hash buckets",
+					list_length(tables), buckets)));
+
+	rebalance_progress_start(list_length(tables), buckets);
+	rebalanceDelay = delay;
+
+	/* Commit the transaction started in PostgresMain() */
+	if (ActiveSnapshotSet())
+		PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	PG_ENSURE_ERROR_CLEANUP(rebalance_progress_end, (Datum) 0);
+	{
+		foreach(lc, tables)
+		{
+			RebalanceTable *table = (RebalanceTable *) lfirst(lc);
+
+			if (!rebalance_table(table, sourceNodes, alterClause, false))
+			{
+				oldcontext = MemoryContextSwitchTo(rebalanceContext);
+				deferred = lappend(deferred, table);
+				MemoryContextSwitchTo(oldcontext);
+			}
+		}
+
+		/* Wait for the tables locked by other sessions */
+		foreach(lc, deferred)
+			(void) rebalance_table((RebalanceTable *) lfirst(lc), sourceNodes,
+								   alterClause, true);
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(rebalance_progress_end, (Datum) 0);
+	rebalance_progress_end(0, (Datum) 0);
+
+	/* Match the commit waiting for us in PostgresMain() */
+	StartTransactionCommand();
+
+	MemoryContextDelete(rebalanceContext);
+}
+
+
+/*
+ * rebalance_nodes
+ * Return the list of Datanode indexes of given subcluster, all the Datanodes
+ * if NULL. If alterClause is not NULL, it is set to the ALTER TABLE clause
+ * moving a table to these nodes.
+ */
+static List *
+rebalance_nodes(PGXCSubCluster *subcluster, char **alterClause)
+{
+	List	   *result = NIL;
+	Oid		   *nodeoids;
+	int			numnodes;
+	int			i;
+	StringInfoData buf;
+
+	nodeoids = GetRelationDistributionNodes(subcluster, &numnodes);
+	initStringInfo(&buf);
+	appendStringInfoString(&buf, "TO NODE (");
+	for (i = 0; i < numnodes; i++)
+	{
+		char		ntype = PGXC_NODE_DATANODE;
+		int			nodeid = PGXCNodeGetNodeId(nodeoids[i], &ntype);
+		char	   *nodename = get_pgxc_nodename(nodeoids[i]);
+
+		/* The node has been created after the pooler was reloaded */
+		if (nodeid < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_OBJECT),
+					 errmsg("Datanode \"%s\" is not known to this session",
+							nodename),
+					 errhint("Run pgxc_pool_reload() after creating nodes.")));
+
+		result = lappend_int(result, nodeid);
+		appendStringInfo(&buf, i == 0 ? "%s" : ", %s",
+						 quote_identifier(nodename));
+	}
+	appendStringInfoChar(&buf, ')');
+	pfree(nodeoids);
+
+	if (alterClause)
+		*alterClause = buf.data;
+	else
+		pfree(buf.data);
+
+	return result;
+}
+
+
+/*
+ * rebalance_same_nodes
+ * Do given lists hold the same Datanode indexes, in any order?
+ */
+static bool
+rebalance_same_nodes(List *nodes1, List *nodes2)
+{
+	return list_length(nodes1) == list_length(nodes2) &&
+		list_difference_int(nodes1, nodes2) == NIL;
+}
+
+
+/*
+ * rebalance_plan
+ * Return the list of tables to move from sourceNodes to targetNodes, and set
+ * buckets to the number of hash buckets changing of node they have.
+ */
+static List *
+rebalance_plan(List *sourceNodes, List *targetNodes, int64 *buckets)
+{
+	List	   *result = NIL;
+	Relation	classRel;
+	SysScanDesc scan;
+	HeapTuple	tuple;
+	int			hashBuckets;
+
+	*buckets = 0;
+	if (rebalance_same_nodes(sourceNodes, targetNodes))
+		return NIL;
+
+	/* The buckets changing of node only depend on the set of nodes */
+	hashBuckets = bms_num_members(distrib_moved_buckets(sourceNodes,
+														targetNodes, NULL));
+
+	classRel = heap_open(PgxcClassRelationId, AccessShareLock);
+	scan = systable_beginscan(classRel, InvalidOid, false, NULL, 0, NULL);
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Oid			relid = ((Form_pgxc_class) GETSTRUCT(tuple))->pcrelid;
+		Relation	rel;
+		RelationLocInfo *locinfo;
+		RebalanceTable *table;
+
+		/* The table may be dropped concurrently */
+		rel = try_relation_open(relid, AccessShareLock);
+		if (rel == NULL)
+			continue;
+		locinfo = RelationGetLocInfo(rel);
+
+		/* Temporary tables of other sessions can not be altered */
+		if (locinfo == NULL ||
+			rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+			!rebalance_same_nodes(locinfo->nodeList, sourceNodes))
+		{
+			relation_close(rel, AccessShareLock);
+			continue;
+		}
+
+		/* Values of ranges or lists of a node can not be given to another */
+		if (IsRelationBoundDistributed(locinfo))
+		{
+			ereport(NOTICE,
+					(errmsg("skipping \"%s\" --- tables distributed by range or list have to be moved with ALTER TABLE",
+							RelationGetRelationName(rel))));
+			relation_close(rel, AccessShareLock);
+			continue;
+		}
+
+		table = (RebalanceTable *) palloc(sizeof(RebalanceTable));
+		table->relid = relid;
+		table->buckets = locinfo->locatorType == LOCATOR_TYPE_HASH ?
+			hashBuckets : 0;
+		*buckets += table->buckets;
+		result = lappend(result, table);
+
+		relation_close(rel, AccessShareLock);
+	}
+	systable_endscan(scan);
+	heap_close(classRel, AccessShareLock);
+
+	return result;
+}
+
+
+/*
+ * rebalance_table
+ * Move a table in its own transaction. If wait is false and the table is
+ * locked, return false without moving it.
+ */
+static bool
+rebalance_table(RebalanceTable *table, List *sourceNodes,
+				const char *alterClause, bool wait)
+{
+	Relation	rel;
+	bool		moved = false;
+
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	/* Take the lock of ALTER TABLE, to know if another session has it */
+	if (wait)
+		LockRelationOid(table->relid, ExclusiveLock);
+	else if (!ConditionalLockRelationOid(table->relid, ExclusiveLock))
+	{
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		return false;
+	}
+
+	/* The table may have been dropped or moved since it was planned */
+	rel = try_relation_open(table->relid, NoLock);
+	if (rel && RelationGetLocInfo(rel) &&
+		rebalance_same_nodes(RelationGetLocInfo(rel)->nodeList, sourceNodes))
+	{
+		char	   *relname;
+		char	   *sql;
+		Node	   *parsetree;
+
+		relname = quote_qualified_identifier(
+						get_namespace_name(RelationGetNamespace(rel)),
+						RelationGetRelationName(rel));
+		relation_close(rel, NoLock);
+
+		ereport(DEBUG1,
+				(errmsg("Rebalancing relation %s", relname)));
+
+		rebalance_progress_table(table->relid, 0);
+
+		sql = psprintf("ALTER TABLE %s %s", relname, alterClause);
+		parsetree = (Node *) linitial(raw_parser(sql));
+		ProcessUtility(parsetree, sql, PROCESS_UTILITY_QUERY, NULL,
+					   None_Receiver, false, NULL);
+		moved = true;
+	}
+	else if (rel)
+		relation_close(rel, NoLock);
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	/* Buckets of a table moved by another session are done too */
+	rebalance_progress_table(InvalidOid, moved ? 0 : table->buckets);
+
+	if (rebalanceDelay > 0)
+		pg_usleep(rebalanceDelay * 1000L);
+	CHECK_FOR_INTERRUPTS();
+
+	return true;
+}
+
+
+/*
+ * RebalanceShmemSize
+ * Size of the shared memory of REBALANCE progress
+ */
+Size
+RebalanceShmemSize(void)
+{
+	return mul_size(MaxBackends, sizeof(RebalanceProgress));
+}
+
+
+/*
+ * RebalanceShmemInit
+ * Initialize the shared memory of REBALANCE progress
+ */
+void
+RebalanceShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	rebalanceProgress = (RebalanceProgress *)
+		ShmemInitStruct("Rebalance Progress", RebalanceShmemSize(), &found);
+
+	if (!found)
+	{
+		for (i = 0; i < MaxBackends; i++)
+		{
+			SpinLockInit(&rebalanceProgress[i].mutex);
+			rebalanceProgress[i].pid = 0;
+		}
+	}
+}
+
+
+/*
+ * rebalance_progress_start
+ * Publish the progress of the REBALANCE of this backend
+ */
+static void
+rebalance_progress_start(int tables, int64 buckets)
+{
+	RebalanceProgress *progress;
+
+	if (rebalanceProgress == NULL)
+		return;
+
+	progress = &rebalanceProgress[MyBackendId - 1];
+	SpinLockAcquire(&progress->mutex);
+	progress->pid = MyProcPid;
+	progress->datid = MyDatabaseId;
+	progress->relid = InvalidOid;
+	progress->tablesTotal = tables;
+	progress->tablesDone = 0;
+	progress->bucketsTotal = buckets;
+	progress->bucketsMoved = 0;
+	progress->rowsMoved = 0;
+	progress->startTime = GetCurrentTimestamp();
+	SpinLockRelease(&progress->mutex);
+
+	myRebalanceProgress = progress;
+}
+
+
+/*
+ * rebalance_progress_end
+ * Stop publishing the progress of the REBALANCE of this backend, also called
+ * on error
+ */
+static void
+rebalance_progress_end(int code, Datum arg)
+{
+	if (myRebalanceProgress)
+	{
+		SpinLockAcquire(&myRebalanceProgress->mutex);
+		myRebalanceProgress->pid = 0;
+		SpinLockRelease(&myRebalanceProgress->mutex);
+		myRebalanceProgress = NULL;
+	}
+	rebalanceDelay = 0;
+}
+
+
+/*
+ * rebalance_progress_table
+ * Report the table REBALANCE starts to move, or with InvalidOid that the
+ * current table is done, counting given buckets as moved
+ */
+static void
+rebalance_progress_table(Oid relid, int64 buckets)
+{
+	if (myRebalanceProgress == NULL)
+		return;
+
+	SpinLockAcquire(&myRebalanceProgress->mutex);
+	myRebalanceProgress->relid = relid;
+	if (!OidIsValid(relid))
+		myRebalanceProgress->tablesDone++;
+	myRebalanceProgress->bucketsMoved += buckets;
+	SpinLockRelease(&myRebalanceProgress->mutex);
+}
+
+
+/*
+ * rebalance_progress_batch
+ * Report a batch of hash buckets moved by distrib_move, and throttle
+ * REBALANCE
+ */
+static void
+rebalance_progress_batch(int buckets, uint64 rows)
+{
+	if (myRebalanceProgress == NULL)
+		return;
+
+	SpinLockAcquire(&myRebalanceProgress->mutex);
+	myRebalanceProgress->bucketsMoved += buckets;
+	myRebalanceProgress->rowsMoved += rows;
+	SpinLockRelease(&myRebalanceProgress->mutex);
+
+	if (rebalanceDelay > 0)
+		pg_usleep(rebalanceDelay * 1000L);
+}
+
+
+/*
+ * pgxc_stat_get_rebalance
+ * Progress of the REBALANCE commands running on this Coordinator
+ */
+Datum
+pgxc_stat_get_rebalance(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	RebalanceProgress *entries;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc	tupdesc;
+		int			count = 0;
+		int			i;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(9, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "pid",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "datid",
+						   OIDOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "relid",
+						   OIDOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "tables_total",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "tables_done",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "buckets_total",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 7, "buckets_moved",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 8, "rows_moved",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 9, "start_time",
+						   TIMESTAMPTZOID, -1, 0);
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/* Copy the slots in use, Datanodes have none */
+		entries = NULL;
+		if (rebalanceProgress)
+		{
+			entries = (RebalanceProgress *)
+				palloc(MaxBackends * sizeof(RebalanceProgress));
+			for (i = 0; i < MaxBackends; i++)
+			{
+				RebalanceProgress *progress = &rebalanceProgress[i];
+
+				SpinLockAcquire(&progress->mutex);
+				if (progress->pid != 0)
+					memcpy(&entries[count++], progress,
+						   sizeof(RebalanceProgress));
+				SpinLockRelease(&progress->mutex);
+			}
+		}
+
+		funcctx->user_fctx = entries;
+		funcctx->max_calls = count;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	entries = (RebalanceProgress *) funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		RebalanceProgress *entry = &entries[funcctx->call_cntr];
+		Datum		values[9];
+		bool		nulls[9];
+		HeapTuple	tuple;
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(entry->pid);
+		values[1] = ObjectIdGetDatum(entry->datid);
+		if (OidIsValid(entry->relid))
+			values[2] = ObjectIdGetDatum(entry->relid);
+		else
+			nulls[2] = true;
+		values[3] = Int32GetDatum(entry->tablesTotal);
+		values[4] = Int32GetDatum(entry->tablesDone);
+		values[5] = Int64GetDatum(entry->bucketsTotal);
+		values[6] = Int64GetDatum(entry->bucketsMoved);
+		values[7] = Int64GetDatum(entry->rowsMoved);
+		values[8] = TimestampTzGetDatum(entry->startTime);
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
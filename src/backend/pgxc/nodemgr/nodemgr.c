@@ -57,6 +57,9 @@ static int	   *shmemNumDataNodes;
 NodeDefinition *coDefs;
 NodeDefinition *dnDefs;
 
+/* Shared memory table of the load of the Datanodes, MaxDataNodes slots */
+static NodeLoad *dnLoads;
+
 /*
  * NodeTablesInit
  *	Initializes shared memory tables of Coordinators and Datanodes.
@@ -97,6 +100,21 @@ NodeTablesShmemInit(void)
 	/* Mark it empty upon creation */
 	if (!found)
 		*shmemNumDataNodes = 0;
+
+	dnLoads = ShmemInitStruct("Datanode Load Table",
+							  sizeof(NodeLoad) * MaxDataNodes,
+							  &found);
+	if (!found)
+	{
+		int i;
+
+		for (i = 0; i < MaxDataNodes; i++)
+		{
+			dnLoads[i].nodeoid = InvalidOid;
+			pg_atomic_init_u32(&dnLoads[i].inflight, 0);
+			pg_atomic_init_u32(&dnLoads[i].latency, 0);
+		}
+	}
 }
 
 
@@ -114,6 +132,7 @@ NodeTablesShmemSize(void)
 	co_size = add_size(co_size, sizeof(int));
 	dn_size = mul_size(sizeof(NodeDefinition), MaxDataNodes);
 	dn_size = add_size(dn_size, sizeof(int));
+	dn_size = add_size(dn_size, mul_size(sizeof(NodeLoad), MaxDataNodes));
 
 	return add_size(co_size, dn_size);
 }
@@ -314,6 +333,7 @@ PgxcNodeListAndCount(void)
 	Relation rel;
 	HeapScanDesc scan;
 	HeapTuple   tuple;
+	int			i, j;
 
 	LWLockAcquire(NodeTableLock, LW_EXCLUSIVE);
 
@@ -366,6 +386,39 @@ PgxcNodeListAndCount(void)
 	if (*shmemNumDataNodes > 1)
 		qsort(dnDefs, *shmemNumDataNodes, sizeof(NodeDefinition), cmp_nodes);
 
+	/*
+	 * Keep the load slots of the remaining Datanodes, free those of the
+	 * dropped ones and give the free slots to the new ones.
+	 */
+	for (i = 0; i < MaxDataNodes; i++)
+	{
+		if (!OidIsValid(dnLoads[i].nodeoid))
+			continue;
+		for (j = 0; j < *shmemNumDataNodes; j++)
+			if (dnDefs[j].nodeoid == dnLoads[i].nodeoid)
+				break;
+		if (j == *shmemNumDataNodes)
+			dnLoads[i].nodeoid = InvalidOid;
+	}
+	for (j = 0; j < *shmemNumDataNodes; j++)
+	{
+		int		free_slot = -1;
+
+		for (i = 0; i < MaxDataNodes; i++)
+		{
+			if (dnLoads[i].nodeoid == dnDefs[j].nodeoid)
+				break;
+			if (free_slot < 0 && !OidIsValid(dnLoads[i].nodeoid))
+				free_slot = i;
+		}
+		if (i == MaxDataNodes && free_slot >= 0)
+		{
+			dnLoads[free_slot].nodeoid = dnDefs[j].nodeoid;
+			pg_atomic_write_u32(&dnLoads[free_slot].inflight, 0);
+			pg_atomic_write_u32(&dnLoads[free_slot].latency, 0);
+		}
+	}
+
 	LWLockRelease(NodeTableLock);
 }
 
@@ -485,6 +538,35 @@ PgxcNodeGetDefinition(Oid node)
 }
 
 
+/*
+ * Find the load slot of a Datanode in the shared memory table, NULL if it
+ * has none.  The slot stays valid as long as the node is defined.
+ */
+NodeLoad *
+PgxcNodeGetLoad(Oid node)
+{
+	NodeLoad   *result = NULL;
+	int			i;
+
+	if (!OidIsValid(node))
+		return NULL;
+
+	LWLockAcquire(NodeTableLock, LW_SHARED);
+
+	for (i = 0; i < MaxDataNodes; i++)
+	{
+		if (dnLoads[i].nodeoid == node)
+		{
+			result = &dnLoads[i];
+			break;
+		}
+	}
+
+	LWLockRelease(NodeTableLock);
+	return result;
+}
+
+
 /*
  * PgxcNodeCreate
  *
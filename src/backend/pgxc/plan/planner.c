@@ -475,9 +475,10 @@ validate_part_col_updatable(const Query *query)
 
 			/*
 			 * See if we have a constant expression comparing against the
-			 * designated partitioned column
+			 * designated partitioned columns
 			 */
-			if (strcmp(tle->resname, GetRelationDistribColumn(rel_loc_info)) == 0)
+			if (list_member_int(rel_loc_info->partAttrNums,
+								get_attnum(rel_loc_info->relid, tle->resname)))
 				ereport(ERROR,
 						(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
 						(errmsg("Partition column can't be updated in current version"))));
@@ -24,10 +24,13 @@
 #include "postgres.h"
 #include "access/twophase.h"
 #include "access/gtm.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "access/relscan.h"
+#include "catalog/pg_index.h"
 #include "catalog/pg_type.h"
 #include "catalog/pgxc_node.h"
 #include "commands/prepare.h"
@@ -52,8 +55,10 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/rel.h"
 #include "utils/tuplesort.h"
 #include "utils/snapmgr.h"
+#include "utils/syscache.h"
 #include "utils/builtins.h"
 #include "pgxc/locator.h"
 #include "pgxc/pgxc.h"
@@ -1680,6 +1685,7 @@ handle_response(PGXCNodeHandle *conn, ResponseCombiner *combiner)
 				/* No activity is expected on the connection until next query */
 				conn->state = DN_CONNECTION_STATE_IDLE;
 				conn->combiner = NULL;
+				pgxc_node_request_done(conn, true);
 				return RESPONSE_SUSPENDED;
 			case '1': /* ParseComplete */
 			case '2': /* BindComplete */
@@ -1723,6 +1729,7 @@ handle_response(PGXCNodeHandle *conn, ResponseCombiner *combiner)
 				conn->transaction_status = msg[0];
 				conn->state = DN_CONNECTION_STATE_IDLE;
 				conn->combiner = NULL;
+				pgxc_node_request_done(conn, true);
 #ifdef DN_CONNECTION_DEBUG
 				conn->have_row_desc = false;
 #endif
@@ -1796,6 +1803,7 @@ is_data_node_ready(PGXCNodeHandle * conn)
 			conn->transaction_status = msg[0];
 			conn->state = DN_CONNECTION_STATE_IDLE;
 			conn->combiner = NULL;
+			pgxc_node_request_done(conn, true);
 			return true;
 		}
 	}
@@ -2670,17 +2678,28 @@ DataNodeCopyBegin(RemoteCopyData *rcstate)
 	 * fail and we leave with dirty connections.
 	 * If we get an error now datanode connection will be clean and error
 	 * handler will issue transaction abort.
+	 * Rows of a RANGE or LIST distributed table are placed by the bounds of
+	 * the table, which only a relation locator knows about.
 	 */
-	rcstate->locator = createLocator(
-			rcstate->is_from ? rcstate->rel_loc->locatorType
-					: LOCATOR_TYPE_RROBIN,
-			rcstate->is_from ? RELATION_ACCESS_INSERT : RELATION_ACCESS_READ,
-			rcstate->dist_type,
-			LOCATOR_LIST_POINTER,
-			conn_count,
-			(void *) connections,
-			NULL,
-			false);
+	if (rcstate->is_from && IsRelationBoundDistributed(rcstate->rel_loc))
+		rcstate->locator = createRelationLocator(rcstate->rel_loc,
+												 RELATION_ACCESS_INSERT,
+												 LOCATOR_LIST_POINTER,
+												 conn_count,
+												 (void *) connections,
+												 NULL,
+												 false);
+	else
+		rcstate->locator = createLocator(
+				rcstate->is_from ? rcstate->rel_loc->locatorType
+						: LOCATOR_TYPE_RROBIN,
+				rcstate->is_from ? RELATION_ACCESS_INSERT : RELATION_ACCESS_READ,
+				rcstate->dist_type,
+				LOCATOR_LIST_POINTER,
+				conn_count,
+				(void *) connections,
+				NULL,
+				false);
 
 	/* Send query to nodes */
 	for (i = 0; i < conn_count; i++)
@@ -2991,9 +3010,15 @@ get_exec_connections(RemoteQueryState *planstate,
 										   planstate->combiner.ss.ps.ps_ExprContext,
 										   &isnull,
 										   NULL);
-			RelationLocInfo *rel_loc_info = GetRelationLocInfo(exec_nodes->en_relid);
+			/*
+			 * Locate the value with the locator cached in the relcache entry
+			 * rather than building one for each row
+			 */
+			Relation	rel = relation_open(exec_nodes->en_relid,
+											AccessShareLock);
+			RelationLocInfo *rel_loc_info = RelationGetLocInfo(rel);
 			/* PGXCTODO what is the type of partvalue here */
-			ExecNodes *nodes = GetRelationNodes(rel_loc_info,
+			ExecNodes *nodes = GetRelationNodesForRelation(rel,
 												partvalue,
 												isnull,
 												exec_nodes->accesstype);
@@ -3011,7 +3036,7 @@ get_exec_connections(RemoteQueryState *planstate,
 				primarynode = nodes->primarynodelist;
 				pfree(nodes);
 			}
-			FreeRelationLocInfo(rel_loc_info);
+			relation_close(rel, AccessShareLock);
 		}
 		else if (OidIsValid(exec_nodes->en_relid))
 		{
@@ -4975,6 +5000,72 @@ determine_param_types(Plan *plan,  struct find_params_context *context)
 }
 
 
+/*
+ * Can the replicated write done by the subplan never wait for a row lock held
+ * by a concurrent writer?
+ *
+ * Replicated writes are run on the primary node first and on the other nodes
+ * once it is completed, so that the conflicting writers are ordered by the
+ * row locks on the primary and may not deadlock on the other nodes.  A plain
+ * INSERT does not lock existing rows, unless a unique or exclusion index makes
+ * it wait for the conflicting inserter, a trigger (including the foreign key
+ * checks) locks other rows or the source of the rows is locked for update.
+ * Then there is nothing to order, and the statement may be sent to all the
+ * nodes at once.  Any other replicated write, in particular every UPDATE and
+ * DELETE and every INSERT into a table with a primary key, keeps the two
+ * round trips: no per-key ordering is attempted.
+ *
+ * The table locks are then taken on all the nodes at once as well.  A
+ * conflicting table lock requested through another Coordinator, by LOCK
+ * TABLE or DDL, may be granted first on some of the nodes and deadlock with
+ * the INSERT across nodes.  That can not be seen from here, so it is left to
+ * lock_timeout and documented with CREATE NODE.  Through this Coordinator
+ * both are ordered by the table lock taken here first.
+ */
+static bool
+replicated_write_conflict_free(RemoteSubplan *node, EState *estate)
+{
+	ModifyTable *mt = (ModifyTable *) outerPlan(node);
+	Relation	rel;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		result;
+
+	if (!IsA(mt, ModifyTable) ||
+			mt->operation != CMD_INSERT ||
+			mt->onConflictAction != ONCONFLICT_NONE ||
+			list_length(mt->resultRelations) != 1 ||
+			estate->es_plannedstmt->rowMarks != NIL)
+		return false;
+
+	/* The target relation is locked by the parser already */
+	rel = heap_open(getrelid(linitial_int(mt->resultRelations),
+							 estate->es_range_table), NoLock);
+	result = !rel->rd_rel->relhastriggers;
+	indexoidlist = result ? RelationGetIndexList(rel) : NIL;
+	foreach(lc, indexoidlist)
+	{
+		HeapTuple		indexTuple;
+		Form_pg_index	indexStruct;
+
+		indexTuple = SearchSysCache1(INDEXRELID,
+									 ObjectIdGetDatum(lfirst_oid(lc)));
+		if (!HeapTupleIsValid(indexTuple))
+			elog(ERROR, "cache lookup failed for index %u", lfirst_oid(lc));
+		indexStruct = (Form_pg_index) GETSTRUCT(indexTuple);
+		if (indexStruct->indisunique || indexStruct->indisexclusion)
+			result = false;
+		ReleaseSysCache(indexTuple);
+		if (!result)
+			break;
+	}
+	list_free(indexoidlist);
+	heap_close(rel, NoLock);
+
+	return result;
+}
+
+
 RemoteSubplanState *
 ExecInitRemoteSubplan(RemoteSubplan *node, EState *estate, int eflags)
 {
@@ -5012,6 +5103,9 @@ ExecInitRemoteSubplan(RemoteSubplan *node, EState *estate, int eflags)
 		remotestate->execOnAll = true;
 	}
 	remotestate->execNodes = list_copy(node->nodeList);
+	remotestate->conflict_free = IS_PGXC_COORDINATOR &&
+			combineType == COMBINE_TYPE_SAME &&
+			replicated_write_conflict_free(node, estate);
 	InitResponseCombiner(combiner, 0, combineType);
 	combiner->ss.ps.plan = (Plan *) node;
 	combiner->ss.ps.state = estate;
@@ -5346,6 +5440,25 @@ ExecFinishInitRemoteSubplan(RemoteSubplanState *node)
 		combiner->connections = pgxc_connections->datanode_handles;
 		combiner->current_conn = 0;
 		pfree(pgxc_connections);
+
+		/*
+		 * Pipelined replicated write reaches the primary first, move it at
+		 * the head of the list.
+		 */
+		if (node->conflict_free && OidIsValid(primary_data_node))
+		{
+			for (i = 1; i < combiner->conn_count; i++)
+			{
+				PGXCNodeHandle *conn = combiner->connections[i];
+
+				if (conn->nodeoid == primary_data_node)
+				{
+					combiner->connections[i] = combiner->connections[0];
+					combiner->connections[0] = conn;
+					break;
+				}
+			}
+		}
 	}
 	else
 	{
@@ -5559,13 +5672,16 @@ primary_mode_phase_two:
 		char *paramdata = NULL;
 		/*
 		 * Conditions when we want to execute query on the primary node first:
-		 * Coordinator running replicated ModifyTable on multiple nodes
+		 * Coordinator running replicated ModifyTable on multiple nodes, which
+		 * may conflict with concurrent writers. Conflict free writes are
+		 * pipelined to all the nodes, the primary first.
 		 */
 		bool primary_mode = combiner->probing_primary ||
 				(IS_PGXC_COORDINATOR &&
 				 combiner->combine_type == COMBINE_TYPE_SAME &&
 				 OidIsValid(primary_data_node) &&
-				 combiner->conn_count > 1);
+				 combiner->conn_count > 1 &&
+				 !node->conflict_free);
 		char cursor[NAMEDATALEN];
 
 		if (plan->cursor)
@@ -117,6 +117,7 @@ static void pgxc_node_init(PGXCNodeHandle *handle, int sock);
 #endif
 static void pgxc_node_free(PGXCNodeHandle *handle);
 static void pgxc_node_all_free(void);
+static void pgxc_node_request_begin(PGXCNodeHandle *handle);
 
 static int	get_int(PGXCNodeHandle * conn, size_t len, int *out);
 static int	get_char(PGXCNodeHandle * conn, char *out);
@@ -146,6 +147,8 @@ init_pgxc_handle(PGXCNodeHandle *pgxc_handle)
 	pgxc_handle->inEnd = 0;
 	pgxc_handle->inCursor = 0;
 	pgxc_handle->outEnd = 0;
+	pgxc_handle->load = NULL;
+	pgxc_handle->load_counted = false;
 
 	if (pgxc_handle->outBuffer == NULL || pgxc_handle->inBuffer == NULL)
 	{
@@ -211,6 +214,7 @@ InitMultinodeExecutor(bool is_force)
 	{
 		init_pgxc_handle(&dn_handles[count]);
 		dn_handles[count].nodeoid = dnOids[count];
+		dn_handles[count].load = PgxcNodeGetLoad(dnOids[count]);
 	}
 	for (count = 0; count < NumCoords; count++)
 	{
@@ -329,6 +333,7 @@ PGXCNodeConnected(NODE_CONNECTION *conn)
 static void
 pgxc_node_free(PGXCNodeHandle *handle)
 {
+	pgxc_node_request_done(handle, false);
 	close(handle->sock);
 	handle->sock = NO_SOCKET;
 }
@@ -1499,6 +1504,7 @@ pgxc_node_send_execute(PGXCNodeHandle * handle, const char *portal, int fetch)
 	handle->outEnd += 4;
 
 	handle->state = DN_CONNECTION_STATE_QUERY;
+	pgxc_node_request_begin(handle);
 
 	return 0;
 }
@@ -1585,6 +1591,54 @@ pgxc_node_send_query_extended(PGXCNodeHandle *handle, const char *query,
 }
 
 
+/*
+ * Count a request sent to the Datanode in its load.  Several messages may be
+ * sent before the node answers, only the first one starts the request.
+ */
+static void
+pgxc_node_request_begin(PGXCNodeHandle *handle)
+{
+	if (handle->load == NULL || handle->load_counted)
+		return;
+
+	pg_atomic_fetch_add_u32(&handle->load->inflight, 1);
+	handle->load_counted = true;
+	INSTR_TIME_SET_CURRENT(handle->request_start);
+}
+
+/*
+ * The Datanode is done with the request counted in its load, because it is
+ * ready for the next one or because the connection is released.  If it
+ * answered, account the response time in the moving average of the node,
+ * each new request weighting for 1/8.  Concurrent updates may lose one
+ * response time, which is harmless.
+ */
+void
+pgxc_node_request_done(PGXCNodeHandle *handle, bool answered)
+{
+	instr_time	elapsed;
+	uint32		latency;
+	uint64		sample;
+
+	if (!handle->load_counted)
+		return;
+
+	pg_atomic_fetch_sub_u32(&handle->load->inflight, 1);
+	handle->load_counted = false;
+	if (!answered)
+		return;
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, handle->request_start);
+	sample = Min(INSTR_TIME_GET_MICROSEC(elapsed), PG_UINT32_MAX);
+	latency = pg_atomic_read_u32(&handle->load->latency);
+	if (latency == 0)
+		latency = (uint32) sample;
+	else
+		latency = (uint32) ((latency * (uint64) 7 + sample) / 8);
+	pg_atomic_write_u32(&handle->load->latency, Max(latency, 1));
+}
+
 /*
  * This method won't return until connection buffer is empty or error occurs
  * To ensure all data are on the wire before waiting for response
@@ -1666,6 +1720,7 @@ pgxc_node_send_query(PGXCNodeHandle * handle, const char *query)
 	handle->outEnd += strLen;
 
 	handle->state = DN_CONNECTION_STATE_QUERY;
+	pgxc_node_request_begin(handle);
 
  	return pgxc_node_flush(handle);
 }
@@ -2357,6 +2412,20 @@ PGXCNodeGetNodeOid(int nodeid, char node_type)
 	return handles[nodeid].nodeoid;
 }
 
+/*
+ * PGXCNodeGetLoad
+ *		Look at the data cached for handles and return the load of the
+ *		Datanode, NULL if unknown
+ */
+NodeLoad *
+PGXCNodeGetLoad(int nodeid)
+{
+	if (nodeid < 0 || nodeid >= NumDataNodes)
+		return NULL;
+
+	return dn_handles[nodeid].load;
+}
+
 /*
  * pgxc_node_str
  *
@@ -2680,6 +2749,7 @@ pgxc_node_set_query(PGXCNodeHandle *handle, const char *set_query)
 			handle->transaction_status = msg[0];
 			handle->state = DN_CONNECTION_STATE_IDLE;
 			handle->combiner = NULL;
+			pgxc_node_request_done(handle, true);
 			break;
 		}
 	}
@@ -55,6 +55,7 @@
 #include "pgxc/pgxc.h"
 #include "pgxc/squeue.h"
 #include "pgxc/pause.h"
+#include "pgxc/redistrib.h"
 #endif
 
 shmem_startup_hook_type shmem_startup_hook = NULL;
@@ -152,7 +153,10 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		if (IS_PGXC_DATANODE)
 			size = add_size(size, SharedQueueShmemSize());
 		if (IS_PGXC_COORDINATOR)
+		{
 			size = add_size(size, ClusterLockShmemSize());
+			size = add_size(size, RebalanceShmemSize());
+		}
 		size = add_size(size, ClusterMonitorShmemSize());
 #endif
 		size = add_size(size, BTreeShmemSize());
@@ -274,7 +278,10 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	if (IS_PGXC_DATANODE)
 		SharedQueuesInit();
 	if (IS_PGXC_COORDINATOR)
+	{
 		ClusterLockShmemInit();
+		RebalanceShmemInit();
+	}
 	ClusterMonitorShmemInit();
 #endif
 
@@ -670,13 +670,14 @@ PortalStart(Portal portal, ParamListInfo params,
 					keytype = queryDesc->plannedstmt->distributionKey == InvalidAttrNumber ?
 							InvalidOid :
 							queryDesc->tupDesc->attrs[queryDesc->plannedstmt->distributionKey-1]->atttypid;
-					locator = createLocator(
+					locator = createLocatorExtended(
 							queryDesc->plannedstmt->distributionType,
 							RELATION_ACCESS_INSERT,
 							keytype,
 							LOCATOR_LIST_INT,
 							len,
 							consMap,
+							queryDesc->plannedstmt->distributionNodes,
 							NULL,
 							false);
 					dest = CreateDestReceiver(DestProducer);
@@ -731,13 +732,14 @@ PortalStart(Portal portal, ParamListInfo params,
 						keytype = queryDesc->plannedstmt->distributionKey == InvalidAttrNumber ?
 								InvalidOid :
 								queryDesc->tupDesc->attrs[queryDesc->plannedstmt->distributionKey-1]->atttypid;
-						locator = createLocator(
+						locator = createLocatorExtended(
 								queryDesc->plannedstmt->distributionType,
 								RELATION_ACCESS_INSERT,
 								keytype,
 								LOCATOR_LIST_INT,
 								len,
 								consMap,
+								queryDesc->plannedstmt->distributionNodes,
 								NULL,
 								false);
 						dest = CreateDestReceiver(DestProducer);
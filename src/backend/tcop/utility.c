@@ -79,6 +79,7 @@
 #include "pgxc/pgxc.h"
 #include "pgxc/planner.h"
 #include "pgxc/poolutils.h"
+#include "pgxc/redistrib.h"
 #include "nodes/nodes.h"
 #include "pgxc/poolmgr.h"
 #include "pgxc/nodemgr.h"
@@ -1071,6 +1072,15 @@ standard_ProcessUtility(Node *parsetree,
 			break;
 #endif
 
+			/*
+			 * Tables are moved by ALTER TABLE commands run by the Coordinator,
+			 * which send them to the other nodes.
+			 */
+		case T_RebalanceStmt:
+			PreventCommandDuringRecovery("REBALANCE");
+			PGXCRebalance((RebalanceStmt *) parsetree, isTopLevel);
+			break;
+
 			/*
 			 * Node DDL is an operation local to Coordinator.
 			 * In case of a new node being created in the cluster,
@@ -3476,6 +3486,10 @@ CreateCommandTag(Node *parsetree)
 			break;
 #endif
 
+		case T_RebalanceStmt:
+			tag = "REBALANCE";
+			break;
+
 		case T_ExecDirectStmt:
 			tag = "EXECUTE DIRECT";
 			break;
@@ -4140,6 +4154,7 @@ GetCommandLogLevel(Node *parsetree)
 
 #ifdef PGXC
 		case T_CleanConnStmt:
+		case T_RebalanceStmt:
 			lev = LOGSTMT_DDL;
 			break;
 #endif
@@ -400,6 +400,9 @@ static void get_update_query_targetlist_def(Query *query, List *targetList,
 								RangeTblEntry *rte);
 static void get_delete_query_def(Query *query, deparse_context *context);
 static void get_utility_query_def(Query *query, deparse_context *context);
+#ifdef PGXC
+static void get_distribution_value(StringInfo buf, Node *value);
+#endif
 static void get_basic_select_query(Query *query, deparse_context *context,
 					   TupleDesc resultDesc);
 static void get_target_list(List *targetList, deparse_context *context,
@@ -6172,6 +6175,52 @@ get_delete_query_def(Query *query, deparse_context *context)
 }
 
 
+#ifdef PGXC
+/*
+ * get_distribution_value	- Parse back a constant of DISTRIBUTE BY VALUES
+ */
+static void
+get_distribution_value(StringInfo buf, Node *value)
+{
+	if (IsA(value, TypeCast))
+	{
+		TypeCast   *tc = (TypeCast *) value;
+
+		appendStringInfoChar(buf, '(');
+		get_distribution_value(buf, tc->arg);
+		appendStringInfo(buf, ")::%s", TypeNameToString(tc->typeName));
+		return;
+	}
+	if (IsA(value, A_Const))
+	{
+		Value	   *val = &((A_Const *) value)->val;
+
+		switch (nodeTag(val))
+		{
+			case T_Integer:
+				appendStringInfo(buf, "%ld", intVal(val));
+				return;
+			case T_Float:
+				appendStringInfoString(buf, strVal(val));
+				return;
+			case T_String:
+			case T_BitString:
+				simple_quote_literal(buf, strVal(val));
+				return;
+			case T_Null:
+				appendStringInfoString(buf, "NULL");
+				return;
+			default:
+				break;
+		}
+	}
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("distribution values must be constants")));
+}
+#endif
+
+
 /* ----------
  * get_utility_query_def			- Parse back a UTILITY parsetree
  * ----------
@@ -6308,7 +6357,21 @@ get_utility_query_def(Query *query, deparse_context *context)
 					break;
 
 				case DISTTYPE_HASH:
-					appendStringInfo(buf, " DISTRIBUTE BY HASH(%s)", stmt->distributeby->colname);
+					if (stmt->distributeby->colnames)
+					{
+						ListCell   *lc;
+						const char *sep = "";
+
+						appendStringInfo(buf, " DISTRIBUTE BY HASH(");
+						foreach(lc, stmt->distributeby->colnames)
+						{
+							appendStringInfo(buf, "%s%s", sep, strVal(lfirst(lc)));
+							sep = ", ";
+						}
+						appendStringInfoChar(buf, ')');
+					}
+					else
+						appendStringInfo(buf, " DISTRIBUTE BY HASH(%s)", stmt->distributeby->colname);
 					break;
 
 				case DISTTYPE_ROUNDROBIN:
@@ -6319,6 +6382,47 @@ get_utility_query_def(Query *query, deparse_context *context)
 					appendStringInfo(buf, " DISTRIBUTE BY MODULO(%s)", stmt->distributeby->colname);
 					break;
 
+				case DISTTYPE_RANGE:
+				case DISTTYPE_LIST:
+					{
+						ListCell   *lc;
+						const char *sep = "";
+
+						appendStringInfo(buf, " DISTRIBUTE BY %s(%s) VALUES (",
+										 stmt->distributeby->disttype == DISTTYPE_RANGE ?
+										 "RANGE" : "LIST",
+										 stmt->distributeby->colname);
+						foreach(lc, stmt->distributeby->values)
+						{
+							DefElem    *def = (DefElem *) lfirst(lc);
+
+							appendStringInfo(buf, "%s%s", sep,
+											 quote_identifier(def->defname));
+							if (def->arg && IsA(def->arg, List))
+							{
+								ListCell   *vlc;
+								const char *vsep = "";
+
+								appendStringInfoString(buf, " IN (");
+								foreach(vlc, (List *) def->arg)
+								{
+									appendStringInfoString(buf, vsep);
+									get_distribution_value(buf, (Node *) lfirst(vlc));
+									vsep = ", ";
+								}
+								appendStringInfoChar(buf, ')');
+							}
+							else if (def->arg)
+							{
+								appendStringInfoString(buf, " FROM ");
+								get_distribution_value(buf, def->arg);
+							}
+							sep = ", ";
+						}
+						appendStringInfoChar(buf, ')');
+					}
+					break;
+
 				default:
 					ereport(ERROR, (errcode(ERRCODE_SYNTAX_ERROR),
 								errmsg("Invalid distribution type")));
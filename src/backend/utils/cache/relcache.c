@@ -2042,6 +2042,10 @@ RelationDestroyRelation(Relation relation, bool remember_tupdesc)
 		MemoryContextDelete(relation->rd_rsdesc->rscxt);
 	if (relation->rd_fdwroutine)
 		pfree(relation->rd_fdwroutine);
+#ifdef PGXC
+	if (relation->rd_locatorcxt)
+		MemoryContextDelete(relation->rd_locatorcxt);
+#endif
 	pfree(relation);
 }
 
@@ -2201,6 +2205,9 @@ RelationClearRelation(Relation relation, bool rebuild)
 		bool		keep_tupdesc;
 		bool		keep_rules;
 		bool		keep_policies;
+#ifdef PGXC
+		bool		keep_locators;
+#endif
 
 		/* Build temporary entry, but don't link it into hashtable */
 		newrel = RelationBuildDesc(save_relid, false);
@@ -2231,6 +2238,11 @@ RelationClearRelation(Relation relation, bool rebuild)
 		keep_tupdesc = equalTupleDescs(relation->rd_att, newrel->rd_att);
 		keep_rules = equalRuleLocks(relation->rd_rules, newrel->rd_rules);
 		keep_policies = equalRSDesc(relation->rd_rsdesc, newrel->rd_rsdesc);
+#ifdef PGXC
+		keep_locators = relation->rd_locator_info && newrel->rd_locator_info &&
+			IsLocatorInfoIdentical(relation->rd_locator_info,
+								   newrel->rd_locator_info);
+#endif
 
 		/*
 		 * Perform swapping of the relcache entry contents.  Within this
@@ -2281,6 +2293,19 @@ RelationClearRelation(Relation relation, bool rebuild)
 		}
 		if (keep_policies)
 			SWAPFIELD(RowSecurityDesc *, rd_rsdesc);
+#ifdef PGXC
+		/* locators may be in use, do not free them if they are still valid */
+		if (keep_locators)
+		{
+			Locator    *tmplocators[RELATION_ACCESS_INSERT + 1];
+
+			SWAPFIELD(MemoryContext, rd_locatorcxt);
+			memcpy(tmplocators, newrel->rd_locators, sizeof(tmplocators));
+			memcpy(newrel->rd_locators, relation->rd_locators,
+				   sizeof(tmplocators));
+			memcpy(relation->rd_locators, tmplocators, sizeof(tmplocators));
+		}
+#endif
 		/* toast OID override must be preserved */
 		SWAPFIELD(Oid, rd_toastoid);
 		/* pgstat_info must be preserved */
@@ -4874,6 +4899,11 @@ load_relcache_init_file(bool shared)
 		rel->rd_exclprocs = NULL;
 		rel->rd_exclstrats = NULL;
 		rel->rd_fdwroutine = NULL;
+#ifdef PGXC
+		rel->rd_locator_info = NULL;
+		rel->rd_locatorcxt = NULL;
+		MemSet(rel->rd_locators, 0, sizeof(rel->rd_locators));
+#endif
 
 		/*
 		 * Reset transient-state fields in the relcache entry
@@ -967,6 +967,15 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"gtm_shared_memory", PGC_POSTMASTER, GTM,
+			gettext_noop("Talk to a GTM proxy on the same host through shared memory."),
+			gettext_noop("Backends fall back to TCP if the proxy does not offer it.")
+		},
+		&GtmSharedMemory,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"gtm_backup_barrier", PGC_SUSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables coordinator to report barrier id to GTM for backup."),
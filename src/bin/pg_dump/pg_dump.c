@@ -262,6 +262,9 @@ static const char *fmtCopyColumnList(const TableInfo *ti, PQExpBuffer buffer);
 static char *get_synchronized_snapshot(Archive *fout);
 static PGresult *ExecuteSqlQueryForSingleRow(Archive *fout, char *query);
 static void setupDumpWorker(Archive *AHX, DumpOptions *dopt, RestoreOptions *ropt);
+#ifdef PGXC
+static bool pgxcClassHasColumn(Archive *fout, const char *attname);
+#endif
 
 
 int
@@ -4559,7 +4562,11 @@ getTables(Archive *fout, DumpOptions *dopt, int *numTables)
 #ifdef PGXC
 	int			i_pgxclocatortype;
 	int			i_pgxcattnum;
+	int			i_pgxcattnums;
+	int			i_pgxcvalues;
 	int			i_pgxc_node_names;
+	const char *pgxcattnums;
+	const char *pgxcvalues;
 #endif
 	int			i_reltablespace;
 	int			i_reloptions;
@@ -4571,6 +4578,27 @@ getTables(Archive *fout, DumpOptions *dopt, int *numTables)
 	/* Make sure we are in proper schema */
 	selectSourceSchema(fout, "pg_catalog");
 
+#ifdef PGXC
+	/*
+	 * Multi-column distribution keys and the values of the nodes of tables
+	 * distributed by range or list are not in the pgxc_class of older
+	 * servers.
+	 */
+	if (fout->remoteVersion >= 90500 && pgxcClassHasColumn(fout, "pcattnums"))
+		pgxcattnums = "(SELECT pcattnums from pgxc_class v where v.pcrelid = c.oid) AS pgxcattnums,";
+	else
+		pgxcattnums = "NULL AS pgxcattnums,";
+	if (fout->remoteVersion >= 90500 && pgxcClassHasColumn(fout, "pcvalues"))
+		pgxcvalues = "(SELECT string_agg(quote_ident(n.node_name) || "
+			"COALESCE(CASE v.pclocatortype WHEN 'G' THEN ' FROM ' || quote_literal(v.pcvalues[k]) "
+			"ELSE ' IN (' || (SELECT string_agg(COALESCE(quote_literal(e), 'NULL'), ', ') "
+			"FROM unnest(v.pcvalues[k]::text[]) e) || ')' END, ''), ', ' ORDER BY k) "
+			"FROM pgxc_class v, generate_series(1, array_upper(v.pcvalues, 1)) k, pgxc_node n "
+			"WHERE v.pcrelid = c.oid AND n.oid = v.nodeoids[k - 1]) AS pgxcvalues,";
+	else
+		pgxcvalues = "NULL AS pgxcvalues,";
+#endif
+
 	/*
 	 * Find all the tables and table-like objects.
 	 *
@@ -4616,6 +4644,7 @@ getTables(Archive *fout, DumpOptions *dopt, int *numTables)
 #ifdef PGXC
 						  "(SELECT pclocatortype from pgxc_class v where v.pcrelid = c.oid) AS pgxclocatortype,"
 						  "(SELECT pcattnum from pgxc_class v where v.pcrelid = c.oid) AS pgxcattnum,"
+						  "%s%s"
 						  "(SELECT string_agg(node_name,',') AS pgxc_node_names from pgxc_node n where n.oid in (select unnest(nodeoids) from pgxc_class v where v.pcrelid=c.oid) ) , "
 #endif
 						  "array_to_string(array_remove(array_remove(c.reloptions,'check_option=local'),'check_option=cascaded'), ', ') AS reloptions, "
@@ -4632,6 +4661,9 @@ getTables(Archive *fout, DumpOptions *dopt, int *numTables)
 				   "WHERE c.relkind in ('%c', '%c', '%c', '%c', '%c', '%c') "
 						  "ORDER BY c.oid",
 						  username_subquery,
+#ifdef PGXC
+						  pgxcattnums, pgxcvalues,
+#endif
 						  RELKIND_SEQUENCE,
 						  RELKIND_RELATION, RELKIND_SEQUENCE,
 						  RELKIND_VIEW, RELKIND_COMPOSITE_TYPE,
@@ -5099,6 +5131,8 @@ getTables(Archive *fout, DumpOptions *dopt, int *numTables)
 #ifdef PGXC
 	i_pgxclocatortype = PQfnumber(res, "pgxclocatortype");
 	i_pgxcattnum = PQfnumber(res, "pgxcattnum");
+	i_pgxcattnums = PQfnumber(res, "pgxcattnums");
+	i_pgxcvalues = PQfnumber(res, "pgxcvalues");
 	i_pgxc_node_names = PQfnumber(res, "pgxc_node_names");
 #endif
 	i_reltablespace = PQfnumber(res, "reltablespace");
@@ -5171,11 +5205,23 @@ getTables(Archive *fout, DumpOptions *dopt, int *numTables)
 		{
 			tblinfo[i].pgxclocatortype = 'E';
 			tblinfo[i].pgxcattnum = 0;
+			tblinfo[i].pgxcattnums = NULL;
+			tblinfo[i].pgxcvalues = NULL;
 		}
 		else
 		{
 			tblinfo[i].pgxclocatortype = *(PQgetvalue(res, i, i_pgxclocatortype));
 			tblinfo[i].pgxcattnum = atoi(PQgetvalue(res, i, i_pgxcattnum));
+			/* Older servers only have a distribution column */
+			if (i_pgxcattnums >= 0 && !PQgetisnull(res, i, i_pgxcattnums))
+				tblinfo[i].pgxcattnums = pg_strdup(PQgetvalue(res, i, i_pgxcattnums));
+			else
+				tblinfo[i].pgxcattnums = NULL;
+			/* Only tables distributed by range or list have values */
+			if (i_pgxcvalues >= 0 && !PQgetisnull(res, i, i_pgxcvalues))
+				tblinfo[i].pgxcvalues = pg_strdup(PQgetvalue(res, i, i_pgxcvalues));
+			else
+				tblinfo[i].pgxcvalues = NULL;
 		}
 		tblinfo[i].pgxc_node_names = pg_strdup(PQgetvalue(res, i, i_pgxc_node_names));
 #endif
@@ -14067,8 +14113,26 @@ dumpTableSchema(Archive *fout, DumpOptions *dopt, TableInfo *tbinfo)
 			else if (tbinfo->pgxclocatortype == 'H')
 			{
 				int hashkey = tbinfo->pgxcattnum;
-				appendPQExpBuffer(q, "\nDISTRIBUTE BY HASH (%s)",
-								  fmtId(tbinfo->attnames[hashkey - 1]));
+
+				if (tbinfo->pgxcattnums && strchr(tbinfo->pgxcattnums, ' '))
+				{
+					/* Distribution key of several columns, like "2 3" */
+					char	   *ptr = tbinfo->pgxcattnums;
+					char	   *end;
+
+					appendPQExpBuffer(q, "\nDISTRIBUTE BY HASH (");
+					while ((hashkey = strtol(ptr, &end, 10)) > 0 && end != ptr)
+					{
+						appendPQExpBuffer(q, "%s%s",
+										  ptr == tbinfo->pgxcattnums ? "" : ", ",
+										  fmtId(tbinfo->attnames[hashkey - 1]));
+						ptr = end;
+					}
+					appendPQExpBuffer(q, ")");
+				}
+				else
+					appendPQExpBuffer(q, "\nDISTRIBUTE BY HASH (%s)",
+									  fmtId(tbinfo->attnames[hashkey - 1]));
 			}
 			else if (tbinfo->pgxclocatortype == 'M')
 			{
@@ -14076,6 +14140,16 @@ dumpTableSchema(Archive *fout, DumpOptions *dopt, TableInfo *tbinfo)
 				appendPQExpBuffer(q, "\nDISTRIBUTE BY MODULO (%s)",
 								  fmtId(tbinfo->attnames[hashkey - 1]));
 			}
+			/* G: DISTRIBUTE BY RANGE, L: DISTRIBUTE BY LIST */
+			else if ((tbinfo->pgxclocatortype == 'G' ||
+					  tbinfo->pgxclocatortype == 'L') && tbinfo->pgxcvalues)
+			{
+				int hashkey = tbinfo->pgxcattnum;
+				appendPQExpBuffer(q, "\nDISTRIBUTE BY %s (%s) VALUES (%s)",
+								  tbinfo->pgxclocatortype == 'G' ? "RANGE" : "LIST",
+								  fmtId(tbinfo->attnames[hashkey - 1]),
+								  tbinfo->pgxcvalues);
+			}
 		}
 		if (include_nodes &&
 			tbinfo->pgxc_node_names != NULL &&
@@ -16449,3 +16523,31 @@ ExecuteSqlQueryForSingleRow(Archive *fout, char *query)
 
 	return res;
 }
+
+#ifdef PGXC
+/*
+ * Check whether the pgxc_class catalog of the server has the given column.
+ */
+static bool
+pgxcClassHasColumn(Archive *fout, const char *attname)
+{
+	PQExpBuffer query = createPQExpBuffer();
+	PGresult   *res;
+	bool		result;
+
+	appendPQExpBufferStr(query,
+						 "SELECT 1 FROM pg_catalog.pg_attribute "
+						 "WHERE attrelid = 'pg_catalog.pgxc_class'::pg_catalog.regclass "
+						 "AND attname = ");
+	appendStringLiteralAH(query, attname, fout);
+	appendPQExpBufferStr(query, " AND NOT attisdropped");
+
+	res = ExecuteSqlQuery(fout, query->data, PGRES_TUPLES_OK);
+	result = (PQntuples(res) > 0);
+
+	PQclear(res);
+	destroyPQExpBuffer(query);
+
+	return result;
+}
+#endif
@@ -231,6 +231,8 @@ typedef struct _tableInfo
 	/* PGXC table locator Data */
 	char		pgxclocatortype;	/* Type of PGXC table locator */
 	int			pgxcattnum;		/* Number of the attribute the table is partitioned with */
+	char		*pgxcattnums;	/* Numbers of all the distribution attributes, or NULL */
+	char		*pgxcvalues;	/* VALUES of a range or list distribution, or NULL */
 	char		*pgxc_node_names;	/* List of node names where this table is distributed */
 #endif
 	/*
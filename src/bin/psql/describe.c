@@ -29,6 +29,8 @@
 #define LOCATOR_TYPE_HASH 'H'
 #define LOCATOR_TYPE_RROBIN 'N'
 #define LOCATOR_TYPE_MODULO 'M'
+#define LOCATOR_TYPE_RANGE 'G'
+#define LOCATOR_TYPE_LIST 'L'
 #endif /* PGXC */
 
 static bool describeOneTableDetails(const char *schemaname,
@@ -2541,13 +2543,27 @@ describeOneTableDetails(const char *schemaname,
 							"WHEN '%c' THEN 'ROUND ROBIN' \n"
 							"WHEN '%c' THEN 'REPLICATION' \n"
 							"WHEN '%c' THEN 'HASH' \n"
-							"WHEN '%c' THEN 'MODULO' END || CASE pcattnum WHEN 0 THEN '' ELSE '('|| a.attname ||')' END as distype \n"
+							"WHEN '%c' THEN 'MODULO' \n"
+							"WHEN '%c' THEN 'RANGE' \n"
+							"WHEN '%c' THEN 'LIST' END || CASE pcattnum WHEN 0 THEN '' ELSE '('|| \n"
+								"array_to_string(ARRAY( \n"
+									"SELECT ka.attname FROM pg_catalog.pg_attribute ka, \n"
+									"generate_series(0, array_upper(c.pcattnums, 1)) AS k \n"
+									"WHERE ka.attrelid = c.pcrelid AND ka.attnum = c.pcattnums[k] \n"
+									"ORDER BY k), ', ') ||')' END as distype \n"
 							", CASE array_length(nodeoids, 1) \n"
 								"WHEN nc.dn_cn THEN 'ALL DATANODES' \n"
 								"ELSE array_to_string(ARRAY( \n"
 									"SELECT node_name FROM pg_catalog.pgxc_node \n"
 									"WHERE oid in (SELECT unnest(nodeoids) FROM pg_catalog.pgxc_class WHERE pcrelid = '%s') \n"
 								"), ', ') END as loc_nodes \n"
+							", array_to_string(ARRAY( \n"
+								"SELECT n.node_name || COALESCE(CASE c.pclocatortype WHEN '%c' \n"
+									"THEN ' FROM ' || c.pcvalues[k] \n"
+									"ELSE ' IN (' || btrim(c.pcvalues[k], '{}') || ')' END, '') \n"
+								"FROM pg_catalog.pgxc_node n, \n"
+								"generate_series(1, array_upper(c.pcvalues, 1)) AS k \n"
+								"WHERE n.oid = c.nodeoids[k - 1] ORDER BY k), ', ') as dist_values \n"
 						"FROM pg_catalog.pg_attribute a right join pg_catalog.pgxc_class c on a.attrelid = c.pcrelid and a.attnum = c.pcattnum, \n"
 						"(SELECT count(*) AS dn_cn FROM pg_catalog.pgxc_node WHERE node_type = 'D') as nc \n"
 						"WHERE pcrelid = '%s'"
@@ -2555,7 +2571,10 @@ describeOneTableDetails(const char *schemaname,
 					, LOCATOR_TYPE_REPLICATED
 					, LOCATOR_TYPE_HASH
 					, LOCATOR_TYPE_MODULO
+					, LOCATOR_TYPE_RANGE
+					, LOCATOR_TYPE_LIST
 					, oid
+					, LOCATOR_TYPE_RANGE
 					, oid);
 			result = PSQLexec(buf.data);
 
@@ -2579,6 +2598,14 @@ describeOneTableDetails(const char *schemaname,
 									PQgetvalue(result, 0, 1));
 				printTableAddFooter(&cont, buf.data);
 
+				/* Print the values of each node of a range or list */
+				if (PQgetvalue(result, 0, 2)[0] != '\0')
+				{
+					printfPQExpBuffer(&buf, "%s: %s", _("Distribution Values"),
+										PQgetvalue(result, 0, 2));
+					printTableAddFooter(&cont, buf.data);
+				}
+
 				PQclear(result);
 			}
 		}
@@ -63,6 +63,7 @@ static const GTMPQconninfoOption GTMPQconninfoOptions[] = {
 	{"remote_type", NULL},
 	{"postmaster", NULL},
 	{"client_id", NULL},
+	{"shared_memory", NULL},
 	/* Terminating entry --- MUST BE LAST */
 	{NULL, NULL}
 };
@@ -70,6 +71,7 @@ static const GTMPQconninfoOption GTMPQconninfoOptions[] = {
 static bool connectOptions1(GTM_Conn *conn, const char *conninfo);
 static int	connectGTMStart(GTM_Conn *conn);
 static int	connectGTMComplete(GTM_Conn *conn);
+static void connectSharedMemory(GTM_Conn *conn);
 static GTM_Conn *makeEmptyGTM_Conn(void);
 static void freeGTM_Conn(GTM_Conn *conn);
 static void closeGTM_Conn(GTM_Conn *conn);
@@ -87,7 +89,11 @@ PQconnectGTM(const char *conninfo)
 	GTM_Conn	   *conn = PQconnectGTMStart(conninfo);
 
 	if (conn && conn->status != CONNECTION_BAD)
+	{
 		(void) connectGTMComplete(conn);
+		if (conn->status == CONNECTION_OK && conn->shared_memory)
+			connectSharedMemory(conn);
+	}
 	else if (conn != NULL)
 	{
 		freeGTM_Conn(conn);
@@ -188,6 +194,8 @@ connectOptions1(GTM_Conn *conn, const char *conninfo)
 	conn->remote_type = tmp ? atoi(tmp) : GTM_NODE_DEFAULT;
 	tmp = conninfo_getval(connOptions, "client_id");
 	conn->my_id = tmp ? atoi(tmp) : 0;
+	tmp = conninfo_getval(connOptions, "shared_memory");
+	conn->shared_memory = tmp ? atoi(tmp) : 0;
 
 	/*
 	 * Free the option info - all is in conn now
@@ -837,6 +845,61 @@ error_return:
 }
 
 
+/*
+ *		connectSharedMemory
+ *
+ * Ask a GTM proxy running on this host to serve the connection through a
+ * slot of its shared memory segment, see gtm_shmq.h.  The connection keeps
+ * using its socket if there is no such proxy, it has no free slot, or the
+ * server at the other end of the socket is not that proxy: it then does not
+ * know the cookie of the segment and refuses to attach.
+ */
+static void
+connectSharedMemory(GTM_Conn *conn)
+{
+	GTM_Shmq   *shmq;
+	GTM_Result *res;
+	int			slotno;
+
+	if (conn->pgport == NULL ||
+		(shmq = GTM_ShmqOpen(atoi(conn->pgport))) == NULL)
+		return;
+
+	slotno = GTM_ShmqClaimSlot(shmq);
+	if (slotno < 0)
+	{
+		GTM_ShmqClose(shmq);
+		return;
+	}
+
+	if (gtmpqPutMsgStart('C', true, conn) ||
+		gtmpqPutInt(MSG_SHM_ATTACH, sizeof (GTM_MessageType), conn) ||
+		gtmpqPutInt(slotno, sizeof (int32), conn) ||
+		gtmpqPutnchar((char *) &shmq->sq_header->sh_cookie, sizeof (uint64), conn) ||
+		gtmpqPutMsgEnd(conn) ||
+		gtmpqFlush(conn))
+		goto attach_failed;
+
+	res = GTMPQgetResult(conn);
+	if (res == NULL || res->gr_status != GTM_RESULT_OK ||
+		res->gr_type != SHM_ATTACH_RESULT)
+		goto attach_failed;
+
+	/* The proxy uses the slot from now on, so do we */
+	conn->shmq = shmq;
+	conn->shm_slot = &shmq->sq_slots[slotno];
+	conn->shm_slotno = slotno;
+	return;
+
+attach_failed:
+	/* A refusal is not an error of the connection, do not leave it behind */
+	if (conn->status == CONNECTION_OK)
+		resetGTMPQExpBuffer(&conn->errorMessage);
+	if (shmq->sq_slots[slotno].sl_state == GTM_SHMQ_SLOT_CLAIMED)
+		GTM_ShmqReleaseSlot(shmq, slotno);
+	GTM_ShmqClose(shmq);
+}
+
 /*
  * makeEmptyGTM_Conn
  *	 - create a GTM_Conn data structure with (as yet) no interesting data
@@ -886,6 +949,64 @@ makeEmptyGTM_Conn(void)
 	return conn;
 }
 
+/*
+ * GTMPQcreateBufferedConn
+ *
+ * Make a connection object that is not attached to any socket.  Messages
+ * can be built on it with the usual routines; whenever it would be flushed,
+ * the pending output is passed to the hook instead.  Nothing can be read
+ * from such a connection.
+ */
+GTM_Conn *
+GTMPQcreateBufferedConn(GTMPQsendHook hook)
+{
+	GTM_Conn	   *conn = makeEmptyGTM_Conn();
+
+	if (conn == NULL)
+		return NULL;
+
+	conn->sock = -1;
+	conn->status = CONNECTION_OK;
+	conn->sendHook = hook;
+
+	return conn;
+}
+
+static int
+refuse_send(GTM_Conn *conn, const char *buf, int len)
+{
+	return -1;
+}
+
+/*
+ * GTMPQcreateReaderConn
+ *
+ * Make a connection object reading from the socket of conn with buffers of
+ * its own, so that one thread may wait for replies on it while others write
+ * to conn.  Nothing can be written to it, and GTMPQfinish() on it leaves
+ * conn open.
+ */
+GTM_Conn *
+GTMPQcreateReaderConn(GTM_Conn *conn)
+{
+	GTM_Conn	   *reader = makeEmptyGTM_Conn();
+
+	if (reader == NULL)
+		return NULL;
+
+	reader->sock = dup(conn->sock);
+	if (reader->sock < 0)
+	{
+		freeGTM_Conn(reader);
+		return NULL;
+	}
+	reader->status = CONNECTION_OK;
+	reader->remote_type = conn->remote_type;
+	reader->sendHook = refuse_send;
+
+	return reader;
+}
+
 /*
  * freeGTM_Conn
  *	 - free an idle (closed) GTM_Conn data structure
@@ -921,6 +1042,12 @@ freeGTM_Conn(GTM_Conn *conn)
 		if (conn->result->gr_snapshot.sn_xip)
 			free(conn->result->gr_snapshot.sn_xip);
 
+		/* And the buffers kept from one result to the next */
+		if (conn->result->gr_multi_data)
+			free(conn->result->gr_multi_data);
+		if (conn->result->gr_proxy_data)
+			free(conn->result->gr_proxy_data);
+
 		/* Depending on result type there could be allocated data */
 		switch (conn->result->gr_type)
 		{
@@ -986,6 +1113,13 @@ closeGTM_Conn(GTM_Conn *conn)
 	if (conn->sock >= 0)
 		close(conn->sock);
 	conn->sock = -1;
+
+	/* The proxy gives the slot back once it sees the socket closed */
+	if (conn->shmq)
+		GTM_ShmqClose(conn->shmq);
+	conn->shmq = NULL;
+	conn->shm_slot = NULL;
+
 	conn->status = CONNECTION_BAD;		/* Well, not really _bad_ - just
 										 * absent */
 	gtm_freeaddrinfo_all(conn->addrlist_family, conn->addrlist);
@@ -52,6 +52,11 @@ static int	gtmpqSendSome(GTM_Conn *conn, int len);
 static int gtmpqSocketCheck(GTM_Conn *conn, int forRead, int forWrite,
 			  time_t end_time);
 static int	gtmpqSocketPoll(int sock, int forRead, int forWrite, time_t end_time);
+static int	gtmpqReadShm(GTM_Conn *conn);
+static int	gtmpqSendShm(GTM_Conn *conn);
+static void gtmpqNotifyShm(GTM_Conn *conn);
+static int	gtmpqWaitShm(GTM_Conn *conn, int forRead, int forWrite,
+			 time_t end_time);
 
 
 /*
@@ -516,6 +521,24 @@ gtmpqPutMsgEnd(GTM_Conn *conn)
 	return 0;
 }
 
+/*
+ * gtmpqPutRaw: append complete, already framed messages to the output buffer
+ *
+ * Returns 0 on success, EOF on error
+ */
+int
+gtmpqPutRaw(const char *buf, size_t len, GTM_Conn *conn)
+{
+	if (gtmpqCheckOutBufferSpace(conn->outCount + len, conn))
+		return EOF;
+
+	memcpy(conn->outBuffer + conn->outCount, buf, len);
+	conn->outCount += len;
+	conn->outMsgEnd = conn->outCount;
+
+	return 0;
+}
+
 /* ----------
  * gtmpqReadData: read more data, if any is available
  * Possible return values:
@@ -578,6 +601,9 @@ gtmpqReadData(GTM_Conn *conn)
 		}
 	}
 
+	if (conn->shm_slot)
+		return gtmpqReadShm(conn);
+
 	/* OK, try to read some data */
 retry3:
 	nread = recv(conn->sock, conn->inBuffer + conn->inEnd,
@@ -722,6 +748,41 @@ definitelyFailed:
 	return -1;
 }
 
+/*
+ * gtmpqReadShm: gtmpqReadData for a connection attached to a proxy slot
+ */
+static int
+gtmpqReadShm(GTM_Conn *conn)
+{
+	int			nread;
+
+	nread = GTM_ShmqRead(&conn->shm_slot->sl_response,
+						 conn->inBuffer + conn->inEnd,
+						 conn->inBufSize - conn->inEnd);
+	if (nread > 0)
+	{
+		conn->inEnd += nread;
+		return 1;
+	}
+
+	/*
+	 * The proxy does not write to the socket any more, it only becomes
+	 * readable once the proxy closed the connection.
+	 */
+	if (gtmpqSocketPoll(conn->sock, 1, 0, (time_t) 0) == 0)
+		return 0;
+
+	printfGTMPQExpBuffer(&conn->errorMessage,
+								"server closed the connection unexpectedly\n"
+				   "\tThis probably means the server terminated abnormally\n"
+							 "\tbefore or while processing the request.\n");
+	conn->status = CONNECTION_BAD;
+	close(conn->sock);
+	conn->sock = -1;
+
+	return -1;
+}
+
 /*
  * gtmpqSendSome: send data waiting in the output buffer.
  *
@@ -738,6 +799,14 @@ gtmpqSendSome(GTM_Conn *conn, int len)
 	int			remaining = conn->outCount;
 	int			result = 0;
 
+	/* Buffered connection, the hook takes everything in one go */
+	if (conn->sendHook)
+	{
+		result = conn->sendHook(conn, conn->outBuffer, conn->outCount);
+		conn->outCount = 0;
+		return (result < 0) ? -1 : 0;
+	}
+
 	if (conn->sock < 0)
 	{
 		printfGTMPQExpBuffer(&conn->errorMessage,
@@ -745,6 +814,9 @@ gtmpqSendSome(GTM_Conn *conn, int len)
 		return -1;
 	}
 
+	if (conn->shm_slot)
+		return gtmpqSendShm(conn);
+
 	/* while there's still data to send */
 	while (len > 0)
 	{
@@ -831,6 +903,66 @@ gtmpqSendSome(GTM_Conn *conn, int len)
 	return result;
 }
 
+/*
+ * gtmpqSendShm: gtmpqSendSome for a connection attached to a proxy slot.
+ *
+ * All the output goes to the request ring; if it does not fit, we wait for
+ * the proxy to read some of it, even on a non-blocking connection.
+ */
+static int
+gtmpqSendShm(GTM_Conn *conn)
+{
+	GTM_ShmqRing *ring = &conn->shm_slot->sl_request;
+	char	   *ptr = conn->outBuffer;
+	int			remaining = conn->outCount;
+
+	conn->outCount = 0;
+	while (remaining > 0)
+	{
+		int			sent;
+
+		sent = GTM_ShmqWrite(ring, ptr, remaining);
+		ptr += sent;
+		remaining -= sent;
+		gtmpqNotifyShm(conn);
+
+		if (remaining > 0 &&
+			!GTM_ShmqWaitSpace(ring, GTM_SHMQ_CHECK_MS) &&
+			gtmpqSocketPoll(conn->sock, 1, 0, (time_t) 0) != 0)
+		{
+			printfGTMPQExpBuffer(&conn->errorMessage,
+								"server closed the connection unexpectedly\n"
+					"\tThis probably means the server terminated abnormally\n"
+							 "\tbefore or while processing the request.\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * gtmpqNotifyShm: tell the proxy about data written to the request ring.
+ *
+ * The proxy connection may wait for the rest of a message on the ring
+ * itself.  Otherwise the worker thread serving the slot finds the data the
+ * next time it looks at its connections, and if it sleeps on its sockets, a
+ * byte written to the socket wakes it up.
+ */
+static void
+gtmpqNotifyShm(GTM_Conn *conn)
+{
+	GTM_ShmqSlot *slot = conn->shm_slot;
+
+	GTM_ShmqWakeup(&slot->sl_request);
+	if (conn->shmq->sq_workers[slot->sl_worker].sw_sleeping)
+	{
+		char		doorbell = 0;
+
+		(void) send(conn->sock, &doorbell, 1, 0);
+	}
+}
+
 
 /*
  * gtmpqFlush: send any data waiting in the output buffer
@@ -938,6 +1070,9 @@ gtmpqSocketCheck(GTM_Conn *conn, int forRead, int forWrite, time_t end_time)
 		return -1;
 	}
 
+	if (conn->shm_slot)
+		return gtmpqWaitShm(conn, forRead, forWrite, end_time);
+
 	/* We will retry as long as we get EINTR */
 	do
 		result = gtmpqSocketPoll(conn->sock, forRead, forWrite, end_time);
@@ -951,6 +1086,46 @@ gtmpqSocketCheck(GTM_Conn *conn, int forRead, int forWrite, time_t end_time)
 }
 
 
+/*
+ * gtmpqWaitShm: gtmpqSocketCheck for a connection attached to a proxy slot.
+ *
+ * The rings are waited on GTM_SHMQ_CHECK_MS at a time, the socket is
+ * checked in between in case the proxy went away.  A readable socket is
+ * reported as ready, so that the caller reads it and finds out.
+ */
+static int
+gtmpqWaitShm(GTM_Conn *conn, int forRead, int forWrite, time_t end_time)
+{
+	GTM_ShmqSlot *slot = conn->shm_slot;
+
+	if (!forRead && !forWrite)
+		return 0;
+
+	for (;;)
+	{
+		int			result;
+
+		if (forRead && GTM_ShmqWait(&slot->sl_response, GTM_SHMQ_CHECK_MS))
+			return 1;
+		if (forWrite && GTM_ShmqWaitSpace(&slot->sl_request, GTM_SHMQ_CHECK_MS))
+			return 1;
+
+		result = gtmpqSocketPoll(conn->sock, 1, 0, (time_t) 0);
+		if (result < 0 && SOCK_ERRNO == EINTR)
+			continue;
+		if (result != 0)
+		{
+			if (result < 0)
+				printfGTMPQExpBuffer(&conn->errorMessage,
+								  "select() failed: \n");
+			return result;
+		}
+
+		if (end_time != ((time_t) -1) && time(NULL) >= end_time)
+			return 0;
+	}
+}
+
 /*
  * Check a file descriptor for read and/or write data, possibly waiting.
  * If neither forRead nor forWrite are set, immediately return a timeout
@@ -45,6 +45,7 @@ static void handleSyncLoss(GTM_Conn *conn, char id, int msgLength);
 static GTM_Result *pqParseInput(GTM_Conn *conn);
 static int gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result);
 static int gtmpqReadSeqKey(GTM_SequenceKey seqkey, GTM_Conn *conn);
+static void *gtmpqMultiResultArray(GTM_Result *result, int *count, size_t size);
 
 /*
  * parseInput: if appropriate, parse input data from backend
@@ -441,7 +442,12 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 				result->gr_status = GTM_RESULT_ERROR;
 				break;
 			}
-			if (gtmpqGetnchar((char *)result->gr_resdata.grd_txn_get_multi.txn_gxid,
+			result->gr_resdata.grd_txn_get_multi.txn_gxid =
+				gtmpqMultiResultArray(result,
+						&result->gr_resdata.grd_txn_get_multi.txn_count,
+						sizeof (GlobalTransactionId));
+			if (result->gr_resdata.grd_txn_get_multi.txn_gxid == NULL ||
+				gtmpqGetnchar((char *)result->gr_resdata.grd_txn_get_multi.txn_gxid,
 						   sizeof (GlobalTransactionId) * result->gr_resdata.grd_txn_get_multi.txn_count,
 						   conn))
 			{
@@ -455,13 +461,20 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 
 		case TXN_COMMIT_MULTI_RESULT:
 		case TXN_ROLLBACK_MULTI_RESULT:
+		case TXN_PREPARE_MULTI_RESULT:
+		case TXN_COMMIT_PREPARED_MULTI_RESULT:
 			if (gtmpqGetnchar((char *)&result->gr_resdata.grd_txn_rc_multi.txn_count,
 						   sizeof (int), conn))
 			{
 				result->gr_status = GTM_RESULT_ERROR;
 				break;
 			}
-			if (gtmpqGetnchar((char *)result->gr_resdata.grd_txn_rc_multi.status,
+			result->gr_resdata.grd_txn_rc_multi.status =
+				gtmpqMultiResultArray(result,
+						&result->gr_resdata.grd_txn_rc_multi.txn_count,
+						sizeof (int));
+			if (result->gr_resdata.grd_txn_rc_multi.status == NULL ||
+				gtmpqGetnchar((char *)result->gr_resdata.grd_txn_rc_multi.status,
 						   sizeof (int) * result->gr_resdata.grd_txn_rc_multi.txn_count, conn))
 			{
 				result->gr_status = GTM_RESULT_ERROR;
@@ -492,7 +505,12 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 				result->gr_status = GTM_RESULT_ERROR;
 				break;
 			}
-			if (gtmpqGetnchar((char *)result->gr_resdata.grd_txn_snap_multi.status,
+			result->gr_resdata.grd_txn_snap_multi.status =
+				gtmpqMultiResultArray(result,
+						&result->gr_resdata.grd_txn_snap_multi.txn_count,
+						sizeof (int));
+			if (result->gr_resdata.grd_txn_snap_multi.status == NULL ||
+				gtmpqGetnchar((char *)result->gr_resdata.grd_txn_snap_multi.status,
 						   sizeof (int) * result->gr_resdata.grd_txn_snap_multi.txn_count, conn))
 			{
 				result->gr_status = GTM_RESULT_ERROR;
@@ -524,17 +542,34 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 			xcnt = result->gr_snapshot.sn_xcnt;
 			xip = result->gr_snapshot.sn_xip;
 
+			if (xcnt < 0 || xcnt > GTM_MAX_GLOBAL_TRANSACTIONS)
+			{
+				result->gr_status = GTM_RESULT_ERROR;
+				break;
+			}
+
+			/*
+			 * Size the array after the snapshots received, rather than for
+			 * GTM_MAX_GLOBAL_TRANSACTIONS, doubling it when it is too small
+			 */
 			if (!xip || xcnt > xsize)
 			{
-				if (!xip)
-					xip = (GlobalTransactionId *) malloc(sizeof(GlobalTransactionId) *
-														 GTM_MAX_GLOBAL_TRANSACTIONS);
-				else
-					xip = (GlobalTransactionId *) realloc(xip,
-									  sizeof(GlobalTransactionId) * xcnt);
+				xsize = Max(xsize * 2, 64);
+				while (xsize < xcnt)
+					xsize *= 2;
+				xip = (GlobalTransactionId *) realloc(xip,
+								  sizeof(GlobalTransactionId) * xsize);
+				if (xip == NULL)
+				{
+					free(result->gr_snapshot.sn_xip);
+					result->gr_snapshot.sn_xip = NULL;
+					result->gr_xip_size = 0;
+					result->gr_status = GTM_RESULT_ERROR;
+					break;
+				}
 
 				result->gr_snapshot.sn_xip = xip;
-				result->gr_xip_size = xcnt;
+				result->gr_xip_size = xsize;
 			}
 
 			if (gtmpqGetnchar((char *)xip, sizeof(GlobalTransactionId) * xcnt, conn))
@@ -574,6 +609,26 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 #endif
 			break;
 
+		case SEQUENCE_GET_NEXT_MULTI_RESULT:
+			if (gtmpqGetnchar((char *)&result->gr_resdata.grd_seq_multi.seq_count,
+						   sizeof (int), conn) ||
+				result->gr_resdata.grd_seq_multi.seq_count < 0 ||
+				result->gr_resdata.grd_seq_multi.seq_count > GTM_MAX_SEQ_MULTI)
+			{
+				result->gr_status = GTM_RESULT_ERROR;
+				break;
+			}
+			if (gtmpqGetnchar((char *)result->gr_resdata.grd_seq_multi.status,
+						   sizeof (int) * result->gr_resdata.grd_seq_multi.seq_count, conn) ||
+				gtmpqGetnchar((char *)result->gr_resdata.grd_seq_multi.seqval,
+						   sizeof (GTM_Sequence) * result->gr_resdata.grd_seq_multi.seq_count, conn) ||
+				gtmpqGetnchar((char *)result->gr_resdata.grd_seq_multi.rangemax,
+						   sizeof (GTM_Sequence) * result->gr_resdata.grd_seq_multi.seq_count, conn) ||
+				gtmpqGetnchar((char *)result->gr_resdata.grd_seq_multi.increment,
+						   sizeof (GTM_Sequence) * result->gr_resdata.grd_seq_multi.seq_count, conn))
+				result->gr_status = GTM_RESULT_ERROR;
+			break;
+
 		case SEQUENCE_LIST_RESULT:
 			if (gtmpqGetInt(&result->gr_resdata.grd_seq_list.seq_count,
 					sizeof (int32), conn))
@@ -782,6 +837,40 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 			break;
 		}
 		case BARRIER_RESULT:
+		case SHM_ATTACH_RESULT:
+			break;
+
+		case GET_STATS_RESULT:
+			if (gtmpqGetInt(&result->gr_resdata.grd_stats.count,
+							sizeof (int32), conn))
+			{
+				result->gr_status = GTM_RESULT_ERROR;
+				break;
+			}
+
+			result->gr_resdata.grd_stats.entries =
+				(GTM_StatEntry *) malloc(sizeof (GTM_StatEntry) *
+										 result->gr_resdata.grd_stats.count);
+
+			for (i = 0; i < result->gr_resdata.grd_stats.count; i++)
+			{
+				GTM_StatEntry *entry = result->gr_resdata.grd_stats.entries + i;
+				int			kind;
+				int			namelen;
+
+				if (gtmpqGetInt(&kind, sizeof (int32), conn) ||
+					gtmpqGetInt(&namelen, sizeof (int32), conn) ||
+					namelen >= GTM_STAT_NAME_LEN ||
+					gtmpqGetnchar(entry->se_name, namelen, conn) ||
+					gtmpqGetnchar((char *) &entry->se_hist,
+								  sizeof (GTM_StatHist), conn))
+				{
+					result->gr_status = GTM_RESULT_ERROR;
+					break;
+				}
+				entry->se_kind = (GTM_StatKind) kind;
+				entry->se_name[namelen] = '\0';
+			}
 			break;
 
 		case REPORT_XMIN_RESULT:
@@ -840,6 +929,43 @@ gtmpqReadSeqKey(GTM_SequenceKey seqkey, GTM_Conn *conn)
 	return 0;
 }
 
+/*
+ * Room for an array of *count entries of the given size in the result.  The
+ * buffer is kept from one result to the next on the connection, and only
+ * grows.  Returns NULL, and sets *count to 0 so that no one looks into the
+ * array, if *count is not sensible or memory is exhausted.
+ */
+static void *
+gtmpqMultiResultArray(GTM_Result *result, int *count, size_t size)
+{
+	size_t		needed;
+
+	if (*count < 0 || *count > GTM_MAX_GLOBAL_TRANSACTIONS)
+	{
+		*count = 0;
+		return NULL;
+	}
+
+	needed = Max(*count, 1) * size;
+	if (result->gr_multi_datalen < needed)
+	{
+		size_t		newlen = Max(result->gr_multi_datalen * 2, 64 * sizeof (int64));
+		char	   *data;
+
+		while (newlen < needed)
+			newlen *= 2;
+		data = realloc(result->gr_multi_data, newlen);
+		if (data == NULL)
+		{
+			*count = 0;
+			return NULL;
+		}
+		result->gr_multi_data = data;
+		result->gr_multi_datalen = newlen;
+	}
+	return result->gr_multi_data;
+}
+
 void
 gtmpqFreeResultData(GTM_Result *result, GTM_PGXCNodeType remote_type)
 {
@@ -879,6 +1005,13 @@ gtmpqFreeResultData(GTM_Result *result, GTM_PGXCNodeType remote_type)
 			break;
 
 		case BARRIER_RESULT:
+		case SHM_ATTACH_RESULT:
+			break;
+
+		case GET_STATS_RESULT:
+			if (result->gr_resdata.grd_stats.entries)
+				free(result->gr_resdata.grd_stats.entries);
+			result->gr_resdata.grd_stats.entries = NULL;
 			break;
 
 		case SNAPSHOT_GET_RESULT:
@@ -57,6 +57,13 @@ static int prepare_transaction_internal(GTM_Conn *conn, GlobalTransactionId gxid
 static int abort_transaction_internal(GTM_Conn *conn, GlobalTransactionId gxid, bool is_backup);
 static int abort_transaction_multi_internal(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid,
 											int *txn_count_out, int *status_out, bool is_backup);
+static int prepare_transaction_multi_internal(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid,
+											  int *txn_count_out, int *status_out, bool is_backup);
+static int commit_prepared_transaction_multi_internal(GTM_Conn *conn, int txn_count,
+													  GlobalTransactionId *gxid,
+													  GlobalTransactionId *prepared_gxid,
+													  int *txn_count_out, int *status_out,
+													  bool is_backup);
 static int open_sequence_internal(GTM_Conn *conn, GTM_SequenceKey key, GTM_Sequence increment,
 								  GTM_Sequence minval, GTM_Sequence maxval,
 								  GTM_Sequence startval, bool cycle, bool is_backup);
@@ -81,6 +88,9 @@ static int node_register_worker(GTM_Conn *conn, GTM_PGXCNodeType type, const cha
 								GTM_PGXCNodeStatus status, bool is_backup);
 static int node_unregister_worker(GTM_Conn *conn, GTM_PGXCNodeType type, const char * node_name, bool is_backup);
 static int report_barrier_internal(GTM_Conn *conn, char *barrier_id, bool is_backup);
+static int register_session_internal(GTM_Conn *conn, const char *coord_name,
+									 int coord_procid, int coord_backendid,
+									 bool is_backup);
 /*
  * Make an empty result if old one is null.
  */
@@ -302,9 +312,6 @@ get_next_gxid(GTM_Conn *conn)
 	if ((res = GTMPQgetResult(conn)) == NULL)
 		goto receive_failed;
 
-	fprintf(stderr, "GTMPQgetResult() done.\n");
-	fflush(stderr);
-
 	next_gxid = res->gr_resdata.grd_next_gxid;
 
 	if (res->gr_status == GTM_RESULT_OK)
@@ -736,8 +743,26 @@ commit_prepared_transaction(GTM_Conn *conn,
 		int waited_xid_count,
 		GlobalTransactionId *waited_xids)
 {
-	return commit_prepared_transaction_internal(conn, gxid, prepared_gxid,
-			waited_xid_count, waited_xids, false);
+	/*
+	 * Without transactions to wait for, use the multi-transaction message so
+	 * that a GTM proxy can group it with the commits of other backends
+	 */
+	if (waited_xid_count == 0)
+	{
+		int txn_count_out;
+		int status_out;
+		int status;
+
+		status = commit_prepared_transaction_multi(conn, 1, &gxid,
+				&prepared_gxid, &txn_count_out, &status_out);
+		/* Report a failed commit as the single message would */
+		if (status == GTM_RESULT_OK && status_out != STATUS_OK)
+			status = GTM_RESULT_ERROR;
+		return status;
+	}
+	else
+		return commit_prepared_transaction_internal(conn, gxid, prepared_gxid,
+				waited_xid_count, waited_xids, false);
 }
 
 int
@@ -950,7 +975,17 @@ send_failed:
 int
 prepare_transaction(GTM_Conn *conn, GlobalTransactionId gxid)
 {
-	return prepare_transaction_internal(conn, gxid, false);
+	int txn_count_out;
+	int status_out;
+	int status;
+
+	/* Sent as a group of one, so that a GTM proxy can group it further */
+	status = prepare_transaction_multi(conn, 1, &gxid, &txn_count_out,
+			&status_out);
+	/* Report a failed prepare as the single message would */
+	if (status == GTM_RESULT_OK && status_out != STATUS_OK)
+		status = GTM_RESULT_ERROR;
+	return status;
 }
 
 int
@@ -1880,6 +1915,8 @@ GTM_FreeResult(GTM_Result *result, GTM_PGXCNodeType remote_type)
 	if (result == NULL)
 		return;
 	gtmpqFreeResultData(result, remote_type);
+	if (result->gr_multi_data)
+		free(result->gr_multi_data);
 	free(result);
 }
 
@@ -2093,7 +2130,7 @@ commit_transaction_multi(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxi
 	if (res->gr_status == GTM_RESULT_OK)
 	{
 		memcpy(txn_count_out, &res->gr_resdata.grd_txn_get_multi.txn_count, sizeof(int));
-		memcpy(status_out, &res->gr_resdata.grd_txn_rc_multi.status, sizeof(int) * (*txn_count_out));
+		memcpy(status_out, res->gr_resdata.grd_txn_rc_multi.status, sizeof(int) * (*txn_count_out));
 	}
 
 	return res->gr_status;
@@ -2165,7 +2202,167 @@ abort_transaction_multi_internal(GTM_Conn *conn, int txn_count, GlobalTransactio
 		if (res->gr_status == GTM_RESULT_OK)
 		{
 			memcpy(txn_count_out, &res->gr_resdata.grd_txn_get_multi.txn_count, sizeof(int));
-			memcpy(status_out, &res->gr_resdata.grd_txn_rc_multi.status, sizeof(int) * (*txn_count_out));
+			memcpy(status_out, res->gr_resdata.grd_txn_rc_multi.status, sizeof(int) * (*txn_count_out));
+		}
+
+		return res->gr_status;
+	}
+	return GTM_RESULT_OK;
+
+receive_failed:
+send_failed:
+	conn->result = makeEmptyResultIfIsNull(conn->result);
+	conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+	return -1;
+}
+
+int
+prepare_transaction_multi(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid,
+						  int *txn_count_out, int *status_out)
+{
+	return prepare_transaction_multi_internal(conn, txn_count, gxid, txn_count_out, status_out, false);
+}
+
+int
+bkup_prepare_transaction_multi(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid)
+{
+	int txn_count_out;
+	int status_out[GTM_MAX_GLOBAL_TRANSACTIONS];
+
+	return prepare_transaction_multi_internal(conn, txn_count, gxid, &txn_count_out, status_out, true);
+}
+
+static int
+prepare_transaction_multi_internal(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid,
+								   int *txn_count_out, int *status_out, bool is_backup)
+{
+	GTM_Result *res = NULL;
+	time_t finish_time;
+	int i;
+
+	/* Start the message. */
+	if (gtmpqPutMsgStart('C', true, conn)) /* FIXME: no proxy header */
+		goto send_failed;
+
+	if (gtmpqPutInt(is_backup ? MSG_BKUP_TXN_PREPARE_MULTI : MSG_TXN_PREPARE_MULTI, sizeof (GTM_MessageType), conn) ||
+	    gtmpqPutInt(txn_count, sizeof(int), conn))
+		goto send_failed;
+
+	for (i = 0; i < txn_count; i++)
+	{
+		if (gtmpqPutnchar((char *)&gxid[i],
+				  sizeof (GlobalTransactionId), conn))
+			  goto send_failed;
+	}
+
+	/* Finish the message. */
+	if (gtmpqPutMsgEnd(conn))
+		goto send_failed;
+
+	/* Flush to ensure backend gets it. */
+	if (gtmpqFlush(conn))
+		goto send_failed;
+
+	if (!is_backup)
+	{
+		finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
+		if (gtmpqWaitTimed(true, false, conn, finish_time) ||
+			gtmpqReadData(conn) < 0)
+			goto receive_failed;
+
+		if ((res = GTMPQgetResult(conn)) == NULL)
+			goto receive_failed;
+
+		if (res->gr_status == GTM_RESULT_OK)
+		{
+			Assert(res->gr_type == TXN_PREPARE_MULTI_RESULT);
+			memcpy(txn_count_out, &res->gr_resdata.grd_txn_rc_multi.txn_count, sizeof(int));
+			memcpy(status_out, res->gr_resdata.grd_txn_rc_multi.status, sizeof(int) * (*txn_count_out));
+		}
+
+		return res->gr_status;
+	}
+	return GTM_RESULT_OK;
+
+receive_failed:
+send_failed:
+	conn->result = makeEmptyResultIfIsNull(conn->result);
+	conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+	return -1;
+}
+
+int
+commit_prepared_transaction_multi(GTM_Conn *conn, int txn_count,
+								  GlobalTransactionId *gxid,
+								  GlobalTransactionId *prepared_gxid,
+								  int *txn_count_out, int *status_out)
+{
+	return commit_prepared_transaction_multi_internal(conn, txn_count, gxid,
+			prepared_gxid, txn_count_out, status_out, false);
+}
+
+int
+bkup_commit_prepared_transaction_multi(GTM_Conn *conn, int txn_count,
+		GlobalTransactionId *gxid, GlobalTransactionId *prepared_gxid)
+{
+	int txn_count_out;
+	int status_out[GTM_MAX_GLOBAL_TRANSACTIONS];
+
+	return commit_prepared_transaction_multi_internal(conn, txn_count, gxid,
+			prepared_gxid, &txn_count_out, status_out, true);
+}
+
+static int
+commit_prepared_transaction_multi_internal(GTM_Conn *conn, int txn_count,
+										   GlobalTransactionId *gxid,
+										   GlobalTransactionId *prepared_gxid,
+										   int *txn_count_out, int *status_out,
+										   bool is_backup)
+{
+	GTM_Result *res = NULL;
+	time_t finish_time;
+	int i;
+
+	/* Start the message. */
+	if (gtmpqPutMsgStart('C', true, conn)) /* FIXME: no proxy header */
+		goto send_failed;
+
+	if (gtmpqPutInt(is_backup ? MSG_BKUP_TXN_COMMIT_PREPARED_MULTI : MSG_TXN_COMMIT_PREPARED_MULTI, sizeof (GTM_MessageType), conn) ||
+	    gtmpqPutInt(txn_count, sizeof(int), conn))
+		goto send_failed;
+
+	for (i = 0; i < txn_count; i++)
+	{
+		if (gtmpqPutnchar((char *)&gxid[i],
+				  sizeof (GlobalTransactionId), conn) ||
+			gtmpqPutnchar((char *)&prepared_gxid[i],
+				  sizeof (GlobalTransactionId), conn))
+			  goto send_failed;
+	}
+
+	/* Finish the message. */
+	if (gtmpqPutMsgEnd(conn))
+		goto send_failed;
+
+	/* Flush to ensure backend gets it. */
+	if (gtmpqFlush(conn))
+		goto send_failed;
+
+	if (!is_backup)
+	{
+		finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
+		if (gtmpqWaitTimed(true, false, conn, finish_time) ||
+			gtmpqReadData(conn) < 0)
+			goto receive_failed;
+
+		if ((res = GTMPQgetResult(conn)) == NULL)
+			goto receive_failed;
+
+		if (res->gr_status == GTM_RESULT_OK)
+		{
+			Assert(res->gr_type == TXN_COMMIT_PREPARED_MULTI_RESULT);
+			memcpy(txn_count_out, &res->gr_resdata.grd_txn_rc_multi.txn_count, sizeof(int));
+			memcpy(status_out, res->gr_resdata.grd_txn_rc_multi.status, sizeof(int) * (*txn_count_out));
 		}
 
 		return res->gr_status;
@@ -2223,7 +2420,7 @@ snapshot_get_multi(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid,
 	if (res->gr_status == GTM_RESULT_OK)
 	{
 		memcpy(txn_count_out, &res->gr_resdata.grd_txn_get_multi.txn_count, sizeof(int));
-		memcpy(status_out, &res->gr_resdata.grd_txn_rc_multi.status, sizeof(int) * (*txn_count_out));
+		memcpy(status_out, res->gr_resdata.grd_txn_rc_multi.status, sizeof(int) * (*txn_count_out));
 		memcpy(xmin_out, &res->gr_snapshot.sn_xmin, sizeof(GlobalTransactionId));
 		memcpy(xmax_out, &res->gr_snapshot.sn_xmax, sizeof(GlobalTransactionId));
 		memcpy(xcnt_out, &res->gr_snapshot.sn_xcnt, sizeof(int32));
@@ -2323,9 +2520,14 @@ set_begin_end_backup(GTM_Conn *conn, bool begin)
 	if (gtmpqFlush(conn))
 		goto send_failed;
 
+	/*
+	 * Several replies may arrive in one read when sync requests are
+	 * pipelined, so only wait on the socket if nothing is buffered yet.
+	 */
 	finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
-	if (gtmpqWaitTimed(true, false, conn, finish_time) ||
-		gtmpqReadData(conn) < 0)
+	if (conn->inStart == conn->inEnd &&
+		(gtmpqWaitTimed(true, false, conn, finish_time) ||
+		 gtmpqReadData(conn) < 0))
 		goto receive_failed;
 
 	if ((res = GTMPQgetResult(conn)) == NULL)
@@ -2346,13 +2548,29 @@ send_failed:
 int
 gtm_sync_standby(GTM_Conn *conn)
 {
-	GTM_Result *res = NULL;
-	time_t finish_time;
+	if (send_sync_standby(conn))
+	{
+		conn->result = makeEmptyResultIfIsNull(conn->result);
+		conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+		return -1;
+	}
 
-	if (gtmpqPutMsgStart('C', true, conn))
-		goto send_failed;
+	return receive_sync_standby(conn);
+}
 
-	if (gtmpqPutInt(MSG_SYNC_STANDBY, sizeof(GTM_MessageType), conn))
+/*
+ * Send a sync request without waiting for the reply.  Several requests may
+ * be outstanding on the same connection; the standby answers them in order
+ * and each answer is collected with receive_sync_standby().
+ *
+ * Unlike most routines here, a send failure does not touch conn->result,
+ * so that another thread may be reading replies on the same connection.
+ */
+int
+send_sync_standby(GTM_Conn *conn)
+{
+	if (gtmpqPutMsgStart('C', true, conn) ||
+		gtmpqPutInt(MSG_SYNC_STANDBY, sizeof(GTM_MessageType), conn))
 		goto send_failed;
 
 	if (gtmpqPutMsgEnd(conn))
@@ -2361,9 +2579,29 @@ gtm_sync_standby(GTM_Conn *conn)
 	if (gtmpqFlush(conn))
 		goto send_failed;
 
-		finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
-	if (gtmpqWaitTimed(true, false, conn, finish_time) ||
-		gtmpqReadData(conn) < 0)
+	return 0;
+
+send_failed:
+	return -1;
+}
+
+/*
+ * Wait for the reply to the oldest outstanding sync request
+ */
+int
+receive_sync_standby(GTM_Conn *conn)
+{
+	GTM_Result *res = NULL;
+	time_t finish_time;
+
+	/*
+	 * Several replies may arrive in one read when sync requests are
+	 * pipelined, so only wait on the socket if nothing is buffered yet.
+	 */
+	finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
+	if (conn->inStart == conn->inEnd &&
+		(gtmpqWaitTimed(true, false, conn, finish_time) ||
+		 gtmpqReadData(conn) < 0))
 		goto receive_failed;
 
 	if ((res = GTMPQgetResult(conn)) == NULL)
@@ -2372,7 +2610,6 @@ gtm_sync_standby(GTM_Conn *conn)
 	return res->gr_status;
 
 receive_failed:
-send_failed:
 	conn->result = makeEmptyResultIfIsNull(conn->result);
 	conn->result->gr_status = GTM_RESULT_COMM_ERROR;
 	return -1;
@@ -2391,13 +2628,31 @@ send_failed:
 int
 register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
 				 int coord_backendid)
+{
+	return register_session_internal(conn, coord_name, coord_procid,
+									 coord_backendid, false);
+}
+
+int
+bkup_register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
+					  int coord_backendid)
+{
+	return register_session_internal(conn, coord_name, coord_procid,
+									 coord_backendid, true);
+}
+
+static int
+register_session_internal(GTM_Conn *conn, const char *coord_name,
+						  int coord_procid, int coord_backendid,
+						  bool is_backup)
 {
 	GTM_Result *res = NULL;
 	time_t 		finish_time;
 	int32		len = strlen(coord_name);
 
 	if (gtmpqPutMsgStart('C', true, conn) ||
-		gtmpqPutInt(MSG_REGISTER_SESSION, sizeof (GTM_MessageType), conn) ||
+		gtmpqPutInt(is_backup ? MSG_BKUP_REGISTER_SESSION : MSG_REGISTER_SESSION,
+					sizeof (GTM_MessageType), conn) ||
 		gtmpqPutInt(len, sizeof(len), conn) ||
 		gtmpqPutnchar(coord_name, len, conn) ||
 		gtmpqPutInt(coord_procid, sizeof(coord_procid), conn) ||
@@ -2418,6 +2673,9 @@ register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
 		goto send_failed;
 	}
 
+	if (is_backup)
+		return GTM_RESULT_OK;
+
 	finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
 	if (gtmpqWaitTimed(true, false, conn, finish_time) ||
 		gtmpqReadData(conn) < 0)
@@ -2499,3 +2757,49 @@ send_failed:
 
 }
 
+/*
+ * Fetch the latency histograms of GTM.  The entries are malloc'd and
+ * belong to the caller.  Returns the number of entries or -1.
+ */
+int
+get_gtm_stats(GTM_Conn *conn, GTM_StatEntry **entries)
+{
+	GTM_Result *res = NULL;
+	time_t finish_time;
+
+	 /* Start the message. */
+	if (gtmpqPutMsgStart('C', true, conn) ||
+		gtmpqPutInt(MSG_GET_STATS, sizeof (GTM_MessageType), conn))
+		goto send_failed;
+
+	/* Finish the message. */
+	if (gtmpqPutMsgEnd(conn))
+		goto send_failed;
+
+	/* Flush to ensure backend gets it. */
+	if (gtmpqFlush(conn))
+		goto send_failed;
+
+	finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
+	if (gtmpqWaitTimed(true, false, conn, finish_time) ||
+		gtmpqReadData(conn) < 0)
+		goto receive_failed;
+
+	if ((res = GTMPQgetResult(conn)) == NULL)
+		goto receive_failed;
+
+	if (res->gr_status != GTM_RESULT_OK)
+		return -1;
+
+	Assert(res->gr_type == GET_STATS_RESULT);
+	*entries = res->gr_resdata.grd_stats.entries;
+	res->gr_resdata.grd_stats.entries = NULL;
+
+	return res->gr_resdata.grd_stats.count;
+
+receive_failed:
+send_failed:
+	conn->result = makeEmptyResultIfIsNull(conn->result);
+	conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+	return -1;
+}
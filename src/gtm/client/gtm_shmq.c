@@ -0,0 +1,435 @@
+/*-------------------------------------------------------------------------
+ *
+ * gtm_shmq.c
+ *	Shared memory transport between a GTM proxy and its local clients
+ *
+ * See gtm_shmq.h for the layout of the segment.  The routines here are used
+ * by the proxy as well as by the client library, so they do not report
+ * errors themselves; failures are returned to the caller with errno set.
+ *
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "gtm/gtm_c.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef HAVE_LINUX_FUTEX_H
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "gtm/gtm_shmq.h"
+
+/* Times a consumer checks the ring before it goes to sleep */
+#define GTM_SHMQ_SPINS			100
+
+/* Poll interval when the sleep cannot be woken up */
+#define GTM_SHMQ_POLL_US		50
+
+static size_t GTM_ShmqSize(int nslots, int nworkers);
+static void GTM_ShmqSetup(GTM_Shmq *shmq, char *base);
+static bool GTM_ShmqInUse(int port);
+
+static size_t
+GTM_ShmqSize(int nslots, int nworkers)
+{
+	return sizeof (GTM_ShmqHeader) +
+		(size_t) nworkers * sizeof (GTM_ShmqWorker) +
+		(size_t) nslots * sizeof (GTM_ShmqSlot);
+}
+
+static void
+GTM_ShmqSetup(GTM_Shmq *shmq, char *base)
+{
+	shmq->sq_header = (GTM_ShmqHeader *) base;
+	shmq->sq_workers = (GTM_ShmqWorker *) (base + sizeof (GTM_ShmqHeader));
+	shmq->sq_slots = (GTM_ShmqSlot *) (shmq->sq_workers +
+									   shmq->sq_header->sh_nworkers);
+}
+
+/*
+ * Tell whether the segment of port belongs to a running proxy.
+ */
+static bool
+GTM_ShmqInUse(int port)
+{
+	GTM_Shmq   *shmq = GTM_ShmqOpen(port);
+	pid_t		pid;
+
+	if (shmq == NULL)
+		return false;
+	pid = shmq->sq_header->sh_pid;
+	GTM_ShmqClose(shmq);
+
+	return pid != 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+/*
+ * Create the segment of the proxy listening on port, with nslots slots for
+ * clients and nworkers worker threads.  The caller must have bound the port
+ * first, so that no other proxy uses it.  A segment left over by a proxy
+ * that did not exit cleanly is replaced, the one of a running proxy is not.
+ */
+GTM_Shmq *
+GTM_ShmqCreate(int port, int nslots, int nworkers)
+{
+	GTM_Shmq   *shmq;
+	GTM_ShmqHeader *header;
+	size_t		size = GTM_ShmqSize(nslots, nworkers);
+	char	   *base;
+	int			fd;
+	int			save_errno;
+
+	shmq = (GTM_Shmq *) malloc(sizeof (GTM_Shmq));
+	if (shmq == NULL)
+		return NULL;
+	snprintf(shmq->sq_name, GTM_SHMQ_NAME_LEN, "/gtm_proxy.%d", port);
+
+#ifndef GTM_SHMQ_SUPPORTED
+	free(shmq);
+	errno = ENOSYS;
+	return NULL;
+#endif
+
+	fd = shm_open(shmq->sq_name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd < 0 && errno == EEXIST)
+	{
+		if (GTM_ShmqInUse(port))
+		{
+			free(shmq);
+			errno = EADDRINUSE;
+			return NULL;
+		}
+		shm_unlink(shmq->sq_name);
+		fd = shm_open(shmq->sq_name, O_RDWR | O_CREAT | O_EXCL,
+					  S_IRUSR | S_IWUSR);
+	}
+	if (fd < 0)
+	{
+		save_errno = errno;
+		free(shmq);
+		errno = save_errno;
+		return NULL;
+	}
+
+	if (ftruncate(fd, size) != 0 ||
+		(base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+					 fd, 0)) == MAP_FAILED)
+	{
+		save_errno = errno;
+		close(fd);
+		shm_unlink(shmq->sq_name);
+		free(shmq);
+		errno = save_errno;
+		return NULL;
+	}
+	close(fd);
+
+	/* A fresh segment is zeroed, all the slots are free */
+	header = (GTM_ShmqHeader *) base;
+	header->sh_nslots = nslots;
+	header->sh_nworkers = nworkers;
+	header->sh_ring_size = GTM_SHMQ_RING_SIZE;
+	header->sh_pid = getpid();
+	header->sh_cookie = ((uint64) getpid() << 32) ^ (uint64) time(NULL) ^
+		(uint64) (uintptr_t) base;
+
+	shmq->sq_size = size;
+	GTM_ShmqSetup(shmq, base);
+
+	/* Clients only use the segment once they see the magic number */
+	GTM_ShmqBarrier();
+	header->sh_magic = GTM_SHMQ_MAGIC;
+
+	return shmq;
+}
+
+/*
+ * Map the segment of the proxy listening on port, if any.
+ */
+GTM_Shmq *
+GTM_ShmqOpen(int port)
+{
+	GTM_Shmq   *shmq;
+	GTM_ShmqHeader *header;
+	struct stat st;
+	char	   *base;
+	int			fd;
+	int			save_errno;
+
+	shmq = (GTM_Shmq *) malloc(sizeof (GTM_Shmq));
+	if (shmq == NULL)
+		return NULL;
+	snprintf(shmq->sq_name, GTM_SHMQ_NAME_LEN, "/gtm_proxy.%d", port);
+
+#ifndef GTM_SHMQ_SUPPORTED
+	free(shmq);
+	errno = ENOSYS;
+	return NULL;
+#endif
+
+	fd = shm_open(shmq->sq_name, O_RDWR, 0);
+	if (fd < 0)
+	{
+		save_errno = errno;
+		free(shmq);
+		errno = save_errno;
+		return NULL;
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_size < sizeof (GTM_ShmqHeader) ||
+		(base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+					 fd, 0)) == MAP_FAILED)
+	{
+		save_errno = errno;
+		close(fd);
+		free(shmq);
+		errno = save_errno;
+		return NULL;
+	}
+	close(fd);
+
+	shmq->sq_size = st.st_size;
+	header = (GTM_ShmqHeader *) base;
+	if (header->sh_magic != GTM_SHMQ_MAGIC ||
+		header->sh_ring_size != GTM_SHMQ_RING_SIZE ||
+		GTM_ShmqSize(header->sh_nslots, header->sh_nworkers) != st.st_size)
+	{
+		munmap(base, st.st_size);
+		free(shmq);
+		errno = EINVAL;
+		return NULL;
+	}
+	GTM_ShmqBarrier();
+
+	GTM_ShmqSetup(shmq, base);
+	return shmq;
+}
+
+/*
+ * Unmap the segment
+ */
+void
+GTM_ShmqClose(GTM_Shmq *shmq)
+{
+	munmap((char *) shmq->sq_header, shmq->sq_size);
+	free(shmq);
+}
+
+/*
+ * Remove the name of the segment so that no more clients find it.  Those
+ * already attached keep it mapped.
+ */
+void
+GTM_ShmqRemove(GTM_Shmq *shmq)
+{
+	shm_unlink(shmq->sq_name);
+}
+
+/*
+ * Claim a free slot for this process and empty its rings.  Slots claimed by
+ * processes that died before they got attached are taken over.
+ *
+ * Returns the slot number, or -1 if all of them are in use.
+ */
+int
+GTM_ShmqClaimSlot(GTM_Shmq *shmq)
+{
+	int32		pid = getpid();
+	int			ii;
+
+	for (ii = 0; ii < shmq->sq_header->sh_nslots; ii++)
+	{
+		GTM_ShmqSlot *slot = &shmq->sq_slots[ii];
+		uint32		state = slot->sl_state;
+
+		if (state == GTM_SHMQ_SLOT_ATTACHED)
+			continue;
+		if (state == GTM_SHMQ_SLOT_CLAIMED)
+		{
+			int32		owner = slot->sl_pid;
+
+			if (owner == pid || kill(owner, 0) == 0 || errno != ESRCH)
+				continue;
+			if (!GTM_ShmqCompareAndSwap(&slot->sl_pid, owner, pid))
+				continue;
+		}
+		else if (!GTM_ShmqCompareAndSwap(&slot->sl_state,
+										GTM_SHMQ_SLOT_FREE,
+										GTM_SHMQ_SLOT_CLAIMED))
+			continue;
+
+		slot->sl_pid = pid;
+		slot->sl_request.rg_head = slot->sl_request.rg_tail = 0;
+		slot->sl_request.rg_waiting = 0;
+		slot->sl_response.rg_head = slot->sl_response.rg_tail = 0;
+		slot->sl_response.rg_waiting = 0;
+		GTM_ShmqBarrier();
+		return ii;
+	}
+
+	errno = EBUSY;
+	return -1;
+}
+
+/*
+ * Give a slot back, by the client if the proxy did not attach it, by the
+ * proxy once the connection using it is closed.
+ */
+void
+GTM_ShmqReleaseSlot(GTM_Shmq *shmq, int slotno)
+{
+	GTM_ShmqSlot *slot = &shmq->sq_slots[slotno];
+
+	slot->sl_pid = 0;
+	GTM_ShmqBarrier();
+	slot->sl_state = GTM_SHMQ_SLOT_FREE;
+}
+
+/*
+ * Copy as much of buf as fits into the ring.  Returns the number of bytes
+ * written, the caller wakes up the consumer once it is done.
+ */
+int
+GTM_ShmqWrite(GTM_ShmqRing *ring, const char *buf, int len)
+{
+	uint32		head = ring->rg_head;
+	uint32		space;
+	uint32		offset;
+	uint32		first;
+
+	GTM_ShmqBarrier();
+	space = GTM_SHMQ_RING_SIZE - (head - ring->rg_tail);
+	if (len > space)
+		len = space;
+	if (len == 0)
+		return 0;
+
+	offset = head & (GTM_SHMQ_RING_SIZE - 1);
+	first = Min(len, GTM_SHMQ_RING_SIZE - offset);
+	memcpy(ring->rg_data + offset, buf, first);
+	memcpy(ring->rg_data, buf + first, len - first);
+
+	/* The data must be there before the consumer sees the new head */
+	GTM_ShmqBarrier();
+	ring->rg_head = head + len;
+
+	return len;
+}
+
+/*
+ * Copy up to len bytes out of the ring.  Returns the number of bytes read.
+ */
+int
+GTM_ShmqRead(GTM_ShmqRing *ring, char *buf, int len)
+{
+	uint32		tail = ring->rg_tail;
+	uint32		avail;
+	uint32		offset;
+	uint32		first;
+
+	avail = ring->rg_head - tail;
+	if (len > avail)
+		len = avail;
+	if (len == 0)
+		return 0;
+	GTM_ShmqBarrier();
+
+	offset = tail & (GTM_SHMQ_RING_SIZE - 1);
+	first = Min(len, GTM_SHMQ_RING_SIZE - offset);
+	memcpy(buf, ring->rg_data + offset, first);
+	memcpy(buf + first, ring->rg_data, len - first);
+
+	/* Done with the data before the producer may overwrite it */
+	GTM_ShmqBarrier();
+	ring->rg_tail = tail + len;
+
+	return len;
+}
+
+/*
+ * Wait until the ring has some data, for at most timeout_ms.  Returns true
+ * if it has.
+ *
+ * The consumer spins for a moment, since the response to a request often
+ * comes back quickly, then sleeps on rg_head until the producer wakes it up.
+ */
+bool
+GTM_ShmqWait(GTM_ShmqRing *ring, int timeout_ms)
+{
+	uint32		head;
+	int			ii;
+
+	for (ii = 0; ii < GTM_SHMQ_SPINS; ii++)
+	{
+		if (!GTM_ShmqEmpty(ring))
+			return true;
+	}
+
+	ring->rg_waiting = 1;
+	GTM_ShmqBarrier();
+	head = ring->rg_head;
+	if (head == ring->rg_tail)
+	{
+#ifdef HAVE_LINUX_FUTEX_H
+		struct timespec ts;
+
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+		syscall(SYS_futex, &ring->rg_head, FUTEX_WAIT, head, &ts, NULL, 0);
+#else
+		long		waited_us;
+
+		for (waited_us = 0; waited_us < timeout_ms * 1000L &&
+				 ring->rg_head == head; waited_us += GTM_SHMQ_POLL_US)
+			pg_usleep(GTM_SHMQ_POLL_US);
+#endif
+	}
+	ring->rg_waiting = 0;
+
+	return !GTM_ShmqEmpty(ring);
+}
+
+/*
+ * Wait until the ring has some free space, for at most timeout_ms.  Returns
+ * true if it has.  The consumer does not wake up the producer, rings only
+ * fill up with messages larger than they are, so polling is good enough.
+ */
+bool
+GTM_ShmqWaitSpace(GTM_ShmqRing *ring, int timeout_ms)
+{
+	long		waited_us;
+
+	for (waited_us = 0; GTM_ShmqFull(ring); waited_us += GTM_SHMQ_POLL_US)
+	{
+		if (waited_us >= timeout_ms * 1000L)
+			return false;
+		pg_usleep(GTM_SHMQ_POLL_US);
+	}
+	return true;
+}
+
+/*
+ * Wake up the consumer of the ring if it sleeps
+ */
+void
+GTM_ShmqWakeup(GTM_ShmqRing *ring)
+{
+	GTM_ShmqBarrier();
+	if (ring->rg_waiting)
+	{
+#ifdef HAVE_LINUX_FUTEX_H
+		syscall(SYS_futex, &ring->rg_head, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+	}
+}
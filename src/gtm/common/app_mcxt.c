@@ -1,6 +1,6 @@
 /*----------------------------------------------------------------------------------
  *
- * mxct.c
+ * app_mcxt.c
  *		Postgres-XC memory context management code for applications.
  *
  * This module is for Postgres-XC application/utility programs.  Sometimes,
@@ -10,7 +10,8 @@
  * This module "virtualize" such module-dependent memory management.
  *
  * This code is for general use, which depends only upon confentional
- * memory management functions.
+ * memory management functions.  It is not part of libgtm, which has its
+ * own memory contexts: programs link the object file on its own.
  *
  * Copyright (c) 2012, Postgres-XC Development Group
  *
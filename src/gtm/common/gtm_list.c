@@ -129,6 +129,34 @@ gtm_lappend(gtm_List *list, void *datum)
 	return list;
 }
 
+/*
+ * Like gtm_lappend, but use the given cell rather than allocating one.
+ * Only the gtm_List header is allocated, if the list was empty.
+ */
+gtm_List *
+gtm_lappend_given_cell(gtm_List *list, gtm_ListCell *cell, void *datum)
+{
+	cell->next = NULL;
+	gtm_lfirst(cell) = datum;
+
+	if (list == gtm_NIL)
+	{
+		list = (gtm_List *) palloc(sizeof(*list));
+		list->length = 1;
+		list->head = cell;
+		list->tail = cell;
+	}
+	else
+	{
+		list->tail->next = cell;
+		list->tail = cell;
+		list->length++;
+	}
+
+	check_list_invariants(list);
+	return list;
+}
+
 /*
  * Add a new cell to the list, in the position after 'prev_cell'. The
  * data in the cell is left undefined, and must be filled in by the
@@ -377,6 +405,38 @@ gtm_list_delete_cell(gtm_List *list, gtm_ListCell *cell, gtm_ListCell *prev)
 	return list;
 }
 
+/*
+ * Like gtm_list_delete_cell, but the cell is left to the caller, who may
+ * give it again to gtm_lappend_given_cell.  The gtm_List header is still
+ * pfree'd if this was the last gtm_member.
+ */
+gtm_List *
+gtm_list_unlink_cell(gtm_List *list, gtm_ListCell *cell, gtm_ListCell *prev)
+{
+	check_list_invariants(list);
+	Assert(prev != NULL ? gtm_lnext(prev) == cell : gtm_list_head(list) == cell);
+
+	if (list->length == 1)
+	{
+		pfree(list);
+		cell->next = NULL;
+		return gtm_NIL;
+	}
+
+	list->length--;
+
+	if (prev)
+		prev->next = cell->next;
+	else
+		list->head = cell->next;
+
+	if (list->tail == cell)
+		list->tail = prev;
+
+	cell->next = NULL;
+	return list;
+}
+
 /*
  * Delete the first cell in list that matches datum, if any.
  * Equality is determined via gtm_equal().
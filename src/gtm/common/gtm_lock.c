@@ -15,6 +15,7 @@
  */
 #include "gtm/gtm_c.h"
 #include "gtm/gtm_lock.h"
+#include "gtm/gtm_stat.h"
 #include "gtm/elog.h"
 
 /*
@@ -29,11 +30,26 @@ bool
 GTM_RWLockAcquire(GTM_RWLock *lock, GTM_LockMode mode)
 {
 	int status = EINVAL;
+	uint64 wait_start = 0;
 #ifdef GTM_LOCK_DEBUG
 	int indx;
 	int ii;
 #endif
 
+	/*
+	 * For locks with statistics, try without blocking first so that only the
+	 * acquisitions that have to wait are timed.
+	 */
+	if (lock->lk_wait_stat != NULL)
+	{
+		if (GTM_RWLockConditionalAcquire(lock, mode))
+		{
+			GTM_StatHistAdd(lock->lk_wait_stat, 0);
+			return true;
+		}
+		wait_start = GTM_StatNow();
+	}
+
 	switch (mode)
 	{
 		case GTM_LOCKMODE_WRITE:
@@ -131,6 +147,9 @@ GTM_RWLockAcquire(GTM_RWLock *lock, GTM_LockMode mode)
 			break;
 	}
 
+	if (lock->lk_wait_stat != NULL && status == 0)
+		GTM_StatHistAdd(lock->lk_wait_stat, GTM_StatNow() - wait_start);
+
 	return status ? false : true;
 }
 
@@ -191,6 +210,7 @@ GTM_RWLockInit(GTM_RWLock *lock)
 	memset(lock, 0, sizeof (GTM_RWLock));
 	pthread_mutex_init(&lock->lk_debug_mutex, NULL);
 #endif
+	lock->lk_wait_stat = NULL;
 	return pthread_rwlock_init(&lock->lk_lock, NULL);
 }
 
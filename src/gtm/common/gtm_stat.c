@@ -0,0 +1,148 @@
+/*-------------------------------------------------------------------------
+ *
+ * gtm_stat.c
+ *	Latency statistics of GTM
+ *
+ * The histograms are shared by all the threads and updated with atomic
+ * operations, so that no lock is taken to count a sample.  Readers may see
+ * a histogram in the middle of an update, which is good enough for
+ * statistics.
+ *
+ * Portions Copyright (c) 1996-2009, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "gtm/gtm_c.h"
+
+#include <time.h>
+
+#include "gtm/gtm_stat.h"
+#include "gtm/gtm_utils.h"
+
+GTM_StatHist	GTMStatMessages[MSG_TYPE_COUNT];
+GTM_StatHist	GTMStatLocks[GTM_STAT_LOCK_COUNT];
+GTM_StatHist	GTMStatStandby;
+
+static const char *GTMStatLockNames[GTM_STAT_LOCK_COUNT] = {
+	"XidGenLock",
+	"TransArrayLock",
+	"SequenceLock"
+};
+
+/*
+ * Current time in microseconds, only meaningful to compute intervals
+ */
+uint64
+GTM_StatNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Count a sample
+ */
+void
+GTM_StatHistAdd(GTM_StatHist *hist, uint64 elapsed_us)
+{
+	int			bucket = 0;
+	uint64		max;
+
+	while (bucket < GTM_STAT_BUCKETS - 1 && (elapsed_us >> bucket) != 0)
+		bucket++;
+
+	__sync_fetch_and_add(&hist->sh_count, 1);
+	__sync_fetch_and_add(&hist->sh_buckets[bucket], 1);
+	if (elapsed_us == 0)
+		return;
+
+	__sync_fetch_and_add(&hist->sh_total_us, elapsed_us);
+	while ((max = hist->sh_max_us) < elapsed_us &&
+		   !__sync_bool_compare_and_swap(&hist->sh_max_us, max, elapsed_us))
+		;
+}
+
+/*
+ * Upper bound of the given fraction of the samples, in microseconds
+ */
+uint64
+GTM_StatHistPercentile(GTM_StatHist *hist, double fraction)
+{
+	uint64		rank = (uint64) (hist->sh_count * fraction);
+	uint64		seen = 0;
+	int			bucket;
+
+	for (bucket = 0; bucket < GTM_STAT_BUCKETS - 1; bucket++)
+	{
+		seen += hist->sh_buckets[bucket];
+		if (seen > rank)
+			return Min((uint64) 1 << bucket, hist->sh_max_us);
+	}
+	return hist->sh_max_us;
+}
+
+const char *
+GTM_StatKindName(GTM_StatKind kind)
+{
+	switch (kind)
+	{
+		case GTM_STAT_MESSAGE:
+			return "message";
+		case GTM_STAT_LOCK:
+			return "lock";
+		case GTM_STAT_STANDBY:
+			return "standby";
+	}
+	return "unknown";
+}
+
+/*
+ * Copy the histograms that counted something into entries, which must have
+ * room for GTM_STAT_MAX_ENTRIES.  Returns the number of entries filled.
+ */
+int
+GTM_StatCollect(GTM_StatEntry *entries)
+{
+	int			count = 0;
+	int			ii;
+
+	for (ii = 0; ii < MSG_TYPE_COUNT; ii++)
+	{
+		const char *name;
+
+		if (GTMStatMessages[ii].sh_count == 0)
+			continue;
+		name = gtm_util_message_name(ii);
+		entries[count].se_kind = GTM_STAT_MESSAGE;
+		strlcpy(entries[count].se_name, name ? name : "UNKNOWN_MESSAGE",
+				GTM_STAT_NAME_LEN);
+		memcpy(&entries[count].se_hist, &GTMStatMessages[ii],
+			   sizeof (GTM_StatHist));
+		count++;
+	}
+
+	for (ii = 0; ii < GTM_STAT_LOCK_COUNT; ii++)
+	{
+		entries[count].se_kind = GTM_STAT_LOCK;
+		strlcpy(entries[count].se_name, GTMStatLockNames[ii],
+				GTM_STAT_NAME_LEN);
+		memcpy(&entries[count].se_hist, &GTMStatLocks[ii],
+			   sizeof (GTM_StatHist));
+		count++;
+	}
+
+	entries[count].se_kind = GTM_STAT_STANDBY;
+	strlcpy(entries[count].se_name, "StandbySync", GTM_STAT_NAME_LEN);
+	memcpy(&entries[count].se_hist, &GTMStatStandby, sizeof (GTM_StatHist));
+	count++;
+
+	return count;
+}
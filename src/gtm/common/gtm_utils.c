@@ -37,7 +37,9 @@ static struct enum_name message_name_tab[] =
 	{MSG_NODE_UNREGISTER, "MSG_NODE_UNREGISTER"},
 	{MSG_BKUP_NODE_UNREGISTER, "MSG_BKUP_NODE_UNREGISTER"},
 	{MSG_REGISTER_SESSION, "MSG_REGISTER_SESSION"},
+	{MSG_BKUP_REGISTER_SESSION, "MSG_BKUP_REGISTER_SESSION"},
 	{MSG_REPORT_XMIN, "MSG_REPORT_XMIN"},
+	{MSG_BKUP_REPORT_XMIN, "MSG_BKUP_REPORT_XMIN"},
 	{MSG_NODE_LIST, "MSG_NODE_LIST"},
 	{MSG_NODE_BEGIN_REPLICATION_INIT, "MSG_NODE_BEGIN_REPLICATION_INIT"},
 	{MSG_NODE_END_REPLICATION_INIT, "MSG_NODE_END_REPLICATION_INIT"},
@@ -57,8 +59,12 @@ static struct enum_name message_name_tab[] =
 	{MSG_BKUP_TXN_COMMIT_MULTI, "MSG_BKUP_TXN_COMMIT_MULTI"},
 	{MSG_TXN_COMMIT_PREPARED, "MSG_TXN_COMMIT_PREPARED"},
 	{MSG_BKUP_TXN_COMMIT_PREPARED, "MSG_BKUP_TXN_COMMIT_PREPARED"},
+	{MSG_TXN_COMMIT_PREPARED_MULTI, "MSG_TXN_COMMIT_PREPARED_MULTI"},
+	{MSG_BKUP_TXN_COMMIT_PREPARED_MULTI, "MSG_BKUP_TXN_COMMIT_PREPARED_MULTI"},
 	{MSG_TXN_PREPARE, "MSG_TXN_PREPARE"},
 	{MSG_BKUP_TXN_PREPARE, "MSG_BKUP_TXN_PREPARE"},
+	{MSG_TXN_PREPARE_MULTI, "MSG_TXN_PREPARE_MULTI"},
+	{MSG_BKUP_TXN_PREPARE_MULTI, "MSG_BKUP_TXN_PREPARE_MULTI"},
 	{MSG_TXN_ROLLBACK, "MSG_TXN_ROLLBACK"},
 	{MSG_BKUP_TXN_ROLLBACK, "MSG_BKUP_TXN_ROLLBACK"},
 	{MSG_TXN_ROLLBACK_MULTI, "MSG_TXN_ROLLBACK_MULTI"},
@@ -76,6 +82,7 @@ static struct enum_name message_name_tab[] =
 	{MSG_SEQUENCE_GET_CURRENT, "MSG_SEQUENCE_GET_CURRENT"},
 	{MSG_SEQUENCE_GET_NEXT, "MSG_SEQUENCE_GET_NEXT"},
 	{MSG_BKUP_SEQUENCE_GET_NEXT, "MSG_BKUP_SEQUENCE_GET_NEXT"},
+	{MSG_SEQUENCE_GET_NEXT_MULTI, "MSG_SEQUENCE_GET_NEXT_MULTI"},
 	{MSG_SEQUENCE_GET_LAST, "MSG_SEQUENCE_GET_LAST"},
 	{MSG_SEQUENCE_SET_VAL, "MSG_SEQUENCE_SET_VAL"},
 	{MSG_BKUP_SEQUENCE_SET_VAL, "MSG_BKUP_SEQUENCE_SET_VAL"},
@@ -95,6 +102,10 @@ static struct enum_name message_name_tab[] =
 	{MSG_BKUP_TXN_BEGIN_GETGXID_AUTOVACUUM, "MSG_BKUP_TXN_BEGIN_GETGXID_AUTOVACUUM"},
 	{MSG_DATA_FLUSH, "MSG_DATA_FLUSH"},
 	{MSG_BACKEND_DISCONNECT, "MSG_BACKEND_DISCONNECT"},
+	{MSG_BARRIER, "MSG_BARRIER"},
+	{MSG_BKUP_BARRIER, "MSG_BKUP_BARRIER"},
+	{MSG_SHM_ATTACH, "MSG_SHM_ATTACH"},
+	{MSG_GET_STATS, "MSG_GET_STATS"},
 	{MSG_TYPE_COUNT, "MSG_TYPE_COUNT"},
 	{-1, NULL}
 };
@@ -104,6 +115,7 @@ static struct enum_name result_name_tab[] =
 	{SYNC_STANDBY_RESULT, "SYNC_STANDBY_RESULT"},
 	{NODE_REGISTER_RESULT, "NODE_REGISTER_RESULT"},
 	{NODE_UNREGISTER_RESULT, "NODE_UNREGISTER_RESULT"},
+	{REGISTER_SESSION_RESULT, "REGISTER_SESSION_RESULT"},
 	{NODE_LIST_RESULT, "NODE_LIST_RESULT"},
 	{NODE_BEGIN_REPLICATION_INIT_RESULT, "NODE_BEGIN_REPLICATION_INIT_RESULT"},
 	{NODE_END_REPLICATION_INIT_RESULT, "NODE_END_REPLICATION_INIT_RESULT"},
@@ -113,8 +125,10 @@ static struct enum_name result_name_tab[] =
 	{TXN_BEGIN_GETGXID_RESULT, "TXN_BEGIN_GETGXID_RESULT"},
 	{TXN_BEGIN_GETGXID_MULTI_RESULT, "TXN_BEGIN_GETGXID_MULTI_RESULT"},
 	{TXN_PREPARE_RESULT, "TXN_PREPARE_RESULT"},
+	{TXN_PREPARE_MULTI_RESULT, "TXN_PREPARE_MULTI_RESULT"},
 	{TXN_START_PREPARED_RESULT, "TXN_START_PREPARED_RESULT"},
 	{TXN_COMMIT_PREPARED_RESULT, "TXN_COMMIT_PREPARED_RESULT"},
+	{TXN_COMMIT_PREPARED_MULTI_RESULT, "TXN_COMMIT_PREPARED_MULTI_RESULT"},
 	{TXN_COMMIT_RESULT, "TXN_COMMIT_RESULT"},
 	{TXN_COMMIT_MULTI_RESULT, "TXN_COMMIT_MULTI_RESULT"},
 	{TXN_ROLLBACK_RESULT, "TXN_ROLLBACK_RESULT"},
@@ -129,6 +143,7 @@ static struct enum_name result_name_tab[] =
 	{SEQUENCE_INIT_RESULT, "SEQUENCE_INIT_RESULT"},
 	{SEQUENCE_GET_CURRENT_RESULT, "SEQUENCE_GET_CURRENT_RESULT"},
 	{SEQUENCE_GET_NEXT_RESULT, "SEQUENCE_GET_NEXT_RESULT"},
+	{SEQUENCE_GET_NEXT_MULTI_RESULT, "SEQUENCE_GET_NEXT_MULTI_RESULT"},
 	{SEQUENCE_GET_LAST_RESULT, "SEQUENCE_GET_LAST_RESULT"},
 	{SEQUENCE_SET_VAL_RESULT, "SEQUENCE_SET_VAL_RESULT"},
 	{SEQUENCE_RESET_RESULT, "SEQUENCE_RESET_RESULT"},
@@ -140,6 +155,9 @@ static struct enum_name result_name_tab[] =
 	{TXN_GET_ALL_PREPARED_RESULT, "TXN_GET_ALL_PREPARED_RESULT"},
 	{TXN_BEGIN_GETGXID_AUTOVACUUM_RESULT, "TXN_BEGIN_GETGXID_AUTOVACUUM_RESULT"},
 	{REPORT_XMIN_RESULT, "REPORT_XMIN_RESULT"},
+	{BARRIER_RESULT, "BARRIER_RESULT"},
+	{SHM_ATTACH_RESULT, "SHM_ATTACH_RESULT"},
+	{GET_STATS_RESULT, "GET_STATS_RESULT"},
 	{RESULT_TYPE_COUNT, "RESULT_TYPE_COUNT"},
 	{-1, NULL}
 };
@@ -163,7 +181,7 @@ void gtm_util_init_nametabs(void)
 			message_max = message_name_tab[ii].type;
 	}
 	message_name = (char **)malloc(sizeof(char *) * (message_max + 1));
-	memset(message_name, sizeof(char *) * (message_max + 1), 0);
+	memset(message_name, 0, sizeof(char *) * (message_max + 1));
 	for (ii = 0; message_name_tab[ii].type >= 0; ii++)
 	{
 		message_name[message_name_tab[ii].type] = message_name_tab[ii].name;
@@ -175,7 +193,7 @@ void gtm_util_init_nametabs(void)
 			result_max = result_name_tab[ii].type;
 	}
 	result_name = (char **)malloc(sizeof(char *) * (result_max + 1));
-	memset(result_name, sizeof(char *) * (result_max + 1), 0);
+	memset(result_name, 0, sizeof(char *) * (result_max + 1));
 	for (ii = 0; result_name_tab[ii].type >= 0; ii++)
 	{
 		result_name[result_name_tab[ii].type] = result_name_tab[ii].name;
@@ -12,6 +12,7 @@
 
 #include "gtm/gtm_c.h"
 #include "gtm/libpq-fe.h"
+#include "gtm/gtm_client.h"
 
 #include <locale.h>
 #include <signal.h>
@@ -46,7 +47,8 @@ typedef enum
 	PROMOTE_COMMAND,
 	RESTART_COMMAND,
 	STATUS_COMMAND,
-	RECONNECT_COMMAND
+	RECONNECT_COMMAND,
+	STATS_COMMAND
 } CtlCommand;
 
 #define DEFAULT_WAIT	60
@@ -81,6 +83,7 @@ static void do_start(void);
 static void do_stop(void);
 static void do_restart(void);
 static void do_reconnect(void);
+static void do_stats(void);
 static void print_msg(const char *msg);
 
 static pgpid_t get_pgpid(void);
@@ -88,6 +91,7 @@ static char **readfile(const char *path);
 static int	start_gtm(void);
 static void read_gtm_opts(void);
 
+static void get_gtm_port(char *portstr, size_t len);
 static bool test_gtm_connection();
 static bool gtm_is_alive(pid_t pid);
 
@@ -347,18 +351,13 @@ static int RunAsDaemon(char *cmd)
 
 
 /*
- * Find the gtm port and try a connection
+ * Find the port the gtm listens on
  */
-static bool
-test_gtm_connection()
+static void
+get_gtm_port(char *portstr, size_t len)
 {
-	GTM_Conn	   *conn;
-	bool		success = false;
-	int			i;
-	char		portstr[32];
 	char	   *p;
 	char	   *q;
-	char		connstr[128];	/* Should be way more than enough! */
 
 	*portstr = '\0';
 
@@ -388,7 +387,7 @@ test_gtm_connection()
 				   !(isspace((unsigned char) *q) || *q == '\'' || *q == '"'))
 				q++;
 			/* and save the argument value */
-			strlcpy(portstr, p, Min((q - p) + 1, sizeof(portstr)));
+			strlcpy(portstr, p, Min((q - p) + 1, len));
 			/* keep looking, maybe there is another -p */
 			p = q;
 		}
@@ -434,7 +433,7 @@ test_gtm_connection()
 						 *q == '\'' || *q == '"' || *q == '#'))
 					q++;
 				/* and save the argument value */
-				strlcpy(portstr, p, Min((q - p) + 1, sizeof(portstr)));
+				strlcpy(portstr, p, Min((q - p) + 1, len));
 				/* keep looking, maybe there is another */
 			}
 		}
@@ -443,7 +442,22 @@ test_gtm_connection()
 	/* Still not found? Use compiled-in default */
 #define GTM_DEFAULT_PORT		6666
 	if (!*portstr)
-		snprintf(portstr, sizeof(portstr), "%d", GTM_DEFAULT_PORT);
+		snprintf(portstr, len, "%d", GTM_DEFAULT_PORT);
+}
+
+/*
+ * Find the gtm port and try a connection
+ */
+static bool
+test_gtm_connection()
+{
+	GTM_Conn	   *conn;
+	bool		success = false;
+	int			i;
+	char		portstr[32];
+	char		connstr[128];	/* Should be way more than enough! */
+
+	get_gtm_port(portstr, sizeof(portstr));
 
 	/*
 	 * We need to set a connect timeout otherwise on Windows the SCM will
@@ -911,6 +925,64 @@ do_status(void)
 	exit(1);
 }
 
+/*
+ * Print the latency histograms of the running GTM, in microseconds
+ */
+static void
+do_stats(void)
+{
+	GTM_Conn   *conn;
+	GTM_StatEntry *entries;
+	int			count;
+	int			i;
+	char		portstr[32];
+	char		connstr[128];
+
+	read_gtm_opts();
+	get_gtm_port(portstr, sizeof(portstr));
+
+	snprintf(connstr, sizeof(connstr),
+			 "host=localhost port=%s connect_timeout=5 node_name=one", portstr);
+
+	conn = PQconnectGTM(connstr);
+	if (conn == NULL || GTMPQstatus(conn) != CONNECTION_OK)
+	{
+		write_stderr(_("%s: could not connect to server on port %s\n"),
+					 progname, portstr);
+		GTMPQfinish(conn);
+		exit(1);
+	}
+
+	count = get_gtm_stats(conn, &entries);
+	if (count < 0)
+	{
+		write_stderr(_("%s: could not get statistics from server\n"), progname);
+		GTMPQfinish(conn);
+		exit(1);
+	}
+
+	printf("%-8s %-40s %12s %10s %10s %10s %10s %10s\n",
+		   "kind", "name", "count", "avg", "p50", "p99", "p999", "max");
+	for (i = 0; i < count; i++)
+	{
+		GTM_StatHist *hist = &entries[i].se_hist;
+
+		printf("%-8s %-40s %12lu %10.1f %10lu %10lu %10lu %10lu\n",
+			   GTM_StatKindName(entries[i].se_kind),
+			   entries[i].se_name,
+			   (unsigned long) hist->sh_count,
+			   hist->sh_count ?
+			   (double) hist->sh_total_us / hist->sh_count : 0.0,
+			   (unsigned long) GTM_StatHistPercentile(hist, 0.5),
+			   (unsigned long) GTM_StatHistPercentile(hist, 0.99),
+			   (unsigned long) GTM_StatHistPercentile(hist, 0.999),
+			   (unsigned long) hist->sh_max_us);
+	}
+
+	free(entries);
+	GTMPQfinish(conn);
+}
+
 
 /*
  *	utility routines
@@ -960,6 +1032,7 @@ do_help(void)
 		 "                 [-o \"OPTIONS\"]\n"), progname);
 	printf(_("  %s status  -Z STARTUP_MODE [-w] [-t SECS] [-D DATADIR]\n"), progname);
 	printf(_("  %s reconnect -Z STARTUP_MODE [-D DATADIR] -o \"OPTIONS\"]\n"), progname);
+	printf(_("  %s stats   -Z STARTUP_MODE [-D DATADIR] [-o \"OPTIONS\"]\n"), progname);
 
 	printf(_("\nCommon options:\n"));
 	printf(_("  -D DATADIR             location of the database storage area\n"));
@@ -1161,6 +1234,8 @@ main(int argc, char **argv)
 				ctl_command = STATUS_COMMAND;
 			else if (strcmp(argv[optind], "reconnect") == 0)
 				ctl_command = RECONNECT_COMMAND;
+			else if (strcmp(argv[optind], "stats") == 0)
+				ctl_command = STATS_COMMAND;
 			else
 			{
 				write_stderr(_("%s: unrecognized operation mode \"%s\"\n"),
@@ -1294,6 +1369,9 @@ main(int argc, char **argv)
 		case RECONNECT_COMMAND:
 			do_reconnect();
 			break;
+		case STATS_COMMAND:
+			do_stats();
+			break;
 		default:
 			break;
 	}
@@ -90,6 +90,7 @@
 #include "gtm/ip.h"
 #include "gtm/libpq.h"
 #include "gtm/libpq-be.h"
+#include "gtm/gtm_shmq.h"
 #include "gtm/elog.h"
 
 #define MAXGTMPATH	256
@@ -109,6 +110,8 @@ extern int         tcp_keepalives_count;
 /* Internal functions */
 static int	internal_putbytes(Port *myport, const char *s, size_t len);
 static int	internal_flush(Port *myport);
+static int	internal_flush_shm(Port *myport);
+static int	pq_recvshm(Port *myport, char *buf, int len);
 
 /*
  * Streams -- wrapper around Unix socket system calls
@@ -504,7 +507,11 @@ pq_recvbuf(Port *myport)
 	{
 		int			r;
 
-		r = recv(myport->sock, myport->PqRecvBuffer + myport->PqRecvLength,
+		if (myport->shm_slot)
+			r = pq_recvshm(myport, myport->PqRecvBuffer + myport->PqRecvLength,
+						   PQ_BUFFER_SIZE - myport->PqRecvLength);
+		else
+			r = recv(myport->sock, myport->PqRecvBuffer + myport->PqRecvLength,
 						PQ_BUFFER_SIZE - myport->PqRecvLength, 0);
 		myport->last_call = GTM_LastCall_RECV;
 
@@ -540,6 +547,53 @@ pq_recvbuf(Port *myport)
 	}
 }
 
+/* --------------------------------
+ *		pq_recvshm - read from the shared memory slot of the connection
+ *
+ *		Waits for data like recv() on a blocking socket, and returns 0
+ *		once the client closed its socket.
+ * --------------------------------
+ */
+static int
+pq_recvshm(Port *myport, char *buf, int len)
+{
+	GTM_ShmqRing *ring = &myport->shm_slot->sl_request;
+	int			r;
+
+	while ((r = GTM_ShmqRead(ring, buf, len)) == 0)
+	{
+		if (!GTM_ShmqWait(ring, GTM_SHMQ_CHECK_MS) && pq_peerclosed(myport))
+			return 0;
+	}
+	return r;
+}
+
+/* --------------------------------
+ *		pq_peerclosed - check the socket of a shared memory connection
+ *
+ *		The client only writes to the socket to wake us up.  Consume those
+ *		bytes, and return true if the client closed the connection.
+ * --------------------------------
+ */
+bool
+pq_peerclosed(Port *myport)
+{
+	char		buf[64];
+
+	for (;;)
+	{
+		int			r = recv(myport->sock, buf, sizeof (buf), MSG_DONTWAIT);
+
+		if (r > 0)
+			continue;
+		if (r == 0)
+			return true;
+		if (errno == EINTR)
+			continue;
+		return !(errno == EAGAIN || errno == EWOULDBLOCK);
+	}
+}
+
 /* --------------------------------
  *		pq_getbyte	- get a single byte from connection, or return EOF
  * --------------------------------
@@ -816,6 +870,9 @@ internal_flush(Port *myport)
 	char	   *bufptr = myport->PqSendBuffer;
 	char	   *bufend = myport->PqSendBuffer + myport->PqSendPointer;
 
+	if (myport->shm_slot)
+		return internal_flush_shm(myport);
+
 	while (bufptr < bufend)
 	{
 		int			r;
@@ -864,6 +921,40 @@ internal_flush(Port *myport)
 	return 0;
 }
 
+/*
+ * internal_flush for a connection switched to a shared memory slot.  The
+ * client reads the response ring as we go, so a response larger than the
+ * ring is written as the client makes room.
+ */
+static int
+internal_flush_shm(Port *myport)
+{
+	GTM_ShmqRing *ring = &myport->shm_slot->sl_response;
+	char	   *bufptr = myport->PqSendBuffer;
+	char	   *bufend = myport->PqSendBuffer + myport->PqSendPointer;
+
+	while (bufptr < bufend)
+	{
+		bufptr += GTM_ShmqWrite(ring, bufptr, bufend - bufptr);
+		GTM_ShmqWakeup(ring);
+
+		if (bufptr < bufend &&
+			!GTM_ShmqWaitSpace(ring, GTM_SHMQ_CHECK_MS) &&
+			pq_peerclosed(myport))
+		{
+			ereport(COMMERROR,
+					(EPIPE,
+					 errmsg("could not send data to client: connection closed")));
+			myport->PqSendPointer = 0;
+			return EOF;
+		}
+	}
+
+	myport->last_errno = 0;
+	myport->PqSendPointer = 0;
+	return 0;
+}
+
 
 /* --------------------------------
  * Message-level I/O routines begin here.
@@ -1,4 +1,8 @@
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "gtm/gtm_c.h"
+#include "gtm/gtm.h"
 #include "gtm/gtm_lock.h"
 #include "gtm/gtm_txn.h"
 #include "gtm/gtm_seq.h"
@@ -9,32 +13,366 @@ GTM_RWLock gtm_bkup_lock;
 bool gtm_need_bkup;
 
 extern char GTMControlFile[];
+extern char GTMControlFileTmp[];
+extern char GTMWalFile[];
+extern char GTMWalFileTmp[];
+extern GTM_MutexLock control_lock;
+extern char *GTMDataDir;
 
+/*
+ * GTM write-ahead log
+ *
+ * The control file is a checkpoint of the GTM state.  Every change made to
+ * that state afterwards is appended to the log as a one-line record before
+ * it becomes visible to clients:
+ *
+ *	X <gxid>		gxids are reserved up to gxid
+ *	S <sequence>	sequence created or changed, values reserved up to the
+ *					stored one; same fields as a control file line
+ *	D <key>			sequence dropped
+ *	B <key>			all the sequences of a database dropped
+ *
+ * Gxids and sequence values are reserved RestoreDuration at a time, so only
+ * a fraction of the calls write a record.  Once the log grows beyond
+ * GTM_WAL_CHECKPOINT_SIZE a new checkpoint is written at the end of the
+ * current command and the records it covers are cut off the log.
+ *
+ * At startup the control file is loaded and the log is replayed on top of
+ * it.  Replaying a record the control file already covers is harmless, as
+ * the latest record of each object wins.
+ */
+#define GTM_WAL_CHECKPOINT_SIZE		(1024 * 1024)
+#define GTM_WAL_RECORD_SIZE			2048
 
+static GTM_MutexLock gtm_wal_lock;
+static int	gtm_wal_fd = -1;
+static off_t gtm_wal_size;
 
-void GTM_WriteRestorePoint(void)
+static void GTM_CutWal(off_t redo);
+static int GTM_FsyncDataDir(void);
+
+void
+GTM_InitWal(void)
 {
-	FILE *f = fopen(GTMControlFile, "w");
+	GTM_MutexLockInit(&gtm_wal_lock);
+}
 
-	if (f == NULL)
+/*
+ * Open the log for appending. Nothing is logged before this is called, so
+ * restoring or replaying the GTM state does not write records.
+ */
+void
+GTM_OpenWal(void)
+{
+	GTM_MutexLockAcquire(&gtm_wal_lock);
+
+	gtm_wal_fd = open(GTMWalFile, O_RDWR | O_APPEND | O_CREAT, 0600);
+	if (gtm_wal_fd < 0 || GTM_FsyncDataDir() != 0)
+	{
+		GTM_MutexLockRelease(&gtm_wal_lock);
+		ereport(FATAL, (errno,
+						errmsg("Cannot open GTM log file %s", GTMWalFile),
+						errhint("%s", strerror(errno))));
+	}
+	gtm_wal_size = lseek(gtm_wal_fd, 0, SEEK_END);
+
+	GTM_MutexLockRelease(&gtm_wal_lock);
+}
+
+/*
+ * Append a record to the log and make it durable.
+ *
+ * Returns false if the record could not be written, in which case the
+ * change it describes must not be handed out.
+ */
+bool
+GTM_WalAppend(const char *record)
+{
+	size_t		len = strlen(record);
+
+	GTM_MutexLockAcquire(&gtm_wal_lock);
+
+	if (gtm_wal_fd < 0)
+	{
+		GTM_MutexLockRelease(&gtm_wal_lock);
+		return true;
+	}
+
+	if (write(gtm_wal_fd, record, len) != len ||
+		fdatasync(gtm_wal_fd) != 0)
+	{
+		ereport(LOG, (errno,
+					  errmsg("Cannot write to GTM log file %s", GTMWalFile),
+					  errhint("%s", strerror(errno))));
+		/* Do not leave a partial record behind */
+		if (ftruncate(gtm_wal_fd, gtm_wal_size) != 0)
+			elog(LOG, "Cannot truncate GTM log file %s", GTMWalFile);
+		GTM_MutexLockRelease(&gtm_wal_lock);
+		return false;
+	}
+
+	gtm_wal_size += len;
+	if (gtm_wal_size > GTM_WAL_CHECKPOINT_SIZE)
+		GTM_SetNeedBackup();
+
+	GTM_MutexLockRelease(&gtm_wal_lock);
+	return true;
+}
+
+/*
+ * Replay the log on top of the state restored from the control file.
+ */
+void
+GTM_ReplayWal(void)
+{
+	FILE	   *f;
+	char		record[GTM_WAL_RECORD_SIZE];
+	int			count = 0;
+
+	if ((f = fopen(GTMWalFile, "r")) == NULL)
+		return;
+
+	while (fgets(record, sizeof (record), f) != NULL)
+	{
+		GlobalTransactionId gxid;
+		size_t		len = strlen(record);
+
+		/* A record without newline was not completely written */
+		if (len == 0 || record[len - 1] != '\n')
+		{
+			elog(LOG, "Ignoring incomplete record at the end of GTM log");
+			break;
+		}
+		record[len - 1] = '\0';
+
+		switch (record[0])
+		{
+			case 'X':
+				if (sscanf(record + 1, "%u", &gxid) != 1)
+				{
+					elog(WARNING, "Corrupted GTM log record \"%s\"", record);
+					goto done;
+				}
+				GTM_ReplayRestorePointXid(gxid);
+				break;
+
+			case 'S':
+			case 'D':
+			case 'B':
+				if (!GTM_ReplaySeqInfo(record))
+				{
+					elog(WARNING, "Corrupted GTM log record \"%s\"", record);
+					goto done;
+				}
+				break;
+
+			default:
+				elog(WARNING, "Corrupted GTM log record \"%s\"", record);
+				goto done;
+		}
+		count++;
+	}
+
+done:
+	fclose(f);
+	elog(LOG, "Replayed %d record(s) from GTM log", count);
+}
+
+/*
+ * Write a checkpoint: a new control file covering every record logged so
+ * far, then cut those records off the log.
+ *
+ * With isBackup the reserved gxid and sequence values are saved, which stay
+ * valid while the GTM keeps running.  Otherwise the current values are
+ * saved, that is only safe once no more gxids are handed out, at shutdown.
+ */
+void
+GTM_WriteCheckpoint(bool isBackup)
+{
+	FILE	   *ctlf;
+	off_t		redo;
+
+	GTM_MutexLockAcquire(&control_lock);
+
+	/*
+	 * Changes are logged before they are made visible, so the state saved
+	 * below includes at least everything logged up to here.
+	 */
+	GTM_MutexLockAcquire(&gtm_wal_lock);
+	redo = gtm_wal_size;
+	GTM_MutexLockRelease(&gtm_wal_lock);
+
+	ctlf = fopen(GTMControlFileTmp, "w");
+	if (ctlf == NULL)
 	{
 		ereport(LOG, (errno,
 					  errmsg("Cannot open control file"),
 					  errhint("%s", strerror(errno))));
+		GTM_MutexLockRelease(&control_lock);
+		return;
+	}
+
+	if (isBackup)
+	{
+		GTM_WriteRestorePointXid(ctlf);
+		GTM_WriteRestorePointSeq(ctlf);
+	}
+	else
+	{
+		GTM_SaveTxnInfo(ctlf);
+		GTM_SaveSeqInfo(ctlf);
+	}
+
+	if (fflush(ctlf) != 0 || fsync(fileno(ctlf)) != 0)
+	{
+		ereport(LOG, (errno,
+					  errmsg("Cannot write control file"),
+					  errhint("%s", strerror(errno))));
+		fclose(ctlf);
+		GTM_MutexLockRelease(&control_lock);
+		return;
+	}
+	fclose(ctlf);
+
+	if (rename(GTMControlFileTmp, GTMControlFile) != 0)
+	{
+		ereport(LOG, (errno,
+					  errmsg("Cannot rename control file"),
+					  errhint("%s", strerror(errno))));
+		GTM_MutexLockRelease(&control_lock);
+		return;
+	}
+
+	/* The log must not be cut before the new control file is durable */
+	if (GTM_FsyncDataDir() != 0)
+	{
+		ereport(LOG, (errno,
+					  errmsg("Cannot sync GTM data directory %s", GTMDataDir),
+					  errhint("%s", strerror(errno))));
+		GTM_MutexLockRelease(&control_lock);
+		return;
+	}
+
+	GTM_CutWal(redo);
+
+	GTM_MutexLockRelease(&control_lock);
+}
+
+/*
+ * Remove the first redo bytes of the log, which the control file now
+ * covers.  Records appended while the checkpoint was being written are
+ * copied to a new log file that replaces the current one.
+ */
+static void
+GTM_CutWal(off_t redo)
+{
+	char	   *tail = NULL;
+	off_t		tail_size;
+	int			fd;
+
+	GTM_MutexLockAcquire(&gtm_wal_lock);
+
+	if (gtm_wal_fd < 0)
+	{
+		GTM_MutexLockRelease(&gtm_wal_lock);
+		return;
+	}
+
+	tail_size = gtm_wal_size - redo;
+	if (tail_size == 0)
+	{
+		if (ftruncate(gtm_wal_fd, 0) != 0 || fsync(gtm_wal_fd) != 0)
+			ereport(LOG, (errno,
+						  errmsg("Cannot truncate GTM log file %s", GTMWalFile),
+						  errhint("%s", strerror(errno))));
+		else
+			gtm_wal_size = 0;
+		GTM_MutexLockRelease(&gtm_wal_lock);
 		return;
 	}
+
+	tail = (char *) palloc(tail_size);
+	if (pread(gtm_wal_fd, tail, tail_size, redo) != tail_size)
+		goto cut_failed;
+
+	fd = open(GTMWalFileTmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		goto cut_failed;
+	if (write(fd, tail, tail_size) != tail_size || fsync(fd) != 0)
+	{
+		close(fd);
+		goto cut_failed;
+	}
+	close(fd);
+
+	if (rename(GTMWalFileTmp, GTMWalFile) != 0)
+		goto cut_failed;
+
+	/*
+	 * The old log is gone, records appended from now on are only durable
+	 * once the new one is.
+	 */
+	close(gtm_wal_fd);
+	gtm_wal_fd = open(GTMWalFile, O_RDWR | O_APPEND, 0600);
+	if (gtm_wal_fd < 0 || GTM_FsyncDataDir() != 0)
+	{
+		GTM_MutexLockRelease(&gtm_wal_lock);
+		ereport(FATAL, (errno,
+						errmsg("Cannot open GTM log file %s", GTMWalFile),
+						errhint("%s", strerror(errno))));
+	}
+	gtm_wal_size = tail_size;
+
+	pfree(tail);
+	GTM_MutexLockRelease(&gtm_wal_lock);
+	return;
+
+cut_failed:
+	/* Keeping the whole log is safe, it is only longer to replay */
+	ereport(LOG, (errno,
+				  errmsg("Cannot cut GTM log file %s", GTMWalFile),
+				  errhint("%s", strerror(errno))));
+	pfree(tail);
+	GTM_MutexLockRelease(&gtm_wal_lock);
+}
+
+/*
+ * Make the renames and creations of files in the data directory durable.
+ * Returns 0 on success, -1 with errno set otherwise.
+ */
+static int
+GTM_FsyncDataDir(void)
+{
+	int			fd;
+	int			save_errno;
+
+	fd = open(GTMDataDir, O_RDONLY, 0);
+	if (fd < 0)
+		return -1;
+	if (fsync(fd) != 0)
+	{
+		save_errno = errno;
+		close(fd);
+		errno = save_errno;
+		return -1;
+	}
+	return close(fd);
+}
+
+/*
+ * Write a checkpoint if the log has grown enough since the last one.
+ */
+void GTM_WriteRestorePoint(void)
+{
 	GTM_RWLockAcquire(&gtm_bkup_lock, GTM_LOCKMODE_WRITE);
 	if (!gtm_need_bkup)
 	{
 		GTM_RWLockRelease(&gtm_bkup_lock);
-		fclose(f);
 		return;
 	}
 	gtm_need_bkup = FALSE;
 	GTM_RWLockRelease(&gtm_bkup_lock);
-	GTM_WriteRestorePointXid(f);
-	GTM_WriteRestorePointSeq(f);
-	fclose(f);
+	GTM_WriteCheckpoint(true);
 }
 
 void GTM_WriteBarrierBackup(char *barrier_id)
@@ -53,14 +391,11 @@ void GTM_WriteBarrierBackup(char *barrier_id)
 					  errhint("%s", strerror(errno))));
 		return;
 	}
-	GTM_RWLockAcquire(&gtm_bkup_lock, GTM_LOCKMODE_WRITE);
-	gtm_need_bkup = FALSE;
-	GTM_RWLockRelease(&gtm_bkup_lock);
 	GTM_WriteRestorePointXid(f);
 	GTM_WriteRestorePointSeq(f);
 	fclose(f);
 }
-	
+
 
 void GTM_MakeBackup(char *path)
 {
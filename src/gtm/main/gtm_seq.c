@@ -26,6 +26,7 @@
 #include "gtm/gtm_client.h"
 #include "gtm/gtm_seq.h"
 #include "gtm/gtm_serialize.h"
+#include "gtm/gtm_stat.h"
 #include "gtm/gtm_standby.h"
 #include "gtm/standby_utils.h"
 #include "gtm/libpq.h"
@@ -35,16 +36,49 @@
 
 extern bool Backup_synchronously;
 
+/*
+ * Sequences are kept in a hash table of buckets, each one a list with its
+ * own lock.  The bucket array doubles once there are more than
+ * SEQ_HASH_MAX_LOAD sequences per bucket on average.  Resizing holds
+ * sht_lock exclusively, every other access to the table holds it shared.
+ *
+ * A second table of fixed size indexes the sequences by database, so that
+ * dropping a database does not scan every sequence.  It is hashed on the key
+ * up to the first dot, which is the same for a database key and for the keys
+ * of all the sequences of that database.
+ *
+ * Locks are taken in this order: sht_lock, database bucket, sequence bucket,
+ * sequence.
+ */
 typedef struct GTM_SeqInfoHashBucket
 {
 	gtm_List   *shb_list;
 	GTM_RWLock	shb_lock;
 } GTM_SeqInfoHashBucket;
 
-#define SEQ_HASH_TABLE_SIZE		1024
-static GTM_SeqInfoHashBucket GTMSequences[SEQ_HASH_TABLE_SIZE];
+typedef struct GTM_SeqInfoHashTable
+{
+	GTM_RWLock	sht_lock;
+	uint32		sht_size;			/* number of buckets, a power of 2 */
+	GTM_SeqInfoHashBucket *sht_buckets;
+
+	GTM_MutexLock sht_count_lock;
+	uint32		sht_count;			/* number of sequences */
+} GTM_SeqInfoHashTable;
+
+#define SEQ_HASH_TABLE_INIT_SIZE	1024
+#define SEQ_HASH_MAX_LOAD			2
+#define SEQ_DB_HASH_TABLE_SIZE		256
 
+static GTM_SeqInfoHashTable GTMSequences;
+static GTM_SeqInfoHashBucket GTMSequencesByDB[SEQ_DB_HASH_TABLE_SIZE];
+
+static uint32 seq_hash_bytes(const char *key, int keylen);
 static uint32 seq_gethash(GTM_SequenceKey key);
+static uint32 seq_getdbhash(GTM_SequenceKey key);
+static GTM_SeqInfoHashBucket *seq_get_bucket(uint32 hash);
+static void seq_update_count(int delta);
+static void seq_grow_table(void);
 static bool seq_keys_equal(GTM_SequenceKey key1, GTM_SequenceKey key2);
 static bool seq_key_dbname_equal(GTM_SequenceKey nsp, GTM_SequenceKey seq);
 static GTM_SeqInfo *seq_find_seqinfo(GTM_SequenceKey seqkey);
@@ -53,24 +87,189 @@ static int seq_add_seqinfo(GTM_SeqInfo *seqinfo);
 static int seq_remove_seqinfo(GTM_SeqInfo *seqinfo);
 static GTM_SequenceKey seq_copy_key(GTM_SequenceKey key);
 static int seq_drop_with_dbkey(GTM_SequenceKey nsp);
-static bool GTM_NeedSeqRestoreUpdateInternal(GTM_SeqInfo *seqinfo);
+static bool GTM_NeedSeqRestoreUpdateInternal(GTM_SeqInfo *seqinfo,
+											 GTM_Sequence oldval, bool called);
+static void advance_gs_value(GTM_SeqInfo *seqinfo);
+static int seq_log_seqinfo(GTM_SeqInfo *seqinfo);
+static int seq_log_drop(GTM_SequenceKey seqkey);
 
 static GTM_Sequence get_rangemax(GTM_SeqInfo *seqinfo, GTM_Sequence range);
+static int seq_get_next(GTM_SequenceKey seqkey, char *coord_name,
+						int coord_procid, GTM_Sequence range,
+						GTM_Sequence *result, GTM_Sequence *rangemax,
+						GTM_Sequence *increment);
+#ifdef HAVE_GCC__SYNC_INT64_CAS
+static bool seq_getnext_fast(GTM_SequenceKey seqkey, char *coord_name,
+							 int coord_procid, GTM_Sequence range,
+							 GTM_Sequence *result, GTM_Sequence *rangemax,
+							 GTM_Sequence *increment);
+#endif
+
+#define seq_rotl32(x, r)	(((x) << (r)) | ((x) >> (32 - (r))))
+
+/*
+ * MurmurHash3 (x86, 32 bits) of the given bytes
+ */
+static uint32
+seq_hash_bytes(const char *key, int keylen)
+{
+	const unsigned char *data = (const unsigned char *) key;
+	int			nblocks = keylen / 4;
+	uint32		h = 0;
+	uint32		k;
+	int			ii;
+
+	for (ii = 0; ii < nblocks; ii++)
+	{
+		memcpy(&k, data + ii * 4, sizeof (k));
+		k *= 0xcc9e2d51;
+		k = seq_rotl32(k, 15);
+		k *= 0x1b873593;
+
+		h ^= k;
+		h = seq_rotl32(h, 13);
+		h = h * 5 + 0xe6546b64;
+	}
+
+	k = 0;
+	switch (keylen & 3)
+	{
+		case 3:
+			k ^= data[nblocks * 4 + 2] << 16;
+			/* fall through */
+		case 2:
+			k ^= data[nblocks * 4 + 1] << 8;
+			/* fall through */
+		case 1:
+			k ^= data[nblocks * 4];
+			k *= 0xcc9e2d51;
+			k = seq_rotl32(k, 15);
+			k *= 0x1b873593;
+			h ^= k;
+	}
+
+	h ^= keylen;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	return h;
+}
 
 /*
  * Get the hash value given the sequence key
- *
- * XXX This should probably be replaced by a better hash function.
  */
 static uint32
 seq_gethash(GTM_SequenceKey key)
 {
-	uint32 total = 0;
-	int ii;
+	return seq_hash_bytes(key->gsk_key, key->gsk_keylen);
+}
+
+/*
+ * Get the bucket of the database index for the given key, sequence or
+ * database one.
+ */
+static uint32
+seq_getdbhash(GTM_SequenceKey key)
+{
+	int			len;
+
+	for (len = 0; len < key->gsk_keylen; len++)
+		if (key->gsk_key[len] == '.' || key->gsk_key[len] == '\0')
+			break;
+
+	return seq_hash_bytes(key->gsk_key, len) % SEQ_DB_HASH_TABLE_SIZE;
+}
+
+/*
+ * Get the bucket for the given hash value. sht_lock must be held.
+ */
+static GTM_SeqInfoHashBucket *
+seq_get_bucket(uint32 hash)
+{
+	return &GTMSequences.sht_buckets[hash & (GTMSequences.sht_size - 1)];
+}
+
+/*
+ * Account for added or removed sequences, and grow the table if it is now
+ * too loaded.  Must be called without holding any lock of the table.
+ */
+static void
+seq_update_count(int delta)
+{
+	bool		grow;
+
+	GTM_MutexLockAcquire(&GTMSequences.sht_count_lock);
+	GTMSequences.sht_count += delta;
+	grow = GTMSequences.sht_count > GTMSequences.sht_size * SEQ_HASH_MAX_LOAD;
+	GTM_MutexLockRelease(&GTMSequences.sht_count_lock);
+
+	if (grow)
+		seq_grow_table();
+}
 
-	for (ii = 0; ii < key->gsk_keylen; ii++)
-		total += key->gsk_key[ii];
-	return (total % SEQ_HASH_TABLE_SIZE);
+/*
+ * Double the number of buckets of the sequence table
+ */
+static void
+seq_grow_table(void)
+{
+	MemoryContext oldContext;
+	GTM_SeqInfoHashBucket *buckets;
+	uint32		size;
+	uint32		ii;
+
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_WRITE);
+
+	/* Another thread may have grown it meanwhile */
+	GTM_MutexLockAcquire(&GTMSequences.sht_count_lock);
+	if (GTMSequences.sht_count <= GTMSequences.sht_size * SEQ_HASH_MAX_LOAD)
+	{
+		GTM_MutexLockRelease(&GTMSequences.sht_count_lock);
+		GTM_RWLockRelease(&GTMSequences.sht_lock);
+		return;
+	}
+	GTM_MutexLockRelease(&GTMSequences.sht_count_lock);
+
+	/* The table outlives any thread */
+	oldContext = MemoryContextSwitchTo(TopMostMemoryContext);
+
+	size = GTMSequences.sht_size * 2;
+	buckets = (GTM_SeqInfoHashBucket *) palloc(size * sizeof (GTM_SeqInfoHashBucket));
+	for (ii = 0; ii < size; ii++)
+	{
+		buckets[ii].shb_list = gtm_NIL;
+		GTM_RWLockInit(&buckets[ii].shb_lock);
+	}
+
+	for (ii = 0; ii < GTMSequences.sht_size; ii++)
+	{
+		GTM_SeqInfoHashBucket *bucket = &GTMSequences.sht_buckets[ii];
+		gtm_ListCell *elem;
+
+		gtm_foreach(elem, bucket->shb_list)
+		{
+			GTM_SeqInfo *seqinfo = (GTM_SeqInfo *) gtm_lfirst(elem);
+			GTM_SeqInfoHashBucket *newbucket;
+
+			newbucket = &buckets[seq_gethash(seqinfo->gs_key) & (size - 1)];
+			newbucket->shb_list = gtm_lappend(newbucket->shb_list, seqinfo);
+		}
+		gtm_list_free(bucket->shb_list);
+		GTM_RWLockDestroy(&bucket->shb_lock);
+	}
+	pfree(GTMSequences.sht_buckets);
+
+	GTMSequences.sht_buckets = buckets;
+	GTMSequences.sht_size = size;
+
+	MemoryContextSwitchTo(oldContext);
+
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
+
+	elog(DEBUG1, "Sequence hash table grown to %u buckets", size);
 }
 
 /*
@@ -101,7 +300,8 @@ seq_find_seqinfo(GTM_SequenceKey seqkey)
 	gtm_ListCell *elem;
 	GTM_SeqInfo *curr_seqinfo = NULL;
 
-	bucket = &GTMSequences[hash];
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_READ);
+	bucket = seq_get_bucket(hash);
 
 	GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
 
@@ -120,13 +320,17 @@ seq_find_seqinfo(GTM_SequenceKey seqkey)
 		{
 			elog(LOG, "Sequence not active");
 			GTM_RWLockRelease(&curr_seqinfo->gs_lock);
-			return NULL;
+			curr_seqinfo = NULL;
+		}
+		else
+		{
+			Assert(curr_seqinfo->gs_ref_count != SEQ_MAX_REFCOUNT);
+			curr_seqinfo->gs_ref_count++;
+			GTM_RWLockRelease(&curr_seqinfo->gs_lock);
 		}
-		Assert(curr_seqinfo->gs_ref_count != SEQ_MAX_REFCOUNT);
-		curr_seqinfo->gs_ref_count++;
-		GTM_RWLockRelease(&curr_seqinfo->gs_lock);
 	}
 	GTM_RWLockRelease(&bucket->shb_lock);
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
 
 	return curr_seqinfo;
 }
@@ -164,9 +368,11 @@ seq_add_seqinfo(GTM_SeqInfo *seqinfo)
 {
 	uint32 hash = seq_gethash(seqinfo->gs_key);
 	GTM_SeqInfoHashBucket	*bucket;
+	GTM_SeqInfoHashBucket	*dbbucket;
 	gtm_ListCell *elem;
 
-	bucket = &GTMSequences[hash];
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_READ);
+	bucket = seq_get_bucket(hash);
 
 	GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_WRITE);
 
@@ -178,6 +384,7 @@ seq_add_seqinfo(GTM_SeqInfo *seqinfo)
 		if (seq_keys_equal(curr_seqinfo->gs_key, seqinfo->gs_key))
 		{
 			GTM_RWLockRelease(&bucket->shb_lock);
+			GTM_RWLockRelease(&GTMSequences.sht_lock);
 			ereport(LOG,
 					(EEXIST,
 					 errmsg("Sequence with the given key already exists")));
@@ -191,6 +398,15 @@ seq_add_seqinfo(GTM_SeqInfo *seqinfo)
 	bucket->shb_list = gtm_lappend(bucket->shb_list, seqinfo);
 	GTM_RWLockRelease(&bucket->shb_lock);
 
+	dbbucket = &GTMSequencesByDB[seq_getdbhash(seqinfo->gs_key)];
+	GTM_RWLockAcquire(&dbbucket->shb_lock, GTM_LOCKMODE_WRITE);
+	dbbucket->shb_list = gtm_lappend(dbbucket->shb_list, seqinfo);
+	GTM_RWLockRelease(&dbbucket->shb_lock);
+
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
+
+	seq_update_count(1);
+
 	return 0;
 }
 
@@ -204,8 +420,10 @@ seq_remove_seqinfo(GTM_SeqInfo *seqinfo)
 {
 	uint32 hash = seq_gethash(seqinfo->gs_key);
 	GTM_SeqInfoHashBucket	*bucket;
+	GTM_SeqInfoHashBucket	*dbbucket;
 
-	bucket = &GTMSequences[hash];
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_READ);
+	bucket = seq_get_bucket(hash);
 
 	GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_WRITE);
 	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
@@ -215,6 +433,7 @@ seq_remove_seqinfo(GTM_SeqInfo *seqinfo)
 		seqinfo->gs_state = SEQ_STATE_DELETED;
 		GTM_RWLockRelease(&seqinfo->gs_lock);
 		GTM_RWLockRelease(&bucket->shb_lock);
+		GTM_RWLockRelease(&GTMSequences.sht_lock);
 		return EBUSY;
 	}
 
@@ -222,6 +441,15 @@ seq_remove_seqinfo(GTM_SeqInfo *seqinfo)
 	GTM_RWLockRelease(&seqinfo->gs_lock);
 	GTM_RWLockRelease(&bucket->shb_lock);
 
+	dbbucket = &GTMSequencesByDB[seq_getdbhash(seqinfo->gs_key)];
+	GTM_RWLockAcquire(&dbbucket->shb_lock, GTM_LOCKMODE_WRITE);
+	dbbucket->shb_list = gtm_list_delete(dbbucket->shb_list, seqinfo);
+	GTM_RWLockRelease(&dbbucket->shb_lock);
+
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
+
+	seq_update_count(-1);
+
 	return 0;
 }
 
@@ -268,6 +496,7 @@ GTM_SeqOpen(GTM_SequenceKey seqkey,
 		ereport(ERROR, (ENOMEM, errmsg("Out of memory")));
 
 	GTM_RWLockInit(&seqinfo->gs_lock);
+	seqinfo->gs_lock.lk_wait_stat = &GTMStatLocks[GTM_STAT_LOCK_SEQUENCE];
 
 	seqinfo->gs_ref_count = 0;
 	seqinfo->gs_key = seq_copy_key(seqkey);
@@ -351,8 +580,12 @@ GTM_SeqOpen(GTM_SequenceKey seqkey,
 		GTM_RWLockDestroy(&seqinfo->gs_lock);
 		pfree(seqinfo->gs_key);
 		pfree(seqinfo);
+		return errcode;
 	}
-	GTM_SetNeedBackup();
+
+	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_READ);
+	errcode = seq_log_seqinfo(seqinfo);
+	GTM_RWLockRelease(&seqinfo->gs_lock);
 
 	return errcode;
 }
@@ -370,6 +603,7 @@ int GTM_SeqAlter(GTM_SequenceKey seqkey,
 				 bool is_restart)
 {
 	GTM_SeqInfo *seqinfo = seq_find_seqinfo(seqkey);
+	int errcode;
 
 	if (seqinfo == NULL)
 	{
@@ -405,10 +639,14 @@ int GTM_SeqAlter(GTM_SequenceKey seqkey,
 	if (seqinfo->gs_init_value != startval)
 		seqinfo->gs_init_value = startval;
 
+	/* Values are reserved again from the current one on the next call */
+	seqinfo->gs_backedUpValue = seqinfo->gs_value;
+	errcode = seq_log_seqinfo(seqinfo);
+
 	/* Remove the old key with the old name */
 	GTM_RWLockRelease(&seqinfo->gs_lock);
 	seq_release_seqinfo(seqinfo);
-	return 0;
+	return errcode;
 }
 
 /*
@@ -433,6 +671,7 @@ GTM_SeqRestore(GTM_SequenceKey seqkey,
 		ereport(ERROR, (ENOMEM, errmsg("Out of memory")));
 
 	GTM_RWLockInit(&seqinfo->gs_lock);
+	seqinfo->gs_lock.lk_wait_stat = &GTMStatLocks[GTM_STAT_LOCK_SEQUENCE];
 
 	seqinfo->gs_ref_count = 0;
 	seqinfo->gs_key = seq_copy_key(seqkey);
@@ -482,7 +721,7 @@ GTM_SeqClose(GTM_SequenceKey seqkey)
 				seq_remove_seqinfo(seqinfo);
 				pfree(seqinfo->gs_key);
 				pfree(seqinfo);
-				res = 0;
+				res = seq_log_drop(seqkey);
 			}
 			else
 				res = EINVAL;
@@ -491,6 +730,8 @@ GTM_SeqClose(GTM_SequenceKey seqkey)
 		}
 		case GTM_SEQ_DB_NAME:
 			res = seq_drop_with_dbkey(seqkey);
+			if (res == 0)
+				res = seq_log_drop(seqkey);
 			break;
 
 		default:
@@ -532,71 +773,79 @@ seq_key_dbname_equal(GTM_SequenceKey nsp, GTM_SequenceKey seq)
 static int
 seq_drop_with_dbkey(GTM_SequenceKey nsp)
 {
-	int ii = 0;
+	GTM_SeqInfoHashBucket *dbbucket;
 	GTM_SeqInfoHashBucket *bucket;
 	gtm_ListCell *cell, *prev;
 	GTM_SeqInfo *curr_seqinfo = NULL;
 	int res = 0;
+	int ndeleted = 0;
 	bool deleted;
 
-	for(ii = 0; ii < SEQ_HASH_TABLE_SIZE; ii++)
-	{
-		bucket = &GTMSequences[ii];
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_READ);
 
-		GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
+	/* Only the sequences of this database bucket can match */
+	dbbucket = &GTMSequencesByDB[seq_getdbhash(nsp)];
+	GTM_RWLockAcquire(&dbbucket->shb_lock, GTM_LOCKMODE_WRITE);
+
+	prev = NULL;
+	cell = gtm_list_head(dbbucket->shb_list);
+	while (cell != NULL)
+	{
+		curr_seqinfo = (GTM_SeqInfo *) gtm_lfirst(cell);
+		deleted = false;
 
-		prev = NULL;
-		cell = gtm_list_head(bucket->shb_list);
-		while (cell != NULL)
+		if (seq_key_dbname_equal(nsp, curr_seqinfo->gs_key))
 		{
-			curr_seqinfo = (GTM_SeqInfo *) gtm_lfirst(cell);
-			deleted = false;
+			bucket = seq_get_bucket(seq_gethash(curr_seqinfo->gs_key));
+			GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_WRITE);
+			GTM_RWLockAcquire(&curr_seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
 
-			if (seq_key_dbname_equal(nsp, curr_seqinfo->gs_key))
+			if (curr_seqinfo->gs_ref_count > 1)
 			{
-				GTM_RWLockAcquire(&curr_seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
+				curr_seqinfo->gs_state = SEQ_STATE_DELETED;
 
-				if (curr_seqinfo->gs_ref_count > 1)
-				{
-					curr_seqinfo->gs_state = SEQ_STATE_DELETED;
-
-					/* can not happen, be checked before called */
-					elog(LOG,"Sequence %s is in use, mark for deletion only",
-							 curr_seqinfo->gs_key->gsk_key);
+				/* can not happen, be checked before called */
+				elog(LOG,"Sequence %s is in use, mark for deletion only",
+						 curr_seqinfo->gs_key->gsk_key);
 
-					/*
-					 * Continue to delete other sequences linked to this dbname,
-					 * sequences in use are deleted later.
-					 */
-					res = EBUSY;
-				}
-				else
-				{
-					/* Sequence is not is busy state, it can be deleted safely */
-
-					bucket->shb_list = gtm_list_delete_cell(bucket->shb_list, cell, prev);
-					elog(DEBUG1, "Sequence %s was deleted from GTM",
-							  curr_seqinfo->gs_key->gsk_key);
-
-					deleted = true;
-				}
-				GTM_RWLockRelease(&curr_seqinfo->gs_lock);
-			}
-			if (deleted)
-			{
-				if (prev)
-					cell = gtm_lnext(prev);
-				else
-					cell = gtm_list_head(bucket->shb_list);
+				/*
+				 * Continue to delete other sequences linked to this dbname,
+				 * sequences in use are deleted later.
+				 */
+				res = EBUSY;
 			}
 			else
 			{
-				prev = cell;
-				cell = gtm_lnext(cell);
+				/* Sequence is not is busy state, it can be deleted safely */
+
+				bucket->shb_list = gtm_list_delete(bucket->shb_list, curr_seqinfo);
+				dbbucket->shb_list = gtm_list_delete_cell(dbbucket->shb_list, cell, prev);
+				elog(DEBUG1, "Sequence %s was deleted from GTM",
+						  curr_seqinfo->gs_key->gsk_key);
+
+				deleted = true;
+				ndeleted++;
 			}
+			GTM_RWLockRelease(&curr_seqinfo->gs_lock);
+			GTM_RWLockRelease(&bucket->shb_lock);
+		}
+		if (deleted)
+		{
+			if (prev)
+				cell = gtm_lnext(prev);
+			else
+				cell = gtm_list_head(dbbucket->shb_list);
+		}
+		else
+		{
+			prev = cell;
+			cell = gtm_lnext(cell);
 		}
-		GTM_RWLockRelease(&bucket->shb_lock);
 	}
+	GTM_RWLockRelease(&dbbucket->shb_lock);
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
+
+	seq_update_count(-ndeleted);
 
 	return res;
 }
@@ -624,6 +873,7 @@ GTM_SeqRename(GTM_SequenceKey seqkey, GTM_SequenceKey newseqkey)
 
 	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
 	GTM_RWLockInit(&newseqinfo->gs_lock);
+	newseqinfo->gs_lock.lk_wait_stat = &GTMStatLocks[GTM_STAT_LOCK_SEQUENCE];
 
 	newseqinfo->gs_ref_count = 0;
 	newseqinfo->gs_key = seq_copy_key(newseqkey);
@@ -657,6 +907,14 @@ GTM_SeqRename(GTM_SequenceKey seqkey, GTM_SequenceKey newseqkey)
 		return errcode;
 	}
 
+	/* Log the new sequence, the old one is logged as dropped below */
+	if ((errcode = seq_log_seqinfo(newseqinfo)))
+	{
+		GTM_RWLockRelease(&seqinfo->gs_lock);
+		seq_release_seqinfo(seqinfo);
+		return errcode;
+	}
+
 	/* Remove the old key with the old name */
 	GTM_RWLockRelease(&seqinfo->gs_lock);
 	/* Release first the structure as it has been taken previously */
@@ -788,6 +1046,7 @@ GTM_SeqSetVal(GTM_SequenceKey seqkey, char *coord_name,
 			  int coord_procid, GTM_Sequence nextval, bool iscalled)
 {
 	GTM_SeqInfo *seqinfo = seq_find_seqinfo(seqkey);
+	int errcode;
 
 	if (seqinfo == NULL)
 	{
@@ -800,8 +1059,9 @@ GTM_SeqSetVal(GTM_SequenceKey seqkey, char *coord_name,
 
 	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
 
-	seqinfo->gs_value = nextval;
+	seqinfo->gs_value = seqinfo->gs_backedUpValue = nextval;
 	seqinfo->gs_called = iscalled;
+	errcode = seq_log_seqinfo(seqinfo);
 
 	/* If sequence is not called, update last value for the session */
 	if (!iscalled)
@@ -811,7 +1071,7 @@ GTM_SeqSetVal(GTM_SequenceKey seqkey, char *coord_name,
 	GTM_RWLockRelease(&seqinfo->gs_lock);
 	seq_release_seqinfo(seqinfo);
 
-	return 0;
+	return errcode;
 }
 
 /*
@@ -822,8 +1082,32 @@ GTM_SeqGetNext(GTM_SequenceKey seqkey, char *coord_name,
 			   int coord_procid, GTM_Sequence range,
 			   GTM_Sequence *result, GTM_Sequence *rangemax)
 {
-	GTM_SeqInfo *seqinfo = seq_find_seqinfo(seqkey);
+	return seq_get_next(seqkey, coord_name, coord_procid, range,
+						result, rangemax, NULL);
+}
+
+/*
+ * Workhorse of GTM_SeqGetNext.  If increment is not NULL, it receives the
+ * increment the range was computed with, so that the caller can split it.
+ */
+static int
+seq_get_next(GTM_SequenceKey seqkey, char *coord_name,
+			 int coord_procid, GTM_Sequence range,
+			 GTM_Sequence *result, GTM_Sequence *rangemax,
+			 GTM_Sequence *increment)
+{
+	GTM_SeqInfo *seqinfo;
+	GTM_Sequence oldval;
+	GTM_Sequence oldBackedUpValue;
+	bool		called;
+
+#ifdef HAVE_GCC__SYNC_INT64_CAS
+	if (seq_getnext_fast(seqkey, coord_name, coord_procid, range,
+						 result, rangemax, increment))
+		return 0;
+#endif
 
+	seqinfo = seq_find_seqinfo(seqkey);
 	if (seqinfo == NULL)
 	{
 		ereport(LOG,
@@ -834,6 +1118,10 @@ GTM_SeqGetNext(GTM_SequenceKey seqkey, char *coord_name,
 
 	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
 
+	oldval = seqinfo->gs_value;
+	oldBackedUpValue = seqinfo->gs_backedUpValue;
+	called = seqinfo->gs_called;
+
 	/*
 	 * If the sequence is called for the first time return the current value.
 	 * It should be already initialized.
@@ -855,7 +1143,7 @@ GTM_SeqGetNext(GTM_SequenceKey seqkey, char *coord_name,
 			if (seqinfo->gs_max_value - seqinfo->gs_increment_by
 					>= seqinfo->gs_value)
 			{
-				int newval = seqinfo->gs_value + seqinfo->gs_increment_by;
+				GTM_Sequence newval = seqinfo->gs_value + seqinfo->gs_increment_by;
 				*result = seqinfo->gs_value = newval;
 			}
 			else if (SEQ_IS_CYCLE(seqinfo))
@@ -883,7 +1171,7 @@ GTM_SeqGetNext(GTM_SequenceKey seqkey, char *coord_name,
 			if (seqinfo->gs_min_value - seqinfo->gs_increment_by
 					<= seqinfo->gs_value)
 			{
-				int newval = seqinfo->gs_value + seqinfo->gs_increment_by;
+				GTM_Sequence newval = seqinfo->gs_value + seqinfo->gs_increment_by;
 				*result = seqinfo->gs_value = newval;
 			}
 			else if (SEQ_IS_CYCLE(seqinfo))
@@ -913,13 +1201,160 @@ GTM_SeqGetNext(GTM_SequenceKey seqkey, char *coord_name,
 	 * local starting seed at the caller. This will go upto the
 	 * rangemax value before contacting GTM again..
 	 */
-	seq_set_lastval(seqinfo, coord_name, coord_procid, *rangemax);
 	seqinfo->gs_value = *rangemax;
+
+	/*
+	 * Reserve the next values in the GTM log before handing out any past the
+	 * restoration point.
+	 */
+	if (GTM_NeedSeqRestoreUpdateInternal(seqinfo, oldval, called))
+	{
+		advance_gs_value(seqinfo);
+		if (seq_log_seqinfo(seqinfo))
+		{
+			seqinfo->gs_value = oldval;
+			seqinfo->gs_backedUpValue = oldBackedUpValue;
+			seqinfo->gs_called = called;
+			GTM_RWLockRelease(&seqinfo->gs_lock);
+			seq_release_seqinfo(seqinfo);
+			return EIO;
+		}
+	}
+
+	seq_set_lastval(seqinfo, coord_name, coord_procid, *rangemax);
+	if (increment)
+		*increment = seqinfo->gs_increment_by;
 	GTM_RWLockRelease(&seqinfo->gs_lock);
 	seq_release_seqinfo(seqinfo);
 	return 0;
 }
 
+#ifdef HAVE_GCC__SYNC_INT64_CAS
+/*
+ * Get next values for the sequence without taking its lock exclusively.
+ *
+ * Concurrent callers hold gs_lock in shared mode and advance gs_value with
+ * a compare-and-swap, while anything else changing the sequence holds it
+ * exclusively.  The bucket lock is kept meanwhile so the sequence cannot be
+ * removed, instead of taking a reference.
+ *
+ * This only applies when all the values are inside the bounds and below the
+ * restoration point, so that nothing needs to be logged and the sequence
+ * cannot wrap around, and when the session already has its last value
+ * entry.  Otherwise returns false and the caller takes the locked path.
+ */
+static bool
+seq_getnext_fast(GTM_SequenceKey seqkey, char *coord_name,
+				 int coord_procid, GTM_Sequence range,
+				 GTM_Sequence *result, GTM_Sequence *rangemax,
+				 GTM_Sequence *increment)
+{
+	GTM_SeqInfoHashBucket *bucket;
+	gtm_ListCell *elem;
+	GTM_SeqInfo *seqinfo = NULL;
+	GTM_SeqLastVal *lastval = NULL;
+	GTM_Sequence oldval;
+	GTM_Sequence newval;
+	GTM_Sequence limit;
+	uint64		step;
+	uint64		nvals = range > 1 ? range : 1;
+	bool		done = false;
+	int			i;
+
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_READ);
+	bucket = seq_get_bucket(seq_gethash(seqkey));
+	GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
+
+	gtm_foreach(elem, bucket->shb_list)
+	{
+		seqinfo = (GTM_SeqInfo *) gtm_lfirst(elem);
+		if (seq_keys_equal(seqinfo->gs_key, seqkey))
+			break;
+		seqinfo = NULL;
+	}
+	if (seqinfo == NULL)
+		goto out;
+
+	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_READ);
+
+	if (seqinfo->gs_state != SEQ_STATE_ACTIVE || !SEQ_IS_CALLED(seqinfo))
+		goto out_seq;
+
+	if (coord_name != NULL && coord_procid != 0)
+	{
+		for (i = 0; i < seqinfo->gs_lastval_count; i++)
+		{
+			if (strcmp(seqinfo->gs_last_values[i].gs_coord_name, coord_name) == 0 &&
+					seqinfo->gs_last_values[i].gs_coord_procid == coord_procid)
+			{
+				lastval = &seqinfo->gs_last_values[i];
+				break;
+			}
+		}
+		if (lastval == NULL)
+			goto out_seq;
+	}
+
+	/*
+	 * The restoration point never lies beyond the bounds, but take the
+	 * nearest of both anyway.  Distances are computed unsigned as they may
+	 * not fit in a GTM_Sequence.
+	 */
+	if (SEQ_IS_ASCENDING(seqinfo))
+	{
+		step = (uint64) seqinfo->gs_increment_by;
+		limit = Min(seqinfo->gs_max_value, seqinfo->gs_backedUpValue);
+	}
+	else
+	{
+		step = (uint64) 0 - (uint64) seqinfo->gs_increment_by;
+		limit = Max(seqinfo->gs_min_value, seqinfo->gs_backedUpValue);
+	}
+
+	for (;;)
+	{
+		oldval = seqinfo->gs_value;
+
+		if (SEQ_IS_ASCENDING(seqinfo))
+		{
+			if (oldval > limit ||
+				((uint64) limit - (uint64) oldval) / step < nvals)
+				goto out_seq;
+			newval = (GTM_Sequence) ((uint64) oldval + step * nvals);
+		}
+		else
+		{
+			if (oldval < limit ||
+				((uint64) oldval - (uint64) limit) / step < nvals)
+				goto out_seq;
+			newval = (GTM_Sequence) ((uint64) oldval - step * nvals);
+		}
+
+		if (__sync_bool_compare_and_swap(&seqinfo->gs_value, oldval, newval))
+			break;
+	}
+
+	*result = SEQ_IS_ASCENDING(seqinfo) ?
+		(GTM_Sequence) ((uint64) oldval + step) :
+		(GTM_Sequence) ((uint64) oldval - step);
+	*rangemax = newval;
+	if (increment)
+		*increment = seqinfo->gs_increment_by;
+
+	/* Only this session ever changes its entry under a shared lock */
+	if (lastval != NULL)
+		lastval->gs_last_value = newval;
+	done = true;
+
+out_seq:
+	GTM_RWLockRelease(&seqinfo->gs_lock);
+out:
+	GTM_RWLockRelease(&bucket->shb_lock);
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
+	return done;
+}
+#endif
+
 /*
  * Given a sequence and the requested range for its values, calculate
  * the legitimate maximum permissible value for this range. In
@@ -930,44 +1365,38 @@ static GTM_Sequence
 get_rangemax(GTM_SeqInfo *seqinfo, GTM_Sequence range)
 {
 	GTM_Sequence rangemax = seqinfo->gs_value;
+	uint64		step;
+	uint64		headroom;
 
 	/*
 	 * Deduct 1 from range because the currval has been accounted
 	 * for already before this call has been made
 	 */
 	range--;
+
+	/*
+	 * Cap the range at the number of increments left before the max value,
+	 * or the min value for a descending sequence, so it does not overflow.
+	 * Distances are computed unsigned as they may not fit in a GTM_Sequence.
+	 */
 	if (SEQ_IS_ASCENDING(seqinfo))
 	{
-		/*
-		 * Check if the sequence will overflow because of the range
-		 * request. If yes, cap it at close to or equal to max value
-		 */
-		while (range != 0 &&
-				(seqinfo->gs_max_value - seqinfo->gs_increment_by >=
-				  rangemax))
-		{
-			rangemax += seqinfo->gs_increment_by;
-			range--;
-		}
+		if (rangemax >= seqinfo->gs_max_value)
+			return rangemax;
+		step = (uint64) seqinfo->gs_increment_by;
+		headroom = (uint64) seqinfo->gs_max_value - (uint64) rangemax;
+		return (GTM_Sequence) ((uint64) rangemax +
+							   step * Min((uint64) range, headroom / step));
 	}
 	else
 	{
-		/*
-		 * Check if the sequence will underflow because of the range
-		 * request. If yes, cap it at close to or equal to min value
-		 *
-		 * Note: The gs_increment_by is a signed integer and is negative for
-		 * descending sequences. So we don't need special handling below
-		 */
-		while (range != 0 &&
-				(seqinfo->gs_min_value - seqinfo->gs_increment_by <=
-				 rangemax))
-		{
-			rangemax += seqinfo->gs_increment_by;
-			range--;
-		}
+		if (rangemax <= seqinfo->gs_min_value)
+			return rangemax;
+		step = (uint64) 0 - (uint64) seqinfo->gs_increment_by;
+		headroom = (uint64) rangemax - (uint64) seqinfo->gs_min_value;
+		return (GTM_Sequence) ((uint64) rangemax -
+							   step * Min((uint64) range, headroom / step));
 	}
-	return rangemax;
 }
 
 /*
@@ -977,6 +1406,7 @@ int
 GTM_SeqReset(GTM_SequenceKey seqkey)
 {
 	GTM_SeqInfo *seqinfo = seq_find_seqinfo(seqkey);
+	int errcode;
 
 	if (seqinfo == NULL)
 	{
@@ -988,12 +1418,11 @@ GTM_SeqReset(GTM_SequenceKey seqkey)
 
 	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
 	seqinfo->gs_value = seqinfo->gs_backedUpValue = seqinfo->gs_init_value;
+	errcode = seq_log_seqinfo(seqinfo);
+	GTM_RWLockRelease(&seqinfo->gs_lock);
 
-	GTM_RWLockRelease(&gtm_bkup_lock);
-
-	GTM_SetNeedBackup();
 	seq_release_seqinfo(seqinfo);
-	return 0;
+	return errcode;
 }
 
 void
@@ -1001,10 +1430,24 @@ GTM_InitSeqManager(void)
 {
 	int ii;
 
-	for (ii = 0; ii < SEQ_HASH_TABLE_SIZE; ii++)
+	GTM_RWLockInit(&GTMSequences.sht_lock);
+	GTM_MutexLockInit(&GTMSequences.sht_count_lock);
+	GTMSequences.sht_count = 0;
+	GTMSequences.sht_size = SEQ_HASH_TABLE_INIT_SIZE;
+	GTMSequences.sht_buckets = (GTM_SeqInfoHashBucket *)
+		MemoryContextAlloc(TopMostMemoryContext,
+						   SEQ_HASH_TABLE_INIT_SIZE * sizeof (GTM_SeqInfoHashBucket));
+
+	for (ii = 0; ii < SEQ_HASH_TABLE_INIT_SIZE; ii++)
+	{
+		GTMSequences.sht_buckets[ii].shb_list = gtm_NIL;
+		GTM_RWLockInit(&GTMSequences.sht_buckets[ii].shb_lock);
+	}
+
+	for (ii = 0; ii < SEQ_DB_HASH_TABLE_SIZE; ii++)
 	{
-		GTMSequences[ii].shb_list = gtm_NIL;
-		GTM_RWLockInit(&GTMSequences[ii].shb_lock);
+		GTMSequencesByDB[ii].shb_list = gtm_NIL;
+		GTM_RWLockInit(&GTMSequencesByDB[ii].shb_lock);
 	}
 }
 
@@ -1086,13 +1529,12 @@ ProcessSequenceInitCommand(Port *myport, StringInfo message, bool is_backup)
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "open_sequence() returns rc %d.", rc);
 		}
-		/* Save control file with new seq info */
-        SaveControlInfo();
 		/*
 		 * Send a SUCCESS message back to the client
 		 */
@@ -1202,13 +1644,12 @@ ProcessSequenceAlterCommand(Port *myport, StringInfo message, bool is_backup)
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "alter_sequence() returns rc %d.", rc);
 		}
-		/* Save control file info */
-        SaveControlInfo();
 
 		pq_beginmessage(&buf, 'S');
 		pq_sendint(&buf, SEQUENCE_ALTER_RESULT, 4);
@@ -1258,12 +1699,13 @@ ProcessSequenceListCommand(Port *myport, StringInfo message)
 	/*
 	 * Store pointers to all GTM_SeqInfo in the hash buckets into an array.
 	 */
-	for (i = 0 ; i < SEQ_HASH_TABLE_SIZE ; i++)
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_READ);
+	for (i = 0 ; i < GTMSequences.sht_size ; i++)
 	{
 		GTM_SeqInfoHashBucket *b;
 		gtm_ListCell *elem;
 
-		b = &GTMSequences[i];
+		b = &GTMSequences.sht_buckets[i];
 
 		GTM_RWLockAcquire(&b->shb_lock, GTM_LOCKMODE_READ);
 
@@ -1302,6 +1744,7 @@ ProcessSequenceListCommand(Port *myport, StringInfo message)
 
 		GTM_RWLockRelease(&b->shb_lock);
 	}
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
 
 	pq_getmsgend(message);
 
@@ -1484,13 +1927,12 @@ ProcessSequenceGetNextCommand(Port *myport, StringInfo message, bool is_backup)
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously &&(myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "get_next() returns GTM_Sequence %ld.", loc_seq);
 		}
-		/* Save control file info */
-        SaveControlInfo();
 
 		/* Respond to the client */
 		pq_beginmessage(&buf, 'S');
@@ -1519,6 +1961,116 @@ ProcessSequenceGetNextCommand(Port *myport, StringInfo message, bool is_backup)
 	}
 }
 
+/*
+ * Process MSG_SEQUENCE_GET_NEXT_MULTI message
+ *
+ * A GTM proxy sends the nextval requests of several backends together, each
+ * one as in MSG_SEQUENCE_GET_NEXT.  Every request gets its own status and
+ * range, along with the increment of the sequence so that the proxy can hand
+ * out the range in parts.
+ */
+void
+ProcessSequenceGetNextCommandMulti(Port *myport, StringInfo message)
+{
+	GTM_SequenceKeyData seqkey[GTM_MAX_SEQ_MULTI];
+	char	   *coord_name[GTM_MAX_SEQ_MULTI];
+	uint32		coord_procid[GTM_MAX_SEQ_MULTI];
+	GTM_Sequence range[GTM_MAX_SEQ_MULTI];
+	GTM_Sequence seqval[GTM_MAX_SEQ_MULTI];
+	GTM_Sequence rangemax[GTM_MAX_SEQ_MULTI];
+	GTM_Sequence increment[GTM_MAX_SEQ_MULTI];
+	int			status[GTM_MAX_SEQ_MULTI];
+	StringInfoData buf;
+	int			seq_count;
+	int			ii;
+
+	seq_count = pq_getmsgint(message, sizeof (int));
+	if (seq_count <= 0 || seq_count > GTM_MAX_SEQ_MULTI)
+		ereport(ERROR,
+				(EPROTO,
+				 errmsg("Invalid number of sequence requests %d", seq_count)));
+
+	for (ii = 0; ii < seq_count; ii++)
+	{
+		uint32		coord_namelen;
+
+		seqkey[ii].gsk_keylen = pq_getmsgint(message, sizeof (seqkey[ii].gsk_keylen));
+		seqkey[ii].gsk_key = (char *)pq_getmsgbytes(message, seqkey[ii].gsk_keylen);
+
+		coord_namelen = pq_getmsgint(message, sizeof(coord_namelen));
+		if (coord_namelen > 0)
+		{
+			coord_name[ii] = (char *) palloc(coord_namelen + 1);
+			memcpy(coord_name[ii], pq_getmsgbytes(message, coord_namelen),
+				   coord_namelen);
+			coord_name[ii][coord_namelen] = '\0';
+		}
+		else
+			coord_name[ii] = NULL;
+		coord_procid[ii] = pq_getmsgint(message, sizeof(coord_procid[ii]));
+		memcpy(&range[ii], pq_getmsgbytes(message, sizeof (GTM_Sequence)),
+			   sizeof (GTM_Sequence));
+	}
+	pq_getmsgend(message);
+
+	for (ii = 0; ii < seq_count; ii++)
+	{
+		status[ii] = seq_get_next(&seqkey[ii], coord_name[ii], coord_procid[ii],
+								  range[ii], &seqval[ii], &rangemax[ii],
+								  &increment[ii]);
+		if (status[ii] != 0)
+			continue;
+
+		elog(DEBUG1, "Getting next value %ld for sequence %s", seqval[ii],
+			 seqkey[ii].gsk_key);
+
+		/* Backup first */
+		if (GetMyThreadInfo->thr_conn->standby)
+		{
+			GTM_Sequence loc_seq;
+			GTM_Sequence loc_rangemax;
+			GTM_Conn *oldconn = GetMyThreadInfo->thr_conn->standby;
+			int count = 0;
+
+		retry:
+			bkup_get_next(GetMyThreadInfo->thr_conn->standby, &seqkey[ii],
+						  coord_name[ii], coord_procid[ii],
+						  range[ii], &loc_seq, &loc_rangemax);
+
+			if (gtm_standby_check_communication_error(&count, oldconn))
+				goto retry;
+		}
+	}
+
+	/* Respond to the proxy */
+	pq_beginmessage(&buf, 'S');
+	pq_sendint(&buf, SEQUENCE_GET_NEXT_MULTI_RESULT, 4);
+	if (myport->remote_type == GTM_NODE_GTM_PROXY)
+	{
+		GTM_ProxyMsgHeader proxyhdr;
+		proxyhdr.ph_conid = myport->conn_id;
+		pq_sendbytes(&buf, (char *)&proxyhdr, sizeof (GTM_ProxyMsgHeader));
+	}
+	pq_sendbytes(&buf, (char *)&seq_count, sizeof (seq_count));
+	pq_sendbytes(&buf, (char *)status, sizeof (int) * seq_count);
+	pq_sendbytes(&buf, (char *)seqval, sizeof (GTM_Sequence) * seq_count);
+	pq_sendbytes(&buf, (char *)rangemax, sizeof (GTM_Sequence) * seq_count);
+	pq_sendbytes(&buf, (char *)increment, sizeof (GTM_Sequence) * seq_count);
+	pq_endmessage(myport, &buf);
+
+	if (myport->remote_type != GTM_NODE_GTM_PROXY)
+	{
+		/* Flush to the standby first */
+		if (GetMyThreadInfo->thr_conn->standby)
+			gtmpqFlush(GetMyThreadInfo->thr_conn->standby);
+		pq_flush(myport);
+	}
+
+	for (ii = 0; ii < seq_count; ii++)
+		if (coord_name[ii])
+			pfree(coord_name[ii]);
+}
+
 /*
  * Process MSG_SEQUENCE_SET_VAL/MSG_BKUP_SEQUENCE_SET_VAL message
  *
@@ -1597,13 +2149,12 @@ ProcessSequenceSetValCommand(Port *myport, StringInfo message, bool is_backup)
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "set_val() returns rc %d.", rc);
 		}
-		/* Save control file info */
-        SaveControlInfo();
 
 		/* Respond to the client */
 		pq_beginmessage(&buf, 'S');
@@ -1670,13 +2221,12 @@ ProcessSequenceResetCommand(Port *myport, StringInfo message, bool is_backup)
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "reset_sequence() returns rc %d.", rc);
 		}
-		/* Save control file info */
-        SaveControlInfo();
 
 		/* Respond to the client */
 		pq_beginmessage(&buf, 'S');
@@ -1745,13 +2295,12 @@ ProcessSequenceCloseCommand(Port *myport, StringInfo message, bool is_backup)
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "close_sequence() returns rc %d.", rc);
 		}
-		/* Save control file info */
-        SaveControlInfo();
 
 		/* Respond to the client */
 		pq_beginmessage(&buf, 'S');
@@ -1835,13 +2384,12 @@ ProcessSequenceRenameCommand(Port *myport, StringInfo message, bool is_backup)
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "rename_sequence() returns rc %d.", rc);
 		}
-		/* Save control file info */
-        SaveControlInfo();
 
 		/* Send a SUCCESS message back to the client */
 		pq_beginmessage(&buf, 'S');
@@ -1983,54 +2531,77 @@ decode_seq_key(char* value, GTM_SequenceKey seqkey)
 	memcpy(seqkey->gsk_key, out, len);
 }
 
-static GTM_Sequence distanceToBackedUpSeqValue(GTM_SeqInfo *seqinfo)
-{
-	if (!SEQ_IS_CALLED(seqinfo))
-		return (GTM_Sequence)0;
-	if (SEQ_IS_ASCENDING(seqinfo))
-	{
-		if ((seqinfo->gs_backedUpValue - seqinfo->gs_value) >= 0)
-			return (seqinfo->gs_backedUpValue - seqinfo->gs_value);
-		if (SEQ_IS_CYCLE(seqinfo))
-			return((seqinfo->gs_max_value - seqinfo->gs_value) + (seqinfo->gs_backedUpValue - seqinfo->gs_min_value));
-		else
-			return(seqinfo->gs_backedUpValue - seqinfo->gs_value);
-	}
-	else
-	{
-		if ((seqinfo->gs_value - seqinfo->gs_backedUpValue) >= 0)
-			return(seqinfo->gs_backedUpValue - seqinfo->gs_value);
-		if (SEQ_IS_CYCLE(seqinfo))
-			return((seqinfo->gs_max_value - seqinfo->gs_backedUpValue) + (seqinfo->gs_value - seqinfo->gs_min_value));
-		else
-			return(seqinfo->gs_backedUpValue - seqinfo->gs_value);
-	}
-	return 0;
-}
-
 bool GTM_NeedSeqRestoreUpdate(GTM_SequenceKey seqkey)
 {
 	GTM_SeqInfo *seqinfo = seq_find_seqinfo(seqkey);
+	bool		need;
+
 	if (!seqinfo)
 		return FALSE;
-	return GTM_NeedSeqRestoreUpdateInternal(seqinfo);
+	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_READ);
+	need = GTM_NeedSeqRestoreUpdateInternal(seqinfo, seqinfo->gs_value,
+											seqinfo->gs_called);
+	GTM_RWLockRelease(&seqinfo->gs_lock);
+	seq_release_seqinfo(seqinfo);
+	return need;
 }
 
-static bool GTM_NeedSeqRestoreUpdateInternal(GTM_SeqInfo *seqinfo)
+/*
+ * Check if the sequence moved from oldval past its restoration point.
+ * A restoration point never wraps around, so wrapping always needs a new
+ * one, and so does the first call as gs_called must be logged.
+ */
+static bool GTM_NeedSeqRestoreUpdateInternal(GTM_SeqInfo *seqinfo,
+											 GTM_Sequence oldval, bool called)
 {
-	GTM_Sequence distance;
-
-	if (!SEQ_IS_CALLED(seqinfo))
+	if (!called)
 		/* The first call.  Must backup */
 		return TRUE;
-	distance = distanceToBackedUpSeqValue(seqinfo);
 	if (SEQ_IS_ASCENDING(seqinfo))
-		return(distance >= seqinfo->gs_increment_by);
+		return (seqinfo->gs_value < oldval ||
+				seqinfo->gs_value > seqinfo->gs_backedUpValue);
 	else
-		return(distance <= seqinfo->gs_increment_by);
+		return (seqinfo->gs_value > oldval ||
+				seqinfo->gs_value < seqinfo->gs_backedUpValue);
 }
 
+/*
+ * Append the state of the sequence to the GTM log, reserving its values up
+ * to gs_backedUpValue.  Called with gs_lock held.
+ */
+static int
+seq_log_seqinfo(GTM_SeqInfo *seqinfo)
+{
+	char key[1024];
+	char record[2048];
+
+	encode_seq_key(seqinfo->gs_key, key);
+	snprintf(record, sizeof (record), "S\t%s\t%ld\t%ld\t%ld\t%ld\t%ld\t%c\t%c\t%x\n",
+			 key, seqinfo->gs_backedUpValue,
+			 seqinfo->gs_init_value, seqinfo->gs_increment_by,
+			 seqinfo->gs_min_value, seqinfo->gs_max_value,
+			 (seqinfo->gs_cycle ? 't' : 'f'),
+			 (seqinfo->gs_called ? 't' : 'f'),
+			 seqinfo->gs_state);
+
+	return GTM_WalAppend(record) ? 0 : EIO;
+}
+
+/*
+ * Log the removal of a sequence, or of all the sequences of a database.
+ */
+static int
+seq_log_drop(GTM_SequenceKey seqkey)
+{
+	char key[1024];
+	char record[2048];
 
+	encode_seq_key(seqkey, key);
+	snprintf(record, sizeof (record), "%c\t%s\n",
+			 seqkey->gsk_type == GTM_SEQ_DB_NAME ? 'B' : 'D', key);
+
+	return GTM_WalAppend(record) ? 0 : EIO;
+}
 
 static void
 GTM_SaveSeqInfo2(FILE *ctlf, bool isBackup)
@@ -2041,9 +2612,10 @@ GTM_SaveSeqInfo2(FILE *ctlf, bool isBackup)
 	int hash;
 	char buffer[1024];
 
-	for (hash = 0; hash < SEQ_HASH_TABLE_SIZE; hash++)
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_READ);
+	for (hash = 0; hash < GTMSequences.sht_size; hash++)
 	{
-		bucket = &GTMSequences[hash];
+		bucket = &GTMSequences.sht_buckets[hash];
 
 		GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
 
@@ -2071,7 +2643,7 @@ GTM_SaveSeqInfo2(FILE *ctlf, bool isBackup)
 		}
 		GTM_RWLockRelease(&bucket->shb_lock);
 	}
-
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
 }
 
 void GTM_SaveSeqInfo(FILE *ctlf)
@@ -2079,9 +2651,12 @@ void GTM_SaveSeqInfo(FILE *ctlf)
 	GTM_SaveSeqInfo2(ctlf, FALSE);
 }
 
+/*
+ * Move the restoration point RestoreDuration values ahead of the current
+ * value, stopping at the end of the sequence.
+ */
 static void advance_gs_value(GTM_SeqInfo *seqinfo)
 {
-	
 	GTM_Sequence distance;
 
 	distance = seqinfo->gs_increment_by * RestoreDuration;
@@ -2090,65 +2665,20 @@ static void advance_gs_value(GTM_SeqInfo *seqinfo)
 		if ((seqinfo->gs_max_value - seqinfo->gs_value) >= distance)
 			seqinfo->gs_backedUpValue = seqinfo->gs_value + distance;
 		else
-		{
-			if (SEQ_IS_CYCLE(seqinfo))
-				seqinfo->gs_backedUpValue = seqinfo->gs_min_value + (distance - (seqinfo->gs_max_value - seqinfo->gs_value));
-			else
-				seqinfo->gs_backedUpValue = seqinfo->gs_max_value;
-		}
+			seqinfo->gs_backedUpValue = seqinfo->gs_max_value;
 	}
 	else
 	{
-		if ((seqinfo->gs_min_value - seqinfo->gs_value) >= distance)
+		if ((seqinfo->gs_min_value - seqinfo->gs_value) <= distance)
 			seqinfo->gs_backedUpValue = seqinfo->gs_value + distance;
 		else
-		{
-			if (SEQ_IS_CYCLE(seqinfo))
-				seqinfo->gs_backedUpValue = seqinfo->gs_max_value + (distance - (seqinfo->gs_min_value - seqinfo->gs_value));
-			else
-				seqinfo->gs_backedUpValue = seqinfo->gs_min_value;
-		}
+			seqinfo->gs_backedUpValue = seqinfo->gs_min_value;
 	}
 }
 
 
-static void
-GTM_UpdateRestorePointSeq(void)
-{
-	GTM_SeqInfoHashBucket *bucket;
-	gtm_ListCell *elem;
-	GTM_SeqInfo *seqinfo = NULL;
-	int hash;
-
-	for (hash = 0; hash < SEQ_HASH_TABLE_SIZE; hash++)
-	{
-		bucket = &GTMSequences[hash];
-
-		GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
-
-		gtm_foreach(elem, bucket->shb_list)
-		{
-			seqinfo = (GTM_SeqInfo *) gtm_lfirst(elem);
-			if (seqinfo == NULL)
-				break;
-
-			if (seqinfo->gs_state == SEQ_STATE_DELETED)
-				continue;
-
-			GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_READ);
-			advance_gs_value(seqinfo);
-			GTM_RWLockRelease(&seqinfo->gs_lock);
-		}
-
-		GTM_RWLockRelease(&bucket->shb_lock);
-	}
-
-}
-
-
 void GTM_WriteRestorePointSeq(FILE *ctlf)
 {
-	GTM_UpdateRestorePointSeq();
 	GTM_SaveSeqInfo2(ctlf, TRUE);
 }
 
@@ -2228,6 +2758,65 @@ GTM_RestoreSeqInfo(FILE *ctlf)
 	}
 }
 
+/*
+ * Apply a sequence record found in the GTM log, see gtm_backup.c.
+ * Returns false if the record cannot be parsed.
+ */
+bool
+GTM_ReplaySeqInfo(char *record)
+{
+	GTM_SequenceKeyData seqkey;
+	GTM_SeqInfo *seqinfo;
+	char seqname[1024];
+	GTM_Sequence increment_by;
+	GTM_Sequence minval;
+	GTM_Sequence maxval;
+	GTM_Sequence startval;
+	GTM_Sequence curval;
+	int32 state;
+	char cycle;
+	char called;
+
+	if (record[0] == 'D' || record[0] == 'B')
+	{
+		if (sscanf(record + 1, "%1023s", seqname) != 1)
+			return false;
+		decode_seq_key(seqname, &seqkey);
+		seqkey.gsk_type = (record[0] == 'B') ? GTM_SEQ_DB_NAME : GTM_SEQ_FULL_NAME;
+		GTM_SeqClose(&seqkey);
+		pfree(seqkey.gsk_key);
+		return true;
+	}
+
+	if (sscanf(record + 1, "%1023s %ld %ld %ld %ld %ld %c %c %x",
+			   seqname, &curval, &startval, &increment_by, &minval, &maxval,
+			   &cycle, &called, &state) != 9)
+		return false;
+	decode_seq_key(seqname, &seqkey);
+
+	if ((seqinfo = seq_find_seqinfo(&seqkey)) == NULL)
+	{
+		GTM_SeqRestore(&seqkey, increment_by, minval, maxval, startval, curval,
+					   state, cycle == 't', called == 't');
+		pfree(seqkey.gsk_key);
+		return true;
+	}
+
+	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
+	seqinfo->gs_value = seqinfo->gs_backedUpValue = curval;
+	seqinfo->gs_init_value = startval;
+	seqinfo->gs_increment_by = increment_by;
+	seqinfo->gs_min_value = minval;
+	seqinfo->gs_max_value = maxval;
+	seqinfo->gs_cycle = (cycle == 't');
+	seqinfo->gs_called = (called == 't');
+	GTM_RWLockRelease(&seqinfo->gs_lock);
+	seq_release_seqinfo(seqinfo);
+
+	pfree(seqkey.gsk_key);
+	return true;
+}
+
 /*
  * Remove all current values allocated for the specified session from all
  * sequences.
@@ -2240,9 +2829,10 @@ GTM_CleanupSeqSession(char *coord_name, int coord_procid)
 	elog(DEBUG1, "Clean up Sequences used in session %s:%d",
 			coord_name, coord_procid);
 
-	for (i = 0; i < SEQ_HASH_TABLE_SIZE; i++)
+	GTM_RWLockAcquire(&GTMSequences.sht_lock, GTM_LOCKMODE_READ);
+	for (i = 0; i < GTMSequences.sht_size; i++)
 	{
-		GTM_SeqInfoHashBucket *bucket = &GTMSequences[i];
+		GTM_SeqInfoHashBucket *bucket = &GTMSequences.sht_buckets[i];
 		gtm_ListCell *elem;
 		GTM_SeqInfo *curr_seqinfo;
 
@@ -2287,4 +2877,5 @@ GTM_CleanupSeqSession(char *coord_name, int coord_procid)
 		}
 		GTM_RWLockRelease(&bucket->shb_lock);
 	}
+	GTM_RWLockRelease(&GTMSequences.sht_lock);
 }
@@ -23,7 +23,22 @@
 #include "gtm/libpq-int.h"
 #include "gtm/pqformat.h"
 
-static GTM_SnapshotData localSnapshot;
+/*
+ * The txid array of a snapshot is sized after the number of open
+ * transactions rather than GTM_MAX_GLOBAL_TRANSACTIONS, and kept for the
+ * next snapshots taken in the same slot.  It only grows, by doubling, so it
+ * is reallocated a few times at most.
+ */
+#define GTM_SNAPSHOT_MIN_XIP	64
+
+static bool GTM_SnapshotXipsHaveRoom(int xip_size,
+						GTM_TransactionHandle handle[], int txn_count,
+						int *status, int needed);
+static void GTM_GrowSnapshotXips(GTM_Snapshot snapshot, int *xip_size,
+					 GTM_TransactionHandle handle[], int txn_count,
+					 int *status, int needed);
+static int GTM_SnapshotXipSize(int xip_size, int needed);
+
 /*
  * Get snapshot for the given transactions. If this is the first call in the
  * transaction, a fresh snapshot is taken and returned back. For a serializable
@@ -67,6 +82,7 @@ GTM_GetTransactionSnapshot(GTM_TransactionHandle handle[], int txn_count, int *s
 	 */
 	GTM_TransactionInfo *mygtm_txninfo = NULL;
 	GTM_Snapshot snapshot = NULL;
+	int		   *xip_size = NULL;
 
 	memset(status, 0, sizeof (int) * txn_count);
 
@@ -79,43 +95,54 @@ GTM_GetTransactionSnapshot(GTM_TransactionHandle handle[], int txn_count, int *s
 		if (handle[ii] != InvalidTransactionHandle)
 			mygtm_txninfo = GTM_HandleToTransactionInfo(handle[ii]);
 		else
-			status[ii] = STATUS_NOT_FOUND;
+			mygtm_txninfo = NULL;
 
 		/*
 		 * If the transaction does not exist, just mark the status field with
-		 * a STATUS_ERROR code
+		 * a STATUS_NOT_FOUND code
 		 */
-		if ((mygtm_txninfo != NULL) && (snapshot == NULL))
+		if (mygtm_txninfo == NULL)
+			status[ii] = STATUS_NOT_FOUND;
+		else if (snapshot == NULL)
+		{
 			snapshot = &mygtm_txninfo->gti_current_snapshot;
+			xip_size = &mygtm_txninfo->gti_xip_size;
+		}
 	}
 
 	/*
 	 * If no valid transaction exists in the array, we record the snapshot in a
-	 * local strucure and still send it out to the caller
+	 * local strucure and still send it out to the caller.  It belongs to the
+	 * thread, and so does its txid array.
 	 */
 	if (snapshot == NULL)
-		snapshot = &localSnapshot;
-
-	Assert(snapshot != NULL);
-
-	if (snapshot->sn_xip == NULL)
 	{
-		/*
-		 * First call for this snapshot
-		 */
-		snapshot->sn_xip = (GlobalTransactionId *)
-			palloc(GTM_MAX_GLOBAL_TRANSACTIONS * sizeof(GlobalTransactionId));
-		if (snapshot->sn_xip == NULL)
-			ereport(ERROR,
-					(ENOMEM,
-					 errmsg("out of memory")));
+		snapshot = &GetMyThreadInfo->thr_local_snapshot;
+		xip_size = &GetMyThreadInfo->thr_local_xip_size;
 	}
 
+	Assert(snapshot != NULL);
+
 	/*
 	 * It is sufficient to get shared lock on ProcArrayLock, even if we are
 	 * going to set MyProc->xmin.
+	 *
+	 * The txid arrays of the snapshots must have room for all the open
+	 * transactions.  They are grown without the read lock, since allocation
+	 * may fail, and we check again once it is back as more transactions may
+	 * have begun meanwhile.
 	 */
 	GTM_RWLockAcquire(&GTMTransactions.gt_TransArrayLock, GTM_LOCKMODE_READ);
+	while (!GTM_SnapshotXipsHaveRoom(*xip_size, handle, txn_count, status,
+									 GTM_CountOpenTransactions()))
+	{
+		int			needed = GTM_CountOpenTransactions();
+
+		GTM_RWLockRelease(&GTMTransactions.gt_TransArrayLock);
+		GTM_GrowSnapshotXips(snapshot, xip_size, handle, txn_count, status,
+							 needed);
+		GTM_RWLockAcquire(&GTMTransactions.gt_TransArrayLock, GTM_LOCKMODE_READ);
+	}
 
 	/* xmax is always latestCompletedXid + 1 */
 	xmax = GTMTransactions.gt_latestCompletedXid;
@@ -220,16 +247,6 @@ GTM_GetTransactionSnapshot(GTM_TransactionHandle handle[], int txn_count, int *s
 				 */
 				if (snapshot != mysnap)
 				{
-					if (mysnap->sn_xip == NULL)
-					{
-						/*
-						 * First call for this snapshot
-						 */
-						mysnap->sn_xip = (GlobalTransactionId *)
-							palloc(GTM_MAX_GLOBAL_TRANSACTIONS * sizeof(GlobalTransactionId));
-						if (mysnap->sn_xip == NULL)
-							ereport(ERROR, (ENOMEM, errmsg("out of memory")));
-					}
 					mysnap->sn_xmin = snapshot->sn_xmin;
 					mysnap->sn_xmax = snapshot->sn_xmax;
 					mysnap->sn_xcnt = snapshot->sn_xcnt;
@@ -241,16 +258,6 @@ GTM_GetTransactionSnapshot(GTM_TransactionHandle handle[], int txn_count, int *s
 		}
 		else if (snapshot != mysnap)
 		{
-			if (mysnap->sn_xip == NULL)
-			{
-				/*
-				 * First call for this snapshot
-				 */
-				mysnap->sn_xip = (GlobalTransactionId *)
-					palloc(GTM_MAX_GLOBAL_TRANSACTIONS * sizeof(GlobalTransactionId));
-				if (mysnap->sn_xip == NULL)
-					ereport(ERROR, (ENOMEM, errmsg("out of memory")));
-			}
 			mysnap->sn_xmin = snapshot->sn_xmin;
 			mysnap->sn_xmax = snapshot->sn_xmax;
 			mysnap->sn_xcnt = snapshot->sn_xcnt;
@@ -271,6 +278,138 @@ GTM_GetTransactionSnapshot(GTM_TransactionHandle handle[], int txn_count, int *s
 	return snapshot;
 }
 
+/*
+ * Check whether the txid arrays of the snapshot, whose size is xip_size, and
+ * of the current snapshots of the given transactions have room for needed
+ * txids.
+ */
+static bool
+GTM_SnapshotXipsHaveRoom(int xip_size, GTM_TransactionHandle handle[],
+						 int txn_count, int *status, int needed)
+{
+	int			ii;
+
+	if (needed > xip_size)
+		return false;
+
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		if (status[ii] == STATUS_ERROR || status[ii] == STATUS_NOT_FOUND)
+			continue;
+
+		if (needed > GTMTransactions.gt_transactions_array[handle[ii]].gti_xip_size)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Grow the txid arrays which have no room for needed txids, without holding
+ * gt_TransArrayLock.
+ *
+ * The local snapshot of the thread is not seen by other threads, so it is
+ * grown in place.  The current snapshots of the transactions may be read by
+ * other threads holding the lock, so their new arrays are allocated first,
+ * swapped in under the write lock, and the old arrays are only freed once
+ * the lock is released.
+ */
+static void
+GTM_GrowSnapshotXips(GTM_Snapshot snapshot, int *xip_size,
+					 GTM_TransactionHandle handle[], int txn_count,
+					 int *status, int needed)
+{
+	GlobalTransactionId **xips;
+	int		   *sizes;
+	int			ii;
+
+	/* The local snapshot of the thread lives in the thread context */
+	if (snapshot == &GetMyThreadInfo->thr_local_snapshot && needed > *xip_size)
+	{
+		int			size = GTM_SnapshotXipSize(*xip_size, needed);
+
+		if (snapshot->sn_xip == NULL)
+			snapshot->sn_xip = (GlobalTransactionId *)
+				MemoryContextAlloc(TopMemoryContext,
+								   size * sizeof (GlobalTransactionId));
+		else
+			snapshot->sn_xip = (GlobalTransactionId *)
+				repalloc(snapshot->sn_xip, size * sizeof (GlobalTransactionId));
+		*xip_size = size;
+	}
+
+	xips = (GlobalTransactionId **) palloc0(txn_count * sizeof (GlobalTransactionId *));
+	sizes = (int *) palloc0(txn_count * sizeof (int));
+
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		GTM_TransactionInfo *gtm_txninfo;
+
+		if (status[ii] == STATUS_ERROR || status[ii] == STATUS_NOT_FOUND)
+			continue;
+
+		/* Only grown under the write lock, checked again there */
+		gtm_txninfo = &GTMTransactions.gt_transactions_array[handle[ii]];
+		if (needed <= gtm_txninfo->gti_xip_size)
+			continue;
+
+		sizes[ii] = GTM_SnapshotXipSize(gtm_txninfo->gti_xip_size, needed);
+		xips[ii] = (GlobalTransactionId *)
+			MemoryContextAlloc(TopMostMemoryContext,
+							   sizes[ii] * sizeof (GlobalTransactionId));
+	}
+
+	GTM_RWLockAcquire(&GTMTransactions.gt_TransArrayLock, GTM_LOCKMODE_WRITE);
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		GTM_TransactionInfo *gtm_txninfo;
+		GTM_Snapshot cursnap;
+		GlobalTransactionId *oldxip;
+
+		if (xips[ii] == NULL)
+			continue;
+
+		/* Another thread may have grown it meanwhile */
+		gtm_txninfo = &GTMTransactions.gt_transactions_array[handle[ii]];
+		if (sizes[ii] <= gtm_txninfo->gti_xip_size)
+			continue;
+
+		/* Keep the snapshot, a serializable transaction may still use it */
+		cursnap = &gtm_txninfo->gti_current_snapshot;
+		oldxip = cursnap->sn_xip;
+		if (oldxip != NULL)
+			memcpy(xips[ii], oldxip,
+				   sizeof (GlobalTransactionId) * cursnap->sn_xcnt);
+		cursnap->sn_xip = xips[ii];
+		gtm_txninfo->gti_xip_size = sizes[ii];
+		xips[ii] = oldxip;
+	}
+	GTM_RWLockRelease(&GTMTransactions.gt_TransArrayLock);
+
+	/* Free the replaced arrays, and the new ones which were not needed */
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		if (xips[ii] != NULL)
+			pfree(xips[ii]);
+	}
+	pfree(xips);
+	pfree(sizes);
+}
+
+/*
+ * Size of a txid array of xip_size grown to have room for needed txids.
+ */
+static int
+GTM_SnapshotXipSize(int xip_size, int needed)
+{
+	int			size;
+
+	size = Max(xip_size * 2, GTM_SNAPSHOT_MIN_XIP);
+	while (size < needed)
+		size *= 2;
+	return Min(size, GTM_MAX_GLOBAL_TRANSACTIONS);
+}
+
 /*
  * Process MSG_SNAPSHOT_GET command
  */
@@ -22,7 +22,9 @@
 #include "gtm/gtm_client.h"
 #include "gtm/gtm_seq.h"
 #include "gtm/gtm_serialize.h"
+#include "gtm/gtm_stat.h"
 #include "gtm/gtm_utils.h"
+#include "gtm/libpq-int.h"
 #include "gtm/register.h"
 
 GTM_Conn *GTM_ActiveConn = NULL;
@@ -31,8 +33,58 @@ static char standbyNodeName[NI_MAXHOST];
 static int standbyPortNumber;
 static char *standbyDataDir;
 
+/*
+ * Replication stream to the GTM standby.
+ *
+ * All GTM threads share a single connection to the standby.  The standby
+ * connection a thread sees in thr_conn->standby is only a buffer: backup
+ * messages are built there as before, and when they are flushed they are
+ * appended to the shared connection under ss_lock, which advances
+ * ss_write_pos.
+ *
+ * In synchronous mode a thread must not answer its client before the
+ * standby has processed its records.  Instead of a round trip per command,
+ * waiting threads share acknowledgements: a sync request covers every
+ * record written so far, up to GTM_STANDBY_MAX_INFLIGHT_SYNC requests may
+ * be outstanding, and one waiting thread at a time reads the replies and
+ * advances ss_ack_pos for everybody.  Records keep flowing while replies
+ * are being waited for: the replies are read from ss_reader, which shares
+ * the socket of ss_conn but not its buffers.
+ *
+ * Each (re)opening of the connection starts a new generation.  Records
+ * written to a connection that failed before acknowledging them may never
+ * have reached the standby, so a thread whose records were written to a
+ * previous generation is not told they were synced: it resends its backup
+ * message, see gtm_standby_sync_or_resend().
+ */
+#define GTM_STANDBY_MAX_INFLIGHT_SYNC	64
+
+#define GTM_STANDBY_RETRY_MAX 3
+
+typedef struct GTM_StandbyStream
+{
+	GTM_MutexLock	ss_lock;		/* protects all the fields below */
+	GTM_CV			ss_cv;			/* signalled when a reader finishes */
+	GTM_Conn	   *ss_conn;		/* shared connection, NULL if none */
+	GTM_Conn	   *ss_reader;		/* replies of ss_conn are read from it */
+	bool			ss_broken;		/* ss_conn failed, must be reopened */
+	bool			ss_reading;		/* a thread is reading a reply */
+	uint64			ss_gen;			/* generation of ss_conn */
+	uint64			ss_write_pos;	/* last record written to ss_conn */
+	uint64			ss_sync_pos;	/* last record covered by a sync request */
+	uint64			ss_ack_pos;		/* last record acknowledged */
+	uint64			ss_prev_ack_pos;	/* ss_ack_pos when ss_conn was opened */
+	int				ss_sync_head;	/* oldest outstanding sync request */
+	int				ss_sync_count;	/* number of outstanding sync requests */
+	uint64			ss_sync_queue[GTM_STANDBY_MAX_INFLIGHT_SYNC];
+} GTM_StandbyStream;
+
+static GTM_StandbyStream StandbyStream;
+
 static GTM_Conn * gtm_standby_connect_to_standby_int(int *report_needed);
 static GTM_Conn *gtm_standby_connectToActiveGTM(void);
+static bool gtm_standby_stream_open(int retry_max);
+static int gtm_standby_stream_send(GTM_Conn *conn, const char *buf, int len);
 
 extern char *NodeName;		/* Defined in main.c */
 
@@ -163,8 +215,27 @@ gtm_standby_restore_gxid(void)
 						txn.gt_transactions_array[i].gti_current_snapshot.sn_xmax;
 		GTMTransactions.gt_transactions_array[handle].gti_current_snapshot.sn_xcnt =
 						txn.gt_transactions_array[i].gti_current_snapshot.sn_xcnt;
-		GTMTransactions.gt_transactions_array[handle].gti_current_snapshot.sn_xip =
-						txn.gt_transactions_array[i].gti_current_snapshot.sn_xip;
+		/*
+		 * The txid array is grown later by GTM_GetTransactionSnapshot with
+		 * repalloc, so it must live in the same context as the arrays
+		 * allocated there.
+		 */
+		if (GTMTransactions.gt_transactions_array[handle].gti_current_snapshot.sn_xip != NULL)
+			pfree(GTMTransactions.gt_transactions_array[handle].gti_current_snapshot.sn_xip);
+		GTMTransactions.gt_transactions_array[handle].gti_current_snapshot.sn_xip = NULL;
+		GTMTransactions.gt_transactions_array[handle].gti_xip_size = 0;
+		if (txn.gt_transactions_array[i].gti_current_snapshot.sn_xcnt > 0)
+		{
+			int		xcnt = txn.gt_transactions_array[i].gti_current_snapshot.sn_xcnt;
+
+			GTMTransactions.gt_transactions_array[handle].gti_current_snapshot.sn_xip =
+				(GlobalTransactionId *) MemoryContextAlloc(TopMostMemoryContext,
+										xcnt * sizeof (GlobalTransactionId));
+			memcpy(GTMTransactions.gt_transactions_array[handle].gti_current_snapshot.sn_xip,
+				   txn.gt_transactions_array[i].gti_current_snapshot.sn_xip,
+				   xcnt * sizeof (GlobalTransactionId));
+			GTMTransactions.gt_transactions_array[handle].gti_xip_size = xcnt;
+		}
 		/* end of copying GTM_SnapshotData */
 
 		GTMTransactions.gt_transactions_array[handle].gti_snapshot_set =
@@ -353,17 +424,24 @@ find_standby_node_info(void)
  * Make a connection to the GTM standby node when getting connected
  * from the client.
  *
+ * What the thread gets is a buffer feeding the shared replication stream,
+ * the actual connection is opened when the first record is written.
+ *
  * Returns a pointer to a GTM_Conn object on success, or NULL on failure.
  */
 GTM_Conn *
 gtm_standby_connect_to_standby(void)
 {
-	GTM_Conn *conn;
-	int report;
+	if (Recovery_IsStandby())
+		return NULL;
 
-	conn = gtm_standby_connect_to_standby_int(&report);
+	if (!find_standby_node_info())
+	{
+		elog(DEBUG1, "Any GTM standby node not found in registered node(s).");
+		return NULL;
+	}
 
-	return conn;
+	return GTMPQcreateBufferedConn(gtm_standby_stream_send);
 }
 
 static GTM_Conn *
@@ -419,32 +497,326 @@ gtm_standby_disconnect_from_standby(GTM_Conn *conn)
 GTM_Conn *
 gtm_standby_reconnect_to_standby(GTM_Conn *old_conn, int retry_max)
 {
-	GTM_Conn *newconn = NULL;
-	int report;
-	int i;
+	bool	opened;
 
 	if (Recovery_IsStandby())
 		return NULL;
 
-	if (old_conn != NULL)
-		gtm_standby_disconnect_from_standby(old_conn);
+	GTM_MutexLockAcquire(&StandbyStream.ss_lock);
+	StandbyStream.ss_broken = true;
+	opened = GTMThreads->gt_standby_ready &&
+		gtm_standby_stream_open(retry_max);
+	GTM_MutexLockRelease(&StandbyStream.ss_lock);
+
+	if (!opened)
+	{
+		if (old_conn != NULL)
+			gtm_standby_disconnect_from_standby(old_conn);
+		return NULL;
+	}
+
+	if (old_conn == NULL)
+		return gtm_standby_connect_to_standby();
+
+	/* The thread's buffer survives, just forget about the failure */
+	if (old_conn->result)
+		old_conn->result->gr_status = GTM_RESULT_OK;
+
+	return old_conn;
+}
+
+/*
+ * Set up the shared replication stream. Called once at startup.
+ */
+void
+gtm_standby_stream_init(void)
+{
+	memset(&StandbyStream, 0, sizeof (StandbyStream));
+	GTM_MutexLockInit(&StandbyStream.ss_lock);
+	GTM_CVInit(&StandbyStream.ss_cv);
+}
+
+/*
+ * (Re)open the shared connection if there is none or it failed.
+ *
+ * Records written to a failed connection are not waited for any more, the
+ * threads that wrote them resend their message.  Must be called with ss_lock
+ * held.
+ */
+static bool
+gtm_standby_stream_open(int retry_max)
+{
+	int		report;
+	int		i;
+
+	if (StandbyStream.ss_conn != NULL && !StandbyStream.ss_broken)
+		return true;
+
+	/* Can't drop the connection under a reader's feet */
+	while (StandbyStream.ss_reading)
+		GTM_CVWait(&StandbyStream.ss_cv, &StandbyStream.ss_lock);
+
+	if (StandbyStream.ss_conn != NULL && !StandbyStream.ss_broken)
+		return true;
+
+	if (StandbyStream.ss_conn != NULL)
+	{
+		GTMPQfinish(StandbyStream.ss_reader);
+		StandbyStream.ss_reader = NULL;
+		gtm_standby_disconnect_from_standby(StandbyStream.ss_conn);
+		StandbyStream.ss_conn = NULL;
+	}
+
+	/* Unacknowledged records of the previous generation are lost */
+	StandbyStream.ss_gen++;
+	StandbyStream.ss_prev_ack_pos = StandbyStream.ss_ack_pos;
+	StandbyStream.ss_sync_pos = StandbyStream.ss_write_pos;
+	StandbyStream.ss_sync_head = 0;
+	StandbyStream.ss_sync_count = 0;
+	StandbyStream.ss_broken = false;
 
 	for (i = 0; i < retry_max; i++)
 	{
-		elog(DEBUG1, "gtm_standby_reconnect_to_standby(): going to re-connect. retry=%d", i);
+		elog(DEBUG1, "gtm_standby_stream_open(): connecting. retry=%d", i);
+
+		StandbyStream.ss_conn = gtm_standby_connect_to_standby_int(&report);
+		if (StandbyStream.ss_conn == NULL)
+			continue;
 
-		newconn = gtm_standby_connect_to_standby_int(&report);
-		if (newconn != NULL)
+		StandbyStream.ss_reader = GTMPQcreateReaderConn(StandbyStream.ss_conn);
+		if (StandbyStream.ss_reader != NULL)
 			break;
+		gtm_standby_disconnect_from_standby(StandbyStream.ss_conn);
+		StandbyStream.ss_conn = NULL;
+	}
+
+	/* Wake up anybody waiting for an acknowledgement that will never come */
+	GTM_CVBcast(&StandbyStream.ss_cv);
+
+	return (StandbyStream.ss_conn != NULL);
+}
+
+/*
+ * Send hook of the per-thread standby buffers: append the records to the
+ * shared connection.
+ */
+static int
+gtm_standby_stream_send(GTM_Conn *conn, const char *buf, int len)
+{
+	int		rc = -1;
 
-		elog(DEBUG1, "gtm_standby_reconnect_to_standby(): re-connect failed. retry=%d", i);
+	GTM_MutexLockAcquire(&StandbyStream.ss_lock);
+
+	/* A detached standby is not written to until it registers again */
+	if (GTMThreads->gt_standby_ready && gtm_standby_stream_open(1))
+	{
+		if (gtmpqPutRaw(buf, len, StandbyStream.ss_conn) == 0 &&
+			gtmpqFlush(StandbyStream.ss_conn) == 0)
+		{
+			GTM_ThreadInfo *thrinfo = GetMyThreadInfo;
+
+			thrinfo->thr_standby_pos = ++StandbyStream.ss_write_pos;
+			if (thrinfo->thr_standby_gen == 0)
+				thrinfo->thr_standby_gen = StandbyStream.ss_gen;
+			rc = 0;
+		}
+		else
+			StandbyStream.ss_broken = true;
 	}
+	else
+		GTMThreads->gt_standby_ready = false;	/* This will make other threads to disconnect from
+												 * the standby, if needed.*/
+
+	GTM_MutexLockRelease(&StandbyStream.ss_lock);
 
-	return newconn;
+	return rc;
 }
 
+/*
+ * Wait until the standby has processed every record this thread has
+ * written so far.
+ *
+ * Returns 0 once they are acknowledged, -1 if the connection they were
+ * written to failed before, in which case they may be lost.
+ */
+int
+gtm_standby_sync(void)
+{
+	GTM_ThreadInfo *thrinfo = GetMyThreadInfo;
+	uint64		pos;
+	uint64		gen;
+	uint64		start;
+	bool		acked;
+
+	if (thrinfo->thr_conn == NULL || thrinfo->thr_conn->standby == NULL)
+		return 0;
+
+	start = GTM_StatNow();
+
+	/* Push out whatever is still sitting in the thread's buffer */
+	if (gtmpqFlush(thrinfo->thr_conn->standby))
+	{
+		thrinfo->thr_standby_gen = 0;
+		return -1;
+	}
+	pos = thrinfo->thr_standby_pos;
+	gen = thrinfo->thr_standby_gen;
+	thrinfo->thr_standby_gen = 0;
+
+	/* Nothing written since the last sync */
+	if (gen == 0)
+		return 0;
+
+	GTM_MutexLockAcquire(&StandbyStream.ss_lock);
+
+	for (;;)
+	{
+		/* Records of a previous connection count if acknowledged on it */
+		if (gen != StandbyStream.ss_gen)
+		{
+			acked = (gen + 1 == StandbyStream.ss_gen &&
+					 pos <= StandbyStream.ss_prev_ack_pos);
+			break;
+		}
+
+		if (pos <= StandbyStream.ss_ack_pos)
+		{
+			acked = true;
+			break;
+		}
+
+		if (StandbyStream.ss_conn == NULL || StandbyStream.ss_broken)
+		{
+			acked = false;
+			break;
+		}
+
+		/* Ask for an acknowledgement, unless a pending one covers us */
+		if (StandbyStream.ss_sync_pos < pos &&
+			StandbyStream.ss_sync_count < GTM_STANDBY_MAX_INFLIGHT_SYNC)
+		{
+			int		tail;
+
+			if (send_sync_standby(StandbyStream.ss_conn))
+			{
+				StandbyStream.ss_broken = true;
+				GTM_CVBcast(&StandbyStream.ss_cv);
+				continue;
+			}
+
+			tail = (StandbyStream.ss_sync_head + StandbyStream.ss_sync_count) %
+				GTM_STANDBY_MAX_INFLIGHT_SYNC;
+			StandbyStream.ss_sync_queue[tail] = StandbyStream.ss_write_pos;
+			StandbyStream.ss_sync_count++;
+			StandbyStream.ss_sync_pos = StandbyStream.ss_write_pos;
+		}
+
+		if (!StandbyStream.ss_reading && StandbyStream.ss_sync_count > 0)
+		{
+			GTM_Conn   *reader = StandbyStream.ss_reader;
+			int			rc;
+
+			/*
+			 * Read the next reply on behalf of all the waiters.  Writers
+			 * only use ss_conn, and the connection is not reopened while
+			 * ss_reading is set, so the lock is not needed to read.
+			 */
+			StandbyStream.ss_reading = true;
+			GTM_MutexLockRelease(&StandbyStream.ss_lock);
+
+			rc = receive_sync_standby(reader);
+
+			GTM_MutexLockAcquire(&StandbyStream.ss_lock);
+			StandbyStream.ss_reading = false;
+
+			if (rc == GTM_RESULT_OK)
+			{
+				StandbyStream.ss_ack_pos =
+					StandbyStream.ss_sync_queue[StandbyStream.ss_sync_head];
+				StandbyStream.ss_sync_head = (StandbyStream.ss_sync_head + 1) %
+					GTM_STANDBY_MAX_INFLIGHT_SYNC;
+				StandbyStream.ss_sync_count--;
+			}
+			else
+			{
+				elog(DEBUG1, "communication error with standby.");
+				StandbyStream.ss_broken = true;
+			}
+
+			GTM_CVBcast(&StandbyStream.ss_cv);
+		}
+		else
+			GTM_CVWait(&StandbyStream.ss_cv, &StandbyStream.ss_lock);
+	}
+
+	GTM_MutexLockRelease(&StandbyStream.ss_lock);
+
+	GTM_StatHistAdd(&GTMStatStandby, GTM_StatNow() - start);
+
+	return acked ? 0 : -1;
+}
+
+/*
+ * Sync with the standby after sending it the backup message of a command.
+ *
+ * If the records of the thread may have been lost, returns true once the
+ * standby is reconnected so that the caller resends its message, at most
+ * once per retry_count.  With a NULL retry_count or when retrying did not
+ * help, the command is already applied here and can not be failed any more:
+ * the standby is detached, see gtm_standby_detach(), and the command is
+ * answered without its backup.
+ */
+bool
+gtm_standby_sync_or_resend(int *retry_count)
+{
+	GTM_ThreadInfo *thrinfo = GetMyThreadInfo;
+
+	if (gtm_standby_sync() == 0)
+		return false;
+
+	if (retry_count != NULL && *retry_count == 0)
+	{
+		(*retry_count)++;
+
+		thrinfo->thr_conn->standby =
+				gtm_standby_reconnect_to_standby(thrinfo->thr_conn->standby,
+												 GTM_STANDBY_RETRY_MAX);
+		if (thrinfo->thr_conn->standby)
+			return true;
+	}
+
+	gtm_standby_detach();
+	return false;
+}
+
+/*
+ * Stop replicating to the standby, which missed some records.
+ *
+ * Threads drop their standby buffer when they see gt_standby_ready unset,
+ * and nothing is written to the shared connection until the standby
+ * registers again, which it does once restarted and copied from this GTM.
+ */
+void
+gtm_standby_detach(void)
+{
+	GTM_ThreadInfo *thrinfo = GetMyThreadInfo;
+
+	GTM_MutexLockAcquire(&StandbyStream.ss_lock);
+	if (GTMThreads->gt_standby_ready)
+		elog(LOG, "GTM standby did not acknowledge the backup of a command, "
+			 "detaching it");
+	GTMThreads->gt_standby_ready = false;
+	StandbyStream.ss_broken = true;
+	GTM_CVBcast(&StandbyStream.ss_cv);
+	GTM_MutexLockRelease(&StandbyStream.ss_lock);
+
+	if (thrinfo->thr_conn->standby)
+	{
+		gtm_standby_disconnect_from_standby(thrinfo->thr_conn->standby);
+		thrinfo->thr_conn->standby = NULL;
+	}
+}
 
-#define GTM_STANDBY_RETRY_MAX 3
 
 bool
 gtm_standby_check_communication_error(int *retry_count, GTM_Conn *oldconn)
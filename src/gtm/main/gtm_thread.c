@@ -386,6 +386,9 @@ GTM_ThreadCleanup(void *argp)
 	 */
 	MemoryContextSwitchTo(thrinfo->thr_parent_context);
 
+	/* The cells are in TopMostMemoryContext, which outlives the thread */
+	GTM_FreeCachedOpenTransactionCells();
+
 	MemoryContextDelete(thrinfo->thr_message_context);
 	thrinfo->thr_message_context = NULL;
 
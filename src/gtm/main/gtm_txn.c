@@ -27,6 +27,7 @@
 #include "gtm/gtm_time.h"
 #include "gtm/gtm_txn.h"
 #include "gtm/gtm_serialize.h"
+#include "gtm/gtm_stat.h"
 #include "gtm/gtm_standby.h"
 #include "gtm/standby_utils.h"
 #include "gtm/libpq.h"
@@ -50,7 +51,6 @@ static void clean_GTM_TransactionInfo(GTM_TransactionInfo *gtm_txninfo);
 static GTM_TransactionHandle GTM_GlobalSessionIDToHandle(
 									const char *global_sessionid);
 
-GlobalTransactionId ControlXid;  /* last one written to control file */
 GTM_Transactions GTMTransactions;
 
 void
@@ -103,6 +103,10 @@ GTM_InitTxnManager(void)
 	 */
 	GTM_RWLockInit(&GTMTransactions.gt_XidGenLock);
 	GTM_RWLockInit(&GTMTransactions.gt_TransArrayLock);
+	GTMTransactions.gt_XidGenLock.lk_wait_stat =
+		&GTMStatLocks[GTM_STAT_LOCK_XIDGEN];
+	GTMTransactions.gt_TransArrayLock.lk_wait_stat =
+		&GTMStatLocks[GTM_STAT_LOCK_TRANSARRAY];
 
 	/*
 	 * Initialize the list
@@ -112,8 +116,6 @@ GTM_InitTxnManager(void)
 
 	GTMTransactions.gt_gtm_state = GTM_STARTING;
 
-	ControlXid = FirstNormalGlobalTransactionId;
-
 	return;
 }
 
@@ -279,12 +281,70 @@ GTM_HandleToTransactionInfo(GTM_TransactionHandle handle)
 
 
 /*
- * Remove the given transaction info structures from the global array. If the
- * calling thread does not have enough cached structures, we in fact keep the
- * structure in the global array and also add it to the list of cached
- * structures for this thread. This ensures that the next transaction starting
- * in this thread can quickly get a free slot in the array of transactions and
- * also avoid repeated malloc/free of the structures.
+ * Get a cell for the list of open transactions, from the cache of the
+ * calling thread if it has one.  Cells are allocated in TopMostMemoryContext,
+ * so that any thread may cache or free them.
+ *
+ * Called with gt_TransArrayLock held in write mode, which is why the cache
+ * is per thread: this keeps the shared allocator, and its own lock, out of
+ * the path of every transaction.
+ */
+static gtm_ListCell *
+GTM_GetOpenTransactionCell(void)
+{
+	GTM_ThreadInfo *thrinfo = GetMyThreadInfo;
+	gtm_ListCell *cell = thrinfo->thr_cached_cells;
+
+	if (cell == NULL)
+		return (gtm_ListCell *) MemoryContextAlloc(TopMostMemoryContext,
+												   sizeof (gtm_ListCell));
+
+	thrinfo->thr_cached_cells = cell->next;
+	thrinfo->thr_cached_cell_count--;
+	return cell;
+}
+
+/*
+ * Give back a cell of the list of open transactions, unlinked from it
+ */
+static void
+GTM_ReleaseOpenTransactionCell(gtm_ListCell *cell)
+{
+	GTM_ThreadInfo *thrinfo = GetMyThreadInfo;
+
+	if (thrinfo->thr_cached_cell_count >= GTM_MAX_CACHED_CELLS)
+	{
+		pfree(cell);
+		return;
+	}
+
+	cell->next = thrinfo->thr_cached_cells;
+	thrinfo->thr_cached_cells = cell;
+	thrinfo->thr_cached_cell_count++;
+}
+
+/*
+ * Free the cells cached by the calling thread, when it exits
+ */
+void
+GTM_FreeCachedOpenTransactionCells(void)
+{
+	GTM_ThreadInfo *thrinfo = GetMyThreadInfo;
+
+	while (thrinfo->thr_cached_cells != NULL)
+	{
+		gtm_ListCell *cell = thrinfo->thr_cached_cells;
+
+		thrinfo->thr_cached_cells = cell->next;
+		pfree(cell);
+	}
+	thrinfo->thr_cached_cell_count = 0;
+}
+
+/*
+ * Remove the given transaction info structures from the global list of open
+ * transactions. The structures stay in the global array, ready for the next
+ * transactions, and the list cells go to the cache of the calling thread.
  *
  * Also compute the latestCompletedXid.
  */
@@ -301,10 +361,25 @@ GTM_RemoveTransInfoMulti(GTM_TransactionInfo *gtm_txninfo[], int txn_count)
 
 	for (ii = 0; ii < txn_count; ii++)
 	{
+		gtm_ListCell *cell, *prev;
+
 		if (gtm_txninfo[ii] == NULL)
 			continue;
 
-		GTMTransactions.gt_open_transactions = gtm_list_delete(GTMTransactions.gt_open_transactions, gtm_txninfo[ii]);
+		prev = NULL;
+		gtm_foreach(cell, GTMTransactions.gt_open_transactions)
+		{
+			if (gtm_lfirst(cell) == gtm_txninfo[ii])
+				break;
+			prev = cell;
+		}
+		if (cell != NULL)
+		{
+			GTMTransactions.gt_open_transactions =
+				gtm_list_unlink_cell(GTMTransactions.gt_open_transactions,
+									 cell, prev);
+			GTM_ReleaseOpenTransactionCell(cell);
+		}
 
 		if (GlobalTransactionIdIsNormal(gtm_txninfo[ii]->gti_gxid) &&
 			GlobalTransactionIdFollowsOrEquals(gtm_txninfo[ii]->gti_gxid,
@@ -357,7 +432,8 @@ GTM_RemoveAllTransInfos(uint32 client_id, int backend_id)
 			((gtm_txninfo->gti_proxy_client_id == backend_id) || (backend_id == -1)))
 		{
 			/* remove the entry */
-			GTMTransactions.gt_open_transactions = gtm_list_delete_cell(GTMTransactions.gt_open_transactions, cell, prev);
+			GTMTransactions.gt_open_transactions = gtm_list_unlink_cell(GTMTransactions.gt_open_transactions, cell, prev);
+			GTM_ReleaseOpenTransactionCell(cell);
 
 			/* update the latestCompletedXid */
 			if (GlobalTransactionIdIsNormal(gtm_txninfo->gti_gxid) &&
@@ -533,7 +609,6 @@ GTM_GetGlobalTransactionIdMulti(GTM_TransactionHandle handle[], int txn_count,
 	GlobalTransactionId xid = InvalidGlobalTransactionId;
 	GTM_TransactionInfo *gtm_txninfo = NULL;
 	int ii;
-	bool save_control = false;
 
 	if (Recovery_IsStandby())
 	{
@@ -611,24 +686,19 @@ GTM_GetGlobalTransactionIdMulti(GTM_TransactionHandle handle[], int txn_count,
 		*new_txn_count = *new_txn_count + 1;
 	}
 
-	/* Periodically write the xid and sequence info out to the control file.
-	 * Try and handle wrapping, too.
+	/*
+	 * Reserve the next gxids in the GTM log before handing out any past the
+	 * restoration point.
 	 */
-	if (GlobalTransactionIdIsValid(xid) &&
-			(xid - ControlXid > CONTROL_INTERVAL || xid < ControlXid))
+	if (GTM_NeedXidRestoreUpdate() && !GTM_UpdateRestorePointXid())
 	{
-		save_control = true;
-		ControlXid = xid;
+		GTM_RWLockRelease(&GTMTransactions.gt_XidGenLock);
+		ereport(ERROR,
+				(EIO,
+				 errmsg("Failed to write the restoration point of gxid")));
 	}
-
-	if (GTM_NeedXidRestoreUpdate())
-		GTM_SetNeedBackup();
 	GTM_RWLockRelease(&GTMTransactions.gt_XidGenLock);
 
-	/* save control info when not holding the XidGenLock */
-	if (save_control)
-		SaveControlInfo();
-
 	return true;
 }
 
@@ -771,9 +841,13 @@ GTM_BeginTransactionMulti(GTM_IsolationLevel isolevel[],
 		 * Add the structure to the global list of open transactions. We should
 		 * call add the element to the list in the context of TopMostMemoryContext
 		 * because the list is global and any memory allocation must outlive the
-		 * thread context
+		 * thread context. The cell itself comes from the cache of this thread
+		 * when it has one.
 		 */
-		GTMTransactions.gt_open_transactions = gtm_lappend(GTMTransactions.gt_open_transactions, gtm_txninfo[kk]);
+		GTMTransactions.gt_open_transactions =
+			gtm_lappend_given_cell(GTMTransactions.gt_open_transactions,
+								   GTM_GetOpenTransactionCell(),
+								   gtm_txninfo[kk]);
 	}
 
 	GTM_RWLockRelease(&GTMTransactions.gt_TransArrayLock);
@@ -1043,26 +1117,49 @@ GTM_CommitTransactionMulti(GTM_TransactionHandle txn[], int txn_count,
 }
 
 /*
- * Prepare a transaction
+ * Prepare multiple transactions in one go
  */
 int
-GTM_PrepareTransaction(GTM_TransactionHandle txn)
+GTM_PrepareTransactionMulti(GTM_TransactionHandle txn[], int txn_count,
+		int status[])
 {
-	GTM_TransactionInfo *gtm_txninfo = NULL;
+	int prepared_count = 0;
+	int ii;
 
-	gtm_txninfo = GTM_HandleToTransactionInfo(txn);
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		GTM_TransactionInfo *gtm_txninfo;
 
-	if (gtm_txninfo == NULL)
-		return STATUS_ERROR;
+		gtm_txninfo = GTM_HandleToTransactionInfo(txn[ii]);
 
-	/*
-	 * Mark the transaction as prepared
-	 */
-	GTM_RWLockAcquire(&gtm_txninfo->gti_lock, GTM_LOCKMODE_WRITE);
-	gtm_txninfo->gti_state = GTM_TXN_PREPARED;
-	GTM_RWLockRelease(&gtm_txninfo->gti_lock);
+		if (gtm_txninfo == NULL)
+		{
+			status[ii] = STATUS_ERROR;
+			continue;
+		}
 
-	return STATUS_OK;
+		/*
+		 * Mark the transaction as prepared
+		 */
+		GTM_RWLockAcquire(&gtm_txninfo->gti_lock, GTM_LOCKMODE_WRITE);
+		gtm_txninfo->gti_state = GTM_TXN_PREPARED;
+		GTM_RWLockRelease(&gtm_txninfo->gti_lock);
+		status[ii] = STATUS_OK;
+		prepared_count++;
+	}
+
+	return prepared_count;
+}
+
+/*
+ * Prepare a transaction
+ */
+int
+GTM_PrepareTransaction(GTM_TransactionHandle txn)
+{
+	int status;
+	GTM_PrepareTransactionMulti(&txn, 1, &status);
+	return status;
 }
 
 /*
@@ -1231,7 +1328,7 @@ ProcessBeginTransactionCommand(Port *myport, StringInfo message)
 				GetMyThreadInfo->thr_client_id, timestamp);
 		/* Synch. with standby */
 		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-			gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			gtm_standby_sync_or_resend(NULL);
 	}
 
 	pq_beginmessage(&buf, 'S');
@@ -1353,8 +1450,9 @@ retry:
 			goto retry;
 
 		/* Sync */
-		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-			gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+			gtm_standby_sync_or_resend(&count))
+			goto retry;
 
 	}
 	/* Respond to the client */
@@ -1397,9 +1495,6 @@ GTM_BkupBeginTransactionGetGXIDMulti(GlobalTransactionId *gxid,
 	int count;
 	MemoryContext oldContext;
 
-	bool save_control = false;
-	GlobalTransactionId xid = InvalidGlobalTransactionId;
-
 	oldContext = MemoryContextSwitchTo(TopMostMemoryContext);
 
 	count = GTM_BeginTransactionMulti(isolevel, readonly, global_sessionid,
@@ -1420,33 +1515,21 @@ GTM_BkupBeginTransactionGetGXIDMulti(GlobalTransactionId *gxid,
 		elog(DEBUG1, "GTM_BkupBeginTransactionGetGXIDMulti: xid(%u), handle(%u)",
 				gxid[ii], txn[ii]);
 
-		/*
-		 * Advance next gxid -- because this is called at slave only, we don't care the restoration point
-		 * here.  Restoration point will be created at promotion.
-		 */
+		/* Advance next gxid */
 		if (GlobalTransactionIdPrecedesOrEquals(GTMTransactions.gt_nextXid, gxid[ii]))
 			GTMTransactions.gt_nextXid = gxid[ii] + 1;
 		if (!GlobalTransactionIdIsValid(GTMTransactions.gt_nextXid))	/* Handle wrap around too */
 			GTMTransactions.gt_nextXid = FirstNormalGlobalTransactionId;
-		xid = GTMTransactions.gt_nextXid;
 	}
 
-	/* Periodically write the xid and sequence info out to the control file.
-	 * Try and handle wrapping, too.
-	 */
-	if (GlobalTransactionIdIsValid(xid) &&
-			(xid - ControlXid > CONTROL_INTERVAL || xid < ControlXid))
-	{
-		save_control = true;
-		ControlXid = xid;
-	}
+	/* Keep the restoration point of the standby ahead of the active one */
+	GTM_RWLockAcquire(&GTMTransactions.gt_XidGenLock, GTM_LOCKMODE_WRITE);
+	if (GTM_NeedXidRestoreUpdate())
+		GTM_UpdateRestorePointXid();
+	GTM_RWLockRelease(&GTMTransactions.gt_XidGenLock);
 
 	GTM_RWLockRelease(&GTMTransactions.gt_TransArrayLock);
 
-	/* save control info when not holding the XidGenLock */
-	if (save_control)
-		SaveControlInfo();
-
 	MemoryContextSwitchTo(oldContext);
 }
 
@@ -1569,8 +1652,9 @@ ProcessBeginTransactionGetGXIDAutovacuumCommand(Port *myport, StringInfo message
 			goto retry;
 
 		/* Sync */
-		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-			gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+			gtm_standby_sync_or_resend(&count))
+			goto retry;
 
 		elog(DEBUG1, "begin_transaction_autovacuum() GXID=%d done.", _gxid);
 	}
@@ -1682,8 +1766,9 @@ retry:
 			goto retry;
 
 		/* Sync */
-		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-			gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+			gtm_standby_sync_or_resend(&count))
+			goto retry;
 
 		elog(DEBUG1, "begin_transaction_multi() rc=%d done.", _rc);
 	}
@@ -1816,8 +1901,9 @@ ProcessCommitTransactionCommand(Port *myport, StringInfo message, bool is_backup
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "commit_transaction() rc=%d done.", _rc);
 		}
@@ -1931,8 +2017,9 @@ ProcessCommitPreparedTransactionCommand(Port *myport, StringInfo message, bool i
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "commit_prepared_transaction() rc=%d done.", _rc);
 		}
@@ -1962,6 +2049,124 @@ ProcessCommitPreparedTransactionCommand(Port *myport, StringInfo message, bool i
 }
 
 
+/*
+ * Process MSG_TXN_COMMIT_PREPARED_MULTI/MSG_BKUP_TXN_COMMIT_PREPARED_MULTI
+ * message
+ *
+ * Each transaction comes with the GXID of its COMMIT PREPARED and the GXID
+ * of its PREPARE, like MSG_TXN_COMMIT_PREPARED.  Clients send this message
+ * only when they have no transaction to wait for, so unlike
+ * MSG_TXN_COMMIT_PREPARED a commit is never delayed.
+ *
+ * is_backup indicates the message is MSG_BKUP_TXN_COMMIT_PREPARED_MULTI
+ */
+void
+ProcessCommitPreparedTransactionCommandMulti(Port *myport, StringInfo message, bool is_backup)
+{
+	StringInfoData buf;
+	GTM_TransactionHandle txn[GTM_MAX_GLOBAL_TRANSACTIONS * 2];
+	GlobalTransactionId gxid[GTM_MAX_GLOBAL_TRANSACTIONS];
+	GlobalTransactionId prepared_gxid[GTM_MAX_GLOBAL_TRANSACTIONS];
+	MemoryContext oldContext;
+	int status[GTM_MAX_GLOBAL_TRANSACTIONS * 2];
+	int txn_count;
+	int ii;
+
+	txn_count = pq_getmsgint(message, sizeof (int));
+	if (txn_count <= 0 || txn_count > GTM_MAX_GLOBAL_TRANSACTIONS)
+		ereport(ERROR,
+				(EPROTO,
+				 errmsg("Invalid number of transactions %d", txn_count)));
+
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		const char *data = pq_getmsgbytes(message, sizeof (gxid[ii]));
+		if (data == NULL)
+			ereport(ERROR,
+					(EPROTO,
+					 errmsg("Message does not contain valid GXID")));
+		memcpy(&gxid[ii], data, sizeof (gxid[ii]));
+
+		data = pq_getmsgbytes(message, sizeof (prepared_gxid[ii]));
+		if (data == NULL)
+			ereport(ERROR,
+					(EPROTO,
+					 errmsg("Message does not contain valid GXID")));
+		memcpy(&prepared_gxid[ii], data, sizeof (prepared_gxid[ii]));
+
+		txn[ii * 2] = GTM_GXIDToHandle(gxid[ii]);
+		txn[ii * 2 + 1] = GTM_GXIDToHandle(prepared_gxid[ii]);
+		elog(DEBUG1, "ProcessCommitPreparedTransactionCommandMulti: gxid(%u), prepared gxid(%u)",
+			 gxid[ii], prepared_gxid[ii]);
+	}
+
+	pq_getmsgend(message);
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+
+	/*
+	 * Commit both GXIDs of all the transactions at once, so that they leave
+	 * the transaction array under a single lock
+	 */
+	GTM_CommitTransactionMulti(txn, txn_count * 2, 0, NULL, status);
+
+	MemoryContextSwitchTo(oldContext);
+
+	/* The status of a transaction is the one of its COMMIT PREPARED GXID */
+	for (ii = 0; ii < txn_count; ii++)
+		status[ii] = status[ii * 2];
+
+	if (!is_backup)
+	{
+		if (GetMyThreadInfo->thr_conn->standby)
+		{
+			/* Backup first */
+			int _rc;
+			GTM_Conn *oldconn = GetMyThreadInfo->thr_conn->standby;
+			int count = 0;
+
+			elog(DEBUG1, "calling commit_prepared_transaction_multi() for standby GTM %p.",
+				 GetMyThreadInfo->thr_conn->standby);
+
+		retry:
+			_rc = bkup_commit_prepared_transaction_multi(GetMyThreadInfo->thr_conn->standby,
+														 txn_count, gxid, prepared_gxid);
+
+			if (gtm_standby_check_communication_error(&count, oldconn))
+				goto retry;
+
+			/* Sync */
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
+
+			elog(DEBUG1, "commit_prepared_transaction_multi() rc=%d done.", _rc);
+		}
+		/* Respond to the client */
+		pq_beginmessage(&buf, 'S');
+		pq_sendint(&buf, TXN_COMMIT_PREPARED_MULTI_RESULT, 4);
+		if (myport->remote_type == GTM_NODE_GTM_PROXY)
+		{
+			GTM_ProxyMsgHeader proxyhdr;
+			proxyhdr.ph_conid = myport->conn_id;
+			pq_sendbytes(&buf, (char *)&proxyhdr, sizeof (GTM_ProxyMsgHeader));
+		}
+		pq_sendbytes(&buf, (char *)&txn_count, sizeof(txn_count));
+		pq_sendbytes(&buf, (char *)status, sizeof(int) * txn_count);
+		pq_endmessage(myport, &buf);
+
+		if (myport->remote_type != GTM_NODE_GTM_PROXY)
+		{
+			/* Flush the standby */
+			if (GetMyThreadInfo->thr_conn->standby)
+				gtmpqFlush(GetMyThreadInfo->thr_conn->standby);
+			pq_flush(myport);
+		}
+	}
+	return;
+}
+
+
 /*
  * Process MSG_TXN_GET_GID_DATA
  * This message is used after at the beginning of a COMMIT PREPARED
@@ -2210,8 +2415,9 @@ ProcessRollbackTransactionCommand(Port *myport, StringInfo message, bool is_back
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "abort_transaction() GXID=%d done.", gxid);
 		}
@@ -2302,8 +2508,9 @@ ProcessCommitTransactionCommandMulti(Port *myport, StringInfo message, bool is_b
 			if (gtm_standby_check_communication_error(&count, oldconn))
 				goto retry;
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "commit_transaction_multi() rc=%d done.", _rc);
 		}
@@ -2391,8 +2598,9 @@ ProcessRollbackTransactionCommandMulti(Port *myport, StringInfo message, bool is
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously &&(myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "abort_transaction_multi() rc=%d done.", _rc);
 		}
@@ -2492,8 +2700,9 @@ ProcessStartPreparedTransactionCommand(Port *myport, StringInfo message, bool is
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "start_prepared_transaction() rc=%d done.", _rc);
 		}
@@ -2571,8 +2780,9 @@ ProcessPrepareTransactionCommand(Port *myport, StringInfo message, bool is_backu
 				goto retry;
 
 			/* Sync */
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "prepare_transaction() GXID=%d done.", gxid);
 		}
@@ -2601,6 +2811,101 @@ ProcessPrepareTransactionCommand(Port *myport, StringInfo message, bool is_backu
 }
 
 
+/*
+ * Process MSG_TXN_PREPARE_MULTI/MSG_BKUP_TXN_PREPARE_MULTI message
+ *
+ * is_backup indicates the message is MSG_BKUP_TXN_PREPARE_MULTI
+ */
+void
+ProcessPrepareTransactionCommandMulti(Port *myport, StringInfo message, bool is_backup)
+{
+	StringInfoData buf;
+	GTM_TransactionHandle txn[GTM_MAX_GLOBAL_TRANSACTIONS];
+	GlobalTransactionId gxid[GTM_MAX_GLOBAL_TRANSACTIONS];
+	MemoryContext oldContext;
+	int status[GTM_MAX_GLOBAL_TRANSACTIONS];
+	int txn_count;
+	int ii;
+
+	txn_count = pq_getmsgint(message, sizeof (int));
+	if (txn_count <= 0 || txn_count > GTM_MAX_GLOBAL_TRANSACTIONS)
+		ereport(ERROR,
+				(EPROTO,
+				 errmsg("Invalid number of transactions %d", txn_count)));
+
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		const char *data = pq_getmsgbytes(message, sizeof (gxid[ii]));
+		if (data == NULL)
+			ereport(ERROR,
+					(EPROTO,
+					 errmsg("Message does not contain valid GXID")));
+		memcpy(&gxid[ii], data, sizeof (gxid[ii]));
+		txn[ii] = GTM_GXIDToHandle(gxid[ii]);
+		elog(DEBUG1, "ProcessPrepareTransactionCommandMulti: gxid(%u), handle(%u)", gxid[ii], txn[ii]);
+	}
+
+	pq_getmsgend(message);
+
+	oldContext = MemoryContextSwitchTo(TopMostMemoryContext);
+
+	/*
+	 * Prepare the transactions
+	 */
+	GTM_PrepareTransactionMulti(txn, txn_count, status);
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (!is_backup)
+	{
+		/* Backup first */
+		if (GetMyThreadInfo->thr_conn->standby)
+		{
+			int _rc;
+			GTM_Conn *oldconn = GetMyThreadInfo->thr_conn->standby;
+			int count = 0;
+
+			elog(DEBUG1, "calling prepare_transaction_multi() for standby GTM %p.",
+				 GetMyThreadInfo->thr_conn->standby);
+
+		retry:
+			_rc = bkup_prepare_transaction_multi(GetMyThreadInfo->thr_conn->standby,
+												 txn_count, gxid);
+
+			if (gtm_standby_check_communication_error(&count, oldconn))
+				goto retry;
+
+			/* Sync */
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
+
+			elog(DEBUG1, "prepare_transaction_multi() rc=%d done.", _rc);
+		}
+		/* Respond to the client */
+		pq_beginmessage(&buf, 'S');
+		pq_sendint(&buf, TXN_PREPARE_MULTI_RESULT, 4);
+		if (myport->remote_type == GTM_NODE_GTM_PROXY)
+		{
+			GTM_ProxyMsgHeader proxyhdr;
+			proxyhdr.ph_conid = myport->conn_id;
+			pq_sendbytes(&buf, (char *)&proxyhdr, sizeof (GTM_ProxyMsgHeader));
+		}
+		pq_sendbytes(&buf, (char *)&txn_count, sizeof(txn_count));
+		pq_sendbytes(&buf, (char *)status, sizeof(int) * txn_count);
+		pq_endmessage(myport, &buf);
+
+		if (myport->remote_type != GTM_NODE_GTM_PROXY)
+		{
+			/* Flush the standby */
+			if (GetMyThreadInfo->thr_conn->standby)
+				gtmpqFlush(GetMyThreadInfo->thr_conn->standby);
+			pq_flush(myport);
+		}
+	}
+	return;
+}
+
 /*
  * Process MSG_TXN_GET_GXID message
  *
@@ -2784,7 +3089,6 @@ GTM_RestoreTxnInfo(FILE *ctlf, GlobalTransactionId next_gxid)
 		{
 			/* Add in extra amount in case we had not gracefully stopped */
 			next_gxid = saved_gxid + CONTROL_INTERVAL;
-			ControlXid = next_gxid;
 		}
 	}
 	else if (!GlobalTransactionIdIsValid(next_gxid))
@@ -2796,9 +3100,27 @@ GTM_RestoreTxnInfo(FILE *ctlf, GlobalTransactionId next_gxid)
 		SetNextGlobalTransactionId(next_gxid);
 	/* Set this otherwise a strange snapshot might be returned for the first one */
 	GTMTransactions.gt_latestCompletedXid = next_gxid - 1;
+	/* Nothing is reserved yet, the first gxid will log a restoration point */
+	GTMTransactions.gt_backedUpXid = next_gxid;
 	return;
 }
 
+/*
+ * Apply a restoration point found in the GTM log.
+ */
+void
+GTM_ReplayRestorePointXid(GlobalTransactionId gxid)
+{
+	if (!GlobalTransactionIdPrecedes(GTMTransactions.gt_nextXid, gxid))
+		return;
+
+	elog(DEBUG1, "Restoring last GXID to %u from GTM log", gxid);
+
+	SetNextGlobalTransactionId(gxid);
+	GTMTransactions.gt_latestCompletedXid = gxid - 1;
+	GTMTransactions.gt_backedUpXid = gxid;
+}
+
 void
 GTM_SaveTxnInfo(FILE *ctlf)
 {
@@ -2816,15 +3138,44 @@ bool GTM_NeedXidRestoreUpdate(void)
 	return(GlobalTransactionIdPrecedesOrEquals(GTMTransactions.gt_backedUpXid, GTMTransactions.gt_nextXid));
 }
 
-void GTM_WriteRestorePointXid(FILE *f)
+/*
+ * Move the restoration point RestoreDuration gxids ahead and log it.
+ * Called with gt_XidGenLock held.
+ */
+bool GTM_UpdateRestorePointXid(void)
 {
+	GlobalTransactionId backedUpXid;
+	char record[32];
+
 	if ((MaxGlobalTransactionId - GTMTransactions.gt_nextXid) <= RestoreDuration)
-		GTMTransactions.gt_backedUpXid = GTMTransactions.gt_nextXid + RestoreDuration;
+		backedUpXid = GTMTransactions.gt_nextXid + RestoreDuration;
 	else
-		GTMTransactions.gt_backedUpXid = FirstNormalGlobalTransactionId + (RestoreDuration - (MaxGlobalTransactionId - GTMTransactions.gt_nextXid));
-	
-	elog(DEBUG1, "Saving transaction restoration info, backed-up gxid: %u", GTMTransactions.gt_backedUpXid);
-	fprintf(f, "%u\n", GTMTransactions.gt_backedUpXid);
+		backedUpXid = FirstNormalGlobalTransactionId + (RestoreDuration - (MaxGlobalTransactionId - GTMTransactions.gt_nextXid));
+
+	snprintf(record, sizeof (record), "X\t%u\n", backedUpXid);
+	if (!GTM_WalAppend(record))
+		return false;
+
+	GTMTransactions.gt_backedUpXid = backedUpXid;
+	elog(DEBUG1, "Logged transaction restoration info, backed-up gxid: %u", backedUpXid);
+	return true;
+}
+
+/*
+ * Save the restoration point in a checkpoint.  It is read under gt_XidGenLock,
+ * which is held while a new one is logged and set, so that the checkpoint
+ * does not save the previous one once its log record is covered.
+ */
+void GTM_WriteRestorePointXid(FILE *f)
+{
+	GlobalTransactionId backedUpXid;
+
+	GTM_RWLockAcquire(&GTMTransactions.gt_XidGenLock, GTM_LOCKMODE_READ);
+	backedUpXid = GTMTransactions.gt_backedUpXid;
+	GTM_RWLockRelease(&GTMTransactions.gt_XidGenLock);
+
+	elog(DEBUG1, "Saving transaction restoration info, backed-up gxid: %u", backedUpXid);
+	fprintf(f, "%u\n", backedUpXid);
 }
 
 GlobalTransactionId
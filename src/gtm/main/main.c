@@ -52,6 +52,7 @@
 #include "gtm/gtm_opt.h"
 #include "gtm/gtm_utils.h"
 #include "gtm/gtm_backup.h"
+#include "gtm/gtm_stat.h"
 
 extern int	optind;
 extern char *optarg;
@@ -81,6 +82,10 @@ bool		isStartUp;
 GTM_MutexLock   control_lock;
 char		GTMControlFileTmp[GTM_MAX_PATH];
 #define GTM_CONTROL_FILE_TMP		"gtm.control.tmp"
+char		GTMWalFile[GTM_MAX_PATH];
+char		GTMWalFileTmp[GTM_MAX_PATH];
+#define GTM_WAL_FILE			"gtm.wal"
+#define GTM_WAL_FILE_TMP		"gtm.wal.tmp"
 
 /* If this is GTM or not */
 /*
@@ -125,6 +130,7 @@ static void DeleteLockFile(const char *filename);
 static void PromoteToActive(void);
 static void ProcessSyncStandbyCommand(Port *myport, GTM_MessageType mtype, StringInfo message);
 static void ProcessBarrierCommand(Port *myport, GTM_MessageType mtype, StringInfo message);
+static void ProcessGetStatsCommand(Port *myport, StringInfo message);
 
 /*
  * One-time initialization. It's called immediately after the main process
@@ -194,8 +200,7 @@ InitGTMProcess()
 	MyThreadID = pthread_self();
 	MemoryContextInit();
 
-	/* Backup the restore point */
-	GTM_WriteRestorePoint();
+	GTM_InitWal();
 
 	/*
 	 * The memory context is now set up.
@@ -208,6 +213,7 @@ InitGTMProcess()
 		fflush(stderr);
 	}
 	GTM_MutexLockInit(&control_lock);
+	gtm_standby_stream_init();
 }
 
 static void
@@ -223,6 +229,8 @@ BaseInit()
 
 	sprintf(GTMControlFile, "%s/%s", GTMDataDir, GTM_CONTROL_FILE);
 	sprintf(GTMControlFileTmp, "%s/%s", GTMDataDir, GTM_CONTROL_FILE_TMP);
+	sprintf(GTMWalFile, "%s/%s", GTMDataDir, GTM_WAL_FILE);
+	sprintf(GTMWalFileTmp, "%s/%s", GTMDataDir, GTM_WAL_FILE_TMP);
 	if (GTMLogFile == NULL)
 	{
 		GTMLogFile = (char *) malloc(GTM_MAX_PATH);
@@ -312,33 +320,13 @@ gtm_status()
 }
 
 /*
- * Save control file info
+ * Save control file info, with the current gxid and sequence values. Used
+ * at shutdown, see GTM_WriteCheckpoint().
  */
 void
 SaveControlInfo(void)
 {
-	FILE	   *ctlf;
-
-	GTM_MutexLockAcquire(&control_lock);
-
-	ctlf = fopen(GTMControlFileTmp, "w");
-
-	if (ctlf == NULL)
-	{
-		fprintf(stderr, "Failed to create/open the control file\n");
-		fclose(ctlf);
-		GTM_MutexLockRelease(&control_lock);
-		return;
-	}
-
-	GTM_SaveTxnInfo(ctlf);
-	GTM_SaveSeqInfo(ctlf);
-	fclose(ctlf);
-
-	remove(GTMControlFile);
-	rename(GTMControlFileTmp, GTMControlFile);
-
-	GTM_MutexLockRelease(&control_lock);
+	GTM_WriteCheckpoint(false);
 }
 
 int
@@ -663,9 +651,19 @@ main(int argc, char *argv[])
 		if (ctlf)
 			fclose(ctlf);
 
+		/* Apply the changes logged since the control file was written */
+		GTM_ReplayWal();
+
 		GTM_MutexLockRelease(&control_lock);
 	}
 
+	/*
+	 * Start logging, and write a checkpoint of the restored state so that
+	 * the log only has to cover what happens from now on.
+	 */
+	GTM_OpenWal();
+	GTM_WriteCheckpoint(true);
+
 	if (Recovery_IsStandby())
 	{
 		if (!gtm_standby_register_self(NodeName, GTMPortNumber, GTMDataDir))
@@ -1241,7 +1239,7 @@ GTM_ThreadMain(void *argp)
 				if (thrinfo->thr_conn->standby)
 				{
 					if (Backup_synchronously)
-						gtm_sync_standby(thrinfo->thr_conn->standby);
+						gtm_standby_sync_or_resend(NULL);
 					else
 						gtmpqFlush(thrinfo->thr_conn->standby);
 				}
@@ -1279,6 +1277,7 @@ ProcessCommand(Port *myport, StringInfo input_message)
 {
 	GTM_MessageType mtype;
 	GTM_ProxyMsgHeader proxyhdr;
+	uint64		start;
 
 	if (myport->remote_type == GTM_NODE_GTM_PROXY)
 		pq_copymsgbytes(input_message, (char *)&proxyhdr, sizeof (GTM_ProxyMsgHeader));
@@ -1294,6 +1293,8 @@ ProcessCommand(Port *myport, StringInfo input_message)
 	 */
 	elog(DEBUG1, "mtype = %s (%d).", gtm_util_message_name(mtype), (int)mtype);
 
+	start = GTM_StatNow();
+
 	switch (mtype)
 	{
 		case MSG_SYNC_STANDBY:
@@ -1305,6 +1306,7 @@ ProcessCommand(Port *myport, StringInfo input_message)
 		case MSG_BKUP_NODE_UNREGISTER:
 		case MSG_NODE_LIST:
 		case MSG_REGISTER_SESSION:
+		case MSG_BKUP_REGISTER_SESSION:
 			ProcessPGXCNodeCommand(myport, mtype, input_message);
 			break;
 		case MSG_BEGIN_BACKUP:
@@ -1329,6 +1331,10 @@ ProcessCommand(Port *myport, StringInfo input_message)
 		case MSG_BKUP_TXN_COMMIT:
 		case MSG_TXN_COMMIT_PREPARED:
 		case MSG_BKUP_TXN_COMMIT_PREPARED:
+		case MSG_TXN_PREPARE_MULTI:
+		case MSG_BKUP_TXN_PREPARE_MULTI:
+		case MSG_TXN_COMMIT_PREPARED_MULTI:
+		case MSG_BKUP_TXN_COMMIT_PREPARED_MULTI:
 		case MSG_TXN_ROLLBACK:
 		case MSG_BKUP_TXN_ROLLBACK:
 		case MSG_TXN_GET_GXID:
@@ -1360,6 +1366,7 @@ ProcessCommand(Port *myport, StringInfo input_message)
 		case MSG_SEQUENCE_GET_CURRENT:
 		case MSG_SEQUENCE_GET_NEXT:
 		case MSG_BKUP_SEQUENCE_GET_NEXT:
+		case MSG_SEQUENCE_GET_NEXT_MULTI:
 		case MSG_SEQUENCE_GET_LAST:
 		case MSG_SEQUENCE_SET_VAL:
 		case MSG_BKUP_SEQUENCE_SET_VAL:
@@ -1385,6 +1392,17 @@ ProcessCommand(Port *myport, StringInfo input_message)
 			ProcessBarrierCommand(myport, mtype, input_message);
 			break;
 
+		case MSG_SHM_ATTACH:
+			/* Only a GTM proxy serves its clients through shared memory */
+			ereport(ERROR,
+					(EPROTO,
+					 errmsg("Shared memory transport is only available through a GTM proxy")));
+			break;
+
+		case MSG_GET_STATS:
+			ProcessGetStatsCommand(myport, input_message);
+			break;
+
 		case MSG_BACKEND_DISCONNECT:
 			elog(DEBUG1, "MSG_BACKEND_DISCONNECT received - removing all txn infos");
 			GTM_RemoveAllTransInfos(GetMyThreadInfo->thr_client_id, proxyhdr.ph_conid);
@@ -1398,6 +1416,9 @@ ProcessCommand(Port *myport, StringInfo input_message)
 					 errmsg("invalid frontend message type %d",
 							mtype)));
 	}
+
+	GTM_StatHistAdd(&GTMStatMessages[mtype], GTM_StatNow() - start);
+
 	if (GTM_NeedBackup())
 		GTM_WriteRestorePoint();
 }
@@ -1511,7 +1532,7 @@ ProcessSyncStandbyCommand(Port *myport, GTM_MessageType mtype, StringInfo messag
 	pq_endmessage(myport, &buf);
 	/* Sync standby first */
 	if (GetMyThreadInfo->thr_conn->standby)
-		gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+		gtm_standby_sync_or_resend(NULL);
 	pq_flush(myport);
 }
 
@@ -1543,7 +1564,11 @@ ProcessPGXCNodeCommand(Port *myport, GTM_MessageType mtype, StringInfo message)
 			break;
 
 		case MSG_REGISTER_SESSION:
-			ProcessPGXCRegisterSession(myport, message);
+			ProcessPGXCRegisterSession(myport, message, false);
+			break;
+
+		case MSG_BKUP_REGISTER_SESSION:
+			ProcessPGXCRegisterSession(myport, message, true);
 			break;
 
 		default:
@@ -1614,6 +1639,14 @@ ProcessTransactionCommand(Port *myport, GTM_MessageType mtype, StringInfo messag
 			ProcessPrepareTransactionCommand(myport, message, true);
 			break;
 
+		case MSG_TXN_PREPARE_MULTI:
+			ProcessPrepareTransactionCommandMulti(myport, message, false);
+			break;
+
+		case MSG_BKUP_TXN_PREPARE_MULTI:
+			ProcessPrepareTransactionCommandMulti(myport, message, true);
+			break;
+
 		case MSG_TXN_COMMIT:
 			ProcessCommitTransactionCommand(myport, message, false);
 			break;
@@ -1630,6 +1663,14 @@ ProcessTransactionCommand(Port *myport, GTM_MessageType mtype, StringInfo messag
 			ProcessCommitPreparedTransactionCommand(myport, message, true);
 			break;
 
+		case MSG_TXN_COMMIT_PREPARED_MULTI:
+			ProcessCommitPreparedTransactionCommandMulti(myport, message, false);
+			break;
+
+		case MSG_BKUP_TXN_COMMIT_PREPARED_MULTI:
+			ProcessCommitPreparedTransactionCommandMulti(myport, message, true);
+			break;
+
 		case MSG_TXN_ROLLBACK:
 			ProcessRollbackTransactionCommand(myport, message, false);
 			break;
@@ -1745,6 +1786,10 @@ ProcessSequenceCommand(Port *myport, GTM_MessageType mtype, StringInfo message)
 			ProcessSequenceGetNextCommand(myport, message, true);
 			break;
 
+		case MSG_SEQUENCE_GET_NEXT_MULTI:
+			ProcessSequenceGetNextCommandMulti(myport, message);
+			break;
+
 		case MSG_SEQUENCE_SET_VAL:
 			ProcessSequenceSetValCommand(myport, message, false);
 			break;
@@ -2214,8 +2259,9 @@ static void ProcessBarrierCommand(Port *myport, GTM_MessageType mtype, StringInf
 		if (gtm_standby_check_communication_error(&count, oldconn))
 			goto retry;
 
-		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-			gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+			gtm_standby_sync_or_resend(&count))
+			goto retry;
 	}
 
 	GTM_WriteBarrierBackup(barrier_id);
@@ -2244,4 +2290,45 @@ static void ProcessBarrierCommand(Port *myport, GTM_MessageType mtype, StringInf
 		}
 	}
 }
-	
+
+/*
+ * Send back the latency histograms
+ */
+static void
+ProcessGetStatsCommand(Port *myport, StringInfo message)
+{
+	GTM_StatEntry *entries;
+	int			count;
+	int			ii;
+	StringInfoData buf;
+
+	pq_getmsgend(message);
+
+	entries = (GTM_StatEntry *) palloc(sizeof (GTM_StatEntry) * GTM_STAT_MAX_ENTRIES);
+	count = GTM_StatCollect(entries);
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendint(&buf, GET_STATS_RESULT, 4);
+	if (myport->remote_type == GTM_NODE_GTM_PROXY)
+	{
+		GTM_ProxyMsgHeader proxyhdr;
+		proxyhdr.ph_conid = myport->conn_id;
+		pq_sendbytes(&buf, (char *)&proxyhdr, sizeof (GTM_ProxyMsgHeader));
+	}
+	pq_sendint(&buf, count, sizeof (int));
+	for (ii = 0; ii < count; ii++)
+	{
+		int			namelen = strlen(entries[ii].se_name);
+
+		pq_sendint(&buf, entries[ii].se_kind, sizeof (int));
+		pq_sendint(&buf, namelen, sizeof (int));
+		pq_sendbytes(&buf, entries[ii].se_name, namelen);
+		pq_sendbytes(&buf, (char *) &entries[ii].se_hist, sizeof (GTM_StatHist));
+	}
+	pq_endmessage(myport, &buf);
+
+	if (myport->remote_type != GTM_NODE_GTM_PROXY)
+		pq_flush(myport);
+
+	pfree(entries);
+}
@@ -52,6 +52,9 @@ extern int GTMProxyPortNumber;
 extern int GTMConnectRetryInterval;
 extern int GTMServerPortNumber;
 extern int GTMProxyWorkerThreads;
+extern int GTMProxySharedMemorySlots;
+extern bool GTMProxyShareSnapshots;
+extern bool GTMProxyCacheSequences;
 extern char *GTMProxyDataDir;
 extern char *GTMProxyConfigFileName;
 extern char *GTMConfigFileName;
@@ -141,6 +144,26 @@ Config_Type_Names();
 
 struct config_bool ConfigureNamesBool[] =
 {
+	{
+		{
+			GTM_OPTNAME_SHARE_SNAPSHOTS, GTMC_STARTUP,
+			gettext_noop("Serves snapshot requests from the last snapshot received from GTM while no commit was acknowledged since."),
+			gettext_noop("Only consistent when all the transactions are committed through this GTM proxy. Default value is off."),
+			0
+		},
+		&GTMProxyShareSnapshots,
+		false, false, NULL
+	},
+	{
+		{
+			GTM_OPTNAME_CACHE_SEQUENCES, GTMC_STARTUP,
+			gettext_noop("Reserves ranges of sequence values from GTM and serves nextval from them."),
+			gettext_noop("Values are no longer handed out in order across GTM proxies. Default value is off."),
+			0
+		},
+		&GTMProxyCacheSequences,
+		false, false, NULL
+	},
 	/* End-of-list marker */
 	{
 		{NULL, 0, NULL, NULL, 0}, NULL, false, false, NULL
@@ -227,6 +250,17 @@ struct config_int ConfigureNamesInt[] =
 		GTM_PROXY_DEFAULT_WORKERS, 1, INT_MAX,
 		0, NULL
 	},
+	{
+		{
+			GTM_OPTNAME_SHARED_MEMORY_SLOTS, GTMC_STARTUP,
+			gettext_noop("Number of local clients served through shared memory."),
+			gettext_noop("0 disables the shared memory transport. Default value is 0."),
+			0
+		},
+		&GTMProxySharedMemorySlots,
+		0, 0, INT_MAX,
+		0, NULL
+	},
 	/* End-of-list marker */
 	{
 		{NULL, 0, NULL, NULL, 0}, NULL, 0, 0, 0, 0, NULL
@@ -22,7 +22,6 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -50,6 +49,8 @@
 /* For reconnect control lock */
 #include "gtm/gtm_lock.h"
 #include "gtm/gtm_opt.h"
+#include "gtm/gtm_time.h"
+#include "gtm/gtm_shmq.h"
 
 extern int	optind;
 extern char *optarg;
@@ -73,6 +74,9 @@ static char *progname = "gtm_proxy";
 char	   *ListenAddresses;
 int			GTMProxyPortNumber;
 int			GTMProxyWorkerThreads;
+bool		GTMProxyShareSnapshots = false;
+bool		GTMProxyCacheSequences = false;
+int			GTMProxySharedMemorySlots = 0;
 char		*GTMProxyDataDir;
 char		*GTMProxyConfigFileName;
 char		*GTMConfigFileName;
@@ -126,6 +130,72 @@ pthread_key_t	threadinfo_key;
 static bool		GTMProxyAbortPending = false;
 static GTM_Conn *master_conn;
 
+/* Segment of the shared memory transport, when shared_memory_slots > 0 */
+static GTM_Shmq *GTMProxy_Shmq = NULL;
+
+/*
+ * The last snapshot received from GTM, shared by all the worker threads when
+ * share_snapshots is on.
+ *
+ * ss_version counts the commits acknowledged through this proxy.  A snapshot
+ * is kept only if no commit was acknowledged between the time its request
+ * was sent and the time it came back, and is dropped at the next commit, so
+ * it includes every commit a client may have been told about.
+ */
+typedef struct GTMProxy_SharedSnapshot
+{
+	GTM_RWLock			ss_lock;
+	uint64				ss_version;
+	bool				ss_valid;
+	GlobalTransactionId	ss_xmin;
+	GlobalTransactionId	ss_xmax;
+	int					ss_xcnt;
+	GlobalTransactionId	ss_xip[GTM_MAX_GLOBAL_TRANSACTIONS];
+} GTMProxy_SharedSnapshot;
+
+static GTMProxy_SharedSnapshot SharedSnapshot;
+
+/*
+ * Sequence values reserved from GTM by a worker thread when cache_sequences
+ * is on.  The values from sc_next to sc_rangemax are handed out to the
+ * backends of the thread.  Once they are used up, the next request asks GTM
+ * for a refill along with its own values, sized to last about
+ * SEQ_CACHE_TARGET_MS at the rate they were consumed.
+ */
+typedef struct GTMProxy_SeqCache
+{
+	GTM_Sequence		sc_next;
+	GTM_Sequence		sc_rangemax;
+	GTM_Sequence		sc_increment;
+	bool				sc_empty;
+	bool				sc_refilling;	/* a refill is in flight */
+	GTM_Sequence		sc_consumed;	/* values handed out since last refill */
+	GTM_Timestamp		sc_refill_time;	/* when the last refill was asked */
+	uint32				sc_keylen;
+	char				sc_key[1];		/* VARIABLE LENGTH ARRAY */
+} GTMProxy_SeqCache;
+
+#define SEQ_CACHE_TARGET_MS		1000
+#define SEQ_CACHE_MAX_REFILL	10000
+
+/*
+ * The last value of a sequence served by the proxy to a connection, which
+ * currval of the session returns.
+ */
+typedef struct GTMProxy_SeqLastVal
+{
+	GTM_Sequence		sl_value;
+	uint32				sl_keylen;
+	char				sl_key[1];		/* VARIABLE LENGTH ARRAY */
+} GTMProxy_SeqLastVal;
+
+/*
+ * Bumped whenever a sequence change is acknowledged through this proxy, so
+ * that the worker threads discard the values they reserved before.
+ */
+static GTM_MutexLock SeqGenerationLock;
+static uint64 SeqGeneration;
+
 
 /*
  * External Routines
@@ -139,9 +209,22 @@ extern void InitializeGTMOptions(void);
 static Port *ConnCreate(int serverFd);
 static void ConnFree(Port *conn);
 static int ServerLoop(void);
-static int initMasks(fd_set *rmask);
+static int initPollFds(struct pollfd *pfds);
+static void RaiseOpenFileLimit(void);
 void *GTMProxy_ThreadMain(void *argp);
 static int GTMProxyAddConnection(Port *port);
+static void GTMProxy_TakeNewConnections(GTMProxy_ThreadInfo *thrinfo);
+static void GTMProxy_ReadConnection(GTMProxy_ThreadInfo *thrinfo,
+		GTMProxy_ConnectionInfo *conninfo, StringInfo input_message);
+static void GTMProxy_CloseConnection(GTMProxy_ThreadInfo *thrinfo,
+		GTMProxy_ConnectionInfo *conninfo);
+static void GTMProxy_RemoveClosedConnections(GTMProxy_ThreadInfo *thrinfo);
+static void GTMProxy_AttachSharedMemory(GTMProxy_ConnectionInfo *conninfo,
+		StringInfo message);
+static void GTMProxy_DetachSharedMemory(GTMProxy_ThreadInfo *thrinfo,
+		GTMProxy_ConnectionInfo *conninfo);
+static bool GTMProxy_SharedMemoryReady(GTMProxy_ConnectionInfo *conninfo);
+static bool GTMProxy_SharedMemoryPending(GTMProxy_ThreadInfo *thrinfo);
 static int ReadCommand(GTMProxy_ConnectionInfo *conninfo, StringInfo inBuf);
 static void GTMProxy_HandshakeConnection(GTMProxy_ConnectionInfo *conninfo);
 static void GTMProxy_HandleDisconnect(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn);
@@ -169,6 +252,35 @@ static void ProcessResponse(GTMProxy_ThreadInfo *thrinfo,
 		GTMProxy_CommandInfo *cmdinfo, GTM_Result *res);
 
 static void GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo);
+static gtm_List *GTMProxy_SplitPendingCommands(GTMProxy_ThreadInfo *thrinfo,
+		GTM_MessageType mtype);
+static void GTMProxy_QueueBatch(GTMProxy_ThreadInfo *thrinfo, uint64 snapshot_version);
+static void GTMProxy_ProcessBatchResponses(GTMProxy_ThreadInfo *thrinfo);
+static void GTMProxy_DropBatches(GTMProxy_ThreadInfo *thrinfo);
+static void GTMProxy_ReportDroppedCommand(GTMProxy_CommandInfo *cmdinfo);
+static uint64 GTMProxy_GetSnapshotVersion(void);
+static void GTMProxy_ShareSnapshot(GTM_Snapshot snapshot, uint64 version);
+static void GTMProxy_InvalidateSharedSnapshot(void);
+static bool GTMProxy_SendSharedSnapshot(GTMProxy_ConnectionInfo *conninfo);
+static void ProcessSequenceCommand(GTMProxy_ConnectionInfo *conninfo,
+		GTM_Conn *gtm_conn, GTM_MessageType mtype, StringInfo message);
+static uint64 GTMProxy_GetSeqGeneration(void);
+static void GTMProxy_BumpSeqGeneration(void);
+static GTMProxy_SeqCache *GTMProxy_GetSeqCache(GTMProxy_ThreadInfo *thrinfo,
+		const char *key, uint32 keylen, bool create);
+static bool GTMProxy_SendCachedSequence(GTMProxy_ConnectionInfo *conninfo,
+		const char *key, uint32 keylen, GTM_Sequence range);
+static GTM_Sequence GTMProxy_SeqRefillSize(GTMProxy_SeqCache *cache,
+		GTM_Sequence range);
+static void GTMProxy_CacheSequenceRange(GTMProxy_ThreadInfo *thrinfo,
+		GTMProxy_CommandInfo *cmdinfo, GTM_Result *res);
+static void GTMProxy_SetSequenceLastVal(GTMProxy_ConnectionInfo *conninfo,
+		const char *key, uint32 keylen, GTM_Sequence value);
+static bool GTMProxy_SendSequenceLastVal(GTMProxy_ConnectionInfo *conninfo,
+		const char *key, uint32 keylen);
+static void GTMProxy_ForgetSequenceLastVal(GTMProxy_ConnectionInfo *conninfo,
+		const char *key, uint32 keylen);
+static void GTMProxy_FreeCommand(GTMProxy_CommandInfo *cmdinfo);
 static void GTMProxy_CommandPending(GTMProxy_ConnectionInfo *conninfo,
 		GTM_MessageType mtype, GTMProxy_CommandData cmd_data);
 
@@ -272,6 +384,9 @@ BaseInit()
 
 	GTM_RWLockInit(&ReconnectControlLock);
 
+	GTM_RWLockInit(&SharedSnapshot.ss_lock);
+	GTM_MutexLockInit(&SeqGenerationLock);
+
 	/* Register Proxy on GTM */
 	RegisterProxy(false);
 
@@ -525,6 +640,10 @@ GTMProxy_SigleHandler(int signal)
 	/* Delete pid file before shutting down */
 	DeleteLockFile(GTM_PID_FILE);
 
+	/* No more clients shall find the shared memory segment */
+	if (GTMProxy_Shmq)
+		GTM_ShmqRemove(GTMProxy_Shmq);
+
 	PG_SETMASK(&BlockSig);
 	GTMProxyAbortPending = true;
 
@@ -804,6 +923,8 @@ main(int argc, char *argv[])
 
 	elog(LOG, "Starting GTM proxy at (%s:%d)", ListenAddresses, GTMProxyPortNumber);
 
+	RaiseOpenFileLimit();
+
 	/*
 	 * Establish input sockets.
 	 */
@@ -838,6 +959,22 @@ main(int argc, char *argv[])
 		ereport(FATAL,
 				(errmsg("no socket created for listening")));
 
+	/*
+	 * Now that we own the port, set up the shared memory segment local
+	 * clients find by it.  They keep using TCP if this fails.
+	 */
+	if (GTMProxySharedMemorySlots > 0)
+	{
+		GTMProxy_Shmq = GTM_ShmqCreate(GTMProxyPortNumber,
+									   GTMProxySharedMemorySlots,
+									   GTMProxyWorkerThreads + 1);
+		if (GTMProxy_Shmq == NULL)
+			ereport(LOG,
+					(errno,
+					 errmsg("could not create shared memory segment for %d clients: %m",
+							GTMProxySharedMemorySlots)));
+	}
+
 	/*
 	 * Record gtm proxy options.  We delay this till now to avoid recording
 	 * bogus options
@@ -935,14 +1072,13 @@ ConnFree(Port *conn)
 static int
 ServerLoop(void)
 {
-	fd_set		readmask;
+	struct pollfd listen_fds[MAXLISTEN];
 	int			nSockets;
 
-	nSockets = initMasks(&readmask);
+	nSockets = initPollFds(listen_fds);
 
 	for (;;)
 	{
-		fd_set		rmask;
 		int			selres;
 
 		if (sigsetjmp(mainThreadSIGUSR1_buf, 1) != 0)
@@ -978,8 +1114,6 @@ ServerLoop(void)
 		 * Wait at most one minute, to ensure that the other background
 		 * tasks handled below get done even when no requests are arriving.
 		 */
-		memcpy((char *) &rmask, (char *) &readmask, sizeof(fd_set));
-
 		PG_SETMASK(&UnBlockSig);
 
 		if (GTMProxyAbortPending)
@@ -992,15 +1126,7 @@ ServerLoop(void)
 			exit(1);
 		}
 
-		{
-			/* must set timeout each time; some OSes change it! */
-			struct timeval timeout;
-
-			timeout.tv_sec = 60;
-			timeout.tv_usec = 0;
-
-			selres = select(nSockets, &rmask, NULL, NULL, &timeout);
-		}
+		selres = poll(listen_fds, nSockets, 60 * 1000);
 
 		/*
 		 * Block all signals until we wait again.  (This makes it safe for our
@@ -1008,14 +1134,14 @@ ServerLoop(void)
 		 */
 		PG_SETMASK(&BlockSig);
 
-		/* Now check the select() result */
+		/* Now check the poll() result */
 		if (selres < 0)
 		{
 			if (errno != EINTR && errno != EWOULDBLOCK)
 			{
 				ereport(DEBUG1,
 						(EACCES,
-						 errmsg("select() failed in main thread: %m")));
+						 errmsg("poll() failed in main thread: %m")));
 				return STATUS_ERROR;
 			}
 		}
@@ -1028,15 +1154,13 @@ ServerLoop(void)
 		{
 			int			i;
 
-			for (i = 0; i < MAXLISTEN; i++)
+			for (i = 0; i < nSockets; i++)
 			{
-				if (ListenSocket[i] == -1)
-					break;
-				if (FD_ISSET(ListenSocket[i], &rmask))
+				if (listen_fds[i].revents & POLLIN)
 				{
 					Port	   *port;
 
-					port = ConnCreate(ListenSocket[i]);
+					port = ConnCreate(listen_fds[i].fd);
 					if (port)
 					{
 						if (GTMProxyAddConnection(port) != STATUS_OK)
@@ -1052,29 +1176,46 @@ ServerLoop(void)
 }
 
 /*
- * Initialise the masks for select() for the ports we are listening on.
+ * Initialise the poll() array for the ports we are listening on.
  * Return the number of sockets to listen on.
  */
 static int
-initMasks(fd_set *rmask)
+initPollFds(struct pollfd *pfds)
 {
-	int			maxsock = -1;
 	int			i;
 
-	FD_ZERO(rmask);
-
 	for (i = 0; i < MAXLISTEN; i++)
 	{
 		int			fd = ListenSocket[i];
 
 		if (fd == -1)
 			break;
-		FD_SET(fd, rmask);
-		if (fd > maxsock)
-			maxsock = fd;
+		pfds[i].fd = fd;
+		pfds[i].events = POLLIN;
+		pfds[i].revents = 0;
 	}
 
-	return maxsock + 1;
+	return i;
+}
+
+/*
+ * Each client connection takes a descriptor, raise the limit on them as far
+ * as we are allowed to.
+ */
+static void
+RaiseOpenFileLimit(void)
+{
+	struct rlimit rlim;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) != 0)
+		return;
+
+	if (rlim.rlim_cur == RLIM_INFINITY || rlim.rlim_cur >= rlim.rlim_max)
+		return;
+
+	rlim.rlim_cur = rlim.rlim_max;
+	if (setrlimit(RLIMIT_NOFILE, &rlim) != 0)
+		elog(LOG, "Could not raise the open file limit: %s", strerror(errno));
 }
 
 /*
@@ -1084,11 +1225,13 @@ void *
 GTMProxy_ThreadMain(void *argp)
 {
 	GTMProxy_ThreadInfo *thrinfo = (GTMProxy_ThreadInfo *)argp;
-	int qtype;
 	StringInfoData input_message;
 	sigjmp_buf  local_sigjmp_buf;
-	int32 saved_seqno = -1;
-	int ii, nrfds;
+	int ii, nevents;
+	uint32 gtm_revents;
+	bool read_commands;
+	bool shm_pending = false;
+	uint64 snapshot_version;
 	char gtm_connect_string[1024];
 	int	first_turn = TRUE;	/* Used only to set longjmp target at the first turn of thread loop */
 	GTMProxy_CommandData cmd_data = {};
@@ -1131,15 +1274,7 @@ GTMProxy_ThreadMain(void *argp)
 
 	thrinfo->reconnect_issued = FALSE;
 
-	/*
-	 * Initialize comand backup area
-	 */
-	for (ii = 0; ii < GTM_PROXY_MAX_CONNECTIONS; ii++)
-	{
-		thrinfo->thr_any_backup[ii] = FALSE;
-		thrinfo->thr_qtype[ii] = 0;
-		initStringInfo(&(thrinfo->thr_inBufData[ii]));
-	}
+	GTMProxy_WaitSetInit(thrinfo);
 
 	/*
 	 * If an exception is encountered, processing resumes here so we abort the
@@ -1164,41 +1299,49 @@ GTMProxy_ThreadMain(void *argp)
 		 * error recovery, such as adjusting the FE/BE protocol status.
 		 */
 
+		/*
+		 * A connection that failed its handshake is of no use, close it
+		 */
+		if (thrinfo->thr_conn && !thrinfo->thr_conn->con_authenticated &&
+			!thrinfo->thr_conn->con_disconnected)
+		{
+			EmitErrorReport(NULL);
+			GTMProxy_CloseConnection(thrinfo, thrinfo->thr_conn);
+		}
+
 		/* Report the error to the client and/or server log */
-		if (thrinfo->thr_conn_count > 0)
+		else if (thrinfo->thr_conn_count > 0)
 		{
 			for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
 			{
 				int connIndx = thrinfo->thr_conn_map[ii];
 				GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
-				
+
+				if (conninfo->con_disconnected)
+					continue;
+
 				/*
-				 * Now clean up disconnected connections
+				 * Consume all the pending data on this connection and send
+				 * error report
 				 */
-				if (conninfo->con_disconnected)
-				{
-					GTMProxy_ThreadRemoveConnection(thrinfo, conninfo);
-					pfree(conninfo);
-					ii--;
-				}
-				else
+				if (conninfo->con_pending_msg != MSG_TYPE_INVALID)
 				{
-					/*
-					 * Consume all the pending data on this connection and send
-					 * error report
-					 */
-					if (conninfo->con_pending_msg != MSG_TYPE_INVALID)
-					{
-						conninfo->con_port->PqRecvPointer = conninfo->con_port->PqRecvLength = 0;
-						conninfo->con_pending_msg = MSG_TYPE_INVALID;
-						EmitErrorReport(conninfo->con_port);
-					}
+					conninfo->con_port->PqRecvPointer = conninfo->con_port->PqRecvLength = 0;
+					conninfo->con_pending_msg = MSG_TYPE_INVALID;
+					EmitErrorReport(conninfo->con_port);
 				}
 			}
 		}
 		else
 			EmitErrorReport(NULL);
 
+		/*
+		 * The command being read may have been kept for another try, and
+		 * disconnected connections may be ready to clean up
+		 */
+		thrinfo->thr_resend_backups = true;
+		GTMProxy_RemoveClosedConnections(thrinfo);
+
 		/*
 		 * Now return to normal top-level context and clear ErrorContext for
 		 * next time.
@@ -1224,9 +1367,6 @@ GTMProxy_ThreadMain(void *argp)
 	 */
 	for (;;)
 	{
-		gtm_ListCell *elem = NULL;
-		GTM_Result *res = NULL;
-
 		/*
 		 * Release storage left over from prior query cycle, and create a new
 		 * query input buffer in the cleared MessageContext.
@@ -1240,85 +1380,123 @@ GTMProxy_ThreadMain(void *argp)
 		if (!first_turn)
 		{
 			/*
-			 * Check if there are any changes to the connection array assigned to
-			 * this thread. If so, we need to rebuild the fd array.
+			 * Take the connections handed over by the main thread. If there
+			 * are none at all, wait for at least one connection to be
+			 * assigned to us
 			 */
 			GTM_MutexLockAcquire(&thrinfo->thr_lock);
-			if (saved_seqno != thrinfo->thr_seqno)
+			while (thrinfo->thr_conn_count <= 0 && thrinfo->thr_new_conns == NULL)
 			{
-				saved_seqno = thrinfo->thr_seqno;
-
-				while (thrinfo->thr_conn_count <= 0)
+				if (sigsetjmp(GetMyThreadInfo->longjmp_env, 1) == 0)
 				{
-					/*
-					 * No connections assigned to the thread. Wait for at least one
-					 * connection to be assigned to us
-					 */
-					if (sigsetjmp(GetMyThreadInfo->longjmp_env, 1) == 0)
-					{
-						Enable_Longjmp();
-						GTM_CVWait(&thrinfo->thr_cv, &thrinfo->thr_lock);
-						Disable_Longjmp();
-					}
-					else
-					{
-						/* SIGUSR2 here */
-						workerThreadReconnectToGTM();
-					}
+					Enable_Longjmp();
+					GTM_CVWait(&thrinfo->thr_cv, &thrinfo->thr_lock);
+					Disable_Longjmp();
+				}
+				else
+				{
+					/* SIGUSR2 here */
+					workerThreadReconnectToGTM();
 				}
+			}
+			GTM_MutexLockRelease(&thrinfo->thr_lock);
+
+			GTMProxy_TakeNewConnections(thrinfo);
 
-				memset(thrinfo->thr_poll_fds, 0, sizeof (thrinfo->thr_poll_fds));
+			thrinfo->thr_nevents = 0;
+			shm_pending = false;
+			while (true)
+			{
+				GTM_Conn *gtm_conn = thrinfo->thr_gtm_conn;
+				int		timeout_ms = poll_timeout_ms;
+				uint32	gtm_events = 0;
 
 				/*
-				 * Now grab all the open connections. A lock is being hold so no
-				 * new connections can be added.
+				 * With batches in flight, wait for their responses too, and
+				 * for the GTM connection to take the rest of the last batch
+				 * if it could not be sent at once.  Do not wait at all if a
+				 * response has already been read in.
 				 */
-				for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
+				if (thrinfo->thr_batches != gtm_NIL)
 				{
-					int connIndx = thrinfo->thr_conn_map[ii];
-					GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
-
-					/*
-					 * Detect if the connection has been dropped to avoid
-					 * a segmentation fault.
-					 */
-					if (conninfo->con_port == NULL)
-					{
-						conninfo->con_disconnected = true;
-						continue;
-					}
+					gtm_events = GTM_PROXY_EV_READ;
+					if (gtm_conn->outCount > 0)
+						gtm_events |= GTM_PROXY_EV_WRITE;
 
-					/*
-					 * If this is a newly added connection, complete the handshake
-					 */
-					if (!conninfo->con_authenticated)
-						GTMProxy_HandshakeConnection(conninfo);
+					if (gtm_conn->inStart < gtm_conn->inEnd)
+						timeout_ms = 0;
+				}
+				GTMProxy_WaitSetWatchGTM(thrinfo, gtm_conn->sock, gtm_events);
 
-					thrinfo->thr_poll_fds[ii].fd = conninfo->con_port->sock;
-					thrinfo->thr_poll_fds[ii].events = POLLIN;
-					thrinfo->thr_poll_fds[ii].revents = 0;
+				/*
+				 * Clients attached through shared memory wake us up through
+				 * their socket only when they know we sleep.  Check their
+				 * rings once they can know it.
+				 */
+				if (thrinfo->thr_shm_conns != gtm_NIL)
+				{
+					GTMProxy_Shmq->sq_workers[thrinfo->thr_localid].sw_sleeping = 1;
+					GTM_ShmqBarrier();
+					shm_pending = GTMProxy_SharedMemoryPending(thrinfo);
+					if (shm_pending)
+						timeout_ms = 0;
 				}
-			}
-			GTM_MutexLockRelease(&thrinfo->thr_lock);
 
-			while (true)
-			{
 				Enable_Longjmp();
-				nrfds = poll(thrinfo->thr_poll_fds, thrinfo->thr_conn_count,
-							poll_timeout_ms);
+				nevents = GTMProxy_WaitSetWait(thrinfo, timeout_ms);
 				Disable_Longjmp();
 
-				if (nrfds < 0)
+				if (thrinfo->thr_shm_conns != gtm_NIL)
+					GTMProxy_Shmq->sq_workers[thrinfo->thr_localid].sw_sleeping = 0;
+
+				if (nevents < 0)
 				{
 					if (errno == EINTR)
 						continue;
-					elog(FATAL, "poll returned with error %d", nrfds);
+					elog(FATAL, "poll returned with error %d", nevents);
 				}
 				else
 					break;
 			}
+			thrinfo->thr_nevents = nevents;
+
+			gtm_revents = 0;
+			for (ii = 0; ii < nevents; ii++)
+			{
+				if (thrinfo->thr_events[ii].ev_conn == NULL)
+					gtm_revents = thrinfo->thr_events[ii].ev_events;
+			}
+
+			/*
+			 * Read the responses of the oldest batch once they arrive, or
+			 * wait for them if no more batches may be sent.  Responses to
+			 * later batches may have been read in along, handle them too.
+			 */
+			if (thrinfo->thr_batches != gtm_NIL)
+			{
+				GTM_Conn *gtm_conn = thrinfo->thr_gtm_conn;
+
+				if ((gtm_revents & GTM_PROXY_EV_WRITE) && gtm_conn->outCount > 0)
+				{
+					Enable_Longjmp();
+					gtmpqFlush(gtm_conn);
+					Disable_Longjmp();
+				}
+
+				if ((gtm_revents & (GTM_PROXY_EV_READ | GTM_PROXY_EV_HUP)) ||
+					gtm_conn->inStart < gtm_conn->inEnd ||
+					gtm_list_length(thrinfo->thr_batches) >= GTM_PROXY_MAX_BATCHES)
+				{
+					do
+					{
+						GTMProxy_ProcessBatchResponses(thrinfo);
+						gtm_conn = thrinfo->thr_gtm_conn;
+					} while (thrinfo->thr_batches != gtm_NIL &&
+							 gtm_conn->inStart < gtm_conn->inEnd);
+				}
+			}
 
-			if (nrfds == 0)
+			if (nevents == 0 && !thrinfo->thr_resend_backups && !shm_pending)
 				continue;
 
 			/*
@@ -1356,6 +1534,9 @@ setjmp_again:
 			}
 			gtm_list_free_deep(thrinfo->thr_processed_commands);
 			thrinfo->thr_processed_commands = gtm_NIL;
+			GTMProxy_DropBatches(thrinfo);
+			GTMProxy_InvalidateSharedSnapshot();
+			thrinfo->thr_resend_backups = true;
 			goto setjmp_again;	/* Get ready for another SIGUSR2 */
 		}
 		if (first_turn)
@@ -1364,6 +1545,13 @@ setjmp_again:
 			continue;
 		}
 
+		/*
+		 * Do not read more commands until the responses to the oldest batch
+		 * come back.
+		 */
+		if (gtm_list_length(thrinfo->thr_batches) >= GTM_PROXY_MAX_BATCHES)
+			continue;
+
 		/*
 		 * Just reset the input buffer to avoid repeated palloc/pfrees
 		 *
@@ -1371,156 +1559,158 @@ setjmp_again:
 		 * handle any memory leaks
 		 */
 		resetStringInfo(&input_message);
+		read_commands = false;
+
+		/*
+		 * After a GTM error, commands kept as backup are read again and
+		 * resent.
+		 */
+		if (thrinfo->thr_resend_backups)
+		{
+			thrinfo->thr_resend_backups = false;
+
+			for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
+			{
+				int connIndx = thrinfo->thr_conn_map[ii];
+				GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
+
+				if (!conninfo->con_disconnected && conninfo->con_any_backup)
+				{
+					GTMProxy_ReadConnection(thrinfo, conninfo, &input_message);
+					read_commands = true;
+				}
+			}
+		}
 
 		/*
 		 * Now, read command from each of the connections that has some data to
 		 * be read.
 		 */
-		for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
+		for (ii = 0; ii < thrinfo->thr_nevents; ii++)
 		{
-			int connIndx = thrinfo->thr_conn_map[ii];
-			GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
+			GTMProxy_Event *event = &thrinfo->thr_events[ii];
+			GTMProxy_ConnectionInfo *conninfo = event->ev_conn;
+
+			/*
+			 * Skip the GTM connection, and connections that are gone but
+			 * still wait for responses to commands in flight before they
+			 * can be removed.
+			 */
+			if (conninfo == NULL || conninfo->con_disconnected)
+				continue;
+
 			thrinfo->thr_conn = conninfo;
 
-			if (thrinfo->thr_poll_fds[ii].revents & POLLHUP)
+			/*
+			 * The socket of a connection attached through shared memory is
+			 * only written to wake us up, or closed.  Its messages are read
+			 * from the ring below.
+			 */
+			if (conninfo->con_port->shm_slot &&
+				!(event->ev_events & GTM_PROXY_EV_HUP))
 			{
-				/*
-				 * The fd has become invalid. The connection is broken. Add it
-				 * to the remove_list and cleanup at the end of this round of
-				 * cleanup.
-				 */
-				GTMProxy_CommandPending(thrinfo->thr_conn,
-							MSG_BACKEND_DISCONNECT, cmd_data);
-				continue;
+				if (!pq_peerclosed(conninfo->con_port))
+					continue;
+				event->ev_events |= GTM_PROXY_EV_HUP;
 			}
 
-			if ((thrinfo->thr_any_backup[connIndx]) ||
-				(thrinfo->thr_poll_fds[ii].revents & POLLIN))
+			if (event->ev_events & GTM_PROXY_EV_HUP)
 			{
+				/* Nothing more is read from or written to the slot */
+				if (conninfo->con_port->shm_slot)
+					GTMProxy_DetachSharedMemory(thrinfo, conninfo);
+
 				/*
-				 * (3) read a command (loop blocks here)
+				 * The fd has become invalid. The connection is broken. Send
+				 * the disconnect along with the other commands of this round.
 				 */
-				qtype = ReadCommand(thrinfo->thr_conn, &input_message);
-
-				thrinfo->thr_poll_fds[ii].revents = 0;
-
-				switch(qtype)
+				if (conninfo->con_authenticated)
 				{
-					case 'C':
-						ProcessCommand(thrinfo->thr_conn, thrinfo->thr_gtm_conn,
-								&input_message);
-						HandlePostCommand(thrinfo->thr_conn, thrinfo->thr_gtm_conn);
-						break;
-
-					case 'X':
-					case EOF:
-						/*
-						 * Connection termination request
-						 *
-						 * Close the socket and remember the connection
-						 * as disconnected. All such connections will be
-						 * removed after the command processing is over. We
-						 * can't remove it just yet because we pass the slot id
-						 * to the server to quickly find the backend connection
-						 * while processing proxied messages.
-						 */
-						GTMProxy_CommandPending(thrinfo->thr_conn,
-												MSG_BACKEND_DISCONNECT, cmd_data);
-						break;
-					default:
-						/*
-						 * Also disconnect if protocol error
-						 */
-						GTMProxy_HandleDisconnect(thrinfo->thr_conn, thrinfo->thr_gtm_conn);
-						elog(ERROR, "Unexpected message, or client disconnected abruptly.");
-						break;
+					GTMProxy_CommandPending(conninfo,
+								MSG_BACKEND_DISCONNECT, cmd_data);
+					read_commands = true;
 				}
+				else
+					GTMProxy_CloseConnection(thrinfo, conninfo);
+				continue;
+			}
 
+			if (event->ev_events & GTM_PROXY_EV_READ)
+			{
+				GTMProxy_ReadConnection(thrinfo, conninfo, &input_message);
+				read_commands = true;
 			}
 		}
+		thrinfo->thr_nevents = 0;
 
 		/*
-		 * Ok. All the commands are processed. Commands which can be proxied
-		 * directly have been already sent to the GTM server. Now, group the
-		 * remaining commands, send them to the server and flush the data.
+		 * Read a command from each of the connections attached through shared
+		 * memory that has some data in its ring.
 		 */
-		GTMProxy_ProcessPendingCommands(thrinfo);
+		if (thrinfo->thr_shm_conns != gtm_NIL)
+		{
+			gtm_ListCell *elem;
+			gtm_ListCell *next;
 
-		/*
-		 * Add a special marker to tell the GTM server that we are done with
-		 * one round of messages and the GTM server should flush all the
-		 * pending responses after seeing this message.
-		 */
-		if (gtmpqPutMsgStart('F', true, thrinfo->thr_gtm_conn) ||
-			gtmpqPutInt(MSG_DATA_FLUSH, sizeof (GTM_MessageType), thrinfo->thr_gtm_conn) ||
-			gtmpqPutMsgEnd(thrinfo->thr_gtm_conn))
-			elog(ERROR, "Error sending flush message");
+			for (elem = gtm_list_head(thrinfo->thr_shm_conns); elem != NULL; elem = next)
+			{
+				GTMProxy_ConnectionInfo *conninfo = (GTMProxy_ConnectionInfo *) gtm_lfirst(elem);
 
-		/*
-		 * Make sure everything is on wire now
-		 */
-		Enable_Longjmp();
-		gtmpqFlush(thrinfo->thr_gtm_conn);
-		Disable_Longjmp();
+				/* Reading may close the connection and delete the cell */
+				next = gtm_lnext(elem);
 
-		/*
-		 * Read back the responses and put them on to the right backend
-		 * connection.
-		 */
-		gtm_foreach(elem, thrinfo->thr_processed_commands)
+				if (GTMProxy_SharedMemoryReady(conninfo))
+				{
+					GTMProxy_ReadConnection(thrinfo, conninfo, &input_message);
+					read_commands = true;
+				}
+			}
+		}
+
+		if (read_commands)
 		{
-			GTMProxy_CommandInfo *cmdinfo = (GTMProxy_CommandInfo *)gtm_lfirst(elem);
+			/*
+			 * Snapshots requested in this round can be shared only if no
+			 * commit is acknowledged until they come back.
+			 */
+			snapshot_version = GTMProxy_GetSnapshotVersion();
 
 			/*
-			 * If this is a continuation of a multi-part command response, we
-			 * don't need to read another result from the stream. The previous
-			 * result contains our response and we should just read from it.
+			 * Ok. All the commands are processed. Commands which can be proxied
+			 * directly have been already sent to the GTM server. Now, group the
+			 * remaining commands, send them to the server and flush the data.
 			 */
-			if (cmdinfo->ci_res_index == 0)
-			{
-				Enable_Longjmp();
-				if ((res = GTMPQgetResult(thrinfo->thr_gtm_conn)) == NULL)
-				{
-					/*
-					 * Here's another place to check GTM communication error.
-					 * In this case, backup of each command will be taken care of
-					 * by ProcessResponse() so if socket read/write error is recorded,
-					 * disconnect GTM connection, retry connection and then if it faile,
-					 * wait for reconnect from gtm_ctl.
-					 */
-					if ((thrinfo->thr_gtm_conn->last_errno != 0) || (thrinfo->thr_gtm_conn->status == CONNECTION_BAD))
-					{
-						/*
-						 * Please note that error handling can end up with longjmp() and
-						 * may not return here.
-						 */
-						HandleGTMError(thrinfo->thr_gtm_conn);
-					}
-					elog(ERROR, "GTMPQgetResult failed");
-				}
-				Disable_Longjmp();
-			}
+			GTMProxy_ProcessPendingCommands(thrinfo);
 
-			ProcessResponse(thrinfo, cmdinfo, res);
-		}
+			/*
+			 * Add a special marker to tell the GTM server that we are done with
+			 * one round of messages and the GTM server should flush all the
+			 * pending responses after seeing this message.
+			 */
+			if (gtmpqPutMsgStart('F', true, thrinfo->thr_gtm_conn) ||
+				gtmpqPutInt(MSG_DATA_FLUSH, sizeof (GTM_MessageType), thrinfo->thr_gtm_conn) ||
+				gtmpqPutMsgEnd(thrinfo->thr_gtm_conn))
+				elog(ERROR, "Error sending flush message");
+
+			/*
+			 * Make sure everything is on wire now
+			 */
+			Enable_Longjmp();
+			gtmpqFlush(thrinfo->thr_gtm_conn);
+			Disable_Longjmp();
 
-		gtm_list_free_deep(thrinfo->thr_processed_commands);
-		thrinfo->thr_processed_commands = gtm_NIL;
+			/*
+			 * The responses are read in a later round, once the GTM server
+			 * sends them, so more batches can be sent meanwhile.
+			 */
+			GTMProxy_QueueBatch(thrinfo, snapshot_version);
+		}
 
 		/*
-		 * Now clean up disconnected connections
+		 * Now clean up disconnected connections, once no command of theirs is
+		 * left in flight.
 		 */
-		for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
-		{
-			int connIndx = thrinfo->thr_conn_map[ii];
-			GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
-			if (conninfo->con_disconnected)
-			{
-				GTMProxy_ThreadRemoveConnection(thrinfo, conninfo);
-				pfree(conninfo);
-				ii--;
-			}
-		}
+		GTMProxy_RemoveClosedConnections(thrinfo);
 	}
 
 	/* can't get here because the above loop never exits */
@@ -1530,62 +1720,308 @@ setjmp_again:
 }
 
 /*
- * Add the accepted connection to the pool
+ * Take the connections the main thread handed over to this thread, and wait
+ * for them to send their startup message.
  */
-static int
-GTMProxyAddConnection(Port *port)
+static void
+GTMProxy_TakeNewConnections(GTMProxy_ThreadInfo *thrinfo)
 {
-	GTMProxy_ConnectionInfo *conninfo = NULL;
+	GTMProxy_ConnectionInfo *new_conns;
+	MemoryContext oldContext;
 
-	conninfo = (GTMProxy_ConnectionInfo *)palloc0(sizeof (GTMProxy_ConnectionInfo));
+	GTM_MutexLockAcquire(&thrinfo->thr_lock);
+	new_conns = thrinfo->thr_new_conns;
+	thrinfo->thr_new_conns = NULL;
+	thrinfo->thr_new_count = 0;
+	GTM_MutexLockRelease(&thrinfo->thr_lock);
 
-	if (conninfo == NULL)
+	if (new_conns == NULL)
+		return;
+
+	/* The connection array and the backup buffers last across the loop */
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+
+	while (new_conns != NULL)
 	{
-		ereport(LOG,
-				(ENOMEM,
-					errmsg("Out of memory")));
-		return STATUS_ERROR;
-	}
+		GTMProxy_ConnectionInfo *conninfo = new_conns;
 
-	elog(DEBUG3, "Started new connection");
-	conninfo->con_port = port;
+		new_conns = conninfo->con_next;
+		conninfo->con_next = NULL;
 
-	/*
-	 * Add the conninfo struct to the next worker thread in round-robin manner
-	 */
-	if (!GTMProxy_ThreadAddConnection(conninfo))
-		return STATUS_ERROR;
+		if (!GTMProxy_ThreadTakeConnection(thrinfo, conninfo))
+		{
+			StreamClose(conninfo->con_port->sock);
+			ConnFree(conninfo->con_port);
+			pfree(conninfo);
+			continue;
+		}
 
-	return STATUS_OK;
+		if (!GTMProxy_WaitSetAdd(thrinfo, conninfo))
+		{
+			StreamClose(conninfo->con_port->sock);
+			ConnFree(conninfo->con_port);
+			conninfo->con_port = NULL;
+			GTMProxy_ThreadRemoveConnection(thrinfo, conninfo);
+			pfree(conninfo);
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
 }
 
-void
-ProcessCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
-		StringInfo input_message)
+/*
+ * Read and process a command from a connection that has data to be read, or
+ * whose last command is to be resent. The first message of a new connection
+ * completes its handshake.
+ */
+static void
+GTMProxy_ReadConnection(GTMProxy_ThreadInfo *thrinfo,
+		GTMProxy_ConnectionInfo *conninfo, StringInfo input_message)
 {
-	GTM_MessageType mtype;
+	GTMProxy_CommandData cmd_data = {};
+	int qtype;
 
-	mtype = pq_getmsgint(input_message, sizeof (GTM_MessageType));
+	thrinfo->thr_conn = conninfo;
 
-	switch (mtype)
+	if (!conninfo->con_authenticated)
 	{
-		case MSG_TXN_BEGIN_GETGXID_AUTOVACUUM:
-		case MSG_TXN_PREPARE:
-		case MSG_TXN_START_PREPARED:
-		case MSG_TXN_GET_GID_DATA:
-		case MSG_TXN_COMMIT_PREPARED:
-		case MSG_SNAPSHOT_GET:
-		case MSG_SEQUENCE_INIT:
-		case MSG_SEQUENCE_GET_CURRENT:
-		case MSG_SEQUENCE_GET_NEXT:
-		case MSG_SEQUENCE_GET_LAST:
-		case MSG_SEQUENCE_SET_VAL:
-		case MSG_SEQUENCE_RESET:
-		case MSG_SEQUENCE_CLOSE:
-		case MSG_SEQUENCE_RENAME:
-		case MSG_SEQUENCE_ALTER:
-		case MSG_BARRIER:
-		case MSG_TXN_COMMIT:
+		GTMProxy_HandshakeConnection(conninfo);
+		return;
+	}
+
+	/*
+	 * (3) read a command (loop blocks here)
+	 */
+	qtype = ReadCommand(conninfo, input_message);
+
+	switch(qtype)
+	{
+		case 'C':
+			ProcessCommand(conninfo, thrinfo->thr_gtm_conn, input_message);
+			HandlePostCommand(conninfo, thrinfo->thr_gtm_conn);
+			break;
+
+		case 'X':
+		case EOF:
+			/*
+			 * Connection termination request
+			 *
+			 * Close the socket and remember the connection as disconnected.
+			 * All such connections will be removed after the command
+			 * processing is over. We can't remove it just yet because we pass
+			 * the slot id to the server to quickly find the backend
+			 * connection while processing proxied messages.
+			 */
+			GTMProxy_CommandPending(conninfo, MSG_BACKEND_DISCONNECT, cmd_data);
+			break;
+		default:
+			/*
+			 * Also disconnect if protocol error
+			 */
+			GTMProxy_HandleDisconnect(conninfo, thrinfo->thr_gtm_conn);
+			elog(ERROR, "Unexpected message, or client disconnected abruptly.");
+			break;
+	}
+}
+
+/*
+ * Close a client connection and remember it as disconnected. It is removed
+ * once no command of it is left in flight.
+ */
+static void
+GTMProxy_CloseConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_ConnectionInfo *conninfo)
+{
+	GTMProxy_WaitSetRemove(thrinfo, conninfo);
+	if (conninfo->con_port->shm_slot)
+		GTMProxy_DetachSharedMemory(thrinfo, conninfo);
+
+	conninfo->con_disconnected = true;
+	if (conninfo->con_port->sock > 0)
+		StreamClose(conninfo->con_port->sock);
+	ConnFree(conninfo->con_port);
+	conninfo->con_port = NULL;
+
+	conninfo->con_next = thrinfo->thr_closed_conns;
+	thrinfo->thr_closed_conns = conninfo;
+}
+
+/*
+ * Switch a connection to the shared memory slot its client claimed, see
+ * gtm_shmq.h.  The answer still goes through the socket, the messages that
+ * follow through the rings of the slot.
+ */
+static void
+GTMProxy_AttachSharedMemory(GTMProxy_ConnectionInfo *conninfo, StringInfo message)
+{
+	GTMProxy_ThreadInfo *thrinfo = GetMyThreadInfo;
+	GTM_ShmqSlot *slot;
+	StringInfoData buf;
+	MemoryContext oldContext;
+	int slotno;
+	uint64 cookie;
+
+	slotno = pq_getmsgint(message, sizeof (int32));
+	memcpy(&cookie, pq_getmsgbytes(message, sizeof (uint64)), sizeof (uint64));
+	pq_getmsgend(message);
+
+	/*
+	 * The cookie tells that the client mapped our segment, and not the one
+	 * of another proxy listening on the same port on its own host.
+	 */
+	if (GTMProxy_Shmq == NULL ||
+		cookie != GTMProxy_Shmq->sq_header->sh_cookie ||
+		slotno < 0 || slotno >= GTMProxy_Shmq->sq_header->sh_nslots ||
+		thrinfo->thr_localid >= GTMProxy_Shmq->sq_header->sh_nworkers ||
+		conninfo->con_port->shm_slot != NULL)
+		ereport(ERROR,
+				(EINVAL,
+				 errmsg("Cannot attach the connection to shared memory slot %d",
+						slotno)));
+
+	slot = &GTMProxy_Shmq->sq_slots[slotno];
+	slot->sl_worker = thrinfo->thr_localid;
+	if (!GTM_ShmqCompareAndSwap(&slot->sl_state, GTM_SHMQ_SLOT_CLAIMED,
+								GTM_SHMQ_SLOT_ATTACHED))
+		ereport(ERROR,
+				(EINVAL,
+				 errmsg("Shared memory slot %d is not claimed", slotno)));
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendint(&buf, SHM_ATTACH_RESULT, 4);
+	pq_endmessage(conninfo->con_port, &buf);
+	pq_flush(conninfo->con_port);
+
+	conninfo->con_port->shm_slot = slot;
+	conninfo->con_pending_msg = MSG_TYPE_INVALID;
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+	thrinfo->thr_shm_conns = gtm_lappend(thrinfo->thr_shm_conns, conninfo);
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * Stop using the shared memory slot of a connection and give it back
+ */
+static void
+GTMProxy_DetachSharedMemory(GTMProxy_ThreadInfo *thrinfo, GTMProxy_ConnectionInfo *conninfo)
+{
+	GTM_ShmqSlot *slot = conninfo->con_port->shm_slot;
+
+	conninfo->con_port->shm_slot = NULL;
+	thrinfo->thr_shm_conns = gtm_list_delete_ptr(thrinfo->thr_shm_conns, conninfo);
+	GTM_ShmqReleaseSlot(GTMProxy_Shmq, slot - GTMProxy_Shmq->sq_slots);
+}
+
+/*
+ * Does a connection attached through shared memory have data to be read?
+ * Unlike a socket, the ring does not tell about data already moved to the
+ * input buffer, so check that too.
+ */
+static bool
+GTMProxy_SharedMemoryReady(GTMProxy_ConnectionInfo *conninfo)
+{
+	Port *port = conninfo->con_port;
+
+	return port->PqRecvPointer < port->PqRecvLength ||
+		!GTM_ShmqEmpty(&port->shm_slot->sl_request);
+}
+
+/*
+ * Does any of the connections attached through shared memory have data?
+ */
+static bool
+GTMProxy_SharedMemoryPending(GTMProxy_ThreadInfo *thrinfo)
+{
+	gtm_ListCell *elem;
+
+	gtm_foreach(elem, thrinfo->thr_shm_conns)
+	{
+		if (GTMProxy_SharedMemoryReady((GTMProxy_ConnectionInfo *) gtm_lfirst(elem)))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Remove the disconnected connections with no command left in flight
+ */
+static void
+GTMProxy_RemoveClosedConnections(GTMProxy_ThreadInfo *thrinfo)
+{
+	GTMProxy_ConnectionInfo **link = &thrinfo->thr_closed_conns;
+
+	while (*link != NULL)
+	{
+		GTMProxy_ConnectionInfo *conninfo = *link;
+
+		if (conninfo->con_inflight > 0)
+		{
+			link = &conninfo->con_next;
+			continue;
+		}
+
+		*link = conninfo->con_next;
+		if (thrinfo->thr_conn == conninfo)
+			thrinfo->thr_conn = NULL;
+		GTMProxy_ThreadRemoveConnection(thrinfo, conninfo);
+		pfree(conninfo);
+	}
+}
+
+/*
+ * Add the accepted connection to the pool
+ */
+static int
+GTMProxyAddConnection(Port *port)
+{
+	GTMProxy_ConnectionInfo *conninfo = NULL;
+
+	conninfo = (GTMProxy_ConnectionInfo *)palloc0(sizeof (GTMProxy_ConnectionInfo));
+
+	if (conninfo == NULL)
+	{
+		ereport(LOG,
+				(ENOMEM,
+					errmsg("Out of memory")));
+		return STATUS_ERROR;
+	}
+
+	elog(DEBUG3, "Started new connection");
+	conninfo->con_port = port;
+
+	/*
+	 * Add the conninfo struct to the least loaded worker thread
+	 */
+	if (!GTMProxy_ThreadAddConnection(conninfo))
+		return STATUS_ERROR;
+
+	return STATUS_OK;
+}
+
+void
+ProcessCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
+		StringInfo input_message)
+{
+	GTM_MessageType mtype;
+
+	mtype = pq_getmsgint(input_message, sizeof (GTM_MessageType));
+
+	conninfo->con_pending_msg = mtype;
+
+	switch (mtype)
+	{
+		case MSG_TXN_BEGIN_GETGXID_AUTOVACUUM:
+		case MSG_TXN_PREPARE:
+		case MSG_TXN_START_PREPARED:
+		case MSG_TXN_GET_GID_DATA:
+		case MSG_TXN_GET_NEXT_GXID:
+		case MSG_GET_STATS:
+		case MSG_TXN_COMMIT_PREPARED:
+		case MSG_SNAPSHOT_GET:
+		case MSG_SEQUENCE_INIT:
+		case MSG_SEQUENCE_GET_LAST:
+		case MSG_BARRIER:
+		case MSG_TXN_COMMIT:
 		case MSG_REGISTER_SESSION:
 		case MSG_REPORT_XMIN:
 		case MSG_NODE_REGISTER:
@@ -1593,9 +2029,24 @@ ProcessCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 			GTMProxy_ProxyCommand(conninfo, gtm_conn, mtype, input_message);
 			break;
 
+		case MSG_SEQUENCE_GET_CURRENT:
+		case MSG_SEQUENCE_GET_NEXT:
+		case MSG_SEQUENCE_SET_VAL:
+		case MSG_SEQUENCE_RESET:
+		case MSG_SEQUENCE_CLOSE:
+		case MSG_SEQUENCE_RENAME:
+		case MSG_SEQUENCE_ALTER:
+			if (GTMProxyCacheSequences)
+				ProcessSequenceCommand(conninfo, gtm_conn, mtype, input_message);
+			else
+				GTMProxy_ProxyCommand(conninfo, gtm_conn, mtype, input_message);
+			break;
+
 		case MSG_TXN_BEGIN:
 		case MSG_TXN_BEGIN_GETGXID:
 		case MSG_TXN_COMMIT_MULTI:
+		case MSG_TXN_PREPARE_MULTI:
+		case MSG_TXN_COMMIT_PREPARED_MULTI:
 		case MSG_TXN_ROLLBACK:
 		case MSG_TXN_GET_GXID:
 			ProcessTransactionCommand(conninfo, gtm_conn, mtype, input_message);
@@ -1606,15 +2057,16 @@ ProcessCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 			ProcessSnapshotCommand(conninfo, gtm_conn, mtype, input_message);
 			break;
 
+		case MSG_SHM_ATTACH:
+			GTMProxy_AttachSharedMemory(conninfo, input_message);
+			break;
+
 		default:
 			ereport(FATAL,
 					(EPROTO,
 					 errmsg("invalid frontend message type %d",
 							mtype)));
 	}
-
-	conninfo->con_pending_msg = mtype;
-
 }
 
 /*
@@ -1664,6 +2116,7 @@ HandleGTMError(GTM_Conn *gtm_conn)
 		/* Make sure RECONNECT command would not come while we reconnecting */
 		Disable_Longjmp();
 		/* Close and free previous connection object if still active */
+		GTMProxy_WaitSetWatchGTM(GetMyThreadInfo, -1, 0);
 		GTMPQfinish(gtm_conn);
 		/* Reconnect */
 		sprintf(gtm_connect_string, "host=%s port=%d node_name=%s remote_type=%d",
@@ -1689,8 +2142,6 @@ HandleGTMError(GTM_Conn *gtm_conn)
 static GTM_Conn *
 HandlePostCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn)
 {
-	int		connIdx = conninfo->con_id;
-
 	Assert(conninfo && gtm_conn);
 	/*
 	 * Check if the response was handled without error.
@@ -1699,6 +2150,8 @@ HandlePostCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn)
 	 */
 	if (gtm_conn->last_errno != 0)
 	{
+		/* Resend the backup once reconnected */
+		GetMyThreadInfo->thr_resend_backups = true;
 		return(HandleGTMError(gtm_conn));
 	}
 	else
@@ -1706,8 +2159,8 @@ HandlePostCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn)
 		/*
 		 * Command handled without error.  Clear the backup.
 		 */
-		resetStringInfo(&GetMyThreadInfo->thr_inBufData[connIdx]);
-		GetMyThreadInfo->thr_any_backup[connIdx] = FALSE;
+		resetStringInfo(&conninfo->con_inBufData);
+		conninfo->con_any_backup = FALSE;
 		return(gtm_conn);
 	}
 
@@ -1725,6 +2178,8 @@ IsProxiedMessage(GTM_MessageType mtype)
 		/* There are not so many 2PC from application messages, so just proxy it. */
 		case MSG_TXN_COMMIT_PREPARED:
 		case MSG_TXN_GET_GXID:
+		case MSG_TXN_GET_NEXT_GXID:
+		case MSG_GET_STATS:
 		case MSG_TXN_GET_GID_DATA:
 		case MSG_NODE_REGISTER:
 		case MSG_NODE_UNREGISTER:
@@ -1841,6 +2296,49 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
 			ReleaseCmdBackup(cmdinfo);
 			break;
 
+		case MSG_TXN_PREPARE_MULTI:
+		case MSG_TXN_COMMIT_PREPARED_MULTI:
+			{
+				GTM_ResultType	restype;
+
+				restype = (cmdinfo->ci_mtype == MSG_TXN_PREPARE_MULTI) ?
+					TXN_PREPARE_MULTI_RESULT : TXN_COMMIT_PREPARED_MULTI_RESULT;
+				if (res->gr_type != restype)
+				{
+					ReleaseCmdBackup(cmdinfo);
+					elog(ERROR, "Wrong result");
+				}
+				/* Grouped like MSG_TXN_COMMIT_MULTI */
+				if (cmdinfo->ci_res_index >= res->gr_resdata.grd_txn_rc_multi.txn_count)
+				{
+					ReleaseCmdBackup(cmdinfo);
+					elog(ERROR, "Too few GXIDs");
+				}
+
+				if (res->gr_resdata.grd_txn_rc_multi.status[cmdinfo->ci_res_index] == STATUS_OK)
+				{
+					int txn_count = 1;
+					int status = STATUS_OK;
+
+					pq_beginmessage(&buf, 'S');
+					pq_sendint(&buf, restype, 4);
+					pq_sendbytes(&buf, &txn_count, sizeof (int));
+					pq_sendbytes(&buf, &status, sizeof (int));
+					pq_endmessage(cmdinfo->ci_conn->con_port, &buf);
+					pq_flush(cmdinfo->ci_conn->con_port);
+				}
+				else
+				{
+					ReleaseCmdBackup(cmdinfo);
+					ereport(ERROR2, (EINVAL, errmsg("Transaction %s failed",
+							cmdinfo->ci_mtype == MSG_TXN_PREPARE_MULTI ?
+							"prepare" : "commit prepared")));
+				}
+			}
+			cmdinfo->ci_conn->con_pending_msg = MSG_TYPE_INVALID;
+			ReleaseCmdBackup(cmdinfo);
+			break;
+
 		case MSG_TXN_ROLLBACK:
 			if (res->gr_type != TXN_ROLLBACK_MULTI_RESULT)
 			{
@@ -1917,6 +2415,66 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
 			ReleaseCmdBackup(cmdinfo);
 			break;
 
+		case MSG_SEQUENCE_GET_NEXT_MULTI:
+			/*
+			 * A grouped nextval.  The command gets the first values of the
+			 * range sent back, a refill it carried is already cached.
+			 */
+			if (res->gr_status != GTM_RESULT_OK)
+			{
+				pq_beginmessage(&buf, 'E');
+				pq_sendbytes(&buf, res->gr_proxy_data, res->gr_msglen);
+				pq_endmessage(cmdinfo->ci_conn->con_port, &buf);
+				pq_flush(cmdinfo->ci_conn->con_port);
+				cmdinfo->ci_conn->con_pending_msg = MSG_TYPE_INVALID;
+				ReleaseCmdBackup(cmdinfo);
+				break;
+			}
+			if (res->gr_type != SEQUENCE_GET_NEXT_MULTI_RESULT)
+			{
+				ReleaseCmdBackup(cmdinfo);
+				elog(ERROR, "Wrong result");
+			}
+			if (cmdinfo->ci_res_index >= res->gr_resdata.grd_seq_multi.seq_count)
+			{
+				ReleaseCmdBackup(cmdinfo);
+				elog(ERROR, "Too few sequence values");
+			}
+
+			if (res->gr_resdata.grd_seq_multi.status[cmdinfo->ci_res_index] == 0)
+			{
+				GTM_Sequence seqval = res->gr_resdata.grd_seq_multi.seqval[cmdinfo->ci_res_index];
+				GTM_Sequence rangemax = res->gr_resdata.grd_seq_multi.rangemax[cmdinfo->ci_res_index];
+				GTM_Sequence increment = res->gr_resdata.grd_seq_multi.increment[cmdinfo->ci_res_index];
+				GTM_Sequence count = (rangemax - seqval) / increment + 1;
+
+				if (count > cmdinfo->ci_data.cd_seq.range)
+					rangemax = seqval + (cmdinfo->ci_data.cd_seq.range - 1) * increment;
+
+				pq_beginmessage(&buf, 'S');
+				pq_sendint(&buf, SEQUENCE_GET_NEXT_RESULT, 4);
+				pq_sendint(&buf, cmdinfo->ci_data.cd_seq.keylen, 4);
+				pq_sendbytes(&buf, cmdinfo->ci_data.cd_seq.key,
+							 cmdinfo->ci_data.cd_seq.keylen);
+				pq_sendbytes(&buf, (char *)&seqval, sizeof (GTM_Sequence));
+				pq_sendbytes(&buf, (char *)&rangemax, sizeof (GTM_Sequence));
+				pq_endmessage(cmdinfo->ci_conn->con_port, &buf);
+				pq_flush(cmdinfo->ci_conn->con_port);
+
+				GTMProxy_SetSequenceLastVal(cmdinfo->ci_conn,
+											cmdinfo->ci_data.cd_seq.key,
+											cmdinfo->ci_data.cd_seq.keylen,
+											rangemax);
+			}
+			else
+			{
+				ReleaseCmdBackup(cmdinfo);
+				ereport(ERROR2, (EINVAL, errmsg("Can not get current value of the sequence")));
+			}
+			cmdinfo->ci_conn->con_pending_msg = MSG_TYPE_INVALID;
+			ReleaseCmdBackup(cmdinfo);
+			break;
+
 		case MSG_TXN_BEGIN:
 		case MSG_TXN_BEGIN_GETGXID_AUTOVACUUM:
 		case MSG_TXN_PREPARE:
@@ -1924,6 +2482,8 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
 		/* There are not so many 2PC from application messages, so just proxy it. */
 		case MSG_TXN_COMMIT_PREPARED:
 		case MSG_TXN_GET_GXID:
+		case MSG_TXN_GET_NEXT_GXID:
+		case MSG_GET_STATS:
 		case MSG_TXN_GET_GID_DATA:
 		case MSG_NODE_REGISTER:
 		case MSG_NODE_UNREGISTER:
@@ -1943,7 +2503,7 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
 		case MSG_TXN_COMMIT:
 			Assert(IsProxiedMessage(cmdinfo->ci_mtype));
 			if ((res->gr_proxyhdr.ph_conid == InvalidGTMProxyConnID) ||
-				(res->gr_proxyhdr.ph_conid >= GTM_PROXY_MAX_CONNECTIONS) ||
+				(res->gr_proxyhdr.ph_conid >= thrinfo->thr_conn_slots) ||
 				(thrinfo->thr_all_conns[res->gr_proxyhdr.ph_conid] != cmdinfo->ci_conn))
 			{
 				ReleaseCmdBackup(cmdinfo);
@@ -2021,10 +2581,9 @@ static int
 ReadCommand(GTMProxy_ConnectionInfo *conninfo, StringInfo inBuf)
 {
 	int 			qtype;
-	int				connIdx = conninfo->con_id;
 	int				anyBackup;
 
-	anyBackup = (GetMyThreadInfo->thr_any_backup[connIdx] ? TRUE : FALSE);
+	anyBackup = (conninfo->con_any_backup ? TRUE : FALSE);
 
 	/*
 	 * Get message type code from the frontend.
@@ -2032,16 +2591,16 @@ ReadCommand(GTMProxy_ConnectionInfo *conninfo, StringInfo inBuf)
 	if (!anyBackup)
 	{
 		qtype = pq_getbyte(conninfo->con_port);
-		GetMyThreadInfo->thr_qtype[connIdx] = qtype;
+		conninfo->con_qtype = qtype;
 		/*
-		 * We should not update thr_any_backup here.  This should be
+		 * We should not update con_any_backup here.  This should be
 		 * updated when the backup is consumed or command processing
 		 * is done.
 		 */
 	}
 	else
 	{
-		qtype = GetMyThreadInfo->thr_qtype[connIdx];
+		qtype = conninfo->con_qtype;
 	}
 
 	if (qtype == EOF)			/* frontend disconnected */
@@ -2092,17 +2651,17 @@ ReadCommand(GTMProxy_ConnectionInfo *conninfo, StringInfo inBuf)
 		if (pq_getmessage(conninfo->con_port, inBuf, 0))
 			return EOF;			/* suitable message already logged */
 
-		copyStringInfo(&(GetMyThreadInfo->thr_inBufData[connIdx]), inBuf);
+		copyStringInfo(&conninfo->con_inBufData, inBuf);
 
 		/*
 		 * The next line is added because we added the code to clear backup
 		 * when the response is processed.
 		 */
-		GetMyThreadInfo->thr_any_backup[connIdx] = TRUE;
+		conninfo->con_any_backup = TRUE;
 	}
 	else
 	{
-		copyStringInfo(inBuf, &(GetMyThreadInfo->thr_inBufData[connIdx]));
+		copyStringInfo(inBuf, &conninfo->con_inBufData);
 	}
 	return qtype;
 }
@@ -2125,7 +2684,31 @@ ProcessTransactionCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 			GTMProxy_CommandPending(conninfo, mtype, cmd_data);
 			break;
 
+		case MSG_TXN_COMMIT_PREPARED_MULTI:
+			{
+				int txn_count = pq_getmsgint(message, sizeof (int));
+				const char *data;
+
+				Assert (txn_count == 1);
+				data = pq_getmsgbytes(message, sizeof (GlobalTransactionId));
+				if (data == NULL)
+					ereport(ERROR,
+							(EPROTO,
+							 errmsg("Message does not contain valid GXID")));
+				memcpy(&cmd_data.cd_rc.gxid, data, sizeof (GlobalTransactionId));
+				data = pq_getmsgbytes(message, sizeof (GlobalTransactionId));
+				if (data == NULL)
+					ereport(ERROR,
+							(EPROTO,
+							 errmsg("Message does not contain valid GXID")));
+				memcpy(&cmd_data.cd_rc.prepared_gxid, data, sizeof (GlobalTransactionId));
+			}
+			pq_getmsgend(message);
+			GTMProxy_CommandPending(conninfo, mtype, cmd_data);
+			break;
+
 		case MSG_TXN_COMMIT_MULTI:
+		case MSG_TXN_PREPARE_MULTI:
 			{
 				int txn_count = pq_getmsgint(message, sizeof (int));
 				Assert (txn_count == 1);
@@ -2176,6 +2759,19 @@ ProcessSnapshotCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 					memcpy(&cmd_data.cd_snap.gxid, data, sizeof (GlobalTransactionId));
 				}
 				pq_getmsgend(message);
+
+				/*
+				 * A request without GXID leaves no trace on the GTM server,
+				 * a shared snapshot serves it just as well.
+				 */
+				if (GTMProxyShareSnapshots &&
+					!GlobalTransactionIdIsValid(cmd_data.cd_snap.gxid) &&
+					GTMProxy_SendSharedSnapshot(conninfo))
+				{
+					conninfo->con_pending_msg = MSG_TYPE_INVALID;
+					break;
+				}
+
 				GTMProxy_CommandPending(conninfo, mtype, cmd_data);
 			}
 			break;
@@ -2191,20 +2787,112 @@ ProcessSnapshotCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 }
 
 /*
- * Proxy the incoming message to the GTM server after adding our own identifier
- * to it. The rest of the message is forwarded as it is without even reading
- * its contents.
+ * Sequence commands, when cache_sequences is on.  nextval is served from
+ * the values the thread reserved, or grouped with the other ones of the
+ * round.  The other commands are proxied.
  */
 static void
-GTMProxy_ProxyCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
+ProcessSequenceCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 		GTM_MessageType mtype, StringInfo message)
 {
-	GTMProxy_CommandInfo *cmdinfo;
 	GTMProxy_ThreadInfo *thrinfo = GetMyThreadInfo;
-	GTM_ProxyMsgHeader proxyhdr;
-	const char *unreadmsg;
-	int unreadmsglen;
-
+	GTMProxy_CommandData cmd_data;
+	GTMProxy_SeqCache *cache;
+	int			cursor = message->cursor;
+	uint32		keylen;
+	const char *key;
+	uint32		coord_namelen;
+	MemoryContext oldContext;
+
+	keylen = pq_getmsgint(message, sizeof (keylen));
+	if (keylen == 0 || keylen > GTM_MAX_SEQKEY_LENGTH)
+		ereport(ERROR,
+				(EPROTO,
+				 errmsg("Message does not contain valid sequence key")));
+	key = pq_getmsgbytes(message, keylen);
+
+	switch (mtype)
+	{
+		case MSG_SEQUENCE_GET_NEXT:
+			coord_namelen = pq_getmsgint(message, sizeof (coord_namelen));
+			if (coord_namelen >= SP_NODE_NAME)
+				ereport(ERROR,
+						(EPROTO,
+						 errmsg("Message does not contain valid node name")));
+			memcpy(cmd_data.cd_seq.coord_name,
+				   pq_getmsgbytes(message, coord_namelen), coord_namelen);
+			cmd_data.cd_seq.coord_name[coord_namelen] = '\0';
+			cmd_data.cd_seq.coord_procid = pq_getmsgint(message, sizeof (uint32));
+			memcpy(&cmd_data.cd_seq.range,
+				   pq_getmsgbytes(message, sizeof (GTM_Sequence)),
+				   sizeof (GTM_Sequence));
+			pq_getmsgend(message);
+
+			if (cmd_data.cd_seq.range < 1)
+				cmd_data.cd_seq.range = 1;
+
+			if (GTMProxy_SendCachedSequence(conninfo, key, keylen,
+											cmd_data.cd_seq.range))
+			{
+				conninfo->con_pending_msg = MSG_TYPE_INVALID;
+				return;
+			}
+
+			/* Only one request at a time refills the cache */
+			cache = GTMProxy_GetSeqCache(thrinfo, key, keylen, true);
+			if (cache->sc_refilling)
+				cmd_data.cd_seq.refill = 0;
+			else
+			{
+				cmd_data.cd_seq.refill = GTMProxy_SeqRefillSize(cache,
+													cmd_data.cd_seq.range);
+				cache->sc_refilling = true;
+			}
+			cmd_data.cd_seq.generation = thrinfo->thr_seq_generation;
+
+			oldContext = MemoryContextSwitchTo(TopMemoryContext);
+			cmd_data.cd_seq.key = (char *) palloc(keylen);
+			memcpy(cmd_data.cd_seq.key, key, keylen);
+			cmd_data.cd_seq.keylen = keylen;
+			MemoryContextSwitchTo(oldContext);
+
+			GTMProxy_CommandPending(conninfo, MSG_SEQUENCE_GET_NEXT_MULTI, cmd_data);
+			return;
+
+		case MSG_SEQUENCE_GET_CURRENT:
+			if (GTMProxy_SendSequenceLastVal(conninfo, key, keylen))
+			{
+				conninfo->con_pending_msg = MSG_TYPE_INVALID;
+				return;
+			}
+			break;
+
+		default:
+			/* GTM now knows better what currval returns */
+			GTMProxy_ForgetSequenceLastVal(conninfo, key, keylen);
+			break;
+	}
+
+	message->cursor = cursor;
+	GTMProxy_ProxyCommand(conninfo, gtm_conn, mtype, message);
+}
+
+/*
+ * Proxy the incoming message to the GTM server after adding our own identifier
+ * to it. The rest of the message is forwarded as it is without even reading
+ * its contents.
+ */
+static void
+GTMProxy_ProxyCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
+		GTM_MessageType mtype, StringInfo message)
+{
+	GTMProxy_CommandInfo *cmdinfo;
+	GTMProxy_ThreadInfo *thrinfo = GetMyThreadInfo;
+	GTM_ProxyMsgHeader proxyhdr;
+	const char *unreadmsg;
+	int unreadmsglen;
+	MemoryContext oldContext;
+
 	Assert(IsProxiedMessage(mtype));
 
 	proxyhdr.ph_conid = conninfo->con_id;
@@ -2220,13 +2908,16 @@ GTMProxy_ProxyCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 		elog(ERROR, "Error sending proxied message");
 
 	/*
-	 * Add the message to the pending command list
+	 * Add the message to the pending command list.  It stays there until the
+	 * response comes back, which may be after a few rounds.
 	 */
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
 	cmdinfo = palloc0(sizeof (GTMProxy_CommandInfo));
 	cmdinfo->ci_mtype = mtype;
 	cmdinfo->ci_conn = conninfo;
 	cmdinfo->ci_res_index = 0;
 	thrinfo->thr_processed_commands = gtm_lappend(thrinfo->thr_processed_commands, cmdinfo);
+	MemoryContextSwitchTo(oldContext);
 
 	/* Finish the message. */
 	Enable_Longjmp();
@@ -2341,6 +3032,10 @@ GTMProxy_HandleDisconnect(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn)
 	GTM_ProxyMsgHeader proxyhdr;
 	int namelen;
 
+	/* The disconnect may have been noticed twice */
+	if (conninfo->con_disconnected)
+		return;
+
 	proxyhdr.ph_conid = conninfo->con_id;
 	/* Start the message. */
 	if (gtmpqPutMsgStart('C', true, gtm_conn) ||
@@ -2366,11 +3061,7 @@ GTMProxy_HandleDisconnect(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn)
 	if (gtmpqPutMsgEnd(gtm_conn))
 		elog(ERROR, "Error finishing the message");
 
-	conninfo->con_disconnected = true;
-	if (conninfo->con_port->sock > 0)
-		StreamClose(conninfo->con_port->sock);
-	ConnFree(conninfo->con_port);
-	conninfo->con_port = NULL;
+	GTMProxy_CloseConnection(GetMyThreadInfo, conninfo);
 
 	return;
 }
@@ -2390,12 +3081,16 @@ GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo)
 	for (ii = 0; ii < MSG_TYPE_COUNT; ii++)
 	{
 		int res_index = 0;
+		gtm_List *overflow;
 
 		/* We process backend disconnects last! */
 		if (ii == MSG_BACKEND_DISCONNECT ||
 				gtm_list_length(thrinfo->thr_pending_commands[ii]) == 0)
 			continue;
 
+		/* Commands beyond what a group message takes go in the next one */
+		overflow = GTMProxy_SplitPendingCommands(thrinfo, ii);
+
 		/*
 		 * Start a new group message and fill in the headers
 		 */
@@ -2478,6 +3173,40 @@ GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo)
 
 				break;
 
+			case MSG_TXN_PREPARE_MULTI:
+			case MSG_TXN_COMMIT_PREPARED_MULTI:
+				if (gtmpqPutInt(ii, sizeof (GTM_MessageType), gtm_conn) ||
+					gtmpqPutInt(gtm_list_length(thrinfo->thr_pending_commands[ii]), sizeof(int), gtm_conn))
+					elog(ERROR, "Error sending data");
+
+				gtm_foreach (elem, thrinfo->thr_pending_commands[ii])
+				{
+					cmdinfo = (GTMProxy_CommandInfo *)gtm_lfirst(elem);
+					Assert(cmdinfo->ci_mtype == ii);
+					cmdinfo->ci_res_index = res_index++;
+					if (gtmpqPutnchar((char *)&cmdinfo->ci_data.cd_rc.gxid,
+							sizeof (GlobalTransactionId), gtm_conn))
+						elog(ERROR, "Error sending data");
+					if (ii == MSG_TXN_COMMIT_PREPARED_MULTI &&
+						gtmpqPutnchar((char *)&cmdinfo->ci_data.cd_rc.prepared_gxid,
+							sizeof (GlobalTransactionId), gtm_conn))
+						elog(ERROR, "Error sending data");
+				}
+
+				/* Finish the message. */
+				Enable_Longjmp();
+				if (gtmpqPutMsgEnd(gtm_conn))
+					elog(ERROR, "Error finishing the message");
+				Disable_Longjmp();
+
+				/*
+				 * Move the entire list to the processed command
+				 */
+				thrinfo->thr_processed_commands = gtm_list_concat(thrinfo->thr_processed_commands,
+						thrinfo->thr_pending_commands[ii]);
+				thrinfo->thr_pending_commands[ii] = gtm_NIL;
+				break;
+
 			case MSG_TXN_ROLLBACK:
 				if (gtmpqPutInt(MSG_TXN_ROLLBACK_MULTI, sizeof (GTM_MessageType), gtm_conn) ||
 					gtmpqPutInt(gtm_list_length(thrinfo->thr_pending_commands[ii]), sizeof(int), gtm_conn))
@@ -2502,6 +3231,48 @@ GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo)
 				Disable_Longjmp();
 
 
+				/*
+				 * Move the entire list to the processed command
+				 */
+				thrinfo->thr_processed_commands = gtm_list_concat(thrinfo->thr_processed_commands,
+						thrinfo->thr_pending_commands[ii]);
+				thrinfo->thr_pending_commands[ii] = gtm_NIL;
+				break;
+
+			case MSG_SEQUENCE_GET_NEXT_MULTI:
+				if (gtmpqPutInt(MSG_SEQUENCE_GET_NEXT_MULTI, sizeof (GTM_MessageType), gtm_conn) ||
+					gtmpqPutInt(gtm_list_length(thrinfo->thr_pending_commands[ii]), sizeof(int), gtm_conn))
+					elog(ERROR, "Error sending data");
+
+				gtm_foreach (elem, thrinfo->thr_pending_commands[ii])
+				{
+					GTM_Sequence range;
+					int			coord_namelen;
+
+					cmdinfo = (GTMProxy_CommandInfo *)gtm_lfirst(elem);
+					Assert(cmdinfo->ci_mtype == ii);
+					cmdinfo->ci_res_index = res_index++;
+
+					range = cmdinfo->ci_data.cd_seq.range + cmdinfo->ci_data.cd_seq.refill;
+					coord_namelen = strlen(cmdinfo->ci_data.cd_seq.coord_name);
+					if (gtmpqPutInt(cmdinfo->ci_data.cd_seq.keylen, 4, gtm_conn) ||
+						gtmpqPutnchar(cmdinfo->ci_data.cd_seq.key,
+									  cmdinfo->ci_data.cd_seq.keylen, gtm_conn) ||
+						gtmpqPutInt(coord_namelen, 4, gtm_conn) ||
+						(coord_namelen > 0 &&
+						 gtmpqPutnchar(cmdinfo->ci_data.cd_seq.coord_name,
+									   coord_namelen, gtm_conn)) ||
+						gtmpqPutInt(cmdinfo->ci_data.cd_seq.coord_procid, 4, gtm_conn) ||
+						gtmpqPutnchar((char *)&range, sizeof (GTM_Sequence), gtm_conn))
+						elog(ERROR, "Error sending data");
+				}
+
+				/* Finish the message. */
+				Enable_Longjmp();
+				if (gtmpqPutMsgEnd(gtm_conn))
+					elog(ERROR, "Error finishing the message");
+				Disable_Longjmp();
+
 				/*
 				 * Move the entire list to the processed command
 				 */
@@ -2545,6 +3316,12 @@ GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo)
 			default:
 				elog(ERROR, "This message type (%d) can not be grouped together", ii);
 		}
+
+		if (overflow != gtm_NIL)
+		{
+			thrinfo->thr_pending_commands[ii] = overflow;
+			ii--;
+		}
 	}
 	/* Process backend disconnect messages now */
 	gtm_foreach (elem, thrinfo->thr_pending_commands[MSG_BACKEND_DISCONNECT])
@@ -2557,6 +3334,624 @@ GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo)
 	}
 }
 
+/*
+ * The GTM takes at most GTM_MAX_SEQ_MULTI sequence commands, and at most
+ * GTM_MAX_GLOBAL_TRANSACTIONS other commands in a group message. Leave as
+ * many pending commands of the given type, and return the rest.
+ */
+static gtm_List *
+GTMProxy_SplitPendingCommands(GTMProxy_ThreadInfo *thrinfo, GTM_MessageType mtype)
+{
+	gtm_List *group = gtm_NIL;
+	gtm_List *rest = thrinfo->thr_pending_commands[mtype];
+	int max_count;
+	MemoryContext oldContext;
+
+	if (mtype == MSG_SEQUENCE_GET_NEXT_MULTI)
+		max_count = GTM_MAX_SEQ_MULTI;
+	else
+		max_count = GTM_MAX_GLOBAL_TRANSACTIONS;
+
+	if (gtm_list_length(rest) <= max_count)
+		return gtm_NIL;
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+	while (gtm_list_length(group) < max_count)
+	{
+		group = gtm_lappend(group, gtm_linitial(rest));
+		rest = gtm_list_delete_first(rest);
+	}
+	MemoryContextSwitchTo(oldContext);
+
+	thrinfo->thr_pending_commands[mtype] = group;
+	return rest;
+}
+
+/*
+ * Queue the commands sent in this round as a new batch waiting for its
+ * responses.
+ */
+static void
+GTMProxy_QueueBatch(GTMProxy_ThreadInfo *thrinfo, uint64 snapshot_version)
+{
+	GTMProxy_Batch *batch;
+	gtm_ListCell *elem = NULL;
+	MemoryContext oldContext;
+
+	if (thrinfo->thr_processed_commands == gtm_NIL)
+		return;
+
+	gtm_foreach(elem, thrinfo->thr_processed_commands)
+	{
+		GTMProxy_CommandInfo *cmdinfo = (GTMProxy_CommandInfo *) gtm_lfirst(elem);
+		cmdinfo->ci_conn->con_inflight++;
+	}
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+	batch = (GTMProxy_Batch *) palloc(sizeof (GTMProxy_Batch));
+	batch->pb_id = thrinfo->thr_next_batch_id++;
+	batch->pb_commands = thrinfo->thr_processed_commands;
+	batch->pb_snapshot_version = snapshot_version;
+	thrinfo->thr_batches = gtm_lappend(thrinfo->thr_batches, batch);
+	MemoryContextSwitchTo(oldContext);
+
+	thrinfo->thr_processed_commands = gtm_NIL;
+
+	elog(DEBUG3, "Sent batch %u, %d batches in flight", batch->pb_id,
+		 gtm_list_length(thrinfo->thr_batches));
+}
+
+/*
+ * Read back the responses to the oldest batch in flight and put them on to
+ * the right backend connections.
+ *
+ * Each command is taken off the batch before its response is handled, so
+ * after an error the next call resumes with the following command.
+ */
+static void
+GTMProxy_ProcessBatchResponses(GTMProxy_ThreadInfo *thrinfo)
+{
+	GTMProxy_Batch *batch = (GTMProxy_Batch *) gtm_linitial(thrinfo->thr_batches);
+
+	while (batch->pb_commands != gtm_NIL)
+	{
+		GTMProxy_CommandInfo *cmdinfo;
+
+		cmdinfo = (GTMProxy_CommandInfo *) gtm_linitial(batch->pb_commands);
+		batch->pb_commands = gtm_list_delete_first(batch->pb_commands);
+		cmdinfo->ci_conn->con_inflight--;
+
+		/*
+		 * If this is a continuation of a multi-part command response, we
+		 * don't need to read another result from the stream. The previous
+		 * result contains our response and we should just read from it.
+		 */
+		if (cmdinfo->ci_res_index == 0)
+		{
+			Enable_Longjmp();
+			if ((thrinfo->thr_batch_res = GTMPQgetResult(thrinfo->thr_gtm_conn)) == NULL)
+			{
+				/*
+				 * Here's another place to check GTM communication error.
+				 * In this case, backup of each command will be taken care of
+				 * by ProcessResponse() so if socket read/write error is recorded,
+				 * disconnect GTM connection, retry connection and then if it faile,
+				 * wait for reconnect from gtm_ctl.
+				 */
+				if ((thrinfo->thr_gtm_conn->last_errno != 0) || (thrinfo->thr_gtm_conn->status == CONNECTION_BAD))
+				{
+					/*
+					 * Please note that error handling can end up with longjmp() and
+					 * may not return here.  The responses to the batches in
+					 * flight are lost with the connection, their clients get
+					 * an error.
+					 */
+					GTMProxy_ReportDroppedCommand(cmdinfo);
+					GTMProxy_FreeCommand(cmdinfo);
+					GTMProxy_DropBatches(thrinfo);
+					GTMProxy_InvalidateSharedSnapshot();
+					HandleGTMError(thrinfo->thr_gtm_conn);
+				}
+				elog(ERROR, "GTMPQgetResult failed");
+			}
+			Disable_Longjmp();
+
+			if (GTMProxyCacheSequences)
+			{
+				switch (cmdinfo->ci_mtype)
+				{
+					case MSG_SEQUENCE_SET_VAL:
+					case MSG_SEQUENCE_RESET:
+					case MSG_SEQUENCE_CLOSE:
+					case MSG_SEQUENCE_RENAME:
+					case MSG_SEQUENCE_ALTER:
+						/* Before the client hears about the change */
+						GTMProxy_BumpSeqGeneration();
+						break;
+
+					default:
+						break;
+				}
+			}
+
+			if (GTMProxyShareSnapshots &&
+				thrinfo->thr_batch_res->gr_status == GTM_RESULT_OK)
+			{
+				switch (cmdinfo->ci_mtype)
+				{
+					case MSG_TXN_COMMIT:
+					case MSG_TXN_COMMIT_MULTI:
+					case MSG_TXN_COMMIT_PREPARED:
+					case MSG_TXN_COMMIT_PREPARED_MULTI:
+						/* Before the client hears about the commit */
+						GTMProxy_InvalidateSharedSnapshot();
+						break;
+
+					case MSG_SNAPSHOT_GET_MULTI:
+						GTMProxy_ShareSnapshot(&thrinfo->thr_batch_res->gr_snapshot,
+											   batch->pb_snapshot_version);
+						break;
+
+					default:
+						break;
+				}
+			}
+		}
+
+		/* Cache the refill even if the client is gone */
+		if (cmdinfo->ci_mtype == MSG_SEQUENCE_GET_NEXT_MULTI)
+			GTMProxy_CacheSequenceRange(thrinfo, cmdinfo, thrinfo->thr_batch_res);
+
+		/* Nobody is left to send the response to */
+		if (!cmdinfo->ci_conn->con_disconnected)
+		{
+			/* Errors are reported to this client */
+			thrinfo->thr_conn = cmdinfo->ci_conn;
+			ProcessResponse(thrinfo, cmdinfo, thrinfo->thr_batch_res);
+		}
+		GTMProxy_FreeCommand(cmdinfo);
+	}
+
+	elog(DEBUG3, "Received responses to batch %u", batch->pb_id);
+
+	thrinfo->thr_batches = gtm_list_delete_first(thrinfo->thr_batches);
+	pfree(batch);
+}
+
+/*
+ * Forget the batches in flight, when their responses can not come anymore.
+ * Each client still waiting for a response gets an error instead.
+ */
+static void
+GTMProxy_DropBatches(GTMProxy_ThreadInfo *thrinfo)
+{
+	while (thrinfo->thr_batches != gtm_NIL)
+	{
+		GTMProxy_Batch *batch = (GTMProxy_Batch *) gtm_linitial(thrinfo->thr_batches);
+		gtm_ListCell *elem = NULL;
+
+		gtm_foreach(elem, batch->pb_commands)
+		{
+			GTMProxy_CommandInfo *cmdinfo = (GTMProxy_CommandInfo *) gtm_lfirst(elem);
+			cmdinfo->ci_conn->con_inflight--;
+			GTMProxy_ReportDroppedCommand(cmdinfo);
+			GTMProxy_FreeCommand(cmdinfo);
+		}
+		gtm_list_free(batch->pb_commands);
+
+		thrinfo->thr_batches = gtm_list_delete_first(thrinfo->thr_batches);
+		pfree(batch);
+	}
+	thrinfo->thr_batch_res = NULL;
+
+	/* The refills in flight are lost too */
+	gtm_list_free_deep(thrinfo->thr_seq_cache);
+	thrinfo->thr_seq_cache = gtm_NIL;
+}
+
+/*
+ * Tell the client of a command sent to GTM that its response is lost.
+ *
+ * The backup of the command is released so that it is not sent again once
+ * reconnected, the client would otherwise get two responses.
+ */
+static void
+GTMProxy_ReportDroppedCommand(GTMProxy_CommandInfo *cmdinfo)
+{
+	GTMProxy_ConnectionInfo *conninfo = cmdinfo->ci_conn;
+	StringInfoData buf;
+
+	/* Nobody is left to send the error to */
+	if (conninfo->con_disconnected)
+		return;
+
+	pq_beginmessage(&buf, 'E');
+	pq_sendbyte(&buf, PG_DIAG_SEVERITY);
+	pq_sendstring(&buf, "ERROR");
+	pq_sendbyte(&buf, PG_DIAG_MESSAGE_PRIMARY);
+	pq_sendstring(&buf, "connection to GTM lost before the response was received");
+	pq_sendbyte(&buf, '\0');
+	pq_endmessage(conninfo->con_port, &buf);
+	pq_flush(conninfo->con_port);
+
+	conninfo->con_pending_msg = MSG_TYPE_INVALID;
+	ReleaseCmdBackup(cmdinfo);
+}
+
+/*
+ * Free a command once it is answered or dropped.
+ */
+static void
+GTMProxy_FreeCommand(GTMProxy_CommandInfo *cmdinfo)
+{
+	if (cmdinfo->ci_mtype == MSG_SEQUENCE_GET_NEXT_MULTI)
+		pfree(cmdinfo->ci_data.cd_seq.key);
+	pfree(cmdinfo);
+}
+
+/*
+ * Return the number of commits acknowledged so far.
+ */
+static uint64
+GTMProxy_GetSnapshotVersion(void)
+{
+	uint64		version;
+
+	GTM_RWLockAcquire(&SharedSnapshot.ss_lock, GTM_LOCKMODE_READ);
+	version = SharedSnapshot.ss_version;
+	GTM_RWLockRelease(&SharedSnapshot.ss_lock);
+
+	return version;
+}
+
+/*
+ * Share a snapshot received from the GTM server, unless a commit has been
+ * acknowledged since it was requested.
+ */
+static void
+GTMProxy_ShareSnapshot(GTM_Snapshot snapshot, uint64 version)
+{
+	GTM_RWLockAcquire(&SharedSnapshot.ss_lock, GTM_LOCKMODE_WRITE);
+	if (SharedSnapshot.ss_version == version &&
+		snapshot->sn_xcnt <= GTM_MAX_GLOBAL_TRANSACTIONS)
+	{
+		SharedSnapshot.ss_xmin = snapshot->sn_xmin;
+		SharedSnapshot.ss_xmax = snapshot->sn_xmax;
+		SharedSnapshot.ss_xcnt = snapshot->sn_xcnt;
+		memcpy(SharedSnapshot.ss_xip, snapshot->sn_xip,
+			   sizeof (GlobalTransactionId) * snapshot->sn_xcnt);
+		SharedSnapshot.ss_valid = true;
+	}
+	GTM_RWLockRelease(&SharedSnapshot.ss_lock);
+}
+
+/*
+ * Forget the shared snapshot, a commit has made it obsolete.
+ */
+static void
+GTMProxy_InvalidateSharedSnapshot(void)
+{
+	GTM_RWLockAcquire(&SharedSnapshot.ss_lock, GTM_LOCKMODE_WRITE);
+	SharedSnapshot.ss_version++;
+	SharedSnapshot.ss_valid = false;
+	GTM_RWLockRelease(&SharedSnapshot.ss_lock);
+}
+
+/*
+ * Answer a snapshot request with the shared snapshot.  Returns false if
+ * there is none and the request has to go to the GTM server.
+ */
+static bool
+GTMProxy_SendSharedSnapshot(GTMProxy_ConnectionInfo *conninfo)
+{
+	StringInfoData buf;
+	int			txn_count = 1;
+	int			status = STATUS_OK;
+
+	GTM_RWLockAcquire(&SharedSnapshot.ss_lock, GTM_LOCKMODE_READ);
+	if (!SharedSnapshot.ss_valid)
+	{
+		GTM_RWLockRelease(&SharedSnapshot.ss_lock);
+		return false;
+	}
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendint(&buf, SNAPSHOT_GET_MULTI_RESULT, 4);
+	pq_sendbytes(&buf, (char *)&txn_count, sizeof (txn_count));
+	pq_sendbytes(&buf, (char *)&status, sizeof (status));
+	pq_sendbytes(&buf, (char *)&SharedSnapshot.ss_xmin, sizeof (GlobalTransactionId));
+	pq_sendbytes(&buf, (char *)&SharedSnapshot.ss_xmax, sizeof (GlobalTransactionId));
+	pq_sendint(&buf, SharedSnapshot.ss_xcnt, sizeof (int));
+	pq_sendbytes(&buf, (char *)SharedSnapshot.ss_xip,
+				 sizeof (GlobalTransactionId) * SharedSnapshot.ss_xcnt);
+	GTM_RWLockRelease(&SharedSnapshot.ss_lock);
+
+	pq_endmessage(conninfo->con_port, &buf);
+	pq_flush(conninfo->con_port);
+
+	return true;
+}
+
+/*
+ * Return the number of sequence changes acknowledged so far.
+ */
+static uint64
+GTMProxy_GetSeqGeneration(void)
+{
+	uint64		generation;
+
+	GTM_MutexLockAcquire(&SeqGenerationLock);
+	generation = SeqGeneration;
+	GTM_MutexLockRelease(&SeqGenerationLock);
+
+	return generation;
+}
+
+static void
+GTMProxy_BumpSeqGeneration(void)
+{
+	GTM_MutexLockAcquire(&SeqGenerationLock);
+	SeqGeneration++;
+	GTM_MutexLockRelease(&SeqGenerationLock);
+}
+
+/*
+ * Find the values the thread reserved for a sequence.  All of them are
+ * discarded first if a sequence changed meanwhile.
+ */
+static GTMProxy_SeqCache *
+GTMProxy_GetSeqCache(GTMProxy_ThreadInfo *thrinfo, const char *key,
+					 uint32 keylen, bool create)
+{
+	GTMProxy_SeqCache *cache;
+	gtm_ListCell *elem = NULL;
+	uint64		generation = GTMProxy_GetSeqGeneration();
+	MemoryContext oldContext;
+
+	if (thrinfo->thr_seq_generation != generation)
+	{
+		gtm_list_free_deep(thrinfo->thr_seq_cache);
+		thrinfo->thr_seq_cache = gtm_NIL;
+		thrinfo->thr_seq_generation = generation;
+	}
+
+	gtm_foreach(elem, thrinfo->thr_seq_cache)
+	{
+		cache = (GTMProxy_SeqCache *) gtm_lfirst(elem);
+		if (cache->sc_keylen == keylen && memcmp(cache->sc_key, key, keylen) == 0)
+			return cache;
+	}
+
+	if (!create)
+		return NULL;
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+	cache = (GTMProxy_SeqCache *) palloc0(offsetof(GTMProxy_SeqCache, sc_key) + keylen);
+	cache->sc_empty = true;
+	cache->sc_keylen = keylen;
+	memcpy(cache->sc_key, key, keylen);
+	thrinfo->thr_seq_cache = gtm_lappend(thrinfo->thr_seq_cache, cache);
+	MemoryContextSwitchTo(oldContext);
+
+	return cache;
+}
+
+/*
+ * Answer a nextval request with values the thread reserved, up to the range
+ * asked for.  Returns false if there are none left and the request has to go
+ * to the GTM server.
+ */
+static bool
+GTMProxy_SendCachedSequence(GTMProxy_ConnectionInfo *conninfo,
+							const char *key, uint32 keylen, GTM_Sequence range)
+{
+	GTMProxy_SeqCache *cache;
+	StringInfoData buf;
+	GTM_Sequence seqval;
+	GTM_Sequence rangemax;
+	GTM_Sequence count;
+
+	cache = GTMProxy_GetSeqCache(GetMyThreadInfo, key, keylen, false);
+	if (cache == NULL || cache->sc_empty)
+		return false;
+
+	seqval = cache->sc_next;
+	count = (cache->sc_rangemax - seqval) / cache->sc_increment + 1;
+	if (count > range)
+	{
+		rangemax = seqval + (range - 1) * cache->sc_increment;
+		cache->sc_next = rangemax + cache->sc_increment;
+		count = range;
+	}
+	else
+	{
+		rangemax = cache->sc_rangemax;
+		cache->sc_empty = true;
+	}
+	cache->sc_consumed += count;
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendint(&buf, SEQUENCE_GET_NEXT_RESULT, 4);
+	pq_sendint(&buf, keylen, 4);
+	pq_sendbytes(&buf, key, keylen);
+	pq_sendbytes(&buf, (char *)&seqval, sizeof (GTM_Sequence));
+	pq_sendbytes(&buf, (char *)&rangemax, sizeof (GTM_Sequence));
+	pq_endmessage(conninfo->con_port, &buf);
+	pq_flush(conninfo->con_port);
+
+	GTMProxy_SetSequenceLastVal(conninfo, key, keylen, rangemax);
+
+	return true;
+}
+
+/*
+ * Number of values to reserve in addition to the range a backend asked for,
+ * to last about SEQ_CACHE_TARGET_MS at the rate the previous ones were
+ * consumed.
+ */
+static GTM_Sequence
+GTMProxy_SeqRefillSize(GTMProxy_SeqCache *cache, GTM_Sequence range)
+{
+	GTM_Timestamp now = GTM_TimestampGetCurrent();
+	GTM_Sequence refill;
+
+	if (cache->sc_refill_time == 0)
+		refill = range;
+	else
+	{
+		int64		elapsed_ms = (now - cache->sc_refill_time) / 1000;
+
+		if (elapsed_ms < 1)
+			elapsed_ms = 1;
+		refill = cache->sc_consumed * SEQ_CACHE_TARGET_MS / elapsed_ms;
+	}
+
+	if (refill < range)
+		refill = range;
+	if (refill > SEQ_CACHE_MAX_REFILL)
+		refill = SEQ_CACHE_MAX_REFILL;
+
+	cache->sc_consumed = 0;
+	cache->sc_refill_time = now;
+
+	return refill;
+}
+
+/*
+ * Keep the values the GTM server sent back for a grouped nextval beyond
+ * those of the command itself, if the command carried the refill of its
+ * sequence.
+ */
+static void
+GTMProxy_CacheSequenceRange(GTMProxy_ThreadInfo *thrinfo,
+							GTMProxy_CommandInfo *cmdinfo, GTM_Result *res)
+{
+	GTMProxy_SeqCache *cache;
+	int			idx = cmdinfo->ci_res_index;
+	GTM_Sequence seqval;
+	GTM_Sequence rangemax;
+	GTM_Sequence increment;
+	GTM_Sequence count;
+
+	cache = GTMProxy_GetSeqCache(thrinfo, cmdinfo->ci_data.cd_seq.key,
+								 cmdinfo->ci_data.cd_seq.keylen, false);
+
+	/* Values reserved before a sequence change are not handed out */
+	if (cache == NULL ||
+		cmdinfo->ci_data.cd_seq.generation != thrinfo->thr_seq_generation)
+		return;
+
+	if (cmdinfo->ci_data.cd_seq.refill > 0)
+		cache->sc_refilling = false;
+
+	if (res->gr_status != GTM_RESULT_OK ||
+		res->gr_type != SEQUENCE_GET_NEXT_MULTI_RESULT ||
+		idx >= res->gr_resdata.grd_seq_multi.seq_count ||
+		res->gr_resdata.grd_seq_multi.status[idx] != 0)
+		return;
+
+	seqval = res->gr_resdata.grd_seq_multi.seqval[idx];
+	rangemax = res->gr_resdata.grd_seq_multi.rangemax[idx];
+	increment = res->gr_resdata.grd_seq_multi.increment[idx];
+	count = (rangemax - seqval) / increment + 1;
+
+	if (count <= cmdinfo->ci_data.cd_seq.range)
+	{
+		cache->sc_consumed += count;
+		return;
+	}
+	cache->sc_consumed += cmdinfo->ci_data.cd_seq.range;
+
+	if (cmdinfo->ci_data.cd_seq.refill > 0)
+	{
+		cache->sc_next = seqval + cmdinfo->ci_data.cd_seq.range * increment;
+		cache->sc_rangemax = rangemax;
+		cache->sc_increment = increment;
+		cache->sc_empty = false;
+	}
+}
+
+/*
+ * Remember the last value of a sequence served to a connection.
+ */
+static void
+GTMProxy_SetSequenceLastVal(GTMProxy_ConnectionInfo *conninfo,
+							const char *key, uint32 keylen, GTM_Sequence value)
+{
+	GTMProxy_SeqLastVal *lastval;
+	gtm_ListCell *elem = NULL;
+	MemoryContext oldContext;
+
+	gtm_foreach(elem, conninfo->con_seq_lastvals)
+	{
+		lastval = (GTMProxy_SeqLastVal *) gtm_lfirst(elem);
+		if (lastval->sl_keylen == keylen && memcmp(lastval->sl_key, key, keylen) == 0)
+		{
+			lastval->sl_value = value;
+			return;
+		}
+	}
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+	lastval = (GTMProxy_SeqLastVal *) palloc(offsetof(GTMProxy_SeqLastVal, sl_key) + keylen);
+	lastval->sl_value = value;
+	lastval->sl_keylen = keylen;
+	memcpy(lastval->sl_key, key, keylen);
+	conninfo->con_seq_lastvals = gtm_lappend(conninfo->con_seq_lastvals, lastval);
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * Answer a currval request with the last value served to the connection.
+ * Returns false if there is none and the request has to go to the GTM
+ * server.
+ */
+static bool
+GTMProxy_SendSequenceLastVal(GTMProxy_ConnectionInfo *conninfo,
+							 const char *key, uint32 keylen)
+{
+	GTMProxy_SeqLastVal *lastval;
+	gtm_ListCell *elem = NULL;
+	StringInfoData buf;
+
+	gtm_foreach(elem, conninfo->con_seq_lastvals)
+	{
+		lastval = (GTMProxy_SeqLastVal *) gtm_lfirst(elem);
+		if (lastval->sl_keylen == keylen && memcmp(lastval->sl_key, key, keylen) == 0)
+		{
+			pq_beginmessage(&buf, 'S');
+			pq_sendint(&buf, SEQUENCE_GET_CURRENT_RESULT, 4);
+			pq_sendint(&buf, keylen, 4);
+			pq_sendbytes(&buf, key, keylen);
+			pq_sendbytes(&buf, (char *)&lastval->sl_value, sizeof (GTM_Sequence));
+			pq_endmessage(conninfo->con_port, &buf);
+			pq_flush(conninfo->con_port);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+GTMProxy_ForgetSequenceLastVal(GTMProxy_ConnectionInfo *conninfo,
+							   const char *key, uint32 keylen)
+{
+	GTMProxy_SeqLastVal *lastval;
+	gtm_ListCell *elem = NULL;
+
+	gtm_foreach(elem, conninfo->con_seq_lastvals)
+	{
+		lastval = (GTMProxy_SeqLastVal *) gtm_lfirst(elem);
+		if (lastval->sl_keylen == keylen && memcmp(lastval->sl_key, key, keylen) == 0)
+		{
+			conninfo->con_seq_lastvals = gtm_list_delete_ptr(conninfo->con_seq_lastvals, lastval);
+			pfree(lastval);
+			return;
+		}
+	}
+}
+
 /*
  * Validate the proposed data directory
  */
@@ -3078,11 +4473,12 @@ ConnectGTM(void)
  */
 static void ReleaseCmdBackup(GTMProxy_CommandInfo *cmdinfo)
 {
-	GTMProxy_ConnID connIdx = cmdinfo->ci_conn->con_id;
+	GTMProxy_ConnectionInfo *conninfo = cmdinfo->ci_conn;
 
-	GetMyThreadInfo->thr_any_backup[connIdx] = FALSE;
-	GetMyThreadInfo->thr_qtype[connIdx] = 0;
-	resetStringInfo(&(GetMyThreadInfo->thr_inBufData[connIdx]));
+	conninfo->con_any_backup = FALSE;
+	conninfo->con_qtype = 0;
+	if (conninfo->con_inBufData.data)
+		resetStringInfo(&conninfo->con_inBufData);
 }
 
 
@@ -3113,6 +4509,7 @@ workerThreadReconnectToGTM(void)
 	if (GetMyThreadInfo->thr_gtm_conn)
 	{
 		saveMyClientId = GetMyThreadInfo->thr_gtm_conn->my_id;
+		GTMProxy_WaitSetWatchGTM(GetMyThreadInfo, -1, 0);
 		GTMPQfinish(GetMyThreadInfo->thr_gtm_conn);
 	}
 
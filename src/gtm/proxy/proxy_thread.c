@@ -17,6 +17,10 @@
 #include "gtm/memutils.h"
 #include "gtm/libpq.h"
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 static void *GTMProxy_ThreadMainWrapper(void *argp);
 static void GTMProxy_ThreadCleanup(void *argp);
 
@@ -328,10 +332,10 @@ GTMProxy_ThreadMainWrapper(void *argp)
 }
 
 /*
- * Add the given connection info structure to a thread which is selected by a
- * round-robin manner. The caller is responsible for only accepting the
+ * Hand the given connection info structure over to the worker thread serving
+ * the fewest connections. The caller is responsible for only accepting the
  * connection. Other things including the authentication is done by the worker
- * thread when it finds a new entry in the connection list.
+ * thread when it finds a new entry in its list of new connections.
  *
  * Return the reference to the GTMProxy_ThreadInfo structure of the thread
  * which will be serving this connection
@@ -340,46 +344,116 @@ GTMProxy_ThreadInfo *
 GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo)
 {
 	GTMProxy_ThreadInfo *thrinfo = NULL;
-	GTMProxy_ConnID connIndx, ii;
+	uint32 min_load = 0;
+	int ii;
 
 	/*
-	 * Get the next thread in the queue
+	 * Pick the least loaded worker. Always start with thread 1 because thread
+	 * 0 is the main thread
 	 */
-	GTM_RWLockAcquire(&GTMProxyThreads->gt_lock, GTM_LOCKMODE_WRITE);
+	GTM_RWLockAcquire(&GTMProxyThreads->gt_lock, GTM_LOCKMODE_READ);
 
-	/*
-	 * Always start with thread 1 because thread 0 is the main thread
-	 */
-	if (GTMProxyThreads->gt_next_worker == 0)
-		GTMProxyThreads->gt_next_worker = 1;
+	for (ii = 1; ii < GTMProxyThreads->gt_array_size; ii++)
+	{
+		GTMProxy_ThreadInfo *worker = GTMProxyThreads->gt_threads[ii];
+		uint32 load;
 
-	thrinfo = GTMProxyThreads->gt_threads[GTMProxyThreads->gt_next_worker];
+		if (worker == NULL)
+			continue;
 
-	/*
-	 * Set the next worker thread before releasing the lock
-	 */
-	GTMProxyThreads->gt_next_worker++;
-	if (GTMProxyThreads->gt_next_worker == GTMProxyThreads->gt_thread_count)
-	   GTMProxyThreads->gt_next_worker = 1;
+		GTM_MutexLockAcquire(&worker->thr_lock);
+		load = worker->thr_conn_count + worker->thr_new_count;
+		GTM_MutexLockRelease(&worker->thr_lock);
+
+		if (thrinfo == NULL || load < min_load)
+		{
+			thrinfo = worker;
+			min_load = load;
+		}
+	}
 
 	GTM_RWLockRelease(&GTMProxyThreads->gt_lock);
 
+	if (thrinfo == NULL)
+	{
+		elog(LOG, "No worker thread to serve the connection");
+		return NULL;
+	}
+
 	/*
-	 * Lock the threadninfo structure to safely add the new connection to the
-	 * thread structure. The thread will see the connection when it queries the
-	 * socket descriptor in the next cycle
+	 * Queue the connection for the worker thread, which takes it at the top
+	 * of its next cycle.
 	 */
 	GTM_MutexLockAcquire(&thrinfo->thr_lock);
 
-	if (thrinfo->thr_conn_count >= GTM_PROXY_MAX_CONNECTIONS)
+	conninfo->con_next = thrinfo->thr_new_conns;
+	thrinfo->thr_new_conns = conninfo;
+	thrinfo->thr_new_count++;
+
+	/*
+	 * Signal the worker thread if its waiting for connections to be added to
+	 * its Q. A busy worker finds it within poll_timeout_ms.
+	 */
+	GTM_CVBcast(&thrinfo->thr_cv);
+	GTM_MutexLockRelease(&thrinfo->thr_lock);
+
+	return thrinfo;
+}
+
+/*
+ * Give a connection taken off thr_new_conns a slot in the connection array of
+ * the worker thread, growing the array as needed.
+ *
+ * Returns false if the thread has no slot left.
+ */
+bool
+GTMProxy_ThreadTakeConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_ConnectionInfo *conninfo)
+{
+	GTMProxy_ConnID connIndx;
+	uint32 ii;
+
+	if (thrinfo->thr_conn_count == thrinfo->thr_conn_slots)
 	{
-		GTM_MutexLockRelease(&thrinfo->thr_lock);
-		elog(LOG, "Too many connections");
-		return NULL;
+		uint32 newsize;
+
+		if (thrinfo->thr_conn_slots >= GTM_PROXY_MAX_CONNECTIONS)
+		{
+			elog(LOG, "Too many connections");
+			return false;
+		}
+
+		if (thrinfo->thr_conn_slots == 0)
+			newsize = GTM_PROXY_INIT_CONNECTIONS;
+		else
+			newsize = thrinfo->thr_conn_slots * 2;
+		if (newsize > GTM_PROXY_MAX_CONNECTIONS)
+			newsize = GTM_PROXY_MAX_CONNECTIONS;
+
+		if (thrinfo->thr_all_conns == NULL)
+		{
+			thrinfo->thr_all_conns = (GTMProxy_ConnectionInfo **)
+				palloc(sizeof (GTMProxy_ConnectionInfo *) * newsize);
+			thrinfo->thr_conn_map = (int *) palloc(sizeof (int) * newsize);
+		}
+		else
+		{
+			thrinfo->thr_all_conns = (GTMProxy_ConnectionInfo **)
+				repalloc(thrinfo->thr_all_conns,
+						 sizeof (GTMProxy_ConnectionInfo *) * newsize);
+			thrinfo->thr_conn_map = (int *)
+				repalloc(thrinfo->thr_conn_map, sizeof (int) * newsize);
+		}
+
+		for (ii = thrinfo->thr_conn_slots; ii < newsize; ii++)
+		{
+			thrinfo->thr_all_conns[ii] = NULL;
+			thrinfo->thr_conn_map[ii] = -1;
+		}
+		thrinfo->thr_conn_slots = newsize;
 	}
 
 	connIndx = -1;
-	for (ii = 0; ii < GTM_PROXY_MAX_CONNECTIONS; ii++)
+	for (ii = 0; ii < thrinfo->thr_conn_slots; ii++)
 	{
 		if (thrinfo->thr_all_conns[ii] == NULL)
 		{
@@ -393,9 +467,8 @@ GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo)
 
 	if (connIndx == -1)
 	{
-		GTM_MutexLockRelease(&thrinfo->thr_lock);
 		elog(LOG, "Too many connections - could not find a free slot");
-		return NULL;
+		return false;
 	}
 
 	/*
@@ -409,6 +482,9 @@ GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo)
 	 * while proxying responses back to the client.
 	 */
 	conninfo->con_id = connIndx;
+	conninfo->con_any_backup = FALSE;
+	conninfo->con_qtype = 0;
+	initStringInfo(&conninfo->con_inBufData);
 	thrinfo->thr_all_conns[connIndx] = conninfo;
 
 	/*
@@ -420,32 +496,18 @@ GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo)
 	 * for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
 	 * {
 	 * 		int connIndx = thrinfo->thr_conn_map[ii];
-	 * 	 	GTMProxy_ConnectionInfo *conninfo = * 	 	thrinfo->thr_all_conns[connIndx];	
+	 * 	 	GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
 	 * 	 	.....
 	 * }
-	 */  
-	thrinfo->thr_conn_map[thrinfo->thr_conn_count] = connIndx;
-	thrinfo->thr_conn_count++;
-
-	/*
-	 * Now increment the seqno since a new connection is added to the array.
-	 * Before we do the next poll(), the fd array will be forced to be
-	 * reconstructed.
-	 */
-   	thrinfo->thr_seqno++;
-
-	/*
-	 * Signal the worker thread if its waiting for connections to be added to
-	 * its Q
 	 *
-	 * XXX May be we can first check the condition that this is the first
-	 * connection in the array and also use signal instead of a bcast since
-	 * only one thread is waiting on the cv.
+	 * The count is read by the main thread to balance the load.
 	 */
-	GTM_CVBcast(&thrinfo->thr_cv);
+	GTM_MutexLockAcquire(&thrinfo->thr_lock);
+	thrinfo->thr_conn_map[thrinfo->thr_conn_count] = connIndx;
+	thrinfo->thr_conn_count++;
 	GTM_MutexLockRelease(&thrinfo->thr_lock);
 
-	return thrinfo;
+	return true;
 }
 
 /*
@@ -455,38 +517,24 @@ int
 GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_ConnectionInfo *conninfo)
 {
 	int ii;
-	int connIndx;
-
-	/*
-	 * Lock the threadninfo structure to safely remove the connection from the
-	 * thread structure.
-	 */
-	GTM_MutexLockAcquire(&thrinfo->thr_lock);
-
-	connIndx = -1;
-	for (ii = 0; ii < GTM_PROXY_MAX_CONNECTIONS; ii++)
-	{
-		if (thrinfo->thr_all_conns[ii] == conninfo)
-		{
-			connIndx = ii;
-			break;
-		}
-	}
+	int connIndx = conninfo->con_id;
 
-	if (connIndx == -1)
-	{
-		GTM_MutexLockRelease(&thrinfo->thr_lock);
+	if (connIndx < 0 || connIndx >= thrinfo->thr_conn_slots ||
+		thrinfo->thr_all_conns[connIndx] != conninfo)
 		elog(ERROR, "No such connection");
-	}
 
 	/*
-	 * Reset command backup info
+	 * Release command backup info
 	 */
-	thrinfo->thr_any_backup[connIndx] = FALSE;
-	thrinfo->thr_qtype[connIndx] = 0;
-	resetStringInfo(&(thrinfo->thr_inBufData[connIndx]));
+	conninfo->con_any_backup = FALSE;
+	conninfo->con_qtype = 0;
+	pfree(conninfo->con_inBufData.data);
+	conninfo->con_inBufData.data = NULL;
 	thrinfo->thr_all_conns[connIndx] = NULL;
 
+	gtm_list_free_deep(conninfo->con_seq_lastvals);
+	conninfo->con_seq_lastvals = gtm_NIL;
+
 	/*
 	 * Now also removed the entry from thr_conn_map
 	 */
@@ -497,10 +545,12 @@ GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_Connectio
 	}
 
 	if (ii >= thrinfo->thr_conn_count)
-	{
-		GTM_MutexLockRelease(&thrinfo->thr_lock);
 		elog(FATAL, "Failed to find connection mapping to %d", connIndx);
-	}
+
+	/*
+	 * Lock the threadninfo structure since the main thread reads the count
+	 */
+	GTM_MutexLockAcquire(&thrinfo->thr_lock);
 
 	/*
 	 * If this is the last entry in the array ? If not, then copy the last
@@ -521,13 +571,237 @@ GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_Connectio
 	}
 
 	thrinfo->thr_conn_count--;
+	GTM_MutexLockRelease(&thrinfo->thr_lock);
+
+	return 0;
+}
+
+/*
+ * Wait set of a worker thread
+ *
+ * A worker thread waits for its client connections to become readable, and
+ * for the GTM connection while batches are in flight. With epoll the kernel
+ * keeps the set and only the ready descriptors are reported, so the cost of
+ * a wait does not grow with idle connections. Elsewhere the set is a poll()
+ * array, which each connection keeps its position in.
+ */
+void
+GTMProxy_WaitSetInit(GTMProxy_ThreadInfo *thrinfo)
+{
+	thrinfo->thr_gtm_sock = -1;
+	thrinfo->thr_gtm_events = 0;
+#ifdef HAVE_SYS_EPOLL_H
+	thrinfo->thr_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (thrinfo->thr_epoll_fd < 0)
+		elog(FATAL, "Could not create epoll instance: %s", strerror(errno));
+#else
+	thrinfo->thr_epoll_fd = -1;
+	thrinfo->thr_poll_size = GTM_PROXY_INIT_CONNECTIONS;
+	thrinfo->thr_poll_count = 0;
+	thrinfo->thr_poll_fds = (struct pollfd *)
+		palloc(sizeof (struct pollfd) * (thrinfo->thr_poll_size + 1));
+	thrinfo->thr_poll_conns = (GTMProxy_ConnectionInfo **)
+		palloc(sizeof (GTMProxy_ConnectionInfo *) * thrinfo->thr_poll_size);
+#endif
+}
+
+/*
+ * Wait for the given client connection to become readable. Returns false if
+ * the connection cannot be waited for.
+ */
+bool
+GTMProxy_WaitSetAdd(GTMProxy_ThreadInfo *thrinfo, GTMProxy_ConnectionInfo *conninfo)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = conninfo;
+	if (epoll_ctl(thrinfo->thr_epoll_fd, EPOLL_CTL_ADD,
+				  conninfo->con_port->sock, &ev) < 0)
+	{
+		elog(LOG, "Could not add connection to epoll set: %s",
+			 strerror(errno));
+		return false;
+	}
+#else
+	int pos;
+
+	if (thrinfo->thr_poll_count == thrinfo->thr_poll_size)
+	{
+		thrinfo->thr_poll_size *= 2;
+		thrinfo->thr_poll_fds = (struct pollfd *)
+			repalloc(thrinfo->thr_poll_fds,
+					 sizeof (struct pollfd) * (thrinfo->thr_poll_size + 1));
+		thrinfo->thr_poll_conns = (GTMProxy_ConnectionInfo **)
+			repalloc(thrinfo->thr_poll_conns,
+					 sizeof (GTMProxy_ConnectionInfo *) * thrinfo->thr_poll_size);
+	}
+
+	pos = thrinfo->thr_poll_count++;
+	thrinfo->thr_poll_fds[pos].fd = conninfo->con_port->sock;
+	thrinfo->thr_poll_fds[pos].events = POLLIN;
+	thrinfo->thr_poll_fds[pos].revents = 0;
+	thrinfo->thr_poll_conns[pos] = conninfo;
+	conninfo->con_wait_pos = pos;
+#endif
+
+	return true;
+}
+
+/*
+ * Stop waiting for the given client connection. This must be done before its
+ * socket is closed.
+ */
+void
+GTMProxy_WaitSetRemove(GTMProxy_ThreadInfo *thrinfo, GTMProxy_ConnectionInfo *conninfo)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event ev;
+
+	if (epoll_ctl(thrinfo->thr_epoll_fd, EPOLL_CTL_DEL,
+				  conninfo->con_port->sock, &ev) < 0)
+		elog(LOG, "Could not remove connection from epoll set: %s",
+			 strerror(errno));
+#else
+	int pos = conninfo->con_wait_pos;
+	int last = thrinfo->thr_poll_count - 1;
+
+	if (pos < 0 || pos > last || thrinfo->thr_poll_conns[pos] != conninfo)
+		return;
+
+	/* Move the last entry into the free position */
+	if (pos < last)
+	{
+		thrinfo->thr_poll_fds[pos] = thrinfo->thr_poll_fds[last];
+		thrinfo->thr_poll_conns[pos] = thrinfo->thr_poll_conns[last];
+		thrinfo->thr_poll_conns[pos]->con_wait_pos = pos;
+	}
+	thrinfo->thr_poll_count--;
+	conninfo->con_wait_pos = -1;
+#endif
+}
+
+/*
+ * Set the events to wait for on the GTM connection, none with events 0. The
+ * connection must be unwatched before its socket is closed.
+ */
+void
+GTMProxy_WaitSetWatchGTM(GTMProxy_ThreadInfo *thrinfo, int sock, uint32 events)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event ev;
+	int op;
+
+	if (sock != thrinfo->thr_gtm_sock)
+	{
+		if (thrinfo->thr_gtm_sock >= 0 && thrinfo->thr_gtm_events != 0)
+			epoll_ctl(thrinfo->thr_epoll_fd, EPOLL_CTL_DEL,
+					  thrinfo->thr_gtm_sock, &ev);
+		thrinfo->thr_gtm_sock = sock;
+		thrinfo->thr_gtm_events = 0;
+	}
+
+	if (sock < 0 || events == thrinfo->thr_gtm_events)
+		return;
+
+	if (thrinfo->thr_gtm_events == 0)
+		op = EPOLL_CTL_ADD;
+	else if (events == 0)
+		op = EPOLL_CTL_DEL;
+	else
+		op = EPOLL_CTL_MOD;
+
+	ev.events = 0;
+	if (events & GTM_PROXY_EV_READ)
+		ev.events |= EPOLLIN;
+	if (events & GTM_PROXY_EV_WRITE)
+		ev.events |= EPOLLOUT;
+	ev.data.ptr = NULL;
+
+	if (epoll_ctl(thrinfo->thr_epoll_fd, op, sock, &ev) < 0)
+		elog(ERROR, "Could not watch GTM connection: %s", strerror(errno));
+#endif
+	thrinfo->thr_gtm_sock = sock;
+	thrinfo->thr_gtm_events = events;
+}
+
+/*
+ * Wait up to timeout_ms for the wait set, and fill thr_events with what is
+ * ready. Returns the number of events, or -1 with errno set.
+ */
+int
+GTMProxy_WaitSetWait(GTMProxy_ThreadInfo *thrinfo, int timeout_ms)
+{
+	int nevents = 0;
+	int ii;
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event events[GTM_PROXY_MAX_EVENTS];
+	int nready;
+
+	nready = epoll_wait(thrinfo->thr_epoll_fd, events, GTM_PROXY_MAX_EVENTS,
+						timeout_ms);
+	if (nready < 0)
+		return -1;
+
+	for (ii = 0; ii < nready; ii++)
+	{
+		GTMProxy_Event *event = &thrinfo->thr_events[nevents++];
+
+		event->ev_conn = (GTMProxy_ConnectionInfo *) events[ii].data.ptr;
+		event->ev_events = 0;
+		if (events[ii].events & EPOLLIN)
+			event->ev_events |= GTM_PROXY_EV_READ;
+		if (events[ii].events & EPOLLOUT)
+			event->ev_events |= GTM_PROXY_EV_WRITE;
+		if (events[ii].events & (EPOLLHUP | EPOLLERR))
+			event->ev_events |= GTM_PROXY_EV_HUP;
+	}
+#else
+	int nfds = thrinfo->thr_poll_count;
+	int nready;
+
+	if (thrinfo->thr_gtm_sock >= 0 && thrinfo->thr_gtm_events != 0)
+	{
+		struct pollfd *gtm_pollfd = &thrinfo->thr_poll_fds[nfds++];
+
+		gtm_pollfd->fd = thrinfo->thr_gtm_sock;
+		gtm_pollfd->events = 0;
+		if (thrinfo->thr_gtm_events & GTM_PROXY_EV_READ)
+			gtm_pollfd->events |= POLLIN;
+		if (thrinfo->thr_gtm_events & GTM_PROXY_EV_WRITE)
+			gtm_pollfd->events |= POLLOUT;
+	}
+
+	nready = poll(thrinfo->thr_poll_fds, nfds, timeout_ms);
+	if (nready < 0)
+		return -1;
 
 	/*
-	 * Increment the seqno to ensure that the next time before we poll, the fd
-	 * array is reconstructed.
+	 * The GTM connection goes first so that it is never left out. Clients
+	 * left out are reported again by the next wait.
 	 */
-	thrinfo->thr_seqno++;
-	GTM_MutexLockRelease(&thrinfo->thr_lock);
+	for (ii = nfds - 1; ii >= 0 && nready > 0 && nevents < GTM_PROXY_MAX_EVENTS; ii--)
+	{
+		short revents = thrinfo->thr_poll_fds[ii].revents;
+		GTMProxy_Event *event;
+
+		if (revents == 0)
+			continue;
+		nready--;
+
+		event = &thrinfo->thr_events[nevents++];
+		event->ev_conn = (ii < thrinfo->thr_poll_count) ?
+			thrinfo->thr_poll_conns[ii] : NULL;
+		event->ev_events = 0;
+		if (revents & POLLIN)
+			event->ev_events |= GTM_PROXY_EV_READ;
+		if (revents & POLLOUT)
+			event->ev_events |= GTM_PROXY_EV_WRITE;
+		if (revents & (POLLHUP | POLLERR | POLLNVAL))
+			event->ev_events |= GTM_PROXY_EV_HUP;
+	}
+#endif
 
-	return 0;
+	return nevents;
 }
@@ -215,8 +215,9 @@ ProcessPGXCNodeRegister(Port *myport, StringInfo message, bool is_backup)
 			if (!standbynode)
 				GTMThreads->gt_standby_ready = false;
 
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 		}
 		/*
@@ -316,8 +317,9 @@ ProcessPGXCNodeUnregister(Port *myport, StringInfo message, bool is_backup)
 			if (gtm_standby_check_communication_error(&count, oldconn))
 				goto retry;
 
-			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-				gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY) &&
+				gtm_standby_sync_or_resend(&count))
+				goto retry;
 
 			elog(DEBUG1, "node_unregister() returns rc %d.", _rc);
 		}
@@ -492,10 +494,12 @@ finishStandbyConn(GTM_ThreadInfo *thrinfo)
 }
 
 /*
- * Process MSG_REGISTER_SESSION message
+ * Process MSG_REGISTER_SESSION/MSG_BKUP_REGISTER_SESSION message
+ *
+ * is_backup indicates the message is MSG_BKUP_REGISTER_SESSION
  */
 void
-ProcessPGXCRegisterSession(Port *myport, StringInfo message)
+ProcessPGXCRegisterSession(Port *myport, StringInfo message, bool is_backup)
 {
 	char			coord_name[SP_NODE_NAME];
 	int32			coord_procid;
@@ -539,6 +543,10 @@ ProcessPGXCRegisterSession(Port *myport, StringInfo message)
 			GTM_CleanupSeqSession(coord_name, old_procid);
 	}
 
+	/* Backup messages are not acknowledged */
+	if (is_backup)
+		return;
+
 	/*
 	 * If there is a standby forward the info to it
 	 */
@@ -549,15 +557,15 @@ ProcessPGXCRegisterSession(Port *myport, StringInfo message)
 		int count = 0;
 		GTM_PGXCNodeInfo *standbynode;
 
-		elog(DEBUG1, "calling register_session() for standby GTM %p.",
+		elog(DEBUG1, "calling bkup_register_session() for standby GTM %p.",
 			 GetMyThreadInfo->thr_conn->standby);
 
 		do
 		{
-			_rc = register_session(GetMyThreadInfo->thr_conn->standby,
-								   coord_name, coord_procid, coord_backendid);
+			_rc = bkup_register_session(GetMyThreadInfo->thr_conn->standby,
+										coord_name, coord_procid, coord_backendid);
 
-			elog(DEBUG1, "register_session() returns rc %d.", _rc);
+			elog(DEBUG1, "bkup_register_session() returns rc %d.", _rc);
 		}
 		while (gtm_standby_check_communication_error(&count, oldconn));
 
@@ -567,7 +575,7 @@ ProcessPGXCRegisterSession(Port *myport, StringInfo message)
 			GTMThreads->gt_standby_ready = false;
 
 		if (Backup_synchronously && (myport->remote_type != GTM_NODE_GTM_PROXY))
-			gtm_sync_standby(GetMyThreadInfo->thr_conn->standby);
+			gtm_standby_sync_or_resend(NULL);
 
 	}
 
@@ -11,10 +11,12 @@
 #define ACCESS_GTM_H
 
 #include "gtm/gtm_c.h"
+#include "gtm/gtm_stat.h"
 
 /* Configuration variables */
 extern char *GtmHost;
 extern int GtmPort;
+extern bool GtmSharedMemory;
 extern bool gtm_backup_barrier;
 
 extern bool IsXidFromGTM;
@@ -65,4 +67,6 @@ extern int ReportBarrierGTM(char *barrier_id);
 extern int ReportGlobalXmin(GlobalTransactionId gxid,
 		GlobalTransactionId *global_xmin,
 		GlobalTransactionId *latest_completed_xid);
+/* Statistics */
+extern int GetStatsGTM(GTM_StatEntry **entries);
 #endif /* ACCESS_GTM_H */
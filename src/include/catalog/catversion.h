@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	201509041
+#define CATALOG_VERSION_NO	201509047
 
 #endif
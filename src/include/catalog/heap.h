@@ -18,6 +18,7 @@
 #include "catalog/indexing.h"
 #include "catalog/objectaddress.h"
 #include "parser/parse_node.h"
+#include "utils/array.h"
 
 
 typedef struct RawColumnDefault
@@ -148,10 +149,17 @@ extern void GetRelationDistributionItems(Oid relid,
 										 char *locatortype,
 										 int *hashalgorithm,
 										 int *hashbuckets,
-										 AttrNumber *attnum);
+										 AttrNumber *attnum,
+										 List **attnums);
 extern Oid *GetRelationDistributionNodes(PGXCSubCluster *subcluster,
 										 int *numnodes);
 extern Oid *BuildRelationDistributionNodes(List *nodes, int *numnodes);
+extern ArrayType *GetRelationDistributionValues(DistributeBy *distributeby,
+							  PGXCSubCluster *subcluster,
+							  TupleDesc descriptor,
+							  AttrNumber attnum,
+							  Oid **nodeoids,
+							  int *numnodes);
 extern Oid *SortRelationDistributionNodes(Oid *nodeoids, int numnodes);
 #endif
 
@@ -5290,6 +5290,14 @@ DATA(insert OID = 7010 (  pgxc_is_committed	PGNSP PGUID 12 1 1 0 0 f f f f t t s
 DESCR("is given GXID committed or aborted?");
 DATA(insert OID = 7011 ( pgxc_lock_for_backup PGNSP PGUID 12 1 0 0 0 f f f f t f v 0 0 16 "" _null_ _null_ _null_ _null_ _null_ pgxc_lock_for_backup _null_ _null_ _null_ ));
 DESCR("lock the cluster for taking backup");
+DATA(insert OID = 7024 ( pgxc_gtm_stats	PGNSP PGUID 12 1 100 0 0 f f f f t t v 0 0 2249 "" "{25,25,20,701,20,20,20,20}" "{o,o,o,o,o,o,o,o}" "{kind,name,count,avg_us,p50_us,p99_us,p999_us,max_us}" _null_ _null_ pgxc_gtm_stats _null_ _null_ _null_ ));
+DESCR("statistics: latency of GTM messages, locks and standby sync");
+DATA(insert OID = 7025 ( pgxc_distkey_hash	PGNSP PGUID 12 1 0 2276 0 f f f f f f i 1 0 23 "2276" "{2276}" "{v}" _null_ _null_ _null_ pgxc_distkey_hash _null_ _null_ _null_ ));
+DESCR("distribution key value of a table distributed by several columns");
+DATA(insert OID = 7026 ( pgxc_distkey_node	PGNSP PGUID 12 1 0 0 0 f f f f f f i 4 0 23 "18 2283 2277 1007" _null_ _null_ _null_ _null_ _null_ pgxc_distkey_node _null_ _null_ _null_ ));
+DESCR("rank of the node of a key of a table distributed by range or list");
+DATA(insert OID = 7027 ( pgxc_stat_get_rebalance	PGNSP PGUID 12 1 10 0 0 f f f f t t v 0 0 2249 "" "{23,26,26,23,23,20,20,20,1184}" "{o,o,o,o,o,o,o,o,o}" "{pid,datid,relid,tables_total,tables_done,buckets_total,buckets_moved,rows_moved,start_time}" _null_ _null_ pgxc_stat_get_rebalance _null_ _null_ _null_ ));
+DESCR("statistics: progress of REBALANCE");
 #ifdef XCP
 DATA(insert OID = 7012 ( stormdb_promote_standby	PGNSP PGUID 12 1 0 0 0 f f f f t f v 0 0 2278 "" _null_ _null_ _null_ _null_ _null_ stormdb_promote_standby _null_ _null_ _null_ ));
 DESCR("touch trigger file on a standby machine to end replication");
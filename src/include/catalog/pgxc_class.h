@@ -5,6 +5,7 @@
 #define PGXC_CLASS_H
 
 #include "nodes/parsenodes.h"
+#include "utils/array.h"
 
 #define PgxcClassRelationId  9001
 
@@ -18,11 +19,21 @@ CATALOG(pgxc_class,9001) BKI_WITHOUT_OIDS
 
 	/* VARIABLE LENGTH FIELDS: */
 	oidvector	nodeoids;		/* List of nodes used by table */
+	int2vector	pcattnums;		/* Columns of distribution, in key order */
+#ifdef CATALOG_VARLEN
+	text		pcvalues[1];	/* RANGE or LIST: lower bound or list of
+								 * values of each node of nodeoids */
+	float4		pcnodetuples[1];	/* rows of each node of nodeoids, as of
+									 * the last ANALYZE */
+	text		pchotvalues[1];	/* most common distribution key values */
+	float4		pchotfreqs[1];	/* fraction of all the rows of each */
+	int16		pchotnodes[1];	/* index in nodeoids of the node of each */
+#endif
 } FormData_pgxc_class;
 
 typedef FormData_pgxc_class *Form_pgxc_class;
 
-#define Natts_pgxc_class					6
+#define Natts_pgxc_class					12
 
 #define Anum_pgxc_class_pcrelid				1
 #define Anum_pgxc_class_pclocatortype		2
@@ -30,6 +41,12 @@ typedef FormData_pgxc_class *Form_pgxc_class;
 #define Anum_pgxc_class_pchashalgorithm		4
 #define Anum_pgxc_class_pchashbuckets		5
 #define Anum_pgxc_class_nodes				6
+#define Anum_pgxc_class_pcattnums			7
+#define Anum_pgxc_class_pcvalues			8
+#define Anum_pgxc_class_pcnodetuples		9
+#define Anum_pgxc_class_pchotvalues			10
+#define Anum_pgxc_class_pchotfreqs			11
+#define Anum_pgxc_class_pchotnodes			12
 
 typedef enum PgxcClassAlterType
 {
@@ -44,7 +61,10 @@ extern void PgxcClassCreate(Oid pcrelid,
 							int pchashalgorithm,
 							int pchashbuckets,
 							int numnodes,
-							Oid *nodes);
+							Oid *nodes,
+							int numattnums,
+							int16 *attnums,
+							ArrayType *pcvalues);
 extern void PgxcClassAlter(Oid pcrelid,
 						   char pclocatortype,
 						   int pcattnum,
@@ -52,7 +72,17 @@ extern void PgxcClassAlter(Oid pcrelid,
 						   int pchashbuckets,
 						   int numnodes,
 						   Oid *nodes,
+						   int numattnums,
+						   int16 *attnums,
+						   ArrayType *pcvalues,
 						   PgxcClassAlterType type);
+extern void PgxcClassUpdateStats(Oid pcrelid,
+								 int numnodes,
+								 float4 *nodetuples,
+								 int numhot,
+								 Datum *hotvalues,
+								 float4 *hotfreqs,
+								 int16 *hotnodes);
 extern void RemovePgxcClass(Oid pcrelid);
 
 #endif   /* PGXC_CLASS_H */
@@ -94,6 +94,8 @@ extern const char *seq_identify(uint8 info);
 
 #ifdef XCP
 #define DEFAULT_CACHEVAL	1
+/* Range asked from GTM by COPY, unless sequence_range is set */
+#define MAX_CACHEVAL		1024
 extern int SequenceRangeVal;
 #endif
 #ifdef PGXC
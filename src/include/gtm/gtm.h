@@ -61,7 +61,26 @@ typedef struct GTM_ThreadInfo
 	uint32				thr_client_id;		/* unique client identifier */
 
 	GTM_RWLock			thr_lock;
-	gtm_List				*thr_cached_txninfo;
+
+	/*
+	 * Cells of the list of open transactions released by this thread, reused
+	 * by the next transactions it begins.  Only this thread touches them,
+	 * always with gt_TransArrayLock held.
+	 */
+	gtm_ListCell		*thr_cached_cells;
+	int					thr_cached_cell_count;
+
+	/* Snapshot computed when none of the transactions asked for exists */
+	GTM_SnapshotData	thr_local_snapshot;
+	int					thr_local_xip_size;	/* room in its sn_xip */
+
+	/* Position of the last record this thread passed to the standby */
+	uint64				thr_standby_pos;
+	/*
+	 * Standby connection its oldest record not synced yet was written to,
+	 * 0 if there is none
+	 */
+	uint64				thr_standby_gen;
 } GTM_ThreadInfo;
 
 typedef struct GTM_Threads
@@ -123,11 +142,7 @@ extern GTM_ThreadID						TopMostThreadID;
 #define MyThreadID				(GetMyThreadInfo->thr_id)
 #define IsMainThread()			(GetMyThreadInfo->thr_id == TopMostThreadID)
 
-#define GTM_CachedTransInfo				(GetMyThreadInfo->thr_cached_txninfo)
-#define GTM_HaveFreeCachedTransInfo()	(gtm_list_length(GTM_CachedTransInfo))
-
-#define GTM_MAX_CACHED_TRANSINFO		0
-#define GTM_HaveEnoughCachedTransInfo()	(gtm_list_length(GTM_CachedTransInfo) >= GTM_MAX_CACHED_TRANSINFO)
+#define GTM_MAX_CACHED_CELLS			1024
 
 #define START_CRIT_SECTION()  (CritSectionCount++)
 
@@ -22,6 +22,11 @@ extern GTM_RWLock	gtm_bkup_lock;
 
 #define RestoreDuration	2000
 
+extern void GTM_InitWal(void);
+extern void GTM_OpenWal(void);
+extern bool GTM_WalAppend(const char *record);
+extern void GTM_ReplayWal(void);
+extern void GTM_WriteCheckpoint(bool isBackup);
 extern void GTM_WriteRestorePoint(void);
 extern void GTM_MakeBackup(char *path);
 extern void GTM_SetNeedBackup(void);
@@ -21,6 +21,7 @@
 
 #include "gtm/gtm_c.h"
 #include "gtm/gtm_seq.h"
+#include "gtm/gtm_stat.h"
 #include "gtm/gtm_txn.h"
 #include "gtm/gtm_msg.h"
 #include "gtm/register.h"
@@ -72,17 +73,30 @@ typedef union GTM_ResultData
 		GTM_SeqInfo			   *seq;
 	} grd_seq_list;								/* SEQUENCE_GET_LIST */
 
+	struct
+	{
+		int						seq_count;		/* SEQUENCE_GET_NEXT_MULTI */
+		int						status[GTM_MAX_SEQ_MULTI];
+		GTM_Sequence			seqval[GTM_MAX_SEQ_MULTI];
+		GTM_Sequence			rangemax[GTM_MAX_SEQ_MULTI];
+		GTM_Sequence			increment[GTM_MAX_SEQ_MULTI];
+	} grd_seq_multi;
+
+	/*
+	 * The arrays of the results of grouped messages point into gr_multi_data
+	 * of the result, and hold txn_count entries
+	 */
 	struct
 	{
 		int				txn_count; 				/* TXN_BEGIN_GETGXID_MULTI */
-		GlobalTransactionId		txn_gxid[GTM_MAX_GLOBAL_TRANSACTIONS];
+		GlobalTransactionId		*txn_gxid;
 		GTM_Timestamp			timestamp;
 	} grd_txn_get_multi;
 
 	struct
 	{
 		int				txn_count;				/* TXN_COMMIT_MULTI */
-		int				status[GTM_MAX_GLOBAL_TRANSACTIONS];
+		int				*status;
 	} grd_txn_rc_multi;
 
 	struct
@@ -90,7 +104,7 @@ typedef union GTM_ResultData
 		GTM_TransactionHandle	txnhandle;		/* SNAPSHOT_GXID_GET */
 		GlobalTransactionId		gxid;			/* SNAPSHOT_GET */
 		int						txn_count;		/* SNAPSHOT_GET_MULTI */
-		int						status[GTM_MAX_GLOBAL_TRANSACTIONS];
+		int						*status;
 	} grd_txn_snap_multi;
 
 	struct
@@ -128,6 +142,12 @@ typedef union GTM_ResultData
 		int						errcode;
 	} grd_report_xmin;						/* REPORT_XMIN */
 
+	struct
+	{
+		int						count;
+		GTM_StatEntry		   *entries;
+	} grd_stats;							/* GET_STATS */
+
 	/*
 	 * TODO
 	 * 	TXN_GET_STATUS
@@ -165,6 +185,13 @@ typedef struct GTM_Result
 	 */
 	char		*gr_proxy_data;
 	int			gr_proxy_datalen;
+
+	/*
+	 * And the buffer for the arrays of the results of grouped messages, sized
+	 * after the largest group received so far
+	 */
+	char		*gr_multi_data;
+	size_t		gr_multi_datalen;
 } GTM_Result;
 
 /*
@@ -245,6 +272,20 @@ abort_transaction_multi(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid
 int
 bkup_abort_transaction_multi(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid);
 int
+prepare_transaction_multi(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid,
+						  int *txn_count_out, int *status_out);
+int
+bkup_prepare_transaction_multi(GTM_Conn *conn, int txn_count,
+		GlobalTransactionId *gxid);
+int
+commit_prepared_transaction_multi(GTM_Conn *conn, int txn_count,
+								  GlobalTransactionId *gxid,
+								  GlobalTransactionId *prepared_gxid,
+								  int *txn_count_out, int *status_out);
+int
+bkup_commit_prepared_transaction_multi(GTM_Conn *conn, int txn_count,
+		GlobalTransactionId *gxid, GlobalTransactionId *prepared_gxid);
+int
 snapshot_get_multi(GTM_Conn *conn, int txn_count, GlobalTransactionId *gxid,
 		   int *txn_count_out, int *status_out,
 		   GlobalTransactionId *xmin_out, GlobalTransactionId *xmax_out,
@@ -278,6 +319,8 @@ int backend_disconnect(GTM_Conn *conn, bool is_postmaster, GTM_PGXCNodeType type
 char *node_get_local_addr(GTM_Conn *conn, char *buf, size_t buflen, int *rc);
 int register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
 				 int coord_backendid);
+int bkup_register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
+				 int coord_backendid);
 int report_global_xmin(GTM_Conn *conn, const char *node_name,
 		GTM_PGXCNodeType type, GlobalTransactionId gxid,
 		GlobalTransactionId *global_xmin,
@@ -329,6 +372,13 @@ int bkup_report_barrier(GTM_Conn *conn, char *barrier_id);
  */
 int set_begin_end_backup(GTM_Conn *conn, bool begin);
 int gtm_sync_standby(GTM_Conn *conn);
+int send_sync_standby(GTM_Conn *conn);
+int receive_sync_standby(GTM_Conn *conn);
+
+/*
+ * Statistics
+ */
+int get_gtm_stats(GTM_Conn *conn, GTM_StatEntry **entries);
 
 
 #endif
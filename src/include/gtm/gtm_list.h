@@ -169,6 +169,7 @@ extern int	gtm_list_length(gtm_List *l);
 		 (cell1) = gtm_lnext(cell1), (cell2) = gtm_lnext(cell2))
 
 extern gtm_List *gtm_lappend(gtm_List *list, void *datum);
+extern gtm_List *gtm_lappend_given_cell(gtm_List *list, gtm_ListCell *cell, void *datum);
 extern gtm_List *gtm_lappend_int(gtm_List *list, int datum);
 
 extern gtm_ListCell *gtm_lappend_cell(gtm_List *list, gtm_ListCell *prev, void *datum);
@@ -192,6 +193,7 @@ extern gtm_List *gtm_list_delete_ptr(gtm_List *list, void *datum);
 extern gtm_List *gtm_list_delete_int(gtm_List *list, int datum);
 extern gtm_List *gtm_list_delete_first(gtm_List *list);
 extern gtm_List *gtm_list_delete_cell(gtm_List *list, gtm_ListCell *cell, gtm_ListCell *prev);
+extern gtm_List *gtm_list_unlink_cell(gtm_List *list, gtm_ListCell *cell, gtm_ListCell *prev);
 
 extern gtm_List *gtm_list_union(gtm_List *list1, gtm_List *list2);
 extern gtm_List *gtm_list_union_ptr(gtm_List *list1, gtm_List *list2);
@@ -16,9 +16,13 @@
 #define GTM_LOCK_H
 
 #include <pthread.h>
+
+struct GTM_StatHist;
+
 typedef struct GTM_RWLock
 {
 	pthread_rwlock_t lk_lock;
+	struct GTM_StatHist *lk_wait_stat;	/* counts the waits, if set */
 #ifdef GTM_LOCK_DEBUG
 #define GTM_LOCK_DEBUG_MAX_READ_TRACKERS	1024
 	pthread_mutex_t	lk_debug_mutex;
@@ -33,6 +33,7 @@ typedef enum GTM_MessageType
 	MSG_NODE_UNREGISTER,		/* Unregister a PGXC Node with GTM */
 	MSG_BKUP_NODE_UNREGISTER,	/* Backup of MSG_NODE_UNREGISTER */
 	MSG_REGISTER_SESSION,		/* Register distributed session with GTM */
+	MSG_BKUP_REGISTER_SESSION,	/* Backup of MSG_REGISTER_SESSION */
 	MSG_REPORT_XMIN,			/* Report RecentGlobalXmin to GTM */
 	MSG_BKUP_REPORT_XMIN,
 	MSG_NODE_LIST,				/* Get node list */
@@ -54,8 +55,12 @@ typedef enum GTM_MessageType
 	MSG_BKUP_TXN_COMMIT_MULTI,	/* Bacukp of MSG_TXN_COMMIT_MULTI */
 	MSG_TXN_COMMIT_PREPARED,		/* Commit a prepared transaction */
 	MSG_BKUP_TXN_COMMIT_PREPARED,	/* Backup of MSG_TXN_COMMIT_PREPARED */
+	MSG_TXN_COMMIT_PREPARED_MULTI,		/* Commit multiple prepared transactions */
+	MSG_BKUP_TXN_COMMIT_PREPARED_MULTI,	/* Backup of MSG_TXN_COMMIT_PREPARED_MULTI */
 	MSG_TXN_PREPARE,		/* Finish preparing a transaction */
 	MSG_BKUP_TXN_PREPARE,	/* Backup of MSG_TXN_PREPARE */
+	MSG_TXN_PREPARE_MULTI,		/* Finish preparing multiple transactions */
+	MSG_BKUP_TXN_PREPARE_MULTI,	/* Backup of MSG_TXN_PREPARE_MULTI */
 	MSG_TXN_ROLLBACK,		/* Rollback a transaction */
 	MSG_BKUP_TXN_ROLLBACK,	/* Backup of MSG_TXN_ROLLBACK */
 	MSG_TXN_ROLLBACK_MULTI,			/* Rollback multiple transactions */
@@ -73,6 +78,7 @@ typedef enum GTM_MessageType
 	MSG_SEQUENCE_GET_CURRENT,/* Get the current value of sequence */
 	MSG_SEQUENCE_GET_NEXT,		/* Get the next sequence value of sequence */
 	MSG_BKUP_SEQUENCE_GET_NEXT,	/* Backup of MSG_SEQUENCE_GET_NEXT */
+	MSG_SEQUENCE_GET_NEXT_MULTI,	/* Get the next values of several sequences */
 	MSG_SEQUENCE_GET_LAST,	/* Get the last sequence value of sequence */
 	MSG_SEQUENCE_SET_VAL,		/* Set values for sequence */
 	MSG_BKUP_SEQUENCE_SET_VAL,	/* Backup of MSG_SEQUENCE_SET_VAL */
@@ -94,6 +100,8 @@ typedef enum GTM_MessageType
 	MSG_BACKEND_DISCONNECT,			/* tell GTM that the backend diconnected from the proxy */
 	MSG_BARRIER,				/* Tell the barrier was issued */
 	MSG_BKUP_BARRIER,			/* Backup barrier to standby */
+	MSG_SHM_ATTACH,				/* Switch a proxy connection to shared memory */
+	MSG_GET_STATS,				/* Get latency statistics */
 
 	/*
 	 * Must be at the end
@@ -121,8 +129,10 @@ typedef enum GTM_ResultType
 	TXN_BEGIN_GETGXID_RESULT,
 	TXN_BEGIN_GETGXID_MULTI_RESULT,
 	TXN_PREPARE_RESULT,
+	TXN_PREPARE_MULTI_RESULT,
 	TXN_START_PREPARED_RESULT,
 	TXN_COMMIT_PREPARED_RESULT,
+	TXN_COMMIT_PREPARED_MULTI_RESULT,
 	TXN_COMMIT_RESULT,
 	TXN_COMMIT_MULTI_RESULT,
 	TXN_ROLLBACK_RESULT,
@@ -137,6 +147,7 @@ typedef enum GTM_ResultType
 	SEQUENCE_INIT_RESULT,
 	SEQUENCE_GET_CURRENT_RESULT,
 	SEQUENCE_GET_NEXT_RESULT,
+	SEQUENCE_GET_NEXT_MULTI_RESULT,
 	SEQUENCE_GET_LAST_RESULT,
 	SEQUENCE_SET_VAL_RESULT,
 	SEQUENCE_RESET_RESULT,
@@ -148,6 +159,8 @@ typedef enum GTM_ResultType
 	TXN_GET_ALL_PREPARED_RESULT,
 	TXN_BEGIN_GETGXID_AUTOVACUUM_RESULT,
 	BARRIER_RESULT,
+	SHM_ATTACH_RESULT,
+	GET_STATS_RESULT,
 	RESULT_TYPE_COUNT
 } GTM_ResultType;
 
@@ -330,6 +330,7 @@ const char *const config_type_names[] =\
 
 #define GTM_OPTNAME_ACTIVE_HOST			"active_host"
 #define GTM_OPTNAME_ACTIVE_PORT 		"active_port"
+#define GTM_OPTNAME_CACHE_SEQUENCES		"cache_sequences"
 #define GTM_OPTNAME_CONFIG_FILE			"config_file"
 #define GTM_OPTNAME_DATA_DIR			"data_dir"
 #define GTM_OPTNAME_ERROR_REPORTER		"error_reporter"
@@ -344,6 +345,8 @@ const char *const config_type_names[] =\
 #define GTM_OPTNAME_LOG_MIN_MESSAGES	"log_min_messages"
 #define GTM_OPTNAME_NODENAME			"nodename"
 #define GTM_OPTNAME_PORT				"port"
+#define GTM_OPTNAME_SHARE_SNAPSHOTS		"share_snapshots"
+#define GTM_OPTNAME_SHARED_MEMORY_SLOTS	"shared_memory_slots"
 #define GTM_OPTNAME_STARTUP				"startup"
 #define GTM_OPTNAME_STATUS_READER		"status_reader"
 #define GTM_OPTNAME_SYNCHRONOUS_BACKUP	"synchronous_backup"
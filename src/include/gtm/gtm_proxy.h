@@ -48,8 +48,20 @@ typedef struct GTMProxy_ConnectionInfo
 	GTMProxy_ConnID			con_id;
 
 	GTM_MessageType			con_pending_msg;
+	uint32					con_inflight;	/* commands sent to GTM and not answered */
 	GlobalTransactionId 		con_txid;
 	GTM_TransactionHandle		con_handle;
+	gtm_List				*con_seq_lastvals;	/* GTMProxy_SeqLastVal, of the
+												 * values served by the proxy */
+
+	/* Command backup, resent after a GTM reconnect */
+	bool					con_any_backup;
+	int						con_qtype;
+	StringInfoData			con_inBufData;
+
+	int						con_wait_pos;	/* slot in the poll() wait set */
+	struct GTMProxy_ConnectionInfo *con_next;	/* in thr_new_conns, then
+												 * in thr_closed_conns */
 } GTMProxy_ConnectionInfo;
 
 typedef struct GTMProxy_Connections
@@ -61,7 +73,50 @@ typedef struct GTMProxy_Connections
 } GTMProxy_Connections;
 
 #define ERRORDATA_STACK_SIZE  20
-#define GTM_PROXY_MAX_CONNECTIONS	1024
+
+/*
+ * Connection slots a worker thread starts with, the arrays double as more
+ * connections come in.  The slot travels to the GTM as a GTMProxy_ConnID,
+ * which bounds the slots of a thread.
+ */
+#define GTM_PROXY_INIT_CONNECTIONS	64
+#define GTM_PROXY_MAX_CONNECTIONS	0x7FFF
+
+/* Readiness events a worker thread reads at once */
+#define GTM_PROXY_MAX_EVENTS		256
+
+#define GTM_PROXY_EV_READ			0x01
+#define GTM_PROXY_EV_WRITE			0x02
+#define GTM_PROXY_EV_HUP			0x04
+
+/*
+ * Readiness of a client connection, or of the GTM connection when
+ * ev_conn is NULL.
+ */
+typedef struct GTMProxy_Event
+{
+	struct GTMProxy_ConnectionInfo *ev_conn;
+	uint32					ev_events;		/* GTM_PROXY_EV_* */
+} GTMProxy_Event;
+
+/*
+ * Number of batches of commands a worker thread may have sent to the GTM
+ * server and still wait the responses for.
+ */
+#define GTM_PROXY_MAX_BATCHES		4
+
+/*
+ * Commands sent to the GTM server in one round, followed by a flush marker.
+ * The server answers the commands of a connection in order, so the responses
+ * read from it always belong to the oldest batch in flight.
+ */
+typedef struct GTMProxy_Batch
+{
+	uint32					pb_id;
+	gtm_List				*pb_commands;	/* GTMProxy_CommandInfo, in sending order */
+	uint64					pb_snapshot_version;	/* commits acknowledged
+														 * before sending */
+} GTMProxy_Batch;
 
 typedef struct GTMProxy_ThreadInfo
 {
@@ -78,30 +133,66 @@ typedef struct GTMProxy_ThreadInfo
 	GTMProxy_ConnectionInfo	*thr_conn;		/* Current set of connections from clients */
 	uint32					thr_conn_count;	/* number of connections served by this thread */
 
+	/*
+	 * Connections handed over by the main thread and not yet taken by the
+	 * worker, linked through con_next.  Protected by thr_lock, as are
+	 * thr_conn_count and thr_new_count, which the main thread reads to
+	 * balance the load.
+	 */
 	GTM_MutexLock			thr_lock;
 	GTM_CV					thr_cv;
+	GTMProxy_ConnectionInfo	*thr_new_conns;
+	uint32					thr_new_count;
 
 	/*
-	 * We use a sequence number to track the state of connection/fd array.
-	 * Whenever a new connection is added or an existing connection is deleted
-	 * from the connection array, the sequence number is incremented. The
-	 * thread main routine can then reconstruct the fd array again.
+	 * Connection array, indexed by con_id, and the map of the slots in use.
+	 * Only the worker thread uses them.
 	 */
-	int32					thr_seqno;
+	GTMProxy_ConnectionInfo	**thr_all_conns;
+	int						*thr_conn_map;
+	uint32					thr_conn_slots;
 
-	/* connection array */
-	GTMProxy_ConnectionInfo	*thr_all_conns[GTM_PROXY_MAX_CONNECTIONS];
-	int						thr_conn_map[GTM_PROXY_MAX_CONNECTIONS];
-	struct pollfd			thr_poll_fds[GTM_PROXY_MAX_CONNECTIONS];
+	/*
+	 * Disconnected connections, linked through con_next, removed once no
+	 * command of theirs is in flight
+	 */
+	GTMProxy_ConnectionInfo	*thr_closed_conns;
 
-	/* Command backup */
-	short					thr_any_backup[GTM_PROXY_MAX_CONNECTIONS];
-	int						thr_qtype[GTM_PROXY_MAX_CONNECTIONS];
-	StringInfoData			thr_inBufData[GTM_PROXY_MAX_CONNECTIONS];
+	/* Some connection has a command backup to resend */
+	bool					thr_resend_backups;
+
+	/*
+	 * Wait set of the client connections and of the GTM connection.  It is
+	 * an epoll instance when available, a poll() array otherwise.
+	 */
+	int						thr_epoll_fd;
+	int						thr_gtm_sock;		/* GTM socket in the wait set */
+	uint32					thr_gtm_events;		/* and its events */
+	struct pollfd			*thr_poll_fds;		/* one more for the GTM connection */
+	GTMProxy_ConnectionInfo	**thr_poll_conns;
+	int						thr_poll_count;
+	int						thr_poll_size;
+	GTMProxy_Event			thr_events[GTM_PROXY_MAX_EVENTS];
+	int						thr_nevents;
+
+	/*
+	 * Connections switched to a shared memory slot.  Their rings are checked
+	 * at every round, the socket only wakes up the thread.
+	 */
+	gtm_List				*thr_shm_conns;
 
 	gtm_List 					*thr_processed_commands;
 	gtm_List 					*thr_pending_commands[MSG_TYPE_COUNT];
 
+	/* Batches waiting for responses from GTM, oldest first */
+	gtm_List				*thr_batches;
+	uint32					thr_next_batch_id;
+	struct GTM_Result		*thr_batch_res;		/* response being split between grouped commands */
+
+	/* Sequence values reserved from GTM, GTMProxy_SeqCache */
+	gtm_List				*thr_seq_cache;
+	uint64					thr_seq_generation;	/* sequence changes seen */
+
 	GTM_Conn				*thr_gtm_conn;		/* Connection to GTM */
 
 	/* Reconnect Info */
@@ -116,7 +207,6 @@ typedef struct GTMProxy_Threads
 {
 	uint32					gt_thread_count;
 	uint32					gt_array_size;
-	uint32					gt_next_worker;
 	GTMProxy_ThreadInfo		**gt_threads;
 	GTM_RWLock				gt_lock;
 } GTMProxy_Threads;
@@ -131,9 +221,20 @@ void GTMProxy_ThreadExit(void);
 extern GTMProxy_ThreadInfo *GTMProxy_ThreadCreate(void *(* startroutine)(void *), int idx);
 extern GTMProxy_ThreadInfo * GTMProxy_GetThreadInfo(GTM_ThreadID thrid);
 extern GTMProxy_ThreadInfo *GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo);
+extern bool GTMProxy_ThreadTakeConnection(GTMProxy_ThreadInfo *thrinfo,
+		GTMProxy_ConnectionInfo *conninfo);
 extern int GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo,
 		GTMProxy_ConnectionInfo *conninfo);
 
+extern void GTMProxy_WaitSetInit(GTMProxy_ThreadInfo *thrinfo);
+extern bool GTMProxy_WaitSetAdd(GTMProxy_ThreadInfo *thrinfo,
+		GTMProxy_ConnectionInfo *conninfo);
+extern void GTMProxy_WaitSetRemove(GTMProxy_ThreadInfo *thrinfo,
+		GTMProxy_ConnectionInfo *conninfo);
+extern void GTMProxy_WaitSetWatchGTM(GTMProxy_ThreadInfo *thrinfo,
+		int sock, uint32 events);
+extern int GTMProxy_WaitSetWait(GTMProxy_ThreadInfo *thrinfo, int timeout_ms);
+
 /*
  * Command data - the only relevant information right now is the XID
  * and data necessary for registering (modification of Proxy number registered)
@@ -150,6 +251,7 @@ typedef union GTMProxy_CommandData
 	struct
 	{
 		GlobalTransactionId	gxid;
+		GlobalTransactionId	prepared_gxid;	/* COMMIT PREPARED only */
 	} cd_rc;
 
 	struct
@@ -157,6 +259,17 @@ typedef union GTMProxy_CommandData
 		GlobalTransactionId	gxid;
 	} cd_snap;
 
+	struct
+	{
+		char			*key;
+		uint32			keylen;
+		char			coord_name[SP_NODE_NAME];
+		uint32			coord_procid;
+		GTM_Sequence	range;			/* values the backend asked for */
+		GTM_Sequence	refill;			/* more values asked for the cache */
+		uint64			generation;		/* sequence changes seen when sent */
+	} cd_seq;
+
 	struct
 	{
 		GTM_PGXCNodeType	type;
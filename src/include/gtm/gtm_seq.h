@@ -67,6 +67,9 @@ typedef struct GTM_SeqInfo
 
 #define SEQ_MAX_REFCOUNT		1024
 
+/* Most nextval requests a MSG_SEQUENCE_GET_NEXT_MULTI message can carry */
+#define GTM_MAX_SEQ_MULTI		1024
+
 /* SEQUENCE Management */
 void GTM_InitSeqManager(void);
 int GTM_SeqOpen(GTM_SequenceKey seqkey,
@@ -97,6 +100,7 @@ int GTM_SeqReset(GTM_SequenceKey seqkey);
 void ProcessSequenceInitCommand(Port *myport, StringInfo message, bool is_backup);
 void ProcessSequenceGetCurrentCommand(Port *myport, StringInfo message);
 void ProcessSequenceGetNextCommand(Port *myport, StringInfo message, bool is_backup);
+void ProcessSequenceGetNextCommandMulti(Port *myport, StringInfo message);
 void ProcessSequenceSetValCommand(Port *myport, StringInfo message, bool is_backup);
 void ProcessSequenceResetCommand(Port *myport, StringInfo message, bool is_backup);
 void ProcessSequenceCloseCommand(Port *myport, StringInfo message, bool is_backup);
@@ -107,6 +111,7 @@ void ProcessSequenceListCommand(Port *myport, StringInfo message);
 
 void GTM_SaveSeqInfo(FILE *ctlf);
 void GTM_RestoreSeqInfo(FILE *ctlf);
+bool GTM_ReplaySeqInfo(char *record);
 int GTM_SeqRestore(GTM_SequenceKey seqkey,
 			   GTM_Sequence increment_by,
 			   GTM_Sequence minval,
@@ -0,0 +1,128 @@
+/*-------------------------------------------------------------------------
+ *
+ * gtm_shmq.h
+ *	  Shared memory transport between a GTM proxy and its local clients
+ *
+ * A GTM proxy started with shared_memory_slots > 0 creates a POSIX shared
+ * memory segment named after its port.  A client on the same host connects
+ * over TCP as usual, claims a slot of the segment and asks the proxy to
+ * attach it with MSG_SHM_ATTACH.  From then on the messages of the
+ * connection go through the two rings of the slot, and the socket is only
+ * used to wake up the proxy worker thread when it sleeps, and to tell either
+ * side that the other one went away.
+ *
+ * Each ring has a single producer and a single consumer.  rg_head and
+ * rg_tail count the bytes written and read so far, the producer only moves
+ * rg_head and the consumer only moves rg_tail.  A consumer about to sleep
+ * sets rg_waiting, and the producer wakes it up after moving rg_head.
+ *
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef GTM_SHMQ_H
+#define GTM_SHMQ_H
+
+#include "gtm/gtm_c.h"
+
+#define GTM_SHMQ_MAGIC			0x47534D51		/* "GSMQ" */
+#define GTM_SHMQ_RING_SIZE		(16 * 1024)		/* must be a power of 2 */
+#define GTM_SHMQ_NAME_LEN		64
+
+/* How long waits last before the caller checks the peer is still there */
+#define GTM_SHMQ_CHECK_MS		100
+
+/*
+ * The transport needs compare-and-swap and memory barriers from the
+ * compiler.  Without them no segment is created nor opened, and clients
+ * keep using TCP.
+ */
+#ifdef HAVE_GCC__SYNC_INT32_CAS
+#define GTM_SHMQ_SUPPORTED
+#define GTM_ShmqBarrier()		__sync_synchronize()
+#define GTM_ShmqCompareAndSwap(ptr, oldval, newval) \
+	__sync_bool_compare_and_swap((ptr), (oldval), (newval))
+#else
+/* Never reached, there is no segment to use them on */
+#define GTM_ShmqBarrier()		((void) 0)
+#define GTM_ShmqCompareAndSwap(ptr, oldval, newval)	false
+#endif
+
+/* Slot states */
+#define GTM_SHMQ_SLOT_FREE		0
+#define GTM_SHMQ_SLOT_CLAIMED	1		/* by a client, not attached yet */
+#define GTM_SHMQ_SLOT_ATTACHED	2		/* to a proxy connection */
+
+typedef struct GTM_ShmqRing
+{
+	volatile uint32	rg_head;		/* moved by the producer */
+	volatile uint32	rg_waiting;		/* consumer sleeps until rg_head moves */
+	char			rg_pad1[56];
+	volatile uint32	rg_tail;		/* moved by the consumer */
+	char			rg_pad2[60];
+	char			rg_data[GTM_SHMQ_RING_SIZE];
+} GTM_ShmqRing;
+
+typedef struct GTM_ShmqSlot
+{
+	volatile uint32	sl_state;		/* GTM_SHMQ_SLOT_* */
+	volatile int32	sl_pid;			/* client process */
+	volatile uint32	sl_worker;		/* proxy worker thread serving the slot */
+	char			sl_pad[52];
+	GTM_ShmqRing	sl_request;		/* client to proxy */
+	GTM_ShmqRing	sl_response;	/* proxy to client */
+} GTM_ShmqSlot;
+
+/*
+ * A proxy worker thread sets sw_sleeping before it waits on its sockets, so
+ * that clients know they must write to the socket to wake it up.
+ */
+typedef struct GTM_ShmqWorker
+{
+	volatile uint32	sw_sleeping;
+	char			sw_pad[60];
+} GTM_ShmqWorker;
+
+typedef struct GTM_ShmqHeader
+{
+	uint32			sh_magic;
+	uint32			sh_nslots;
+	uint32			sh_nworkers;
+	uint32			sh_ring_size;
+	uint64			sh_cookie;		/* identifies the proxy instance */
+	int32			sh_pid;			/* proxy process */
+	char			sh_pad[36];
+} GTM_ShmqHeader;
+
+/*
+ * A mapping of the segment, the header is followed by sh_nworkers workers
+ * and sh_nslots slots.
+ */
+typedef struct GTM_Shmq
+{
+	GTM_ShmqHeader	*sq_header;
+	GTM_ShmqWorker	*sq_workers;
+	GTM_ShmqSlot	*sq_slots;
+	size_t			sq_size;
+	char			sq_name[GTM_SHMQ_NAME_LEN];
+} GTM_Shmq;
+
+#define GTM_ShmqEmpty(ring)		((ring)->rg_head == (ring)->rg_tail)
+#define GTM_ShmqFull(ring)		((ring)->rg_head - (ring)->rg_tail == GTM_SHMQ_RING_SIZE)
+
+extern GTM_Shmq *GTM_ShmqCreate(int port, int nslots, int nworkers);
+extern GTM_Shmq *GTM_ShmqOpen(int port);
+extern void GTM_ShmqClose(GTM_Shmq *shmq);
+extern void GTM_ShmqRemove(GTM_Shmq *shmq);
+extern int GTM_ShmqClaimSlot(GTM_Shmq *shmq);
+extern void GTM_ShmqReleaseSlot(GTM_Shmq *shmq, int slotno);
+
+extern int GTM_ShmqWrite(GTM_ShmqRing *ring, const char *buf, int len);
+extern int GTM_ShmqRead(GTM_ShmqRing *ring, char *buf, int len);
+extern bool GTM_ShmqWait(GTM_ShmqRing *ring, int timeout_ms);
+extern bool GTM_ShmqWaitSpace(GTM_ShmqRing *ring, int timeout_ms);
+extern void GTM_ShmqWakeup(GTM_ShmqRing *ring);
+
+#endif   /* GTM_SHMQ_H */
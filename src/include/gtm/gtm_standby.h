@@ -45,6 +45,11 @@ bool gtm_standby_check_communication_error(int *retry_count, GTM_Conn *oldconn);
 
 GTM_PGXCNodeInfo *find_standby_node_info(void);
 
+void gtm_standby_stream_init(void);
+int gtm_standby_sync(void);
+bool gtm_standby_sync_or_resend(int *retry_count);
+void gtm_standby_detach(void);
+
 int gtm_standby_begin_backup(void);
 int gtm_standby_end_backup(void);
 void gtm_standby_closeActiveConn(void);
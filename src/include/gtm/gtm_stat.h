@@ -0,0 +1,74 @@
+/*-------------------------------------------------------------------------
+ *
+ * gtm_stat.h
+ *	  Latency statistics of GTM
+ *
+ * GTM keeps a histogram of the time spent processing each type of message,
+ * of the time spent waiting for its most contended locks and of the time
+ * spent waiting for the standby to acknowledge what was sent to it.  They
+ * are returned to clients by MSG_GET_STATS.
+ *
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef GTM_STAT_H
+#define GTM_STAT_H
+
+#include "gtm/gtm_c.h"
+#include "gtm/gtm_msg.h"
+
+/*
+ * Bucket 0 counts samples under a microsecond, bucket i samples from 2^(i-1)
+ * up to 2^i microseconds, and the last bucket everything longer.
+ */
+#define GTM_STAT_BUCKETS		24
+#define GTM_STAT_NAME_LEN		64
+
+typedef enum GTM_StatKind
+{
+	GTM_STAT_MESSAGE,			/* processing of a message type */
+	GTM_STAT_LOCK,				/* waits for a lock */
+	GTM_STAT_STANDBY			/* waits for the standby */
+} GTM_StatKind;
+
+/* Locks whose waits are counted */
+typedef enum GTM_StatLock
+{
+	GTM_STAT_LOCK_XIDGEN,		/* gt_XidGenLock */
+	GTM_STAT_LOCK_TRANSARRAY,	/* gt_TransArrayLock */
+	GTM_STAT_LOCK_SEQUENCE,		/* gs_lock of all the sequences */
+	GTM_STAT_LOCK_COUNT
+} GTM_StatLock;
+
+typedef struct GTM_StatHist
+{
+	uint64		sh_count;
+	uint64		sh_total_us;
+	uint64		sh_max_us;
+	uint64		sh_buckets[GTM_STAT_BUCKETS];
+} GTM_StatHist;
+
+/* A histogram as returned to clients */
+typedef struct GTM_StatEntry
+{
+	GTM_StatKind	se_kind;
+	char			se_name[GTM_STAT_NAME_LEN];
+	GTM_StatHist	se_hist;
+} GTM_StatEntry;
+
+#define GTM_STAT_MAX_ENTRIES	(MSG_TYPE_COUNT + GTM_STAT_LOCK_COUNT + 1)
+
+extern GTM_StatHist GTMStatMessages[MSG_TYPE_COUNT];
+extern GTM_StatHist GTMStatLocks[GTM_STAT_LOCK_COUNT];
+extern GTM_StatHist GTMStatStandby;
+
+extern uint64 GTM_StatNow(void);
+extern void GTM_StatHistAdd(GTM_StatHist *hist, uint64 elapsed_us);
+extern uint64 GTM_StatHistPercentile(GTM_StatHist *hist, double fraction);
+extern const char *GTM_StatKindName(GTM_StatKind kind);
+extern int GTM_StatCollect(GTM_StatEntry *entries);
+
+#endif   /* GTM_STAT_H */
@@ -51,7 +51,9 @@ extern void GTM_SetShuttingDown(void);
 
 /* For restoration point backup */
 extern bool GTM_NeedXidRestoreUpdate(void);
+extern bool GTM_UpdateRestorePointXid(void);
 extern void GTM_WriteRestorePointXid(FILE *f);
+extern void GTM_ReplayRestorePointXid(GlobalTransactionId gxid);
 
 typedef enum GTM_States
 {
@@ -91,6 +93,7 @@ typedef struct GTM_TransactionInfo
 	char					*gti_gid;
 
 	GTM_SnapshotData		gti_current_snapshot;
+	int						gti_xip_size;	/* room in its sn_xip */
 	bool					gti_snapshot_set;
 
 	GTM_RWLock				gti_lock;
@@ -174,6 +177,8 @@ int GTM_CommitTransactionMulti(GTM_TransactionHandle txn[], int txn_count,
 		int status[]);
 int GTM_CommitTransactionGXID(GlobalTransactionId gxid);
 int GTM_PrepareTransaction(GTM_TransactionHandle txn);
+int GTM_PrepareTransactionMulti(GTM_TransactionHandle txn[], int txn_count,
+		int status[]);
 int GTM_StartPreparedTransaction(GTM_TransactionHandle txn,
 								 char *gid,
 								 char *nodestring);
@@ -188,6 +193,7 @@ GTM_TransactionStates GTM_GetStatus(GTM_TransactionHandle txn);
 GTM_TransactionStates GTM_GetStatusGXID(GlobalTransactionId gxid);
 int GTM_GetAllTransactions(GTM_TransactionInfo txninfo[], uint32 txncnt);
 void GTM_RemoveAllTransInfos(uint32 client_id, int backend_id);
+void GTM_FreeCachedOpenTransactionCells(void);
 uint32 GTMGetLastClientIdentifier(void);
 
 GTM_Snapshot GTM_GetSnapshotData(GTM_TransactionInfo *my_txninfo,
@@ -224,6 +230,8 @@ void ProcessBkupBeginTransactionGetGXIDAutovacuumCommand(Port *myport, StringInf
 void ProcessBeginTransactionGetGXIDCommandMulti(Port *myport, StringInfo message);
 void ProcessCommitTransactionCommandMulti(Port *myport, StringInfo message, bool is_backup);
 void ProcessRollbackTransactionCommandMulti(Port *myport, StringInfo message, bool is_backup) ;
+void ProcessPrepareTransactionCommandMulti(Port *myport, StringInfo message, bool is_backup);
+void ProcessCommitPreparedTransactionCommandMulti(Port *myport, StringInfo message, bool is_backup);
 
 void GTM_SaveTxnInfo(FILE *ctlf);
 void GTM_RestoreTxnInfo(FILE *ctlf, GlobalTransactionId next_gxid);
@@ -62,6 +62,13 @@ typedef struct Port
 	int			PqRecvPointer;		/* Next index to read a byte from PqRecvBuffer */
 	int			PqRecvLength;		/* End of data available in PqRecvBuffer */
 
+	/*
+	 * Shared memory slot the connection was switched to, see gtm_shmq.h.
+	 * The buffers are then filled from and flushed to its rings instead of
+	 * the socket.
+	 */
+	struct GTM_ShmqSlot	*shm_slot;
+
 	/*
 	 * TCP keepalive settings.
 	 *
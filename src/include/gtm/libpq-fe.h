@@ -92,6 +92,9 @@ typedef struct _GTMPQconninfoOption
 
 typedef struct gtm_conn GTM_Conn;
 
+/* Routine consuming the output of a buffered connection */
+typedef int (*GTMPQsendHook) (GTM_Conn *conn, const char *buf, int len);
+
 /* ----------------
  * Exported functions of libpq
  * ----------------
@@ -107,6 +110,12 @@ extern GTMClientPollingStatusType GTMPQconnectPoll(GTM_Conn *conn);
 /* Synchronous (blocking) */
 extern GTM_Conn *PQconnectGTM(const char *conninfo);
 
+/* make a connection object which passes its output to a hook */
+extern GTM_Conn *GTMPQcreateBufferedConn(GTMPQsendHook hook);
+
+/* make a connection object reading the replies sent to another one */
+extern GTM_Conn *GTMPQcreateReaderConn(GTM_Conn *conn);
+
 /* close the current connection and free the GTM_Conn data structure */
 extern void GTMPQfinish(GTM_Conn *conn);
 
@@ -28,6 +28,7 @@
 #include "gtm/pqexpbuffer.h"
 #include "gtm/gtm_client.h"
 #include "gtm/gtm_c.h"
+#include "gtm/gtm_shmq.h"
 
 /*
  * GTM_Conn stores all the state data associated with a single connection
@@ -47,6 +48,8 @@ struct gtm_conn
 	int			remote_type;		/* is this a connection to/from a proxy ? */
 	int			is_postmaster;		/* is this connection to/from a postmaster instance */
 	uint32		my_id;				/* unique identifier issued to us by GTM */
+	int			shared_memory;		/* talk to a local proxy through shared
+									 * memory if it can */
 
 	/* Optional file to write trace info to */
 	FILE		*Pfdebug;
@@ -93,6 +96,21 @@ struct gtm_conn
 
 	/* Pointer to the result of last operation */
 	GTM_Result	*result;
+
+	/*
+	 * If set, outgoing data is handed to this routine instead of being
+	 * written to a socket.  See GTMPQcreateBufferedConn().
+	 */
+	GTMPQsendHook	sendHook;
+
+	/*
+	 * Once the proxy attached a slot of its segment to this connection,
+	 * messages go through the rings of the slot.  The socket only wakes up
+	 * the proxy and tells when it goes away.
+	 */
+	GTM_Shmq		*shmq;
+	GTM_ShmqSlot	*shm_slot;
+	int				shm_slotno;
 };
 
 /* === in fe-misc.c === */
@@ -115,6 +133,7 @@ extern int	gtmpqGetInt(int *result, size_t bytes, GTM_Conn *conn);
 extern int	gtmpqPutInt(int value, size_t bytes, GTM_Conn *conn);
 extern int	gtmpqPutMsgStart(char msg_type, bool force_len, GTM_Conn *conn);
 extern int	gtmpqPutMsgEnd(GTM_Conn *conn);
+extern int	gtmpqPutRaw(const char *buf, size_t len, GTM_Conn *conn);
 extern int	gtmpqReadData(GTM_Conn *conn);
 extern int	gtmpqFlush(GTM_Conn *conn);
 extern int	gtmpqWait(int forRead, int forWrite, GTM_Conn *conn);
@@ -42,6 +42,7 @@ extern int	pq_getbyte(Port *myport);
 extern int	pq_peekbyte(Port *myport);
 extern int	pq_putbytes(Port *myport, const char *s, size_t len);
 extern int	pq_flush(Port *myport);
+extern bool	pq_peerclosed(Port *myport);
 extern int	pq_putmessage(Port *myport, char msgtype, const char *s, size_t len);
 
 #endif   /* LIBPQ_H */
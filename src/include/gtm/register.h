@@ -103,7 +103,7 @@ void Recovery_PGXCNodeDisconnect(Port *myport);
 void Recovery_SaveRegisterFileName(char *dir);
 int Recovery_PGXCNodeRegisterCoordProcess(char *coord_node, int coord_procid,
 								      int coord_backendid);
-void ProcessPGXCRegisterSession(Port *myport, StringInfo message);
+void ProcessPGXCRegisterSession(Port *myport, StringInfo message, bool is_backup);
 
 void ProcessPGXCNodeRegister(Port *myport, StringInfo message, bool is_backup);
 void ProcessPGXCNodeUnregister(Port *myport, StringInfo message, bool is_backup);
@@ -372,6 +372,7 @@ typedef enum NodeTag
 #ifdef PGXC
 	T_BarrierStmt,
 	T_PauseClusterStmt,
+	T_RebalanceStmt,
 #endif
 	T_CreateSchemaStmt,
 	T_AlterDatabaseStmt,
@@ -2829,6 +2829,18 @@ typedef struct PauseClusterStmt
 	bool		pause;			/* will be false to unpause */
 } PauseClusterStmt;
 
+/*
+ * ----------------------
+ *      Rebalance Statement
+ */
+typedef struct RebalanceStmt
+{
+	NodeTag		type;
+	PGXCSubCluster *source;		/* nodes of the tables to move */
+	PGXCSubCluster *target;		/* nodes to move them to, NULL for all */
+	List	   *options;		/* list of DefElem nodes */
+} RebalanceStmt;
+
 /*
  * ----------------------
  *      Barrier Statement
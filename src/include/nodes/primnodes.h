@@ -1390,7 +1390,9 @@ typedef enum DistributionType
 	DISTTYPE_REPLICATION,			/* Replicated */
 	DISTTYPE_HASH,				/* Hash partitioned */
 	DISTTYPE_ROUNDROBIN,			/* Round Robin */
-	DISTTYPE_MODULO				/* Modulo partitioned */
+	DISTTYPE_MODULO,			/* Modulo partitioned */
+	DISTTYPE_RANGE,				/* Range partitioned */
+	DISTTYPE_LIST				/* List partitioned */
 } DistributionType;
 
 /*----------
@@ -1403,6 +1405,10 @@ typedef struct DistributeBy
 	NodeTag		type;
 	DistributionType disttype;		/* Distribution type */
 	char	   	*colname;		/* Distribution column name */
+	List		*colnames;		/* All distribution column names, NIL if
+								 * the key is colname alone */
+	List		*values;		/* RANGE or LIST: DefElem naming each node,
+								 * with its lower bound or list of values */
 } DistributeBy;
 
 /*----------
@@ -38,6 +38,7 @@ extern void transformRuleStmt(RuleStmt *stmt, const char *queryString,
 extern List *transformCreateSchemaStmt(CreateSchemaStmt *stmt);
 #ifdef PGXC
 extern bool CheckLocalIndexColumn (char loctype, char *partcolname, char *indexcolname);
+extern bool CheckLocalIndexColumns(List *partcolnames, List *indexcolnames);
 #endif
 
 #endif   /* PARSE_UTILCMD_H */
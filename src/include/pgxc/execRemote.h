@@ -177,6 +177,9 @@ typedef struct RemoteSubplanState
 	char	   *subplanstr;				/* subplan encoded as a string */
 	bool		bound;					/* subplan is sent down to the nodes */
 	bool		local_exec; 			/* execute subplan on this datanode */
+	bool		conflict_free;			/* replicated write may be sent to all
+										 * nodes at once, see
+										 * replicated_write_conflict_free() */
 	Locator    *locator;				/* determine destination of tuples of
 										 * locally executed plan */
 	int 	   *dest_nodes;				/* allocate once */
@@ -17,6 +17,7 @@
 #define LOCATOR_TYPE_REPLICATED 'R'
 #define LOCATOR_TYPE_HASH 'H'
 #define LOCATOR_TYPE_RANGE 'G'
+#define LOCATOR_TYPE_LIST 'L'
 #define LOCATOR_TYPE_SINGLE 'S'
 #define LOCATOR_TYPE_RROBIN 'N'
 #define LOCATOR_TYPE_CUSTOM 'C'
@@ -29,19 +30,27 @@
 /* Maximum number of preferred Datanodes that can be defined in cluster */
 #define MAX_PREFERRED_NODES 64
 
+/* Number of buckets values of hash distributed tables are hashed into */
 #define HASH_SIZE 4096
-#define HASH_MASK 0x00000FFF;
+#define HASH_MASK 0x00000FFF
 
 #define IsLocatorNone(x) (x == LOCATOR_TYPE_NONE)
 #define IsLocatorReplicated(x) (x == LOCATOR_TYPE_REPLICATED)
 #define IsLocatorColumnDistributed(x) (x == LOCATOR_TYPE_HASH || \
 									   x == LOCATOR_TYPE_RROBIN || \
 									   x == LOCATOR_TYPE_MODULO || \
+									   x == LOCATOR_TYPE_RANGE || \
+									   x == LOCATOR_TYPE_LIST || \
 									   x == LOCATOR_TYPE_DISTRIBUTED)
 #define IsLocatorDistributedByValue(x) (x == LOCATOR_TYPE_HASH || \
 										x == LOCATOR_TYPE_MODULO || \
-										x == LOCATOR_TYPE_RANGE)
+										x == LOCATOR_TYPE_RANGE || \
+										x == LOCATOR_TYPE_LIST)
+/* Distributed by comparing the key with bounds or values given by the user */
+#define IsLocatorBoundDistributed(x) (x == LOCATOR_TYPE_RANGE || \
+									  x == LOCATOR_TYPE_LIST)
 
+#include "access/tupdesc.h"
 #include "nodes/primnodes.h"
 #include "utils/relcache.h"
 
@@ -62,15 +71,50 @@ typedef struct
 {
 	Oid		relid;
 	char		locatorType;
-	PartAttrNumber	partAttrNum;	/* if partitioned */
+	PartAttrNumber	partAttrNum;	/* if partitioned, first key column */
 	char		*partAttrName;		/* if partitioned */
+	List		*partAttrNums;		/* if partitioned, all key columns */
 	List		*nodeList;			/* Node Indices */
 	ListCell	*roundRobinNode;	/* index of the next one to use */
+	/*
+	 * RANGE: the nbounds sorted lower bounds of all the ranges but the
+	 * lowest one, boundNodes giving the node index of each of the
+	 * nbounds + 1 ranges, lowest first.  LIST: the nbounds sorted values,
+	 * boundNodes giving the node index of each.  nullNode is the node index
+	 * of NULL keys, -1 if a LIST does not accept them.  Bounds are of the
+	 * base type of the key column and compared in its collation.
+	 */
+	int			nbounds;
+	Datum	   *bounds;
+	int		   *boundNodes;
+	int			nullNode;
+	Oid			boundType;
+	Oid			boundCollation;
+	/*
+	 * Fraction of the rows having the most common value of a single column
+	 * distribution key, as of the last ANALYZE, 0 if unknown.
+	 */
+	float4		hotKeyFrac;
 } RelationLocInfo;
 
 #define IsRelationReplicated(rel_loc)			IsLocatorReplicated((rel_loc)->locatorType)
 #define IsRelationColumnDistributed(rel_loc) 	IsLocatorColumnDistributed((rel_loc)->locatorType)
 #define IsRelationDistributedByValue(rel_loc)	IsLocatorDistributedByValue((rel_loc)->locatorType)
+#define IsRelationBoundDistributed(rel_loc)		IsLocatorBoundDistributed((rel_loc)->locatorType)
+/*
+ * The distribution key of a table distributed by several columns is the int4
+ * pgxc_distkey_hash() of these columns, placed like an int4 key would be.
+ */
+#define IsRelationMultiColumnDistributed(rel_loc) \
+	(list_length((rel_loc)->partAttrNums) > 1)
+/*
+ * The planner places rows of a table distributed by RANGE or LIST as it would
+ * place rows of a MODULO distributed table by the int4 pgxc_distkey_node() of
+ * their key: the position of their node among the nodes of the table.
+ */
+#define PlannerLocatorType(rel_loc) \
+	(IsRelationBoundDistributed(rel_loc) ? LOCATOR_TYPE_MODULO : \
+	 (rel_loc)->locatorType)
 /*
  * Nodes to execute on
  * primarynodelist is for replicated table writes, where to execute first.
@@ -135,16 +179,35 @@ typedef struct _Locator Locator;
  *	primary - set to true if caller ever wants to determine primary node.
  *            Primary node will be returned as the first element of the
  *			  result array
+ *
+ * A HASH locator needs to know which Datanodes are in nodeList, because they
+ * determine where each hash bucket is stored.  Integers of nodeList are taken
+ * as Datanode indexes and pointers as Datanode connection handles, unless
+ * createLocatorExtended is given the list of Datanode indexes as nodeIds.
  */
 extern Locator *createLocator(char locatorType, RelationAccessType accessType,
 			  Oid dataType, LocatorListType listType, int nodeCount,
 			  void *nodeList, void **result, bool primary);
+extern Locator *createLocatorExtended(char locatorType,
+			  RelationAccessType accessType, Oid dataType,
+			  LocatorListType listType, int nodeCount, void *nodeList,
+			  List *nodeIds, void **result, bool primary);
+extern Locator *createRelationLocator(RelationLocInfo *locInfo,
+					  RelationAccessType accessType, LocatorListType listType,
+					  int nodeCount, void *nodeList, void **result,
+					  bool primary);
+extern Locator *RelationGetLocator(Relation rel,
+				   RelationAccessType accessType);
 extern void freeLocator(Locator *locator);
 
 extern int GET_NODES(Locator *self, Datum value, bool isnull, bool *hasprimary);
+extern void GET_NODES_BATCH(Locator *self, Datum *values, bool *nulls,
+				int count, int *indexes);
+extern bool isLocatorSingleNode(Locator *self);
 extern void *getLocatorResults(Locator *self);
 extern void *getLocatorNodeMap(Locator *self);
 extern int getLocatorNodeCount(Locator *self);
+extern int16 *GetHashBucketMap(List *nodeList);
 
 /* Extern variables related to locations */
 extern Oid primary_data_node;
@@ -161,6 +224,8 @@ extern RelationLocInfo *CopyRelationLocInfo(RelationLocInfo *src_info);
 extern char GetRelationLocType(Oid relid);
 extern bool IsTableDistOnPrimary(RelationLocInfo *rel_loc_info);
 extern bool IsLocatorInfoEqual(RelationLocInfo *rel_loc_info1, RelationLocInfo *rel_loc_info2);
+extern bool IsLocatorInfoIdentical(RelationLocInfo *rel_loc_info1,
+					   RelationLocInfo *rel_loc_info2);
 extern bool IsHashColumn(RelationLocInfo *rel_loc_info, char *part_col_name);
 extern bool IsHashColumnForRelId(Oid relid, char *part_col_name);
 extern int	GetRoundRobinNode(Oid relid);
@@ -168,6 +233,10 @@ extern ExecNodes *GetRelationNodes(RelationLocInfo *rel_loc_info,
 								   Datum valueForDistCol,
 								   bool isValueNull,
 								   RelationAccessType accessType);
+extern ExecNodes *GetRelationNodesForRelation(Relation rel,
+								   Datum valueForDistCol,
+								   bool isValueNull,
+								   RelationAccessType accessType);
 extern ExecNodes *GetRelationNodesByQuals(Oid reloid,
 										  Index varno,
 										  Node *quals,
@@ -178,6 +247,8 @@ extern List *GetAllDataNodes(void);
 extern List *GetAllCoordNodes(void);
 extern int GetAnyDataNode(Bitmapset *nodes);
 extern void RelationBuildLocator(Relation rel);
+extern void BuildRelationLocBounds(RelationLocInfo *locInfo, TupleDesc tupdesc,
+					   Datum pcvalues, bool isnull);
 extern void FreeRelationLocInfo(RelationLocInfo *relationLocInfo);
 
 extern bool IsTypeModuloDistributable(Oid col_type);
@@ -189,5 +260,19 @@ extern bool IsDistColumnForRelId(Oid relid, char *part_col_name);
 extern void FreeExecNodes(ExecNodes **exec_nodes);
 extern List *GetPreferredReplicationNode(List *relNodes);
 extern char *GetRelationDistribColumn(RelationLocInfo *locInfo);
+extern List *GetRelationDistribColumns(RelationLocInfo *locInfo);
+extern Oid GetRelationDistribKeyType(RelationLocInfo *locInfo);
+extern Datum GetRelationDistribKeyValue(RelationLocInfo *locInfo,
+						   TupleDesc tupdesc, Datum *values, bool *nulls,
+						   bool *isnull);
+extern Expr *makeDistribKeyExpr(List *args);
+extern bool IsDistribKeyExpr(Node *node);
+extern Expr *makeBoundKeyExpr(RelationLocInfo *locInfo, Expr *key);
+extern bool IsBoundKeyExpr(Node *node);
+extern Bitmapset *GetBoundKeyRanks(Node *keyExpr, List *quals);
+extern bool IsTypeBoundDistributable(Oid col_type);
+extern List *GetRelationDistribValues(RelationLocInfo *locInfo);
+extern int32 compute_distkey_hash(int nkeys, Oid *types, Datum *values,
+					 bool *nulls);
 
 #endif   /* LOCATOR_H */
@@ -15,6 +15,7 @@
 #define NODEMGR_H
 
 #include "nodes/parsenodes.h"
+#include "port/atomics.h"
 
 #define PGXC_NODENAME_LENGTH	64
 
@@ -36,6 +37,19 @@ typedef struct
 	bool 		nodeispreferred;
 } NodeDefinition;
 
+/*
+ * Load of a Datanode as seen by the backends of this Coordinator: requests
+ * sent to it not answered yet, and moving average of the response time of
+ * the answered ones, in microseconds.  Shared memory slots are assigned to
+ * the Datanodes by their Oid when the node tables are updated.
+ */
+typedef struct NodeLoad
+{
+	Oid					nodeoid;
+	pg_atomic_uint32	inflight;
+	pg_atomic_uint32	latency;
+} NodeLoad;
+
 extern void NodeTablesShmemInit(void);
 extern Size NodeTablesShmemSize(void);
 
@@ -44,6 +58,7 @@ extern void PgxcNodeGetOids(Oid **coOids, Oid **dnOids,
 							int *num_coords, int *num_dns,
 							bool update_preferred);
 extern NodeDefinition *PgxcNodeGetDefinition(Oid node);
+extern NodeLoad *PgxcNodeGetLoad(Oid node);
 extern void PgxcNodeAlter(AlterNodeStmt *stmt);
 extern void PgxcNodeCreate(CreateNodeStmt *stmt);
 extern void PgxcNodeRemove(DropNodeStmt *stmt);
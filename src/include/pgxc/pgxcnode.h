@@ -25,6 +25,7 @@
 #include "utils/timestamp.h"
 #include "nodes/pg_list.h"
 #include "utils/snapshot.h"
+#include "portability/instr_time.h"
 #include <unistd.h>
 
 #define NO_SOCKET -1
@@ -91,6 +92,15 @@ struct pgxc_node_handle
 	 * For details see comments of RESP_ROLLBACK
 	 */
 	bool		ck_resp_rollback;
+
+	/*
+	 * Load of the Datanode in shared memory, NULL for Coordinators.  A
+	 * request is counted there from the time it is sent until the node is
+	 * ready for the next one.
+	 */
+	struct NodeLoad *load;
+	bool		load_counted;
+	instr_time	request_start;
 };
 typedef struct pgxc_node_handle PGXCNodeHandle;
 
@@ -121,6 +131,7 @@ extern PGXCNodeHandle *get_any_handle(List *datanodelist);
 extern int PGXCNodeGetNodeId(Oid nodeoid, char *node_type);
 extern int PGXCNodeGetNodeIdFromName(char *node_name, char *node_type);
 extern Oid PGXCNodeGetNodeOid(int nodeid, char node_type);
+extern struct NodeLoad *PGXCNodeGetLoad(int nodeid);
 
 extern PGXCNodeAllHandles *get_handles(List *datanodelist, List *coordlist, bool is_query_coord_only, bool is_global_session);
 
@@ -171,6 +182,7 @@ extern int	pgxc_node_is_data_enqueued(PGXCNodeHandle *conn);
 
 extern int	send_some(PGXCNodeHandle * handle, int len);
 extern int	pgxc_node_flush(PGXCNodeHandle *handle);
+extern void pgxc_node_request_done(PGXCNodeHandle *handle, bool answered);
 extern void	pgxc_node_flush_read(PGXCNodeHandle *handle);
 
 extern char get_message(PGXCNodeHandle *conn, int *len, char **msg);
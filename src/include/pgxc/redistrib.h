@@ -15,6 +15,7 @@
 #ifndef REDISTRIB_H
 #define REDISTRIB_H
 
+#include "nodes/bitmapset.h"
 #include "nodes/parsenodes.h"
 #include "utils/tuplestore.h"
 
@@ -29,7 +30,8 @@ typedef enum RedistribOperation {
 	DISTRIB_COPY_TO,	/* Perform a COPY TO */
 	DISTRIB_COPY_FROM,	/* Perform a COPY FROM */
 	DISTRIB_TRUNCATE,	/* Truncate relation */
-	DISTRIB_REINDEX		/* Reindex relation */
+	DISTRIB_REINDEX,	/* Reindex relation */
+	DISTRIB_MOVE		/* Move rows between Datanodes */
 } RedistribOperation;
 
 /*
@@ -65,6 +67,8 @@ typedef struct RedistribState {
 	Oid			relid;			/* Oid of relation redistributed */
 	List	   *commands;		/* List of commands */
 	Tuplestorestate *store;		/* Tuple store used for temporary data storage */
+	Bitmapset  *buckets;		/* Hash buckets changing of node, NULL if all
+								 * the data is redistributed */
 } RedistribState;
 
 extern void PGXCRedistribTable(RedistribState *distribState, RedistribCatalog type);
@@ -76,5 +80,10 @@ extern RedistribCommand *makeRedistribCommand(RedistribOperation type,
 extern RedistribState *makeRedistribState(Oid relOid);
 extern void FreeRedistribState(RedistribState *state);
 extern void FreeRedistribCommand(RedistribCommand *command);
+extern RelationLocInfo *GetRedistribSourceLocInfo(Oid relid);
+
+extern void PGXCRebalance(RebalanceStmt *stmt, bool isTopLevel);
+extern Size RebalanceShmemSize(void);
+extern void RebalanceShmemInit(void);
 
 #endif  /* REDISTRIB_H */
@@ -57,6 +57,7 @@ typedef struct RemoteCopyOptions {
 	char	   *rco_escape;			/* CSV escape char (must be 1 byte) */
 	List	   *rco_force_quote;	/* list of column names */
 	List	   *rco_force_notnull;	/* list of column names */
+	char	   *rco_where;			/* COPY TO: only copy rows verifying this */
 } RemoteCopyOptions;
 
 extern void RemoteCopy_BuildStatement(RemoteCopyData *state,
@@ -1313,6 +1313,16 @@ extern Datum stormdb_promote_standby(PG_FUNCTION_ARGS);
 
 /* backend/access/transam/transam.c */
 extern Datum pgxc_is_committed(PG_FUNCTION_ARGS);
+
+/* backend/access/transam/gtm.c */
+extern Datum pgxc_gtm_stats(PG_FUNCTION_ARGS);
+
+/* backend/pgxc/locator/locator.c */
+extern Datum pgxc_distkey_hash(PG_FUNCTION_ARGS);
+extern Datum pgxc_distkey_node(PG_FUNCTION_ARGS);
+
+/* backend/pgxc/locator/redistrib.c */
+extern Datum pgxc_stat_get_rebalance(PG_FUNCTION_ARGS);
 #endif
 
 #endif   /* BUILTINS_H */
@@ -198,6 +198,13 @@ typedef struct RelationData
 	struct PgStat_TableStatus *pgstat_info;		/* statistics collection area */
 #ifdef PGXC
 	RelationLocInfo *rd_locator_info;
+	/*
+	 * Locators of the rows of the relation by access type, built from
+	 * rd_locator_info in rd_locatorcxt when first needed, see
+	 * RelationGetLocator.
+	 */
+	MemoryContext rd_locatorcxt;
+	Locator    *rd_locators[RELATION_ACCESS_INSERT + 1];
 #endif
 } RelationData;
 
@@ -220,3 +220,39 @@ drop table tt_33;
 
 drop table cc_11;
 drop table tt_11;
+
+-- GTM latency statistics
+SELECT count(*) > 0 AS has_messages FROM pgxc_gtm_stats() WHERE kind = 'message';
+SELECT name FROM pgxc_gtm_stats() WHERE kind <> 'message' ORDER BY name;
+
+-- A plain INSERT into a replicated table without unique indexes or triggers
+-- is sent to all the nodes at once, and must land on every node
+CREATE TABLE xl_rep_pipe (a int, b text) DISTRIBUTE BY REPLICATION;
+INSERT INTO xl_rep_pipe VALUES (1, 'one');
+INSERT INTO xl_rep_pipe SELECT i, 'many' FROM generate_series(2, 100) i;
+EXECUTE DIRECT ON (datanode_1) 'SELECT count(*), sum(a) FROM xl_rep_pipe';
+EXECUTE DIRECT ON (datanode_2) 'SELECT count(*), sum(a) FROM xl_rep_pipe';
+DROP TABLE xl_rep_pipe;
+-- Reads of a replicated table go to one node chosen when planning, so a
+-- cached plan keeps reading from the same node
+CREATE TABLE xl_rep_read (a int) DISTRIBUTE BY REPLICATION;
+INSERT INTO xl_rep_read VALUES (1);
+CREATE FUNCTION xl_rep_read_nodes() RETURNS bigint AS $$
+DECLARE
+	node int;
+	nodes int[] := '{}';
+BEGIN
+	FOR i IN 1..10 LOOP
+		SELECT xc_node_id INTO node FROM xl_rep_read;
+		nodes := nodes || node;
+	END LOOP;
+	RETURN (SELECT count(DISTINCT n) FROM unnest(nodes) n);
+END;
+$$ LANGUAGE plpgsql;
+SELECT xl_rep_read_nodes();
+PREPARE xl_rep_read_q AS SELECT count(*) FROM xl_rep_read;
+EXECUTE xl_rep_read_q;
+EXECUTE xl_rep_read_q;
+DEALLOCATE xl_rep_read_q;
+DROP FUNCTION xl_rep_read_nodes();
+DROP TABLE xl_rep_read;
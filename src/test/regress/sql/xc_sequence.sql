@@ -84,3 +84,19 @@ COMMIT;
 CREATE SEQUENCE xc_sequence_tab1_col2_seq START 2344;
 SELECT nextval('xc_sequence_tab1_col2_seq'); -- ok
 DROP SEQUENCE xc_sequence_tab1_col2_seq;
+-- Without sequence_range, GTM hands out one value per call, CACHE 1 or not
+CREATE SEQUENCE xc_sequence_range1 CACHE 1;
+CREATE SEQUENCE xc_sequence_range2;
+SELECT max(nextval('xc_sequence_range1')) FROM generate_series(1, 100);
+SELECT max(nextval('xc_sequence_range2')) FROM generate_series(1, 100);
+DISCARD SEQUENCES;
+SELECT nextval('xc_sequence_range1'); -- no values lost
+SELECT nextval('xc_sequence_range2'); -- no values lost
+-- With sequence_range set, the range grows and unused values are lost
+SET sequence_range = 1000;
+SELECT max(nextval('xc_sequence_range2')) FROM generate_series(1, 100);
+DISCARD SEQUENCES;
+SELECT nextval('xc_sequence_range2') > 202 AS lost;
+RESET sequence_range;
+DROP SEQUENCE xc_sequence_range1;
+DROP SEQUENCE xc_sequence_range2;
@@ -182,3 +182,58 @@ DROP TABLE xl_at2h;
 DROP TABLE xl_at3h;
 DROP TABLE xl_at2m;
 DROP TABLE xl_at3m;
+
+-- Hash distributed table changing of nodes, rows have to stay co-located
+CREATE TABLE xl_atbucket (a int, b text) DISTRIBUTE BY HASH(a) TO NODE (datanode_1);
+CREATE TABLE xl_atbucket2 (a int) DISTRIBUTE BY HASH(a) TO NODE (datanode_1, datanode_2);
+INSERT INTO xl_atbucket SELECT g, 'row ' || g FROM generate_series(1, 1000) g;
+INSERT INTO xl_atbucket VALUES (NULL, 'null row');
+INSERT INTO xl_atbucket2 SELECT generate_series(1, 1000);
+ALTER TABLE xl_atbucket ADD NODE (datanode_2);
+SELECT count(*) FROM xl_atbucket;
+SELECT count(*) FROM xl_atbucket JOIN xl_atbucket2 USING (a);
+SELECT b FROM xl_atbucket WHERE a = 500;
+SELECT b FROM xl_atbucket WHERE a IS NULL;
+ALTER TABLE xl_atbucket DELETE NODE (datanode_1);
+ALTER TABLE xl_atbucket2 DELETE NODE (datanode_1);
+SELECT count(*) FROM xl_atbucket;
+SELECT count(*) FROM xl_atbucket JOIN xl_atbucket2 USING (a);
+SELECT b FROM xl_atbucket WHERE a IS NULL;
+DROP TABLE xl_atbucket;
+DROP TABLE xl_atbucket2;
+
+-- Rows are not moved through the rules of a table
+CREATE TABLE xl_atrule (a int) DISTRIBUTE BY HASH(a) TO NODE (datanode_1);
+CREATE RULE xl_atrule_ins AS ON INSERT TO xl_atrule DO ALSO NOTHING;
+ALTER TABLE xl_atrule ADD NODE (datanode_2);
+DROP RULE xl_atrule_ins ON xl_atrule;
+ALTER TABLE xl_atrule ADD NODE (datanode_2);
+DROP TABLE xl_atrule;
+
+-- REBALANCE of a set of nodes to itself has nothing to move
+REBALANCE FROM NODE (datanode_1) TO NODE (datanode_1);
+REBALANCE FROM NODE (datanode_1) TO NODE (datanode_2) WITH (speed = 1);
+REBALANCE FROM NODE (datanode_1) TO NODE (datanode_2) WITH (delay = -1);
+BEGIN;
+REBALANCE FROM NODE (datanode_1) TO NODE (datanode_2);
+ROLLBACK;
+
+-- REBALANCE of a hash table to more nodes, in a database of its own so that
+-- no table of the other tests is moved
+CREATE DATABASE xl_rebalance;
+\c xl_rebalance
+CREATE TABLE xl_rb1 (a int, b text) DISTRIBUTE BY HASH(a) TO NODE (datanode_1);
+CREATE TABLE xl_rb2 (a int) DISTRIBUTE BY HASH(a) TO NODE (datanode_1);
+INSERT INTO xl_rb1 SELECT g, 'row ' || g FROM generate_series(1, 1000) g;
+INSERT INTO xl_rb2 SELECT generate_series(1, 1000);
+REBALANCE FROM NODE (datanode_1) TO NODE (datanode_1, datanode_2);
+EXECUTE DIRECT ON (datanode_1) 'SELECT count(*) FROM xl_rb1';
+EXECUTE DIRECT ON (datanode_2) 'SELECT count(*) FROM xl_rb1';
+-- Every row still finds its match on its own node
+EXECUTE DIRECT ON (datanode_1) 'SELECT count(*) FROM xl_rb1 JOIN xl_rb2 USING (a)';
+EXECUTE DIRECT ON (datanode_2) 'SELECT count(*) FROM xl_rb1 JOIN xl_rb2 USING (a)';
+SELECT count(*) FROM xl_rb1 JOIN xl_rb2 USING (a);
+SELECT b FROM xl_rb1 WHERE a = 1;
+REBALANCE FROM NODE (datanode_1) TO NODE (datanode_1, datanode_2);
+\c regression
+DROP DATABASE xl_rebalance;
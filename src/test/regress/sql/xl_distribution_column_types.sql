@@ -226,6 +226,69 @@ INSERT INTO xl_dc_weather VALUES ('San Francisco', 46, 50, 0.25, '1994-11-27');
 UPDATE xl_dc_weather SET city = 'SFO' where temp_lo=46 and temp_hi=50; -- fail
 
 
+-- Distribution key of several columns
+CREATE TABLE xl_dc_multi (a int, b text, c int) DISTRIBUTE BY HASH (a, b);
+INSERT INTO xl_dc_multi VALUES (1, 'one', 1), (2, 'two', 2), (3, NULL, 3);
+SELECT * FROM xl_dc_multi WHERE a = 2 AND b = 'two';
+SELECT * FROM xl_dc_multi WHERE b IS NULL;
+SELECT * FROM xl_dc_multi ORDER BY a;
+UPDATE xl_dc_multi SET c = 20 WHERE a = 2 AND b = 'two';
+UPDATE xl_dc_multi SET b = 'deux' WHERE a = 2; -- fail
+DELETE FROM xl_dc_multi WHERE a = 1 AND b = 'one';
+SELECT * FROM xl_dc_multi ORDER BY a;
+CREATE UNIQUE INDEX xl_dc_multi_a ON xl_dc_multi (a); -- fail
+CREATE UNIQUE INDEX xl_dc_multi_ba ON xl_dc_multi (b, a);
+SELECT pgxc_distkey_hash(2, 'two'::text) = pgxc_distkey_hash(2, 'two'::text);
+CREATE TABLE xl_dc_multi2 (a int, b int) DISTRIBUTE BY MODULO (a, b);
+CREATE TABLE xl_dc_multi2 (a int, b int) DISTRIBUTE BY HASH (a, a);
+-- Distribution by range or list of values
+CREATE TABLE xl_dc_range (a int, b text) DISTRIBUTE BY RANGE (a) VALUES (datanode_1, datanode_2 FROM 100);
+INSERT INTO xl_dc_range VALUES (1, 'one'), (100, 'hundred'), (NULL, 'null'), (-5, 'minus');
+SELECT * FROM xl_dc_range WHERE a >= 100;
+SELECT * FROM xl_dc_range WHERE a < 100 ORDER BY a;
+SELECT * FROM xl_dc_range WHERE a IS NULL;
+UPDATE xl_dc_range SET b = 'un' WHERE a = 1;
+DELETE FROM xl_dc_range WHERE a BETWEEN 50 AND 150;
+SELECT * FROM xl_dc_range ORDER BY a;
+CREATE TABLE xl_dc_list (a text, b int) DISTRIBUTE BY LIST (a) VALUES (datanode_1 IN ('red', 'green'), datanode_2 IN ('blue', NULL));
+INSERT INTO xl_dc_list VALUES ('red', 1), ('blue', 2), (NULL, 3), ('green', 4);
+INSERT INTO xl_dc_list VALUES ('yellow', 5); -- fail
+SELECT * FROM xl_dc_list WHERE a IN ('red', 'blue') ORDER BY b;
+SELECT * FROM xl_dc_list WHERE a IS NULL;
+SELECT * FROM xl_dc_list ORDER BY b;
+-- Scans only go to the nodes of the values their quals can select
+EXPLAIN (COSTS OFF, NODES) SELECT * FROM xl_dc_range WHERE a >= 100;
+EXPLAIN (COSTS OFF, NODES) SELECT * FROM xl_dc_range WHERE a < 100;
+EXPLAIN (COSTS OFF, NODES) SELECT * FROM xl_dc_range WHERE a IS NULL;
+EXPLAIN (COSTS OFF, NODES) SELECT * FROM xl_dc_range WHERE a IN (5, 500);
+EXPLAIN (COSTS OFF, NODES) SELECT * FROM xl_dc_list WHERE a = 'blue';
+EXPLAIN (COSTS OFF, NODES) SELECT * FROM xl_dc_list WHERE a IN ('red', 'green');
+EXPLAIN (COSTS OFF, NODES) SELECT * FROM xl_dc_list WHERE a IS NULL;
+-- COPY sends each row to the node of its value
+COPY xl_dc_range FROM stdin;
+150	copied
+99	below
+\.
+COPY xl_dc_list FROM stdin;
+green	6
+blue	7
+\.
+EXECUTE DIRECT ON (datanode_1) 'SELECT * FROM xl_dc_range ORDER BY a';
+EXECUTE DIRECT ON (datanode_2) 'SELECT * FROM xl_dc_range ORDER BY a';
+EXECUTE DIRECT ON (datanode_1) 'SELECT * FROM xl_dc_list ORDER BY b';
+EXECUTE DIRECT ON (datanode_2) 'SELECT * FROM xl_dc_list ORDER BY b';
+-- Nodes only change with the values they store
+CREATE TABLE xl_dc_list3 (a int) DISTRIBUTE BY LIST (a) VALUES (datanode_1 IN (1, 2));
+ALTER TABLE xl_dc_list3 ADD NODE (datanode_2); -- fail
+ALTER TABLE xl_dc_range DELETE NODE (datanode_2); -- fail
+ALTER TABLE xl_dc_list TO NODE (datanode_1); -- fail
+DROP TABLE xl_dc_list3;
+CREATE TABLE xl_dc_range2 (a int) DISTRIBUTE BY RANGE (a) VALUES (datanode_1 FROM 1, datanode_2 FROM 10); -- fail
+CREATE TABLE xl_dc_list2 (a int) DISTRIBUTE BY LIST (a) VALUES (datanode_1 IN (1, 2), datanode_2 IN (2)); -- fail
+CREATE TABLE xl_dc_list2 (a int) DISTRIBUTE BY LIST (a); -- fail
+DROP TABLE xl_dc_range;
+DROP TABLE xl_dc_list;
+DROP TABLE xl_dc_multi;
 DROP TABLE xl_dc;
 DROP TABLE xl_dc1;
 DROP TABLE xl_dc2;
@@ -72,3 +72,26 @@ EXPLAIN VERBOSE DELETE FROM xl_ppm where a=200::INT2;
 
 DROP TABLE xl_pp;
 DROP TABLE xl_ppm;
+
+-- ANALYZE collects the rows of each node and the most common values of the
+-- distribution column over all the nodes
+CREATE TABLE xl_hot (k int, v int) DISTRIBUTE BY HASH(k);
+INSERT INTO xl_hot SELECT 1, i FROM generate_series(1, 900) i;
+INSERT INTO xl_hot SELECT i, i FROM generate_series(1001, 1100) i;
+ANALYZE xl_hot;
+SELECT nodename, n_tup, most_common_vals,
+       ARRAY(SELECT round(f::numeric, 2) FROM unnest(most_common_freqs) f) AS most_common_freqs
+  FROM pgxc_stat_distribution WHERE relname = 'xl_hot' ORDER BY nodename;
+DROP TABLE xl_hot;
+
+-- Redistributing xl_skew by b would send all its rows to one node, so the
+-- join leaves it in place and broadcasts xl_skew_dim instead
+CREATE TABLE xl_skew (a int, b int) DISTRIBUTE BY HASH(a);
+CREATE TABLE xl_skew_dim (b int, c int) DISTRIBUTE BY HASH(b);
+INSERT INTO xl_skew SELECT i, 1 FROM generate_series(1, 1000) i;
+INSERT INTO xl_skew_dim SELECT i, i FROM generate_series(1, 500) i;
+ANALYZE xl_skew;
+ANALYZE xl_skew_dim;
+EXPLAIN (costs off) SELECT * FROM xl_skew s JOIN xl_skew_dim d ON s.b = d.b;
+DROP TABLE xl_skew;
+DROP TABLE xl_skew_dim;